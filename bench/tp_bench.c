@@ -0,0 +1,929 @@
+/* TatuPlot - microbenchmarks (lexer, parser, eval, render headless)
+   Saída: JSON com mediana/p99 por benchmark.
+   Uso: make bench [BENCH_ARGS='--quick --out bench.json'] */
+
+/* sockets Unix dos benches de stream e daemon não fazem parte do C99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "tp_token.h"
+#include "tp_parser.h"
+#include "tp_ast.h"
+#include "tp_prog.h"
+#include "tp_view.h"
+#include "tp_render.h"
+#include "tp_plot.h"
+#include "tp_cache.h"
+#include "tp_deriv.h"
+#include "tp_analysis.h"
+#include "tp_stream.h"
+#include "tp_tile.h"
+#include "tp_daemon.h"
+#include "tp_frame.h"
+#include "tatuplot.h"
+#include "tp_screenshot.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* galeria do README + alguns casos típicos */
+static const char *corpus[] = {
+    "\\left(16\\sin^{3}(x),\\;13\\cos(x)-5\\cos(2x)-2\\cos(3x)-\\cos(4x)\\right)",
+    "(\\sin(3x),\\sin(2x))",
+    "(x\\cos(x),x\\sin(x))",
+    "(\\cos(4x)\\cos(x),\\cos(4x)\\sin(x))",
+    "\\frac{\\sin(x)}{x}",
+    "e^{-\\frac{x^2}{2}}",
+    "\\tan(x)",
+    "\\sin(x)",
+    "x^3-2x^2+x-7",
+    "\\sqrt{x^2+1}\\log(x^2+2)-\\exp(-x)",
+    "\\frac{x^4-3x^2+2}{x^2+1}",
+    "\\sin(x)\\cos(y)",
+    NULL
+};
+
+typedef struct Stats {
+    double median;
+    double p99;
+    double mean;
+    int reps;
+} Stats;
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static Stats stats_of(double *v, int n) {
+    Stats s;
+    qsort(v, (size_t)n, sizeof(double), cmp_double);
+    s.median = v[n / 2];
+    int i99 = (int)ceil(0.99 * (double)n) - 1;
+    if (i99 < 0) i99 = 0;
+    if (i99 > n - 1) i99 = n - 1;
+    s.p99 = v[i99];
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) sum += v[i];
+    s.mean = sum / (double)n;
+    s.reps = n;
+    return s;
+}
+
+static double now_ns(void) {
+    static double ns_per_tick = 0.0;
+    if (ns_per_tick == 0.0) ns_per_tick = 1e9 / (double)SDL_GetPerformanceFrequency();
+    return (double)SDL_GetPerformanceCounter() * ns_per_tick;
+}
+
+/* evita que o compilador descarte resultados */
+static volatile double sink;
+
+/* alguma verificação de custo falhou: sai com 1 */
+static int failed;
+
+/* ---------- saída JSON ---------- */
+
+static FILE *out;
+static int n_results = 0;
+
+static void json_escape(FILE *f, const char *s) {
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', f);
+        fputc(*s, f);
+    }
+}
+
+static void report(const char *group, const char *name, const char *unit, Stats s) {
+    fprintf(out, "%s\n    {\"group\": \"%s\", \"name\": \"", n_results ? "," : "", group);
+    json_escape(out, name);
+    fprintf(out, "\", \"unit\": \"%s\", \"median\": %.3f, \"p99\": %.3f, \"mean\": %.3f, \"reps\": %d}",
+            unit, s.median, s.p99, s.mean, s.reps);
+    n_results++;
+}
+
+/* ---------- benchmarks ---------- */
+
+static void bench_lexer(int reps) {
+    /* corpus inteiro concatenado várias vezes (entrada longa) */
+    size_t total = 0;
+    for (int i = 0; corpus[i]; i++) total += strlen(corpus[i]) + 1;
+    const int copies = 200;
+    char *src = (char*)malloc(total * (size_t)copies + 1);
+    if (!src) return;
+    char *p = src;
+    for (int c = 0; c < copies; c++) {
+        for (int i = 0; corpus[i]; i++) {
+            size_t n = strlen(corpus[i]);
+            memcpy(p, corpus[i], n);
+            p += n;
+            *p++ = ' ';
+        }
+    }
+    *p = '\0';
+
+    double *t = (double*)malloc((size_t)reps * sizeof(double));
+    if (!t) { free(src); return; }
+
+    for (int r = 0; r < reps; r++) {
+        TP_Lexer lx;
+        size_t ntok = 0;
+        double t0 = now_ns();
+        tp_lex_init(&lx, src);
+        while (lx.current->type != TP_TOK_EOF && lx.current->type != TP_TOK_INVALID) {
+            tp_lex_next(&lx);
+            ntok++;
+        }
+        double t1 = now_ns();
+        t[r] = (t1 - t0) / (double)(ntok ? ntok : 1);
+    }
+    report("lexer", "tp_lex_next/corpus", "ns_per_token", stats_of(t, reps));
+
+    free(t);
+    free(src);
+}
+
+static void bench_parser(int reps) {
+    double *t = (double*)malloc((size_t)reps * sizeof(double));
+    if (!t) return;
+
+    for (int i = 0; corpus[i]; i++) {
+        for (int r = 0; r < reps; r++) {
+            TP_Parser p;
+            double t0 = now_ns();
+            tp_parse_init(&p, corpus[i]);
+            TP_Node *n = tp_parse_expr(&p);
+            double t1 = now_ns();
+            tp_ast_free(n);
+            t[r] = t1 - t0;
+        }
+        report("parser", corpus[i], "ns_per_parse", stats_of(t, reps));
+    }
+
+    /* LaTeX gerado por máquina: soma longa (~250 KB); deve escalar linear */
+    const int terms = 10000;
+    char *big = (char*)malloc((size_t)terms * 64 + 1);
+    if (big) {
+        char *q = big;
+        for (int k = 0; k < terms; k++) {
+            q += sprintf(q, "%s\\frac{%d}{%d}\\sin\\left(%dx\\right)\\,",
+                         k ? "+" : "", k + 1, k + 2, k % 7 + 1);
+        }
+        for (int r = 0; r < reps; r++) {
+            TP_Parser p;
+            double t0 = now_ns();
+            tp_parse_init(&p, big);
+            TP_Node *n = tp_parse_expr(&p);
+            double t1 = now_ns();
+            tp_ast_free(n);
+            t[r] = (t1 - t0) / 1e6;
+        }
+        report("parser", "gerado/10000 termos", "ms_per_parse", stats_of(t, reps));
+        free(big);
+    }
+    free(t);
+}
+
+/* parse + compile via cache quente: normalização + lookup */
+static void bench_cache(int reps) {
+    double *t = (double*)malloc((size_t)reps * sizeof(double));
+    TP_Cache cache;
+    if (!t || tp_cache_init(&cache, TP_CACHE_CAPACITY) != 0) { free(t); return; }
+
+    char err[256];
+    for (int i = 0; corpus[i]; i++) {
+        TP_Compiled *ce;
+        if (tp_cache_get(&cache, corpus[i], NULL, 0, &ce, err, (int)sizeof(err)) != 0) continue;
+        tp_compiled_release(ce);
+
+        for (int r = 0; r < reps; r++) {
+            double t0 = now_ns();
+            tp_cache_get(&cache, corpus[i], NULL, 0, &ce, err, (int)sizeof(err));
+            double t1 = now_ns();
+            tp_compiled_release(ce);
+            t[r] = t1 - t0;
+        }
+        report("cache", corpus[i], "ns_per_hit", stats_of(t, reps));
+    }
+
+    tp_cache_free(&cache);
+    free(t);
+}
+
+typedef struct EvalCase {
+    const char *name;
+    const char *expr;
+} EvalCase;
+
+/* um caso por tipo de nó (o custo de x/número entra em todos) */
+static const EvalCase eval_cases[] = {
+    { "number",   "2" },
+    { "var_x",    "x" },
+    { "neg",      "-x" },
+    { "add",      "x+2" },
+    { "sub",      "x-2" },
+    { "mul",      "x*2" },
+    { "div",      "x/2" },
+    { "pow",      "x^{2.5}" },
+    { "pow_int",  "x^3" },
+    { "frac",     "\\frac{x}{2}" },
+    { "sin",      "\\sin(x)" },
+    { "cos",      "\\cos(x)" },
+    { "tan",      "\\tan(x)" },
+    { "log",      "\\log(x)" },
+    { "exp",      "\\exp(x)" },
+    { "sqrt",     "\\sqrt{x}" },
+    { "heart_y",  "13\\cos(x)-5\\cos(2x)-2\\cos(3x)-\\cos(4x)" },
+    /* formas com kernel próprio (tp_shape) */
+    { "poly",     "x^5-3x^3+2x-1" },
+    { "rational", "\\frac{x^2-1}{x^2+1}" },
+    { "fourier",  "\\sin(x)+\\sin(3x)/3+\\sin(5x)/5+\\sin(7x)/7" },
+    { NULL, NULL }
+};
+
+#define EVAL_N 4096
+
+static void bench_eval(int reps) {
+    double *t = (double*)malloc((size_t)reps * sizeof(double));
+    double *xs = (double*)malloc(EVAL_N * sizeof(double));
+    double *ys = (double*)malloc(EVAL_N * sizeof(double));
+    double *d1 = (double*)malloc(EVAL_N * sizeof(double));
+    double *d2 = (double*)malloc(EVAL_N * sizeof(double));
+    if (!t || !xs || !ys || !d1 || !d2) { free(t); free(xs); free(ys); free(d1); free(d2); return; }
+
+    for (int i = 0; i < EVAL_N; i++) xs[i] = 0.25 + 9.5 * (double)i / (double)EVAL_N;
+
+    for (int c = 0; eval_cases[c].name; c++) {
+        TP_Parser p;
+        tp_parse_init(&p, eval_cases[c].expr);
+        TP_Node *n = tp_parse_expr(&p);
+        if (!n) continue;
+
+        /* tp_eval: árvore recursiva, 1 amostra por chamada */
+        for (int r = 0; r < reps; r++) {
+            double acc = 0.0;
+            double t0 = now_ns();
+            for (int i = 0; i < EVAL_N; i++) acc += tp_eval(n, xs[i]);
+            double t1 = now_ns();
+            sink = acc;
+            t[r] = (t1 - t0) / (double)EVAL_N;
+        }
+        report("eval", eval_cases[c].name, "ns_per_sample", stats_of(t, reps));
+
+        /* bytecode em lote */
+        TP_Program *prog = tp_prog_compile(n);
+        if (prog) {
+            char name[64];
+            snprintf(name, sizeof(name), "%s/batch", eval_cases[c].name);
+            for (int r = 0; r < reps; r++) {
+                double t0 = now_ns();
+                tp_prog_eval_batch(prog, xs, NULL, ys, EVAL_N);
+                double t1 = now_ns();
+                sink = ys[EVAL_N / 2];
+                t[r] = (t1 - t0) / (double)EVAL_N;
+            }
+            report("eval", name, "ns_per_sample", stats_of(t, reps));
+
+            /* jato: valor + f' + f'' (amostragem por curvatura) */
+            snprintf(name, sizeof(name), "%s/jet", eval_cases[c].name);
+            for (int r = 0; r < reps; r++) {
+                double t0 = now_ns();
+                tp_prog_eval_jet_p(prog, NULL, xs, NULL, ys, d1, d2, EVAL_N);
+                double t1 = now_ns();
+                sink = ys[EVAL_N / 2] + d1[EVAL_N / 2] + d2[EVAL_N / 2];
+                t[r] = (t1 - t0) / (double)EVAL_N;
+            }
+            report("eval", name, "ns_per_sample", stats_of(t, reps));
+
+            /* forma reconhecida: o mesmo lote pelo bytecode, para comparar */
+            TP_Shape *shape = prog->shape;
+            if (shape) {
+                prog->shape = NULL;
+                snprintf(name, sizeof(name), "%s/generic", eval_cases[c].name);
+                for (int r = 0; r < reps; r++) {
+                    double t0 = now_ns();
+                    tp_prog_eval_batch(prog, xs, NULL, ys, EVAL_N);
+                    double t1 = now_ns();
+                    sink = ys[EVAL_N / 2];
+                    t[r] = (t1 - t0) / (double)EVAL_N;
+                }
+                report("eval", name, "ns_per_sample", stats_of(t, reps));
+                prog->shape = shape;
+            }
+            tp_prog_free(prog);
+        }
+
+        tp_ast_free(n);
+    }
+
+    free(t); free(xs); free(ys); free(d1); free(d2);
+}
+
+/* tuplas: x(t) e y(t) por dois programas vs o programa conjunto */
+static const EvalCase tuple_cases[] = {
+    { "heart",     "(16\\sin(x)^3, 13\\cos(x)-5\\cos(2x)-2\\cos(3x)-\\cos(4x))" },
+    { "lissajous", "(\\sin(3x), \\sin(2x))" },
+    { "rose",      "(\\cos(5x)\\cos(x), \\cos(5x)\\sin(x))" },
+    { NULL, NULL }
+};
+
+static void bench_tuple(int reps) {
+    double *t = (double*)malloc((size_t)reps * sizeof(double));
+    double *ts = (double*)malloc(EVAL_N * sizeof(double));
+    double *xs = (double*)malloc(EVAL_N * sizeof(double));
+    double *ys = (double*)malloc(EVAL_N * sizeof(double));
+    if (!t || !ts || !xs || !ys) { free(t); free(ts); free(xs); free(ys); return; }
+
+    for (int i = 0; i < EVAL_N; i++) ts[i] = 6.283185307179586 * (double)i / (double)EVAL_N;
+
+    TP_Cache cache;
+    if (tp_cache_init(&cache, 16) != 0) { free(t); free(ts); free(xs); free(ys); return; }
+
+    for (int c = 0; tuple_cases[c].name; c++) {
+        TP_Compiled *ce = NULL;
+        char err[128];
+        if (tp_cache_get(&cache, tuple_cases[c].expr, NULL, 0, &ce, err, (int)sizeof(err)) != 0) continue;
+
+        /* pair = NULL: os dois programas em separado */
+        TP_Program *pair = ce->prog_a->pair;
+        for (int pass = 0; pass < 2; pass++) {
+            char name[64];
+            ce->prog_a->pair = pass ? pair : NULL;
+            snprintf(name, sizeof(name), "%s/%s", tuple_cases[c].name, pass ? "joint" : "separate");
+            for (int r = 0; r < reps; r++) {
+                double t0 = now_ns();
+                tp_prog_eval_tuple_p(ce->prog_a, ce->prog_b, NULL, ts, xs, ys, EVAL_N);
+                double t1 = now_ns();
+                sink = xs[EVAL_N / 2] + ys[EVAL_N / 2];
+                t[r] = (t1 - t0) / (double)EVAL_N;
+            }
+            report("tuple", name, "ns_per_sample", stats_of(t, reps));
+        }
+        ce->prog_a->pair = pair;
+        tp_compiled_release(ce);
+    }
+
+    tp_cache_free(&cache);
+    free(t); free(ts); free(xs); free(ys);
+}
+
+static void bench_render(int reps) {
+    const int w = 900, h = 600;
+    SDL_Surface *surf = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer *r = surf ? SDL_CreateSoftwareRenderer(surf) : NULL;
+    if (!r) {
+        fprintf(stderr, "bench: renderer headless indisponivel: %s\n", SDL_GetError());
+        if (surf) SDL_FreeSurface(surf);
+        return;
+    }
+
+    double *t = (double*)malloc((size_t)reps * sizeof(double));
+    if (!t) { SDL_DestroyRenderer(r); SDL_FreeSurface(surf); return; }
+
+    TP_Screen screen = { w, h };
+    const TP_Out out = { r, NULL, NULL };
+
+    /* mesmo desenho em SVG (RDP + escrita bufferizada) para /dev/null */
+    static TP_Vec vec;
+    const TP_Out vout = { NULL, &vec, NULL };
+    char err[256];
+
+    for (int i = 0; corpus[i]; i++) {
+        TP_Parser p;
+        tp_parse_init(&p, corpus[i]);
+        TP_Node *n = tp_parse_expr(&p);
+        if (!n) continue;
+        if (n->type != TP_NODE_TUPLE2 && tp_ast_uses_y(n)) { tp_ast_free(n); continue; }
+
+        TP_View v = { -10.0, 10.0, -10.0, 10.0 };
+
+        for (int k = 0; k < reps; k++) {
+            double t0 = now_ns();
+            SDL_SetRenderDrawColor(r, 0, 0, 0, 255);
+            SDL_RenderClear(r);
+            tp_draw_grid(&out, &v, screen);
+            tp_draw_axes(&out, &v, screen);
+            if (n->type == TP_NODE_TUPLE2) {
+                tp_draw_parametric(&out, &v, screen, n->as.tuple2.a, n->as.tuple2.b,
+                                   0.0, 6.283185307179586, 3000, 0, 220, 0);
+            } else {
+                tp_draw_function(&out, &v, screen, n, 0, 220, 0);
+            }
+            double t1 = now_ns();
+            t[k] = (t1 - t0) / 1e6;
+        }
+        report(n->type == TP_NODE_TUPLE2 ? "render/parametric" : "render/function",
+               corpus[i], "ms_per_frame", stats_of(t, reps));
+
+        int nv = 0;
+        for (int k = 0; k < reps; k++) {
+            double t0 = now_ns();
+            if (tp_vec_open(&vec, "/dev/null", TP_VEC_SVG, w, h, 0, 0, 0, TP_VEC_TOL_PX,
+                            err, (int)sizeof(err)) != 0) break;
+            tp_draw_grid(&vout, &v, screen);
+            tp_draw_axes(&vout, &v, screen);
+            if (n->type == TP_NODE_TUPLE2) {
+                tp_draw_parametric(&vout, &v, screen, n->as.tuple2.a, n->as.tuple2.b,
+                                   0.0, 6.283185307179586, 3000, 0, 220, 0);
+            } else {
+                tp_draw_function(&vout, &v, screen, n, 0, 220, 0);
+            }
+            tp_vec_close(&vec);
+            double t1 = now_ns();
+            t[nv++] = (t1 - t0) / 1e6;
+        }
+        if (nv > 0) report("render/svg", corpus[i], "ms_per_frame", stats_of(t, nv));
+
+        tp_ast_free(n);
+    }
+
+    free(t);
+    SDL_DestroyRenderer(r);
+    SDL_FreeSurface(surf);
+}
+
+/* só o desenho a partir de um sampler completo: classificar, projetar
+   e emitir as polilinhas (sem avaliar) */
+static void bench_draw(int reps) {
+    static const struct { const char *expr; double t0, t1; int n; } cases[] = {
+        { "\\sin(\\frac{1}{x})", -1.0, 1.0, 900 },
+        { "\\tan(x)", -10.0, 10.0, 900 },
+        { "(16\\sin(x)^3, 13\\cos(x)-5\\cos(2x)-2\\cos(3x)-\\cos(4x))", 0.0, 6.283185307179586, 20000 },
+        { NULL, 0.0, 0.0, 0 }
+    };
+    const int w = 900, h = 600;
+    SDL_Surface *surf = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer *r = surf ? SDL_CreateSoftwareRenderer(surf) : NULL;
+    double *t = (double*)malloc((size_t)reps * sizeof(double));
+    TP_Cache cache;
+    if (!r || !t || tp_cache_init(&cache, 16) != 0) {
+        free(t);
+        if (r) SDL_DestroyRenderer(r);
+        if (surf) SDL_FreeSurface(surf);
+        return;
+    }
+
+    TP_Screen screen = { w, h };
+    const TP_Out out = { r, NULL, NULL };
+    const TP_View v = { -10.0, 10.0, -10.0, 10.0 };
+
+    for (int c = 0; cases[c].expr; c++) {
+        TP_Compiled *ce = NULL;
+        char err[128];
+        if (tp_cache_get(&cache, cases[c].expr, NULL, 0, &ce, err, (int)sizeof(err)) != 0) continue;
+
+        TP_Sampler sm;
+        tp_sampler_init(&sm);
+        if (tp_sampler_reset(&sm, cases[c].n, cases[c].t0, cases[c].t1) >= 0) {
+            if (!ce->is_tuple) tp_sampler_set_tolerance(&sm, 0.5 * 20.0 / (double)(h - 1));
+            tp_sampler_refine(&sm, ce->prog_a, ce->prog_b, 0.0);
+
+            for (int k = 0; k < reps; k++) {
+                double t0 = now_ns();
+                if (ce->is_tuple) tp_draw_parametric_samples(&out, &v, screen, &sm, 0, 220, 0);
+                else tp_draw_function_samples(&out, &v, screen, &sm, 0, 220, 0);
+                double t1 = now_ns();
+                t[k] = (t1 - t0) / 1e6;
+            }
+            report("render/draw", cases[c].expr, "ms_per_frame", stats_of(t, reps));
+        }
+        tp_sampler_free(&sm);
+        tp_compiled_release(ce);
+    }
+
+    tp_cache_free(&cache);
+    free(t);
+    SDL_DestroyRenderer(r);
+    SDL_FreeSurface(surf);
+}
+
+typedef struct AnalysisCase {
+    const char *expr;
+    double x0, x1;
+} AnalysisCase;
+
+/* poucos intervalos, muitos (zeros em sub-amostras) e com polos */
+static const AnalysisCase analysis_cases[] = {
+    { "x^3-3x",                  -3.0, 3.0 },
+    { "\\sin(x)",                -100.0, 100.0 },
+    { "\\sin(\\frac{1}{x})",     -1.0, 1.0 },
+    { "\\tan(x)",                -10.0, 10.0 },
+    { NULL, 0.0, 0.0 }
+};
+
+/* varredura + refino paralelo sobre um sampler já completo (900 colunas) */
+static void bench_analysis(int reps) {
+    double *t = (double*)malloc((size_t)reps * sizeof(double));
+    if (!t) return;
+
+    for (int c = 0; analysis_cases[c].expr; c++) {
+        TP_Parser p;
+        tp_parse_init(&p, analysis_cases[c].expr);
+        TP_Node *n = tp_parse_expr(&p);
+        TP_Node *d1 = n ? tp_ast_derive(n) : NULL;
+        TP_Node *d2 = d1 ? tp_ast_derive(d1) : NULL;
+        TP_Program *prog = n ? tp_prog_compile(n) : NULL;
+
+        TP_Sampler s;
+        tp_sampler_init(&s);
+        TP_Analysis a;
+        tp_analysis_init(&a);
+        if (d2 && prog && tp_sampler_reset(&s, 900, analysis_cases[c].x0, analysis_cases[c].x1) >= 0) {
+            tp_sampler_set_tolerance(&s, 0.5 * 20.0 / 599.0);
+            tp_sampler_refine(&s, prog, NULL, 0.0);
+
+            const TP_AnaCurve curve = { "f", n, d1, d2, &s };
+            for (int r = 0; r < reps; r++) {
+                a.valid = 0;
+                double t0 = now_ns();
+                tp_analysis_update(&a, &curve, 1);
+                double t1 = now_ns();
+                t[r] = (t1 - t0) / 1e3;
+            }
+            sink = a.n;
+            report("analysis", analysis_cases[c].expr, "us_per_update", stats_of(t, reps));
+        }
+
+        tp_analysis_free(&a);
+        tp_sampler_free(&s);
+        tp_prog_free(prog);
+        tp_ast_free(d2);
+        tp_ast_free(d1);
+        tp_ast_free(n);
+    }
+
+    free(t);
+}
+
+/* ---------- stream ao vivo ---------- */
+
+#define BENCH_STREAM_POINTS 1000000
+#define BENCH_STREAM_SOCK "/tmp/tatuplot_bench.sock"
+
+typedef struct StreamFeed {
+    const char *text;
+    size_t len;
+} StreamFeed;
+
+/* cliente: conecta e manda o texto todo, como um sensor faria */
+static int stream_feed(void *data) {
+    const StreamFeed *f = (const StreamFeed*)data;
+    struct sockaddr_un a;
+    memset(&a, 0, sizeof(a));
+    a.sun_family = AF_UNIX;
+    strcpy(a.sun_path, BENCH_STREAM_SOCK);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return 1;
+    if (connect(fd, (struct sockaddr*)&a, sizeof(a)) == 0) {
+        for (size_t o = 0; o < f->len; ) {
+            const ssize_t k = write(fd, f->text + o, f->len - o);
+            if (k <= 0) break;
+            o += (size_t)k;
+        }
+    }
+    close(fd);
+    return 0;
+}
+
+/* socket -> leitora (parse) -> anel -> janela, de ponta a ponta */
+static void bench_stream(int reps) {
+    char *text = (char*)malloc((size_t)BENCH_STREAM_POINTS * 24);
+    double *t = (double*)malloc((size_t)reps * sizeof(double));
+    if (!text || !t) { free(text); free(t); return; }
+    size_t len = 0;
+    for (int i = 0; i < BENCH_STREAM_POINTS; i++) {
+        len += (size_t)sprintf(text + len, "%.6f,%.6f\n", i * 1e-3, sin(i * 1e-3));
+    }
+    StreamFeed feed = { text, len };
+
+    char err[256];
+    TP_Stream st;
+    TP_StreamWin w;
+    if (tp_stream_win_init(&w, 100000) != 0) { free(text); free(t); return; }
+    if (tp_stream_open(&st, BENCH_STREAM_SOCK, err, (int)sizeof(err)) != 0) {
+        fprintf(stderr, "bench: stream: %s\n", err);
+        tp_stream_win_free(&w);
+        free(text);
+        free(t);
+        return;
+    }
+
+    int n = 0;
+    for (int r = 0; r < reps; r++) {
+        const int ended0 = SDL_AtomicGet(&st.ended);
+        size_t got = 0;
+        double t0 = now_ns();
+        SDL_Thread *th = SDL_CreateThread(stream_feed, "bench_feed", &feed);
+        if (!th) break;
+        /* render de mentira: drena até o cliente sair */
+        for (;;) {
+            const int done = SDL_AtomicGet(&st.ended) != ended0;
+            got += tp_stream_drain(&st, &w);
+            if (done) break;
+        }
+        double t1 = now_ns();
+        SDL_WaitThread(th, NULL);
+        if (got != BENCH_STREAM_POINTS) break;
+        t[n++] = (t1 - t0) / (double)got;
+    }
+    sink = (double)w.count;
+    if (n > 0) report("stream", "socket x,y", "ns_per_point", stats_of(t, n));
+
+    tp_stream_close(&st);
+    tp_stream_win_free(&w);
+    free(text);
+    free(t);
+}
+
+#define BENCH_DATA_POINTS (1u << 22)
+#define BENCH_DATA_PATH "/tmp/tatuplot_bench.f64"
+
+/* --data com zoom out total: o custo por frame segue a largura, não os
+   pontos (tp_draw_data devolve os passos no LOD) */
+static void bench_data(int reps) {
+    const int w = 900, h = 600;
+    FILE *f = fopen(BENCH_DATA_PATH, "wb");
+    if (!f) return;
+    int ok = 1;
+    for (unsigned i = 0; i < BENCH_DATA_POINTS && ok; i++) {
+        const double xy[2] = { i * 1e-3, sin(i * 1e-3) + 0.1 * sin(i * 0.37) };
+        ok = fwrite(xy, sizeof(xy), 1, f) == 1;
+    }
+    if (fclose(f) != 0 || !ok) {
+        remove(BENCH_DATA_PATH);
+        return;
+    }
+
+    char err[256];
+    TP_Data d;
+    TP_Lod lod;
+    tp_lod_init(&lod);
+    SDL_Surface *surf = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer *r = surf ? SDL_CreateSoftwareRenderer(surf) : NULL;
+    double *t = (double*)malloc((size_t)reps * sizeof(double));
+    if (!r || !t || tp_frame_open_data(&d, &lod, BENCH_DATA_PATH, NULL, err, (int)sizeof(err)) != 0) {
+        free(t);
+        if (r) SDL_DestroyRenderer(r);
+        if (surf) SDL_FreeSurface(surf);
+        tp_lod_free(&lod);
+        remove(BENCH_DATA_PATH);
+        return;
+    }
+
+    TP_Screen screen = { w, h };
+    const TP_Out o = { r, NULL, NULL };
+    const TP_View v = { d.xmin, d.xmax, d.ymin, d.ymax };
+    size_t steps = 0;
+    for (int k = 0; k < reps; k++) {
+        double t0 = now_ns();
+        steps = tp_draw_data(&o, &v, screen, &d, &lod, 0, 220, 0);
+        double t1 = now_ns();
+        t[k] = (t1 - t0) / 1e6;
+    }
+    report("data", "f64 4M pontos, zoom out", "ms_per_frame", stats_of(t, reps));
+    if (steps > (size_t)(2 * w + 2)) {
+        fprintf(stderr, "bench: data: %lu passos no LOD para %d colunas\n", (unsigned long)steps, w);
+        failed = 1;
+    }
+
+    tp_data_close(&d);
+    tp_lod_free(&lod);
+    free(t);
+    SDL_DestroyRenderer(r);
+    SDL_FreeSurface(surf);
+    remove(BENCH_DATA_PATH);
+}
+
+/* tiles: render frio (sampler/heatmap + BMP) e acerto no LRU */
+static void bench_tiles(int reps) {
+    static const char *exprs[] = { "\\sin(x)", "\\sin(x)\\cos(y)", NULL };
+    double *t = (double*)malloc((size_t)reps * sizeof(double));
+    unsigned char *bmp = (unsigned char*)malloc(tp_screenshot_bmp_size(TP_TILE_SIZE, TP_TILE_SIZE));
+    if (!t || !bmp) { free(t); free(bmp); return; }
+    TP_FrameCtx ctx;
+    tp_frame_ctx_init(&ctx);
+
+    for (int i = 0; exprs[i]; i++) {
+        TP_Parser p;
+        tp_parse_init(&p, exprs[i]);
+        TP_Node *n = tp_parse_expr(&p);
+        TP_Program *prog = n ? tp_prog_compile(n) : NULL;
+        if (!prog) { tp_ast_free(n); continue; }
+
+        TP_FrameScene sc;
+        memset(&sc, 0, sizeof(sc));
+        sc.prog_a = prog;
+        sc.is_field = tp_ast_uses_y(n);
+        sc.fg_g = 220;
+        sc.has_zrange = 1;
+        sc.zmin = -1.0;
+        sc.zmax = 1.0;
+        const TP_View base = { -10.0, 10.0, -10.0, 10.0 };
+
+        /* tiles diferentes a cada repetição: nada reaproveitado */
+        for (int k = 0; k < reps; k++) {
+            double t0 = now_ns();
+            tp_tile_render(&sc, &base, &ctx, 4, k % 16, (k / 16) % 16, bmp);
+            double t1 = now_ns();
+            sink = bmp[1000];
+            t[k] = (t1 - t0) / 1e6;
+        }
+        report("tiles/render", exprs[i], "ms_per_tile", stats_of(t, reps));
+
+        TP_TileServer srv;
+        if (tp_tile_server_init(&srv, &sc, &base, exprs[i], NULL, NULL) == 0) {
+            TP_Tile *tile = NULL;
+            if (tp_tile_get(&srv, &ctx, 0, 0, 0, &tile) == 0) tp_tile_release(&srv, tile);
+            for (int k = 0; k < reps; k++) {
+                double t0 = now_ns();
+                for (int j = 0; j < 1000; j++) {
+                    if (tp_tile_get(&srv, &ctx, 0, 0, 0, &tile) == 0) tp_tile_release(&srv, tile);
+                }
+                double t1 = now_ns();
+                t[k] = (t1 - t0) / 1000.0;
+            }
+            report("tiles/lru_hit", exprs[i], "ns_per_tile", stats_of(t, reps));
+            tp_tile_server_free(&srv);
+        }
+
+        tp_prog_free(prog);
+        tp_ast_free(n);
+    }
+
+    tp_frame_ctx_free(&ctx);
+    free(bmp);
+    free(t);
+}
+
+#define BENCH_DAEMON_SOCK "/tmp/tatuplot_bench_daemon.sock"
+
+static int daemon_main(void *data) {
+    tp_daemon_run((TP_Daemon*)data);
+    return 0;
+}
+
+/* lê exatamente n bytes (resposta do daemon) */
+static int read_full(int fd, void *p, size_t n) {
+    char *b = (char*)p;
+    while (n > 0) {
+        const ssize_t k = read(fd, b, n);
+        if (k <= 0) return -1;
+        b += k;
+        n -= (size_t)k;
+    }
+    return 0;
+}
+
+/* daemon: ida e volta de um pedido (parse da linha, cache, frame, BMP)
+   numa conexão aberta, com renderer e expressão já quentes */
+static void bench_daemon(int reps) {
+    static const char *names[] = { "\\sin(x)", "\\sin(x)\\cos(y)", NULL };
+    static const char *reqs[] = {
+        "--expr \"\\sin(x)\" --width 400 --height 300\n",
+        "--expr \"\\sin(x)\\cos(y)\" --width 400 --height 300 --zmin -1 --zmax 1\n",
+    };
+    double *t = (double*)malloc((size_t)reps * sizeof(double));
+    unsigned char *bmp = (unsigned char*)malloc(tp_screenshot_bmp_size(400, 300));
+    if (!t || !bmp) { free(t); free(bmp); return; }
+
+    char err[256];
+    TP_Cache cache;
+    TP_Daemon d;
+    if (tp_cache_init(&cache, TP_CACHE_CAPACITY) != 0) { free(t); free(bmp); return; }
+    if (tp_daemon_open(&d, BENCH_DAEMON_SOCK, &cache, err, (int)sizeof(err)) != 0) {
+        fprintf(stderr, "bench: daemon: %s\n", err);
+        tp_cache_free(&cache);
+        free(t);
+        free(bmp);
+        return;
+    }
+    SDL_Thread *th = SDL_CreateThread(daemon_main, "bench_daemon", &d);
+
+    struct sockaddr_un a;
+    memset(&a, 0, sizeof(a));
+    a.sun_family = AF_UNIX;
+    strcpy(a.sun_path, BENCH_DAEMON_SOCK);
+    const int fd = th ? socket(AF_UNIX, SOCK_STREAM, 0) : -1;
+    if (fd >= 0 && connect(fd, (struct sockaddr*)&a, sizeof(a)) == 0) {
+        for (int i = 0; names[i]; i++) {
+            const size_t len = strlen(reqs[i]);
+            int n = 0;
+            for (int k = -1; k < reps; k++) {
+                double t0 = now_ns();
+                if (write(fd, reqs[i], len) != (ssize_t)len) break;
+                /* cabeçalho "IMG <n>\n" byte a byte, depois o BMP */
+                char head[64];
+                size_t h = 0;
+                while (h + 1 < sizeof(head) && read_full(fd, head + h, 1) == 0 && head[h] != '\n') h++;
+                head[h] = '\0';
+                unsigned long size = 0;
+                if (sscanf(head, "IMG %lu", &size) != 1 || size != tp_screenshot_bmp_size(400, 300)) break;
+                if (read_full(fd, bmp, size) != 0) break;
+                double t1 = now_ns();
+                sink = bmp[1000];
+                /* k = -1: aquece cache e renderer */
+                if (k >= 0) t[n++] = (t1 - t0) / 1e6;
+            }
+            if (n > 0) report("daemon", names[i], "ms_per_plot", stats_of(t, n));
+        }
+    }
+    if (fd >= 0) close(fd);
+
+    SDL_AtomicSet(&d.pool.quit, 1);
+    if (th) SDL_WaitThread(th, NULL);
+    tp_daemon_close(&d);
+    tp_cache_free(&cache);
+    free(bmp);
+    free(t);
+}
+
+/* biblioteca: frame completo e só polilinhas, pela API pública */
+static void bench_lib(int reps) {
+    static const char *exprs[] = { "\\sin(x)", "\\tan(x)", NULL };
+    double *t = (double*)malloc((size_t)reps * sizeof(double));
+    TatuPlot *tp = tatuplot_new();
+    if (!t || !tp) { free(t); tatuplot_free(tp); return; }
+
+    TatuPlotRequest q;
+    tatuplot_request_init(&q);
+    q.width = 400;
+    q.height = 300;
+    for (int i = 0; exprs[i]; i++) {
+        q.expr = exprs[i];
+        TatuPlotImage img;
+        TatuPlotLines l;
+        int n = 0;
+        for (int k = 0; k < reps; k++) {
+            double t0 = now_ns();
+            if (tatuplot_render(tp, &q, &img) != TATUPLOT_OK) break;
+            double t1 = now_ns();
+            sink = img.pixels[1000];
+            t[n++] = (t1 - t0) / 1e6;
+        }
+        if (n > 0) report("lib/render", exprs[i], "ms_per_frame", stats_of(t, n));
+        n = 0;
+        for (int k = 0; k < reps; k++) {
+            double t0 = now_ns();
+            if (tatuplot_lines(tp, &q, &l) != TATUPLOT_OK) break;
+            double t1 = now_ns();
+            sink = l.n_points;
+            t[n++] = (t1 - t0) / 1e6;
+        }
+        if (n > 0) report("lib/lines", exprs[i], "ms_per_frame", stats_of(t, n));
+    }
+
+    tatuplot_free(tp);
+    free(t);
+}
+
+static void usage(const char *prog) {
+    printf("Uso: %s [--quick] [--reps N] [--out arquivo.json]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    int reps = 200;
+    const char *out_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) reps = 21;
+        else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) reps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) out_path = argv[++i];
+        else { usage(argv[0]); return 1; }
+    }
+    if (reps < 1) reps = 1;
+
+    out = stdout;
+    if (out_path) {
+        out = fopen(out_path, "w");
+        if (!out) { fprintf(stderr, "bench: nao consegui abrir %s\n", out_path); return 1; }
+    }
+
+    fprintf(out, "{\n  \"reps\": %d,\n  \"results\": [", reps);
+    bench_lexer(reps);
+    bench_parser(reps);
+    bench_cache(reps);
+    bench_eval(reps);
+    bench_tuple(reps);
+    bench_analysis(reps);
+    /* 1M pontos por repetição */
+    bench_stream(reps / 20 > 3 ? reps / 20 : 3);
+    /* frames são bem mais caros: menos repetições */
+    bench_render(reps / 4 > 5 ? reps / 4 : 5);
+    bench_draw(reps / 4 > 5 ? reps / 4 : 5);
+    bench_data(reps / 4 > 5 ? reps / 4 : 5);
+    bench_tiles(reps / 4 > 5 ? reps / 4 : 5);
+    bench_daemon(reps / 4 > 5 ? reps / 4 : 5);
+    bench_lib(reps / 4 > 5 ? reps / 4 : 5);
+    fprintf(out, "\n  ]\n}\n");
+
+    if (out != stdout) {
+        fclose(out);
+        fprintf(stderr, "bench: resultados em %s\n", out_path);
+    }
+    return failed;
+}
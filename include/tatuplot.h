@@ -0,0 +1,112 @@
+#ifndef TATUPLOT_H
+#define TATUPLOT_H
+
+/* libtatuplot: API C estável para desenhar sem janela dentro de outro
+   processo (make lib -> bin/libtatuplot.a e bin/libtatuplot.so).
+   Expressão + viewport + tamanho entram; saem os pixels do frame
+   (grade, eixos, heatmap, curvas) ou as polilinhas da curva.
+
+   Só este header é público: os tipos tp_* internos podem mudar entre
+   versões. Campos novos entram no fim das structs e
+   tatuplot_request_init preenche o default de todos; por isso sempre
+   inicialize um pedido com ela.
+
+   Um handle guarda o cache de expressões compiladas, o renderer por
+   software e os buffers entre chamadas. Não é thread-safe: use um por
+   thread (handles diferentes rodam em paralelo). O host não precisa
+   inicializar o SDL. */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TATUPLOT_VERSION_MAJOR 1
+#define TATUPLOT_VERSION_MINOR 0
+
+/* parâmetros nomeados por pedido */
+#define TATUPLOT_MAX_PARAMS 8
+
+/* largura/altura máxima (px) */
+#define TATUPLOT_MAX_SIZE 10000
+
+#if defined(__GNUC__)
+#define TATUPLOT_API __attribute__((visibility("default")))
+#else
+#define TATUPLOT_API
+#endif
+
+/* códigos de retorno */
+#define TATUPLOT_OK       0
+#define TATUPLOT_EINVAL   1   /* pedido ou expressão inválida (tatuplot_error) */
+#define TATUPLOT_ENOMEM   2
+
+typedef struct TatuPlot TatuPlot;
+
+typedef struct TatuPlotRequest {
+    const char *expr;            /* y = f(x), (x(t), y(t)) ou z = f(x,y) */
+    int width, height;           /* default 900x600 */
+    double xmin, xmax;           /* viewport; default [-10,10] nos dois */
+    double ymin, ymax;
+    int fit;                     /* tupla: viewport ajustada à curva (default 1) */
+    double tmin, tmax;           /* tupla: range de t; default [0, 2pi] */
+
+    /* parâmetros nomeados usados na expressão (como --param) */
+    const char *const *param_names;
+    const double *param_values;
+    int n_params;
+
+    int deriv;                   /* y = f(x): desenha f' também */
+    int has_zrange;              /* heatmap: sem = auto pelo frame */
+    double zmin, zmax;
+
+    unsigned char bg[3];         /* RGB; default 0,0,0 */
+    unsigned char fg[3];         /* default 0,220,0 */
+} TatuPlotRequest;
+
+/* Frame renderizado. pixels pertence ao handle e vale até a próxima
+   chamada com ele. */
+typedef struct TatuPlotImage {
+    int width, height;
+    int pitch;                   /* bytes por linha */
+    const uint32_t *pixels;      /* ARGB8888, linha 0 em cima */
+    double xmin, xmax, ymin, ymax;   /* viewport usada (depois do fit) */
+} TatuPlotImage;
+
+/* Polilinhas da curva em pixels (sem arredondar; y cresce para baixo),
+   quebradas em descontinuidades e fora do domínio. A polilinha i vai
+   dos pontos starts[i] a starts[i+1]-1; xy intercala x e y. Pertence
+   ao handle e vale até a próxima chamada com ele. */
+typedef struct TatuPlotLines {
+    const double *xy;
+    int n_points;
+    const int *starts;           /* n_lines + 1 entradas */
+    int n_lines;
+    double xmin, xmax, ymin, ymax;
+} TatuPlotLines;
+
+/* MAJOR * 100 + MINOR da biblioteca carregada */
+TATUPLOT_API int tatuplot_version(void);
+
+/* NULL sem memória */
+TATUPLOT_API TatuPlot *tatuplot_new(void);
+TATUPLOT_API void tatuplot_free(TatuPlot *tp);
+
+TATUPLOT_API void tatuplot_request_init(TatuPlotRequest *req);
+
+/* Frame completo em width x height. Retorna TATUPLOT_OK ou um erro. */
+TATUPLOT_API int tatuplot_render(TatuPlot *tp, const TatuPlotRequest *req, TatuPlotImage *out);
+
+/* Só a curva (f' não entra), sem renderer. Heatmap não tem polilinha:
+   TATUPLOT_EINVAL. */
+TATUPLOT_API int tatuplot_lines(TatuPlot *tp, const TatuPlotRequest *req, TatuPlotLines *out);
+
+/* mensagem do último erro do handle ("" se não houve) */
+TATUPLOT_API const char *tatuplot_error(const TatuPlot *tp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef TP_ANALYSIS_H
+#define TP_ANALYSIS_H
+
+#include <stdio.h>
+#include "tp_ast.h"
+#include "tp_sample.h"
+
+/* curvas analisadas juntas (f, f', ...) */
+#define TP_ANALYSIS_MAX_CURVES 4
+
+/* teto de pontos por análise (sin(1/x) não inunda a tela nem o JSON) */
+#define TP_ANALYSIS_MAX 1024
+
+typedef enum TP_FeatureKind {
+    TP_FEAT_ROOT,
+    TP_FEAT_MIN,
+    TP_FEAT_MAX,
+    TP_FEAT_CROSS    /* curve = other no mesmo x */
+} TP_FeatureKind;
+
+typedef struct TP_Feature {
+    TP_FeatureKind kind;
+    int curve, other;    /* índices em TP_AnaCurve (other: só CROSS) */
+    double x, y;
+} TP_Feature;
+
+/* Curva y = f(x) do plot: o buffer de amostras dá os intervalos, as
+   árvores refinam. df/d2f NULL: Brent (sem derivada) no lugar de Newton;
+   sem df não há cruzamento por Newton, mas há por Brent. */
+typedef struct TP_AnaCurve {
+    const char *name;          /* "f", "f'" (relatório) */
+    const TP_Node *f, *df, *d2f;
+    const TP_Sampler *s;       /* completo; f' por amostra em s->d1s */
+} TP_AnaCurve;
+
+/* chave das amostras de uma curva: igual => não recalcula */
+typedef struct TP_AnaKey {
+    int n;
+    double t0, t1, tol;
+    double params[TP_PARAM_MAX];
+} TP_AnaKey;
+
+/* Zeros, extremos locais e cruzamentos entre curvas, sem varrer a
+   função de novo: troca de sinal de y (zero), de f' por amostra
+   (extremo) ou de y_i - y_j (cruzamento) entre amostras vizinhas vira
+   um intervalo. Os intervalos são refinados em paralelo (Newton com
+   bissecção de segurança se há derivada, Brent se não); polos são
+   descartados. Resultado ordenado por x. */
+typedef struct TP_Analysis {
+    TP_Feature *feat;
+    int n, cap;
+
+    int nthreads;
+
+    int n_curves;
+    TP_AnaKey key[TP_ANALYSIS_MAX_CURVES];
+    int valid;
+} TP_Analysis;
+
+void tp_analysis_init(TP_Analysis *a);
+void tp_analysis_free(TP_Analysis *a);
+
+/* Recalcula se todas as amostras estão completas e alguma chave mudou.
+   Cruzamentos só entre curvas com a mesma grade (n, t0, t1).
+   Retorna 1 se recalculou, 0 se manteve, -1 se faltou memória. */
+int tp_analysis_update(TP_Analysis *a, const TP_AnaCurve *c, int n_curves);
+
+/* JSON com a expressão, o intervalo em x, os parâmetros nomeados
+   (names/values, n_params) e os pontos. Retorna 0 se OK. */
+int tp_analysis_write_json(const TP_Analysis *a, const TP_AnaCurve *c,
+                           const char *expr,
+                           const char *const *names, const double *values, int n_params,
+                           FILE *f);
+
+#endif
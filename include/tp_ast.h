@@ -1,9 +1,13 @@
 #ifndef TP_AST_H
 #define TP_AST_H
 
+#include <stdio.h>
+#include "tp_dd.h"
+
 typedef enum TP_NodeType {
     TP_NODE_NUMBER,
     TP_NODE_VAR_X,
+    TP_NODE_VAR_Y,   /* z = f(x,y) (heatmap) */
 
     TP_NODE_UNARY_NEG,
 
@@ -16,7 +20,12 @@ typedef enum TP_NodeType {
     TP_NODE_FUNC1,
     TP_NODE_FRAC,
 
-    TP_NODE_TUPLE2   /* (a,b) usado para curva paramétrica */
+    TP_NODE_TUPLE2,  /* (a,b) usado para curva paramétrica */
+
+    /* definições do usuário (tp_sym): let slot = value in body */
+    TP_NODE_LET,
+    TP_NODE_SLOT,    /* valor ligado por um LET envolvente */
+    TP_NODE_PARAM    /* parâmetro i; só em corpos de função (templates) */
 } TP_NodeType;
 
 typedef enum TP_Func1 {
@@ -30,6 +39,13 @@ typedef enum TP_Func1 {
 
 typedef struct TP_Node TP_Node;
 
+/* slots de LET/SLOT ficam em [0, TP_SLOT_MAX) */
+#define TP_SLOT_MAX (1 << 20)
+
+/* Parâmetros nomeados (--param a=2): SLOTs livres 0..n-1, sem LET.
+   O valor vem de fora a cada avaliação; mudar não re-parseia. */
+#define TP_PARAM_MAX 8
+
 struct TP_Node {
     TP_NodeType type;
     union {
@@ -42,19 +58,92 @@ struct TP_Node {
         struct { TP_Node *num; TP_Node *den; } frac;
 
         struct { TP_Node *a; TP_Node *b; } tuple2;
+
+        int slot;   /* SLOT: slot; PARAM: índice do parâmetro */
+        struct { int slot; TP_Node *value; TP_Node *body; } let;
     } as;
 };
 
 TP_Node *tp_node_number(double v);
 TP_Node *tp_node_var_x(void);
+TP_Node *tp_node_var_y(void);
 TP_Node *tp_node_unary(TP_NodeType t, TP_Node *a);
 TP_Node *tp_node_bin(TP_NodeType t, TP_Node *a, TP_Node *b);
 TP_Node *tp_node_func1(TP_Func1 f, TP_Node *arg);
 TP_Node *tp_node_frac(TP_Node *num, TP_Node *den);
 TP_Node *tp_node_tuple2(TP_Node *a, TP_Node *b);
+TP_Node *tp_node_let(int slot, TP_Node *value, TP_Node *body);
+TP_Node *tp_node_slot(int slot);
+TP_Node *tp_node_param(int index);
 
+/* sem recursão: aceita árvores com qualquer profundidade */
 void tp_ast_free(TP_Node *n);
 
+/* filhos na ordem de avaliação (0, 1 ou 2); LET: value, body */
+int tp_ast_nchildren(const TP_Node *n);
+TP_Node *tp_ast_child(const TP_Node *n, int i);
+void tp_ast_set_child(TP_Node *n, int i, TP_Node *c);
+
+/* cópia profunda (sem recursão); NULL sem memória */
+TP_Node *tp_ast_clone(const TP_Node *n);
+
+/* Cópia em que cada folha passa antes por `leaf`: *out = subárvore nova
+   no lugar da folha, ou NULL para copiar normal. leaf devolve 0 sem
+   memória. */
+typedef int (*TP_LeafMap)(void *ctx, const TP_Node *leaf, TP_Node **out);
+TP_Node *tp_ast_clone_map(const TP_Node *n, TP_LeafMap leaf, void *ctx);
+
+/* Percurso em pós-ordem com pilha explícita (local; heap só em árvores
+   fundas). Somas geradas com dezenas de milhares de termos viram
+   cadeias com essa profundidade, então nada aqui recursa sem limite. */
+#define TP_WALK_LOCAL 64
+
+/* tp_eval2/tp_eval_dd recursam até esta profundidade (caminho rápido);
+   subárvores mais fundas seguem com pilha explícita */
+#define TP_EVAL_REC_MAX 64
+
+typedef struct TP_AstWalkFrame {
+    TP_Node *n;
+    int next;     /* próximo filho a visitar */
+} TP_AstWalkFrame;
+
+typedef struct TP_AstWalk {
+    TP_AstWalkFrame *st;
+    int sp, cap;
+    int failed;   /* sem memória: percurso interrompido */
+    TP_AstWalkFrame local[TP_WALK_LOCAL];
+} TP_AstWalk;
+
+void tp_ast_walk_init(TP_AstWalk *w, const TP_Node *root);
+/* próximo nó (filhos antes do pai); NULL no fim ou se w->failed */
+const TP_Node *tp_ast_walk_next(TP_AstWalk *w);
+void tp_ast_walk_free(TP_AstWalk *w);
+
+/* valor do nó dados os valores dos filhos em `a` (x/y para as folhas;
+   SLOT dá NAN, LET dá o valor do corpo); mesma aritmética da avaliação
+   e do constant folding do bytecode */
+double tp_ast_apply(const TP_Node *n, const double *a, double x, double y);
+
 double tp_eval(const TP_Node *n, double x);
 
+/* avaliação em duas variáveis: z = f(x, y) */
+double tp_eval2(const TP_Node *n, double x, double y);
+
+/* idem com os valores dos parâmetros nomeados (TP_PARAM_MAX doubles;
+   NULL se a expressão não tem parâmetros) */
+double tp_eval_p(const TP_Node *n, double x, double y, const double *params);
+
+/* avaliação em double-double (zoom profundo): + - * / e potência inteira
+   são estendidas; funções usam correção de 1a ordem sobre a parte baixa */
+TP_DD tp_eval_dd(const TP_Node *n, TP_DD x);
+TP_DD tp_eval_dd_p(const TP_Node *n, TP_DD x, const double *params);
+
+/* 1 se a expressão referencia y (campo escalar) */
+int tp_ast_uses_y(const TP_Node *n);
+
+/* texto em pré-ordem numa linha (cache em disco); números em hex (%a),
+   sem perda. write: 1 OK; read: NULL se inválido */
+int tp_ast_write(const TP_Node *n, FILE *f);
+TP_Node *tp_ast_read(FILE *f);
+
 #endif
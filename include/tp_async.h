@@ -0,0 +1,66 @@
+#ifndef TP_ASYNC_H
+#define TP_ASYNC_H
+
+#include <SDL2/SDL.h>
+#include "tp_sample.h"
+
+/* Amostragem em thread dedicada.
+   A thread de render manda "snapshots" da chave (n, t0, t1, parâmetros,
+   tolerância) e só
+   apresenta o último resultado publicado. O worker publica por um
+   triple buffer lock-free: escrever nunca bloqueia ler e vice-versa. */
+
+typedef struct TP_AsyncFrame {
+    TP_Sampler samples;
+    unsigned int seq;   /* requisição que gerou este frame */
+    int failed;         /* 1: sem memória para seq; samples inválido */
+} TP_AsyncFrame;
+
+typedef struct TP_AsyncSampler {
+    const TP_Program *px, *py;
+
+    SDL_Thread *thread;
+    SDL_mutex *lock;
+    SDL_cond *wake;
+
+    /* requisição corrente (protegida por lock) */
+    int req_n;
+    double req_t0, req_t1;
+    double req_params[TP_PARAM_MAX];
+    int req_has_params;
+    double req_tol;
+    SDL_atomic_t req_seq;
+    SDL_atomic_t quit;
+
+    /* triple buffer: back (worker), front (render), middle (troca) */
+    TP_AsyncFrame frames[3];
+    SDL_atomic_t middle;   /* índice | TP_ASYNC_FRESH */
+    int back;
+    int front;
+
+    double slice_ms;       /* publica resultados parciais a cada fatia */
+} TP_AsyncSampler;
+
+/* py == NULL: y = f(x). Retorna 0 se OK. */
+int tp_async_start(TP_AsyncSampler *as,
+                   const TP_Program *px, const TP_Program *py,
+                   double slice_ms);
+void tp_async_stop(TP_AsyncSampler *as);
+
+/* Pede amostras para a chave; só acorda o worker se a chave mudou.
+   params: parâmetros nomeados (TP_PARAM_MAX) ou NULL.
+   tol: ver tp_sampler_set_tolerance (0 = sem estágio por curvatura). */
+void tp_async_request(TP_AsyncSampler *as, int n, double t0, double t1,
+                      const double *params, double tol);
+
+/* Último frame publicado (nunca bloqueia; pode ser de uma chave antiga). */
+const TP_AsyncFrame *tp_async_latest(TP_AsyncSampler *as);
+
+/* 1 se o frame é o resultado completo da última requisição */
+int tp_async_frame_current(TP_AsyncSampler *as, const TP_AsyncFrame *f);
+
+/* Espera (bloqueando) o resultado completo da última requisição; volta
+   também com o frame marcado failed se o worker ficou sem memória. */
+const TP_AsyncFrame *tp_async_wait(TP_AsyncSampler *as);
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef TP_CACHE_H
+#define TP_CACHE_H
+
+#include <SDL2/SDL.h>
+#include "tp_ast.h"
+#include "tp_prog.h"
+
+/* Cache LRU de expressões compiladas (AST + bytecode).
+   Chave: texto normalizado (sem espaços supérfluos nem \left \right
+   \quad \; \, \: \!), então "\left( 2 x \right)" e "(2x)" caem na
+   mesma entrada. Com parâmetros nomeados (--param) os nomes entram na
+   chave: mudar valores não passa por aqui. Thread-safe. */
+
+#define TP_CACHE_CAPACITY 256   /* entradas (default) */
+
+typedef struct TP_Compiled TP_Compiled;
+
+struct TP_Compiled {
+    TP_Node *ast;
+    TP_Program *prog_a;   /* y = f(x), z = f(x,y) ou x(t) da tupla */
+    TP_Program *prog_b;   /* y(t) da tupla; NULL caso contrário */
+    int is_tuple;
+    int is_field;         /* usa y: heatmap */
+
+    /* interno */
+    char *key;
+    unsigned long hash;
+    SDL_atomic_t refs;
+    TP_Compiled *prev, *next;   /* lista LRU (head = mais recente) */
+    TP_Compiled *chain;         /* bucket da tabela hash */
+
+    /* última grafia crua vista: repetição exata nem passa pelo lexer */
+    char *raw;
+    unsigned long raw_hash;
+    TP_Compiled *raw_chain;
+};
+
+typedef struct TP_Cache {
+    SDL_mutex *lock;
+
+    TP_Compiled **buckets;
+    TP_Compiled **raw_buckets;
+    int n_buckets;
+
+    TP_Compiled *head, *tail;
+    int count, capacity;
+
+    unsigned long hits, misses;
+    int dirty;    /* entradas novas desde o último load/save */
+} TP_Cache;
+
+/* 0 OK; 1 sem memória */
+int tp_cache_init(TP_Cache *c, int capacity);
+void tp_cache_free(TP_Cache *c);
+
+/* Devolve a expressão compilada (com referência: liberar com
+   tp_compiled_release). Retorna:
+   0 OK
+   1 erro de parse (errbuf com coluna e mensagem)
+   2 falha ao compilar / memória
+   params[0..n_params): nomes dos parâmetros nomeados (SLOTs livres
+   0..n_params-1 na árvore; ver tp_parser.h). */
+int tp_cache_get(TP_Cache *c, const char *src,
+                 const char *const *params, int n_params,
+                 TP_Compiled **out, char *errbuf, int errbuf_sz);
+
+void tp_compiled_release(TP_Compiled *e);
+
+/* chave normalizada (malloc); NULL sem memória */
+char *tp_cache_normalize(const char *src);
+
+/* Arquivo de cache (texto, versionado): AST e bytecode já otimizados.
+   load: 0 OK (arquivo ausente também é OK), 1 arquivo inválido.
+   save: 0 OK, 1 erro de escrita. */
+int tp_cache_load(TP_Cache *c, const char *path);
+int tp_cache_save(TP_Cache *c, const char *path);
+
+#endif
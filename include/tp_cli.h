@@ -2,6 +2,19 @@
 #define TP_CLI_H
 
 #include "tp_view.h"
+#include "tp_ast.h"
+
+/* --stream-window sem valor */
+#define TP_STREAM_WINDOW_DEFAULT 20000
+
+/* --param nome=valor[:min:max] */
+#define TP_PARAM_NAME_MAX 32
+
+typedef struct TP_ParamSpec {
+    char name[TP_PARAM_NAME_MAX];
+    double value;
+    double min, max;   /* faixa do slider/animação */
+} TP_ParamSpec;
 
 typedef struct TP_Args {
     const char *expr;
@@ -22,6 +35,50 @@ typedef struct TP_Args {
     /* parametric range */
     double tmin, tmax;
 
+    /* heatmap z = f(x,y): range fixo do colormap */
+    int has_zrange;
+    double zmin, zmax;
+
+    /* progressivo: orçamento de avaliação por frame (0 = sem limite) */
+    double budget_ms;
+
+    /* amostragem numa thread separada (render só apresenta o último resultado) */
+    int async_sampling;
+
+    /* profiling: overlay de tempos por estágio e Chrome trace (NULL = sem) */
+    int show_stats;
+    const char *trace_path;
+
+    /* parâmetros nomeados da expressão (ajustáveis sem re-parse) */
+    TP_ParamSpec params[TP_PARAM_MAX];
+    int n_params;
+
+    /* y = f(x): curva de f' (derivada simbólica), marcas de zeros,
+       extremos e cruzamentos, e o relatório deles em JSON ("-" = stdout) */
+    int show_deriv;
+    int show_marks;
+    const char *analysis_path;
+
+    /* série de dados (CSV ou .f64) sobreposta à curva; NULL = sem.
+       lod_path: sidecar da pirâmide min/max (reabre sem reler o arquivo) */
+    const char *data_path;
+    const char *lod_path;
+
+    /* série ao vivo: "-" (stdin) ou socket Unix; NULL = sem.
+       stream_window: N pontos mais recentes na tela */
+    const char *stream_path;
+    int stream_window;
+
+    /* servidor de tiles (0 = janela normal); tile_dir: cache em disco */
+    int serve_port;
+    const char *tile_dir;
+
+    /* daemon de render num socket Unix (NULL = sem) */
+    const char *daemon_path;
+
+    /* cache de expressões compiladas em disco (NULL = só em memória) */
+    const char *cache_path;
+
     /* screenshot */
     const char *out_path; /* default "tatuplot.bmp" se NULL */
     int shot_once;        /* se 1: salva e sai */
@@ -30,11 +87,15 @@ typedef struct TP_Args {
 /* retorna:
    0 OK
    1 erro (errbuf)
-   2 help impresso
+   2 pediu ajuda (-h/--help); quem chama decide se imprime
 */
 int tp_args_parse(int argc, char **argv, TP_Args *out,
                   char *errbuf, int errbuf_sz);
 
 void tp_args_print_help(const char *prog);
 
+/* 1 se path termina em ext (ext em minúsculas, com o ponto); sem
+   diferenciar maiúsculas. Escolhe formato por --out, --data etc. */
+int tp_path_has_ext(const char *path, const char *ext);
+
 #endif
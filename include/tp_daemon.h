@@ -0,0 +1,56 @@
+#ifndef TP_DAEMON_H
+#define TP_DAEMON_H
+
+#include <SDL2/SDL.h>
+#include "tp_cache.h"
+#include "tp_net.h"
+
+/* Daemon de render: escuta num socket Unix e atende pedidos com as
+   mesmas opções da CLI, um por linha, sem subir processo nem SDL de
+   novo a cada gráfico. Cada thread do pool guarda renderer, framebuffer
+   e amostras (TP_FrameCtx) entre pedidos; as expressões compiladas
+   ficam no TP_Cache compartilhado.
+
+   Pedido: uma linha com os argumentos separados por espaço; "..."
+   agrupa (dentro, \" é aspa; as outras barras passam como estão):
+       --expr "\sin(x)" --width 400 --height 300
+   Resposta:
+       IMG <n>\n seguido de n bytes de BMP     (sem --out)
+       OK <caminho>\n                          (--out .bmp/.svg/.pdf)
+       ERRO <mensagem>\n
+   Uma conexão pode mandar vários pedidos; saem na ordem. Linha vazia
+   não tem resposta. Conexão ociosa entre pedidos é fechada quando
+   outras esperam uma thread (o cliente reconecta). */
+
+/* bytes de uma linha de pedido */
+#define TP_DAEMON_LINE 8192
+
+/* argumentos por pedido */
+#define TP_DAEMON_ARGS 128
+
+/* conexões esperando uma thread */
+#define TP_DAEMON_QUEUE 64
+
+typedef struct TP_Daemon {
+    TP_Cache *cache;
+    const char *path;        /* do socket (removido no close) */
+    int fd;
+    TP_NetPool pool;
+
+    SDL_atomic_t requests, failures;
+} TP_Daemon;
+
+/* Escuta em path e sobe as threads. Retorna 0 se OK; senão 1 com a
+   mensagem em err. */
+int tp_daemon_open(TP_Daemon *d, const char *path, TP_Cache *cache, char *err, int err_sz);
+
+/* Aceita conexões até SIGINT/SIGTERM (ou d->pool.quit). */
+void tp_daemon_run(TP_Daemon *d);
+
+void tp_daemon_close(TP_Daemon *d);
+
+/* Separa a linha (in-place) em argv; argv[0] = "tatuplot". Retorna
+   argc, ou -1 com aspa aberta ou argumentos demais. */
+int tp_daemon_split(char *line, char **argv, int max);
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef TP_DATA_H
+#define TP_DATA_H
+
+#include <stddef.h>
+
+/* Série de dados medidos lida de arquivo mapeado em memória (mmap):
+   nada é copiado para a RAM do processo; as páginas vêm do page cache
+   sob demanda, então arquivos de centenas de milhões de pontos abrem
+   sem carregar tudo.
+
+   Formatos (pela extensão):
+   - .f64 / .bin: pares (x, y) de double little-endian intercalados
+   - resto (CSV): uma linha por ponto; "x,y" (separador , ; tab ou
+     espaço; colunas extras ignoradas) ou só "y" (x = índice do ponto).
+     Linhas vazias, "#..." e cabeçalhos não numéricos são pulados. */
+
+typedef enum TP_DataFormat {
+    TP_DATA_CSV,
+    TP_DATA_F64
+} TP_DataFormat;
+
+typedef struct TP_Data {
+    const char *base;      /* mapeamento (somente leitura) */
+    size_t size;
+    long long mtime;       /* do arquivo (valida o sidecar do LOD) */
+    TP_DataFormat fmt;
+    int y_only;            /* CSV de uma coluna */
+
+    /* da varredura de abertura (ou do LOD) */
+    size_t n;              /* pontos */
+    double xmin, xmax, ymin, ymax;   /* só valores finitos */
+    int has_bounds;
+    int x_sorted;          /* x não decrescente (permite busca em .f64) */
+} TP_Data;
+
+/* Percurso sem alocação, em ordem de arquivo */
+typedef struct TP_DataCursor {
+    const TP_Data *d;
+    size_t pos;            /* byte */
+    size_t end;            /* linhas que começam daqui em diante ficam de fora */
+    size_t i;              /* índice do próximo ponto */
+} TP_DataCursor;
+
+/* Só mapeia (n e limites zerados: tp_data_scan ou tp_lod_open).
+   Retorna 0 se OK; senão 1 com a mensagem em err. */
+int tp_data_map(TP_Data *d, const char *path, char *err, int err_sz);
+
+/* Uma passada serial: contagem, limites e ordem. Retorna 0 se há pontos. */
+int tp_data_scan(TP_Data *d);
+
+/* map + scan */
+int tp_data_open(TP_Data *d, const char *path, char *err, int err_sz);
+void tp_data_close(TP_Data *d);
+
+void tp_data_cursor(const TP_Data *d, TP_DataCursor *c);
+
+/* Percurso de [pos, end) começando no ponto de índice i; pos no início
+   de uma linha (tp_data_line_start) ou de um par .f64 */
+void tp_data_cursor_at(const TP_Data *d, TP_DataCursor *c, size_t pos, size_t end, size_t i);
+
+/* Início da primeira linha (ou par .f64) em pos ou depois */
+size_t tp_data_line_start(const TP_Data *d, size_t pos);
+
+/* .f64 com x ordenado: posiciona no último ponto com x < x0 (para a
+   linha entrar pela borda). Outros casos: início. */
+void tp_data_seek(TP_DataCursor *c, double x0);
+
+/* Próximo ponto. Retorna 0 no fim. NaN/inf passam (o chamador quebra a linha). */
+int tp_data_next(TP_DataCursor *c, double *x, double *y);
+
+/* Colunas numéricas (até 2) no início da linha [p, eol), sem o '\n'.
+   0: linha vazia, comentário ou cabeçalho. */
+int tp_data_fields(const char *p, const char *eol, double v[2]);
+
+/* Lê um double em [p, end) sem alocar nem exigir '\0' (o mapeamento
+   não termina em '\0'). Caminho rápido exato para até 19 dígitos e
+   expoente decimal pequeno; o resto cai em strtod sobre cópia local.
+   Retorna o ponteiro após o número ou NULL se não há número. */
+const char *tp_parse_double(const char *p, const char *end, double *out);
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef TP_DD_H
+#define TP_DD_H
+
+/* double-double: valor = hi + lo, ~106 bits de mantissa.
+   Usado no zoom profundo, quando a largura de um pixel fica abaixo
+   de algumas ulps de double das coordenadas. */
+
+typedef struct TP_DD {
+    double hi, lo;
+} TP_DD;
+
+static inline TP_DD tp_dd(double hi) {
+    TP_DD r = { hi, 0.0 };
+    return r;
+}
+
+static inline double tp_dd_to_double(TP_DD a) { return a.hi + a.lo; }
+
+/* soma exata (Knuth) */
+static inline TP_DD tp_dd_two_sum(double a, double b) {
+    TP_DD r;
+    r.hi = a + b;
+    double bb = r.hi - a;
+    r.lo = (a - (r.hi - bb)) + (b - bb);
+    return r;
+}
+
+static inline TP_DD tp_dd_quick_two_sum(double a, double b) {
+    TP_DD r;
+    r.hi = a + b;
+    r.lo = b - (r.hi - a);
+    return r;
+}
+
+/* produto exato (Dekker, sem depender de fma) */
+static inline TP_DD tp_dd_two_prod(double a, double b) {
+    const double split = 134217729.0; /* 2^27 + 1 */
+    double ca = split * a, cb = split * b;
+    double ah = ca - (ca - a), al = a - ah;
+    double bh = cb - (cb - b), bl = b - bh;
+    TP_DD r;
+    r.hi = a * b;
+    r.lo = ((ah * bh - r.hi) + ah * bl + al * bh) + al * bl;
+    return r;
+}
+
+static inline TP_DD tp_dd_neg(TP_DD a) {
+    TP_DD r = { -a.hi, -a.lo };
+    return r;
+}
+
+static inline TP_DD tp_dd_add(TP_DD a, TP_DD b) {
+    TP_DD s = tp_dd_two_sum(a.hi, b.hi);
+    TP_DD t = tp_dd_two_sum(a.lo, b.lo);
+    s.lo += t.hi;
+    s = tp_dd_quick_two_sum(s.hi, s.lo);
+    s.lo += t.lo;
+    return tp_dd_quick_two_sum(s.hi, s.lo);
+}
+
+static inline TP_DD tp_dd_sub(TP_DD a, TP_DD b) {
+    return tp_dd_add(a, tp_dd_neg(b));
+}
+
+static inline TP_DD tp_dd_add_d(TP_DD a, double b) {
+    TP_DD s = tp_dd_two_sum(a.hi, b);
+    s.lo += a.lo;
+    return tp_dd_quick_two_sum(s.hi, s.lo);
+}
+
+static inline TP_DD tp_dd_mul(TP_DD a, TP_DD b) {
+    TP_DD p = tp_dd_two_prod(a.hi, b.hi);
+    p.lo += a.hi * b.lo + a.lo * b.hi;
+    return tp_dd_quick_two_sum(p.hi, p.lo);
+}
+
+static inline TP_DD tp_dd_mul_d(TP_DD a, double b) {
+    TP_DD p = tp_dd_two_prod(a.hi, b);
+    p.lo += a.lo * b;
+    return tp_dd_quick_two_sum(p.hi, p.lo);
+}
+
+static inline TP_DD tp_dd_div(TP_DD a, TP_DD b) {
+    double q1 = a.hi / b.hi;
+    TP_DD r = tp_dd_sub(a, tp_dd_mul_d(b, q1));
+    double q2 = r.hi / b.hi;
+    r = tp_dd_sub(r, tp_dd_mul_d(b, q2));
+    double q3 = r.hi / b.hi;
+    TP_DD q = tp_dd_quick_two_sum(q1, q2);
+    return tp_dd_add_d(q, q3);
+}
+
+#endif
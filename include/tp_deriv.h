@@ -0,0 +1,19 @@
+#ifndef TP_DERIV_H
+#define TP_DERIV_H
+
+#include "tp_ast.h"
+
+/* Derivada simbólica em x (y e parâmetros nomeados são constantes).
+
+   Cobre todos os nós avaliáveis: + - * / \frac, potência (expoente
+   constante, base constante ou geral) e todas as TP_Func1. LET ganha um
+   LET irmão com a derivada do valor (slot + deslocamento), então cada
+   definição continua calculada uma vez. Tupla: derivada de cada
+   componente (em t).
+
+   O resultado já sai simplificado na construção (0 + a, 1 * a, a^1,
+   constantes dobradas), sem recursão: árvores fundas funcionam.
+   NULL sem memória ou se a árvore tem PARAM (template de função). */
+TP_Node *tp_ast_derive(const TP_Node *n);
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef TP_FRAME_H
+#define TP_FRAME_H
+
+#include <SDL2/SDL.h>
+#include "tp_view.h"
+#include "tp_ast.h"
+#include "tp_prog.h"
+#include "tp_data.h"
+#include "tp_lod.h"
+#include "tp_sample.h"
+#include "tp_heatmap.h"
+#include "tp_render.h"
+#include "tp_cli.h"
+
+/* Frame completo sem janela (renderer por software): grade, eixos,
+   heatmap, série de dados e curvas, com as amostras inteiras de uma
+   vez. Base dos tiles (--serve) e do daemon (--daemon). */
+
+/* cor da curva de f' */
+#define TP_DERIV_R 230
+#define TP_DERIV_G 160
+#define TP_DERIV_B 0
+
+/* cor da série de dados (--data) */
+#define TP_DATA_R 90
+#define TP_DATA_G 170
+#define TP_DATA_B 255
+
+/* --data sem --expr: curva que não desenha nada (NaN em todo x) */
+#define TP_NO_EXPR "\\frac{0}{0}"
+
+/* paramétrica: amostras em t (não dependem da viewport) */
+#define TP_FRAME_PARAM_STEPS 3000
+
+/* y = f(x): erro de corda aceito no estágio por curvatura do sampler */
+#define TP_CURVE_TOL_PX 0.5
+
+/* Tudo que define o desenho (nada é do frame: só ponteiros) */
+typedef struct TP_FrameScene {
+    const TP_Program *prog_a, *prog_b;   /* prog_b: y(t) da tupla */
+    const TP_Program *prog_d;            /* f' (NULL = sem) */
+    int is_tuple, is_field;
+    const double *params;                /* NULL sem parâmetros */
+    int n_params;
+    double tmin, tmax;                   /* tupla */
+
+    const TP_Data *data;                 /* NULL sem série */
+    const TP_Lod *lod;
+
+    unsigned char bg_r, bg_g, bg_b;
+    unsigned char fg_r, fg_g, fg_b;
+    unsigned char data_r, data_g, data_b;
+
+    int has_zrange;                      /* sem: auto-range por frame */
+    double zmin, zmax;
+} TP_FrameScene;
+
+/* Surface, renderer e amostras reaproveitados entre frames (um por
+   thread); recriados só quando o tamanho muda. */
+typedef struct TP_FrameCtx {
+    int w, h;
+    SDL_Surface *surf;
+    SDL_Renderer *r;
+    SDL_Texture *heat_tex;   /* criada no primeiro heatmap */
+    Uint32 *pixels;          /* ARGB8888 do último frame (w*h) */
+    TP_Sampler sampler, dsampler;
+    TP_Heatmap heat;
+} TP_FrameCtx;
+
+void tp_frame_ctx_init(TP_FrameCtx *c);
+void tp_frame_ctx_free(TP_FrameCtx *c);
+
+/* Cena nova no mesmo contexto: descarta as amostras (a chave do sampler
+   é só o range, não o programa). */
+void tp_frame_ctx_reset(TP_FrameCtx *c);
+
+/* Desenha a cena em w x h e lê os pixels para c->pixels; vec (pode ser
+   NULL) recebe as mesmas linhas. Retorna 0 se OK, -1 sem memória. */
+int tp_frame_draw(const TP_FrameScene *s, TP_FrameCtx *c,
+                  const TP_View *v, int w, int h, TP_Vec *vec);
+
+/* Só as curvas (f' e f; campo: nada) em out, sem fundo, grade nem
+   leitura de pixels: não precisa de renderer. Retorna 0 ou -1. */
+int tp_frame_draw_curves(const TP_FrameScene *s, TP_FrameCtx *c,
+                         const TP_View *v, int w, int h, const TP_Out *out);
+
+/* --data: mapeia o arquivo; a pirâmide min/max (paralela, ou do sidecar
+   lod_path) dá contagem e limites. Retorna 0 se OK; senão 1 com a
+   mensagem em err (nada fica aberto). */
+int tp_frame_open_data(TP_Data *d, TP_Lod *lod, const char *path, const char *lod_path,
+                       char *err, int err_sz);
+
+/* Viewport inicial e t-range como a janela abre: tupla sem --tmin/--tmax
+   usa xmin/xmax (ou [0, 2pi]) como t e ajusta a viewport à curva; série
+   de dados (data != NULL) ajusta os eixos sem range explícito. */
+void tp_frame_initial_view(const TP_Args *a, const TP_Node *ast, int is_tuple,
+                           const double *params, const TP_Data *data,
+                           TP_View *view, double *tmin, double *tmax);
+
+/* Tupla: viewport nos limites da curva em [tmin, tmax] (+5%) */
+void tp_frame_fit_tuple(TP_View *view, const TP_Node *ast, const double *params,
+                        double tmin, double tmax);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef TP_HEATMAP_H
+#define TP_HEATMAP_H
+
+#include <SDL2/SDL.h>
+#include "tp_view.h"
+#include "tp_render.h"
+#include "tp_prog.h"
+
+#define TP_HEAT_LUT_SIZE 256
+#define TP_HEAT_MAX_THREADS 32
+
+/* Campo escalar z = f(x, y) pintado com colormap.
+   Buffers ficam no struct e são reaproveitados entre frames. */
+typedef struct TP_Heatmap {
+    int w, h;
+    float *z;          /* campo avaliado (w*h) */
+    Uint32 *pixels;    /* ARGB8888 (w*h) */
+
+    Uint32 lut[TP_HEAT_LUT_SIZE];
+    Uint32 nan_color;
+
+    /* pool persistente, criado no init: threads 1..nthreads-1 esperam
+       tarefa; a thread chamadora faz a parte 0 */
+    int nthreads;
+    SDL_Thread *threads[TP_HEAT_MAX_THREADS];
+    SDL_mutex *lock;
+    SDL_cond *go, *done;
+    unsigned gen;        /* incrementa a cada tarefa publicada */
+    int started;         /* índice da próxima thread do pool */
+    int running;         /* threads do pool ainda na tarefa atual */
+    int quit;
+    void (*task)(void *job, int idx);
+    void *task_job;
+    int task_n;          /* índices 0..task_n-1 trabalham */
+
+    /* range usado no último render */
+    double zmin, zmax;
+} TP_Heatmap;
+
+/* colormap estilo viridis (ARGB8888) */
+void tp_colormap_viridis(Uint32 lut[TP_HEAT_LUT_SIZE]);
+
+/* nthreads <= 0: uma por CPU. Sem threads (ou mutex) o render roda
+   na chamadora, sem erro. */
+void tp_heatmap_init(TP_Heatmap *hm, int nthreads);
+void tp_heatmap_free(TP_Heatmap *hm);
+
+/* Avalia o campo na viewport e preenche hm->pixels.
+   block > 1: avalia 1 amostra por bloco block x block (refinamento progressivo).
+   fixed_range: usa [zmin,zmax]; senão auto-range pelo min/max do campo.
+   params: valores dos parâmetros nomeados (NULL se não houver).
+   Retorna 0 se OK. */
+int tp_heatmap_render(TP_Heatmap *hm, const TP_Program *prog, const double *params,
+                      const TP_View *v, TP_Screen s, int block,
+                      int fixed_range, double zmin, double zmax);
+
+#endif
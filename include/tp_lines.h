@@ -0,0 +1,28 @@
+#ifndef TP_LINES_H
+#define TP_LINES_H
+
+/* Polilinhas em memória (biblioteca): as mesmas linhas que vão para a
+   tela, em pixels sem arredondar. Segmento que começa no último ponto
+   continua a polilinha aberta; qualquer outro abre uma nova. Sem cor:
+   quem desenha manda só a curva que interessa. */
+
+typedef struct TP_Lines {
+    double *pt;          /* x, y intercalados */
+    int n, cap;          /* pontos */
+    int *starts;         /* primeiro ponto de cada polilinha; starts[n_lines] = n */
+    int n_lines, cap_lines;
+    int failed;          /* faltou memória em algum momento */
+} TP_Lines;
+
+void tp_lines_init(TP_Lines *l);
+void tp_lines_free(TP_Lines *l);
+
+/* esvazia mantendo os buffers */
+void tp_lines_clear(TP_Lines *l);
+
+void tp_lines_line(TP_Lines *l, double x0, double y0, double x1, double y1);
+
+/* ponto isolado: polilinha de um ponto só */
+void tp_lines_point(TP_Lines *l, double x, double y);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef TP_LOD_H
+#define TP_LOD_H
+
+#include <stddef.h>
+#include "tp_data.h"
+
+/* pontos por bloco do nível 0 */
+#define TP_LOD_BLOCK 256
+
+/* blocos por nó nos níveis de cima */
+#define TP_LOD_FANOUT 8
+
+#define TP_LOD_MAX_LEVELS 24
+
+/* Nível 0: TP_LOD_BLOCK pontos consecutivos (o último bloco de cada
+   pedaço da construção paralela pode ser menor). Guarda onde o bloco
+   começa no arquivo e os 4 valores que bastam para desenhar a linha
+   dentro de uma coluna de pixels: primeiro, último, mínimo e máximo. */
+typedef struct TP_LodBlock {
+    size_t pos;            /* byte do primeiro ponto */
+    size_t i0;             /* índice do primeiro ponto */
+    double x0, x1;         /* x do primeiro e do último ponto */
+    double y0, y1;         /* y do primeiro e do último (NaN quebra a linha) */
+    double ymin, ymax;     /* só finitos; bloco sem nenhum: +inf/-inf */
+} TP_LodBlock;
+
+/* Pirâmide min/max sobre uma TP_Data com x ordenado: qualquer viewport
+   sai em O(largura da tela · log n) por frame, não O(pontos). */
+typedef struct TP_Lod {
+    TP_LodBlock *blk;
+    size_t n_blk;
+
+    /* níveis 1..n_levels-1: nó j cobre TP_LOD_FANOUT nós do nível de baixo */
+    double *ymin[TP_LOD_MAX_LEVELS], *ymax[TP_LOD_MAX_LEVELS];
+    size_t n_node[TP_LOD_MAX_LEVELS];
+    int n_levels;
+
+    int nthreads;
+} TP_Lod;
+
+void tp_lod_init(TP_Lod *l);
+void tp_lod_free(TP_Lod *l);
+
+/* Carrega o sidecar (se path e ele bate com tamanho/mtime do arquivo) ou
+   constrói em paralelo (e grava em path, se dado). Preenche n, limites e
+   x_sorted de d. Retorna 0 se OK, 1 sem pontos, -1 se faltou memória. */
+int tp_lod_open(TP_Lod *l, TP_Data *d, const char *path);
+
+/* Blocos [k0, k1): mínimo e máximo finitos (+inf/-inf se nenhum) */
+void tp_lod_range(const TP_Lod *l, size_t k0, size_t k1, double *ymin, double *ymax);
+
+/* Primeiro bloco em [from, n_blk) com x0 >= x (n_blk se nenhum) */
+size_t tp_lod_find(const TP_Lod *l, size_t from, double x);
+
+#endif
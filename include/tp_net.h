@@ -0,0 +1,70 @@
+#ifndef TP_NET_H
+#define TP_NET_H
+
+#include <SDL2/SDL.h>
+#include <stddef.h>
+
+/* Peças de rede comuns à série ao vivo (tp_stream), ao servidor de
+   tiles (tp_tile) e ao daemon (tp_daemon): socket Unix em escuta,
+   envio com prazo e um pool de threads alimentado por uma fila de
+   conexões aceitas. */
+
+/* espera máxima em poll(): quanto o laço de accept demora a ver o sinal */
+#define TP_NET_POLL_MS 100
+
+/* limite da fila de conexões esperando uma thread */
+#define TP_NET_QUEUE 256
+
+/* threads mesmo com poucas CPUs; no máximo */
+#define TP_NET_MIN_THREADS 4
+#define TP_NET_MAX_THREADS 32
+
+/* Escuta em path (socket Unix). Socket esquecido por uma execução
+   anterior é removido; arquivo comum não. Retorna o fd, ou -1 com a
+   mensagem em err. */
+int tp_net_listen_unix(const char *path, int backlog, char *err, int err_sz);
+
+/* Tudo ou nada; MSG_NOSIGNAL: cliente que fechou não derruba o
+   processo. Cliente que não lê por timeout_ms (< 0: sem prazo) faz o
+   envio falhar. Retorna 0 ou -1. */
+int tp_net_send_all(int fd, const void *p, size_t n, int timeout_ms);
+
+/* Fila de conexões + threads. Cada thread roda o worker do dono, que
+   guarda seu estado na própria pilha e pega conexões com
+   tp_net_pool_next até receber -1. */
+typedef struct TP_NetPool {
+    int fd;                  /* em escuta (do dono: o pool não fecha) */
+
+    SDL_mutex *lock;
+    SDL_cond *conn_ready;    /* conexão na fila (ou quit) */
+    int queue[TP_NET_QUEUE];
+    int q_head, q_count, q_max;
+
+    SDL_Thread *threads[TP_NET_MAX_THREADS];
+    int nthreads;
+    SDL_atomic_t quit;
+} TP_NetPool;
+
+/* Sobe de TP_NET_MIN_THREADS a TP_NET_MAX_THREADS threads (uma por CPU)
+   rodando worker(user); a fila guarda até q_max conexões. Retorna 0 se
+   OK; senão 1 com a mensagem em err (nada fica de pé). */
+int tp_net_pool_start(TP_NetPool *p, int fd, int q_max,
+                      SDL_ThreadFunction worker, const char *name, void *user,
+                      char *err, int err_sz);
+
+/* Próxima conexão da fila (bloqueia); -1 quando o pool para. Quem
+   recebe fecha o fd. */
+int tp_net_pool_next(TP_NetPool *p);
+
+/* conexões na fila esperando uma thread */
+int tp_net_pool_waiting(TP_NetPool *p);
+
+/* Aceita conexões até SIGINT/SIGTERM (ou quit). Fila cheia: um send
+   de busy sem bloquear (o que não couber se perde) e a conexão é
+   fechada. */
+void tp_net_pool_run(TP_NetPool *p, const void *busy, size_t busy_len);
+
+/* Para as threads e fecha as conexões ainda na fila. */
+void tp_net_pool_stop(TP_NetPool *p);
+
+#endif
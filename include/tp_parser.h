@@ -5,14 +5,33 @@
 #include "tp_token.h"
 #include "tp_ast.h"
 
+/* Limite de frames da pilha explícita do parser (cada nível de
+   parêntese, \frac, função ou '-' ocupa de 1 a 3). Acima disso:
+   erro "expressao muito aninhada". */
+#define TP_PARSE_MAX_DEPTH 100000
+
+struct TP_SymTab;
+
 typedef struct TP_Parser {
     TP_Lexer lx;
     const char *error;
     size_t error_pos;
     size_t error_col;
+    int max_depth;   /* tp_parse_init põe o default; pode ser alterado antes do parse */
+    struct TP_SymTab *syms;   /* definições (a = ...; f(u) = ...;) durante tp_parse_expr */
+
+    /* parâmetros nomeados (--param): params[i] vira SLOT livre i, com
+       valor dado na avaliação (tp_eval_p, tp_prog_eval_batch_p).
+       tp_parse_init zera; definir antes do parse. */
+    const char *const *params;
+    int n_params;
 } TP_Parser;
 
 void tp_parse_init(TP_Parser *p, const char *src);
+
+/* programa := (definição ';')* expr
+   definição := nome '=' expr | nome '(' param {',' param} ')' '=' expr
+   Nomes já resolvidos na árvore devolvida (ver tp_sym.h). */
 TP_Node *tp_parse_expr(TP_Parser *p);
 
 #endif
@@ -5,18 +5,67 @@
 #include "tp_view.h"
 #include "tp_render.h"
 #include "tp_ast.h"
+#include "tp_sample.h"
+#include "tp_analysis.h"
+#include "tp_data.h"
+#include "tp_lod.h"
+#include "tp_stream.h"
 
 /* y = f(x) */
-void tp_draw_function(SDL_Renderer *r,
+void tp_draw_function(const TP_Out *o,
                       const TP_View *v, TP_Screen s,
                       const TP_Node *expr,
                       unsigned char fr, unsigned char fg, unsigned char fb);
 
 /* curva paramétrica: (x(t), y(t)) */
-void tp_draw_parametric(SDL_Renderer *r,
+void tp_draw_parametric(const TP_Out *o,
                         const TP_View *v, TP_Screen s,
                         const TP_Node *xexpr, const TP_Node *yexpr,
                         double tmin, double tmax, int steps,
                         unsigned char fr, unsigned char fg, unsigned char fb);
 
+/* y = f(x) em zoom profundo: coordenadas e avaliação em double-double
+   (params: parâmetros nomeados ou NULL) */
+void tp_draw_function_dd(const TP_Out *o,
+                         const TP_ViewDD *v, TP_Screen s,
+                         const TP_Node *expr, const double *params,
+                         unsigned char fr, unsigned char fg, unsigned char fb);
+
+/* Desenha só as amostras já prontas de um TP_Sampler (refinamento
+   progressivo): liga amostras prontas consecutivas. */
+void tp_draw_function_samples(const TP_Out *o,
+                              const TP_View *v, TP_Screen s,
+                              const TP_Sampler *sm,
+                              unsigned char fr, unsigned char fg, unsigned char fb);
+
+void tp_draw_parametric_samples(const TP_Out *o,
+                                const TP_View *v, TP_Screen s,
+                                const TP_Sampler *sm,
+                                unsigned char fr, unsigned char fg, unsigned char fb);
+
+/* Série de dados: liga pontos consecutivos em ordem de arquivo (NaN
+   quebra a linha). Com x ordenado e lod (pode ser NULL): mais de um
+   bloco por coluna vira envelope min/max por coluna, O(largura · log n);
+   menos que isso, ponto a ponto só a partir da borda esquerda. Retorna
+   os passos no LOD (colunas agregadas + blocos lidos ponto a ponto; 0
+   sem lod), no máximo uns 2 por coluna. */
+size_t tp_draw_data(const TP_Out *o,
+                    const TP_View *v, TP_Screen s,
+                    const TP_Data *d, const TP_Lod *lod,
+                    unsigned char fr, unsigned char fg, unsigned char fb);
+
+/* Janela ao vivo: polilinha pelos baldes (primeiro, mínimo/máximo na
+   ordem de chegada, último), O(baldes) por frame qualquer que seja N */
+void tp_draw_stream(const TP_Out *o,
+                    const TP_View *v, TP_Screen s,
+                    const TP_StreamWin *w,
+                    unsigned char fr, unsigned char fg, unsigned char fb);
+
+/* zeros (losango), extremos (triângulo: ponta para cima no máximo) e
+   cruzamentos (X) */
+void tp_draw_features(const TP_Out *o,
+                      const TP_View *v, TP_Screen s,
+                      const TP_Analysis *a,
+                      unsigned char fr, unsigned char fg, unsigned char fb);
+
 #endif
@@ -0,0 +1,51 @@
+#ifndef TP_PROF_H
+#define TP_PROF_H
+
+#include <SDL2/SDL.h>
+#include "tp_render.h"
+
+/* Timers por estágio do frame.
+   Com TP_PROFILE (default no Makefile; `make PROFILE=0` desliga) os macros
+   medem com SDL_GetPerformanceCounter; sem ele viram nada. */
+
+typedef enum TP_ProfStage {
+    TP_STAGE_PARSE,
+    TP_STAGE_SAMPLE,
+    TP_STAGE_RASTER,
+    TP_STAGE_PRESENT,
+    TP_STAGE_SCREENSHOT,
+    TP_STAGE_FRAME,
+
+    TP_STAGE_COUNT
+} TP_ProfStage;
+
+const char *tp_prof_stage_name(TP_ProfStage st);
+
+/* registra um intervalo [t0,t1] (ticks do performance counter); thread-safe */
+void tp_prof_record(TP_ProfStage st, Uint64 t0, Uint64 t1);
+
+/* fecha o frame corrente: atualiza as médias exibidas no overlay */
+void tp_prof_frame_end(void);
+
+/* média móvel (ms) do estágio nos últimos frames */
+double tp_prof_stage_ms(TP_ProfStage st);
+
+/* Chrome trace (chrome://tracing, Perfetto). Retorna 0 se OK, 1 se
+   não abriu o arquivo (errno do fopen), 2 se compilado sem TP_PROFILE. */
+int tp_prof_trace_open(const char *path);
+void tp_prof_trace_close(void);
+
+/* barras por estágio no canto da tela (escala: frame de 60 Hz) */
+void tp_prof_draw_overlay(SDL_Renderer *r, TP_Screen s);
+
+#ifdef TP_PROFILE
+#define TP_PROF_BEGIN(st) const Uint64 tp_prof_t0_##st = SDL_GetPerformanceCounter()
+#define TP_PROF_END(st)   tp_prof_record(st, tp_prof_t0_##st, SDL_GetPerformanceCounter())
+#define TP_PROF_FRAME_END() tp_prof_frame_end()
+#else
+#define TP_PROF_BEGIN(st) ((void)0)
+#define TP_PROF_END(st)   ((void)0)
+#define TP_PROF_FRAME_END() ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef TP_PROG_H
+#define TP_PROG_H
+
+#include <stdio.h>
+#include "tp_ast.h"
+#include "tp_shape.h"
+
+/* Avaliação em lote: a AST é compilada para um bytecode de registradores
+   e cada instrução roda sobre um bloco de TP_LANES amostras (loops
+   simples que o compilador vetoriza). */
+
+#define TP_LANES 64
+
+typedef enum TP_OpCode {
+    TP_OP_CONST,
+    TP_OP_X,
+    TP_OP_Y,
+    TP_OP_PARAM,  /* parâmetro nomeado a (--param); nunca dobrado */
+
+    TP_OP_NEG,
+    TP_OP_ADD,
+    TP_OP_SUB,
+    TP_OP_MUL,
+    TP_OP_DIV,
+    TP_OP_POW,
+    TP_OP_POWI,   /* expoente inteiro constante (k) */
+
+    TP_OP_SIN,
+    TP_OP_COS,
+    TP_OP_TAN,
+    TP_OP_LOG,
+    TP_OP_EXP,
+    TP_OP_SQRT,
+
+    TP_OP_SINCOS  /* sin(a); a instrução seguinte é o COS de a e sai junto */
+} TP_OpCode;
+
+typedef struct TP_Instr {
+    TP_OpCode op;
+    int dst;
+    int a, b;
+    double k;
+} TP_Instr;
+
+typedef struct TP_Program {
+    TP_Instr *code;
+    int n_code;
+
+    int n_regs;
+    int out;      /* registrador com o resultado */
+    int out_b;    /* tp_prog_compile_tuple: registrador de y(t); -1 nos outros */
+
+    unsigned params;   /* bit i: lê o parâmetro i (mudar outros não muda o resultado) */
+
+    TP_Shape *shape;   /* forma reconhecida (tp_shape.h): avalia por ela, não pelo code */
+
+    /* x(t) de uma tupla: programa conjunto de x(t) e y(t) (dono; o
+       cache preenche, NULL = avaliar os dois separados) */
+    struct TP_Program *pair;
+} TP_Program;
+
+/* NULL se falhar (memória) ou se a expressão for tupla */
+TP_Program *tp_prog_compile(const TP_Node *n);
+void tp_prog_free(TP_Program *p);
+
+/* Tupla (x(t), y(t)) num programa só, com duas saídas (out, out_b):
+   subexpressões comuns dos dois lados calculadas uma vez, sin e cos do
+   mesmo argumento juntos (TP_OP_SINCOS) e cos(kt)/sin(kt) com k inteiro
+   pela recorrência de Chebyshev a partir de cos(t) e sin(t). Só para
+   tp_prog_eval_tuple_p. NULL se n não é tupla ou sem memória. */
+TP_Program *tp_prog_compile_tuple(const TP_Node *n);
+
+/* reconhece a forma de n (tp_shape_detect) para os kernels próprios;
+   tp_prog_compile já chama. Sem forma (ou sem memória) fica o bytecode. */
+void tp_prog_specialize(TP_Program *p, const TP_Node *n);
+
+/* bytecode em texto (cache em disco). write: 1 OK; read: NULL se
+   inválido (índices de registrador são validados) */
+int tp_prog_write(const TP_Program *p, FILE *f);
+TP_Program *tp_prog_read(FILE *f);
+
+/* out[i] = f(xs[i], ys[i]); ys pode ser NULL (y = NAN) */
+void tp_prog_eval_batch(const TP_Program *p,
+                        const double *xs, const double *ys,
+                        double *out, int n);
+
+/* idem com os valores dos parâmetros nomeados (TP_PARAM_MAX doubles;
+   NULL: parâmetros valem NAN) */
+void tp_prog_eval_batch_p(const TP_Program *p, const double *params,
+                          const double *xs, const double *ys,
+                          double *out, int n);
+
+/* xs[i] = x(ts[i]), ys[i] = y(ts[i]) numa passada por px->pair; sem
+   ele, px e py em separado */
+void tp_prog_eval_tuple_p(const TP_Program *px, const TP_Program *py,
+                          const double *params, const double *ts,
+                          double *xs, double *ys, int n);
+
+/* Jato de 2ª ordem (modo direto): valor, d/dx e d²/dx² numa passada,
+   nos mesmos blocos de TP_LANES. out sai idêntico a
+   tp_prog_eval_batch_p; y e parâmetros têm derivada 0. */
+void tp_prog_eval_jet_p(const TP_Program *p, const double *params,
+                        const double *xs, const double *ys,
+                        double *out, double *d1, double *d2, int n);
+
+#endif
@@ -3,6 +3,8 @@
 
 #include <SDL2/SDL.h>
 #include "tp_view.h"
+#include "tp_vector.h"
+#include "tp_lines.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -13,14 +15,47 @@ typedef struct TP_Screen {
     int h;
 } TP_Screen;
 
+/* Destino das linhas: a tela (r), um arquivo vetorial (vec) e/ou
+   polilinhas em memória (lines); todos podem receber o mesmo frame.
+   Coordenadas de tela em double: o SDL arredonda como
+   tp_world_to_screen, os outros guardam sem arredondar. */
+typedef struct TP_Out {
+    SDL_Renderer *r;
+    TP_Vec *vec;
+    TP_Lines *lines;
+} TP_Out;
+
+void tp_out_color(const TP_Out *o, unsigned char r, unsigned char g, unsigned char b);
+void tp_out_line(const TP_Out *o, double x0, double y0, double x1, double y1);
+void tp_out_point(const TP_Out *o, double x, double y);
+
+/* n pontos ligados em sequência (mesmos segmentos que n-1 tp_out_line);
+   no renderer cada ponto é arredondado uma vez e vai em lotes para
+   SDL_RenderDrawLines */
+void tp_out_polyline(const TP_Out *o, const double *x, const double *y, int n);
+
 void tp_world_to_screen(const TP_View *v, TP_Screen s,
                         double x, double y, int *sx, int *sy);
 
+/* sem arredondar (lround disso é tp_world_to_screen) */
+void tp_world_to_screen_f(const TP_View *v, TP_Screen s,
+                          double x, double y, double *sx, double *sy);
+
 void tp_screen_to_world(const TP_View *v, TP_Screen s,
                         int sx, int sy, double *x, double *y);
 
-void tp_draw_grid(SDL_Renderer *r, const TP_View *v, TP_Screen s);
-void tp_draw_axes(SDL_Renderer *r, const TP_View *v, TP_Screen s);
+void tp_draw_grid(const TP_Out *o, const TP_View *v, TP_Screen s);
+void tp_draw_axes(const TP_Out *o, const TP_View *v, TP_Screen s);
+
+/* versões double-double (zoom profundo) */
+void tp_world_to_screen_dd(const TP_ViewDD *v, TP_Screen s,
+                           TP_DD x, TP_DD y, int *sx, int *sy);
+
+void tp_screen_to_world_dd(const TP_ViewDD *v, TP_Screen s,
+                           int sx, int sy, TP_DD *x, TP_DD *y);
+
+void tp_draw_grid_dd(const TP_Out *o, const TP_ViewDD *v, TP_Screen s);
+void tp_draw_axes_dd(const TP_Out *o, const TP_ViewDD *v, TP_Screen s);
 
 #ifdef __cplusplus
 }
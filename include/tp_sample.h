@@ -0,0 +1,88 @@
+#ifndef TP_SAMPLE_H
+#define TP_SAMPLE_H
+
+#include "tp_prog.h"
+
+/* passo do primeiro passe grosso (1 a cada 8 amostras) */
+#define TP_SAMPLE_COARSE 8
+
+/* y = f(x): no máximo tantos pedaços por intervalo no estágio por curvatura */
+#define TP_SAMPLE_SUB_MAX 16
+
+/* Amostras de uma curva com refinamento progressivo.
+   Cada passe avalia os índices múltiplos de `stride` ainda não feitos;
+   o stride cai pela metade até 1. O buffer é reaproveitado entre frames.
+
+   y = f(x): os passes avaliam em jato (f, f', f''). Depois deles, um
+   estágio final subdivide cada intervalo [i, i+1] pelo erro de corda
+   previsto |f''| h²/8 contra `tol`, e marca descontinuidades (salto
+   contra o sentido das duas tangentes). */
+typedef struct TP_Sampler {
+    int n, cap;
+    double *ts;            /* parâmetro da amostra (x da coluna ou t) */
+    double *xs, *ys;       /* ponto no mundo */
+    unsigned char *done;
+
+    int stride;            /* passe atual; 0 = completo */
+    int cursor;            /* próximo índice do passe atual */
+
+    /* chave do conteúdo: mudou => descarta tudo */
+    double t0, t1;
+    int valid;
+
+    /* parâmetros nomeados: mudar um refaz só a coordenada cujo
+       programa o lê (redo), reaproveitando a outra */
+    double params[TP_PARAM_MAX];
+    int has_params;
+    int redo;              /* TP_SAMPLE_X | TP_SAMPLE_Y a recalcular */
+
+    /* y = f(x): derivadas em cada amostra e subamostras por curvatura.
+       Intervalo i (i < adapted) tem sub_n[i] pontos em sub_x/sub_y,
+       em ordem (início = soma dos sub_n anteriores). */
+    double *d1s, *d2s;
+    unsigned char *sub_n;
+    unsigned char *brk;    /* 1: descontinuidade entre i e i+1 */
+    double *sub_x, *sub_y;
+    int n_sub, cap_sub;
+    int adapted;           /* intervalos já analisados; n-1 = completo */
+    double tol;            /* erro de corda aceito, unidades de y (0 = sem) */
+} TP_Sampler;
+
+#define TP_SAMPLE_X 1
+#define TP_SAMPLE_Y 2
+
+void tp_sampler_init(TP_Sampler *s);
+void tp_sampler_free(TP_Sampler *s);
+
+/* Garante n amostras em [t0,t1]. Se a chave mudou, cancela o refinamento
+   em andamento e recomeça do passe grosso. Retorna 1 se reiniciou, 0 se
+   manteve, -1 se faltou memória. */
+int tp_sampler_reset(TP_Sampler *s, int n, double t0, double t1);
+
+/* Força recomeçar mesmo com a mesma chave */
+void tp_sampler_invalidate(TP_Sampler *s);
+
+/* Valores dos parâmetros nomeados (TP_PARAM_MAX). Recomeça o
+   refinamento só se mudou algum parâmetro lido por px/py, e só para a
+   coordenada afetada. Retorna 1 se recomeçou. */
+int tp_sampler_set_params(TP_Sampler *s, const double *params,
+                          const TP_Program *px, const TP_Program *py);
+
+/* Erro de corda aceito (unidades de y, ex.: meio pixel). Mudar só
+   refaz o estágio por curvatura. Retorna 1 se recomeçou. */
+int tp_sampler_set_tolerance(TP_Sampler *s, double tol);
+
+/* Avalia até budget_ms estourar (<= 0: sem limite).
+   y = f(x): py == NULL e xs = ts.
+   paramétrica: (px(t), py(t)).
+   Retorna 1 quando todas as amostras estão prontas. */
+int tp_sampler_refine(TP_Sampler *s,
+                      const TP_Program *px, const TP_Program *py,
+                      double budget_ms);
+
+int tp_sampler_complete(const TP_Sampler *s);
+
+/* Copia o estado (amostras + progresso). Retorna 0 se faltou memória. */
+int tp_sampler_copy(TP_Sampler *dst, const TP_Sampler *src);
+
+#endif
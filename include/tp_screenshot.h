@@ -2,6 +2,7 @@
 #define TP_SCREENSHOT_H
 
 #include <SDL2/SDL.h>
+#include <stddef.h>
 
 /* Salva o frame atual do renderer como BMP.
    Retorna 0 se OK; !=0 se erro (msg em errbuf se fornecido). */
@@ -10,4 +11,12 @@ int tp_screenshot_save_bmp(SDL_Renderer *renderer,
                            const char *path,
                            char *errbuf, int errbuf_sz);
 
+/* BMP 24 bits em memória (tiles): bytes do arquivo inteiro */
+size_t tp_screenshot_bmp_size(int w, int h);
+
+/* Codifica w x h pixels ARGB8888 (linhas a cada pitch bytes) em out,
+   com tp_screenshot_bmp_size(w, h) bytes. */
+void tp_screenshot_encode_bmp(const Uint32 *argb, int pitch, int w, int h,
+                              unsigned char *out);
+
 #endif
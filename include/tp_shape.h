@@ -0,0 +1,54 @@
+#ifndef TP_SHAPE_H
+#define TP_SHAPE_H
+
+#include "tp_ast.h"
+
+/* Formas comuns de f(x) reconhecidas na AST e avaliadas por kernels
+   próprios em vez do bytecode genérico:
+
+   - polinômio já expandido (soma de c x^k): Horner
+   - \frac{p(x)}{q(x)} com p e q assim: os dois Horner e a divisão
+     numa passada só
+   - soma de senoides c0 + soma a sin(f x + fase) + b cos(f x + fase)
+     com f múltiplos inteiros de uma fundamental w: um sin e um cos de
+     w x por amostra, os harmônicos saem por rotação
+
+   Só expressões de x com coeficientes constantes (sem y nem parâmetros).
+   Produtos e potências só entram quando um lado é monômio, então nada
+   é expandido (expandir (x-1)^{10} perderia precisão perto de 1). */
+
+#define TP_SHAPE_MAX_DEG  12
+#define TP_SHAPE_MAX_HARM 16
+
+typedef enum TP_ShapeKind {
+    TP_SHAPE_POLY,
+    TP_SHAPE_RATIONAL,
+    TP_SHAPE_TRIG
+} TP_ShapeKind;
+
+typedef struct TP_Shape {
+    TP_ShapeKind kind;
+
+    /* POLY: num; RATIONAL: num/den (índice k = coeficiente de x^k) */
+    int deg_num, deg_den;
+    double num[TP_SHAPE_MAX_DEG + 1];
+    double den[TP_SHAPE_MAX_DEG + 1];
+
+    /* TRIG: c0 + soma_{m=1..n_harm} s[m] sin(m w x) + c[m] cos(m w x) */
+    double c0, w;
+    int n_harm;
+    double s[TP_SHAPE_MAX_HARM + 1];
+    double c[TP_SHAPE_MAX_HARM + 1];
+} TP_Shape;
+
+/* malloc; NULL se n não tem uma das formas (ou sem memória) */
+TP_Shape *tp_shape_detect(const TP_Node *n);
+
+/* out[i] = f(xs[i]) */
+void tp_shape_eval(const TP_Shape *s, const double *xs, double *out, int n);
+
+/* valor (idêntico a tp_shape_eval), f' e f'' */
+void tp_shape_eval_jet(const TP_Shape *s, const double *xs,
+                       double *out, double *d1, double *d2, int n);
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef TP_STREAM_H
+#define TP_STREAM_H
+
+#include <SDL2/SDL.h>
+#include "tp_view.h"
+
+/* Série ao vivo: uma thread lê linhas de texto ("y" ou "x,y", como o
+   CSV de --data) de stdin ou de um socket Unix e empurra os pontos num
+   anel SPSC lock-free. O render só drena o que chegou, uma vez por
+   frame, sem nunca esperar pela leitura; anel cheio segura a leitora
+   (o produtor do pipe/socket sente a contrapressão). */
+
+/* pontos no anel (potência de 2) */
+#define TP_STREAM_RING (1 << 18)
+
+/* bytes por read() */
+#define TP_STREAM_READ 65536
+
+/* pontos acumulados antes de publicar no anel */
+#define TP_STREAM_BATCH 1024
+
+/* baldes da janela: cobre telas de até essa largura sem perder detalhe */
+#define TP_STREAM_BINS 4096
+
+typedef struct TP_StreamPoint {
+    double x, y;
+} TP_StreamPoint;
+
+typedef struct TP_Stream {
+    /* anel: head só o leitor escreve, tail só o render */
+    TP_StreamPoint *ring;
+    SDL_atomic_t head, tail;
+
+    SDL_Thread *thread;
+    SDL_atomic_t quit;
+    SDL_atomic_t ended;    /* stdin no fim ou cliente do socket desconectou */
+    SDL_atomic_t y_only;   /* sessão atual manda só y (x = índice) */
+
+    int fd;                /* stdin, ou socket em escuta */
+    int is_socket;
+    const char *path;      /* do socket (removido no close) */
+} TP_Stream;
+
+/* Janela dos últimos N pontos em baldes de k pontos consecutivos
+   (k = N / TP_STREAM_BINS arredondado para cima). Cada balde guarda
+   primeiro, último, mínimo e máximo na ordem em que chegaram: ponto
+   novo só mexe no balde mais recente, e o frame desenha O(baldes),
+   não O(N). Com N <= TP_STREAM_BINS cada balde é um ponto. */
+typedef struct TP_StreamBin {
+    unsigned long long j;  /* balde j: pontos j*k .. j*k+k-1 */
+    double x0, y0, x1, y1; /* primeiro e último (NaN quebra a linha) */
+    double lo_x, lo_y;     /* mínimo finito (lo_y = +inf se nenhum) */
+    double hi_x, hi_y;     /* máximo finito (hi_y = -inf se nenhum) */
+    int lo_first;          /* mínimo chegou antes do máximo */
+} TP_StreamBin;
+
+typedef struct TP_StreamWin {
+    TP_StreamBin *bin;     /* anel de n_bin baldes, pelo índice j */
+    int n_bin;
+    unsigned long long k;  /* pontos por balde */
+    unsigned long long n;  /* N */
+    unsigned long long count;   /* pontos recebidos desde o início */
+    int y_only;            /* x = índice (do TP_Stream no último drain) */
+} TP_StreamWin;
+
+/* src: "-" (stdin) ou caminho de socket Unix (cria e escuta; um
+   cliente por vez). Retorna 0 se OK; senão 1 com a mensagem em err. */
+int tp_stream_open(TP_Stream *st, const char *src, char *err, int err_sz);
+void tp_stream_close(TP_Stream *st);
+
+/* 1 quando a fonte acabou (ou um cliente saiu). Chamado antes de
+   tp_stream_drain: tudo o que veio antes do fim sai nesse drain. */
+int tp_stream_ended(TP_Stream *st);
+
+/* Janela de n pontos. Retorna 0 se OK, -1 se faltou memória. */
+int tp_stream_win_init(TP_StreamWin *w, unsigned long long n);
+void tp_stream_win_free(TP_StreamWin *w);
+
+/* Passa o que chegou no anel para a janela. Retorna os pontos novos. */
+size_t tp_stream_drain(TP_Stream *st, TP_StreamWin *w);
+
+/* Baldes da janela, do mais antigo ao mais novo (em *first o primeiro) */
+int tp_stream_win_bins(const TP_StreamWin *w, unsigned long long *first);
+
+/* Viewport que acompanha a janela: X dos N últimos pontos (só índice:
+   N de largura, enchendo da esquerda) e Y nos limites deles (+5%).
+   Retorna 0 se a janela está vazia (view intocada). */
+int tp_stream_win_view(const TP_StreamWin *w, TP_View *view, int fit_y);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef TP_SYM_H
+#define TP_SYM_H
+
+#include <stddef.h>
+#include "tp_ast.h"
+
+/* Tabela de símbolos das definições do usuário:
+
+     a = \sin x;  f(u) = u^2 + u;  f(a) + a
+
+   Tudo é resolvido durante o parse: variável vira SLOT (ligado por um
+   LET na raiz), chamada de função vira cópia do corpo com os
+   argumentos no lugar dos parâmetros. A árvore final não tem nomes nem
+   chamadas; avaliação e bytecode não pagam nada pela indireção. */
+
+#define TP_SYM_MAX_PARAMS 8
+
+typedef struct TP_Symbol {
+    const char *name;   /* aponta para o texto-fonte */
+    size_t len;
+    int n_params;       /* -1: variável */
+    int slot;           /* variável: slot do valor */
+    int n_locals;       /* função: slots de LET internos ao corpo */
+    TP_Node *body;      /* valor, ou template com PARAM e slots locais < 0 */
+    int uses[TP_SYM_MAX_PARAMS];   /* função: ocorrências de cada parâmetro */
+} TP_Symbol;
+
+typedef struct TP_SymTab {
+    TP_Symbol *syms;
+    int n, cap;
+
+    int *index;         /* hash aberto por nome: símbolo + 1, 0 = vazio */
+    int n_index;
+
+    int n_slots;        /* próximo slot livre */
+
+    /* parâmetros da definição de função em curso */
+    const char *param[TP_SYM_MAX_PARAMS];
+    size_t param_len[TP_SYM_MAX_PARAMS];
+    int n_param;
+} TP_SymTab;
+
+/* init não aloca: expressões sem definições não pagam nada */
+void tp_sym_init(TP_SymTab *t);
+void tp_sym_free(TP_SymTab *t);
+
+/* índice do símbolo ou -1 */
+int tp_sym_find(const TP_SymTab *t, const char *name, size_t len);
+/* índice do parâmetro da definição em curso ou -1 */
+int tp_sym_param(const TP_SymTab *t, const char *name, size_t len);
+
+/* Registra uma definição; body passa a ser da tabela (liberado também
+   em erro). mark = t->n_slots antes de ler o corpo: os LETs criados
+   desde então são locais à função. Devolve o índice ou -1 sem memória. */
+int tp_sym_define(TP_SymTab *t, const char *name, size_t len, int n_params,
+                  TP_Node *body, int mark);
+
+/* Instancia a função `fn` com args[0..n_params) (consumidos também em
+   erro). Argumento trivial ou usado uma vez entra no lugar do
+   parâmetro; os demais são calculados uma vez num LET. NULL sem
+   memória. */
+TP_Node *tp_sym_call(TP_SymTab *t, int fn, TP_Node **args);
+
+/* Liga as variáveis usadas por `root`: as usadas uma vez (ou triviais)
+   entram no lugar, as demais viram LETs em volta da raiz. Tupla: cada
+   componente à parte, para a raiz continuar sendo TUPLE2. Consome root
+   (também em erro); NULL sem memória. */
+TP_Node *tp_sym_finish(TP_SymTab *t, TP_Node *root);
+
+#endif
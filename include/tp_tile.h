@@ -0,0 +1,98 @@
+#ifndef TP_TILE_H
+#define TP_TILE_H
+
+#include <SDL2/SDL.h>
+#include <stddef.h>
+#include "tp_view.h"
+#include "tp_frame.h"
+#include "tp_net.h"
+
+/* Servidor de tiles estilo mapa: GET /{z}/{x}/{y}.bmp em HTTP no
+   localhost devolve o pedaço 256x256 do gráfico. O tile 0/0/0 é a
+   viewport inicial; cada zoom divide cada tile em 4, x cresce para a
+   direita e y para baixo (sem limite: o plano continua fora do tile 0).
+
+   Render sem janela (tp_frame) num pool de threads, cada uma com seu
+   TP_FrameCtx. Tiles prontos ficam num LRU
+   em memória e, com diretório, também em disco (reaproveitados entre
+   execuções pela chave da cena). Pedido de um tile que já está sendo
+   renderizado espera o mesmo render em vez de repetir. */
+
+/* lado do tile em pixels */
+#define TP_TILE_SIZE 256
+
+/* zoom máximo: abaixo disso o pixel ainda tem mantissa sobrando */
+#define TP_TILE_MAX_ZOOM 40
+
+/* tiles no LRU em memória (~190 KiB cada) */
+#define TP_TILE_MEM_TILES 256
+
+/* conexões aceitas esperando uma thread; cheia responde 503 */
+#define TP_TILE_QUEUE 256
+
+typedef struct TP_Tile TP_Tile;
+
+struct TP_Tile {
+    int z;
+    long long x, y;
+    unsigned long hash;
+
+    unsigned char *bmp;     /* pronto: arquivo BMP inteiro */
+    size_t size;
+    int state;              /* interno */
+
+    /* interno (com o lock do servidor) */
+    int refs;
+    TP_Tile *prev, *next;   /* lista LRU (head = mais recente) */
+    TP_Tile *chain;         /* bucket da tabela hash */
+};
+
+typedef struct TP_TileServer {
+    TP_FrameScene scene;     /* cópia; zmin/zmax resolvidos */
+    TP_View base;            /* tile 0/0/0 */
+    const char *dir;         /* cache em disco; NULL = só memória */
+    unsigned long long key;  /* hash da cena (nome dos arquivos) */
+
+    SDL_mutex *lock;
+    SDL_cond *tile_ready;    /* algum render terminou */
+
+    TP_Tile **buckets;
+    int n_buckets;
+    TP_Tile *head, *tail;
+    int count, capacity;
+
+    int fd;                  /* socket em escuta; -1 antes do listen */
+    TP_NetPool pool;
+
+    /* contadores (com lock) */
+    unsigned long hits, disk_hits, renders, shared;
+} TP_TileServer;
+
+/* Viewport do tile (pixel i da coluna em base.xmin + (x*256+i)*passo) */
+void tp_tile_view(const TP_View *base, int z, long long x, long long y, TP_View *out);
+
+/* Desenha o tile e codifica em bmp (tp_screenshot_bmp_size(256, 256)
+   bytes). Retorna 0 se OK. */
+int tp_tile_render(const TP_FrameScene *s, const TP_View *base, TP_FrameCtx *c,
+                   int z, long long x, long long y, unsigned char *bmp);
+
+/* base: viewport do tile 0/0/0. expr e data_path só entram na chave do
+   cache em disco, dir (NULL = só memória). 0 OK, -1 sem memória. */
+int tp_tile_server_init(TP_TileServer *srv, const TP_FrameScene *scene, const TP_View *base,
+                        const char *expr, const char *data_path, const char *dir);
+void tp_tile_server_free(TP_TileServer *srv);
+
+/* Tile pronto, com referência (liberar com tp_tile_release): memória,
+   disco ou render em c. 0 OK, -1 falhou o render. */
+int tp_tile_get(TP_TileServer *srv, TP_FrameCtx *c,
+                int z, long long x, long long y, TP_Tile **out);
+void tp_tile_release(TP_TileServer *srv, TP_Tile *t);
+
+/* Escuta em 127.0.0.1:port e sobe as threads. 0 OK; senão 1 com a
+   mensagem em err. */
+int tp_tile_server_listen(TP_TileServer *srv, int port, char *err, int err_sz);
+
+/* Aceita conexões até SIGINT/SIGTERM. */
+void tp_tile_server_run(TP_TileServer *srv);
+
+#endif
@@ -16,6 +16,8 @@ typedef enum TP_TokType {
     TP_TOK_CARET,
 
     TP_TOK_COMMA,   /* , */
+    TP_TOK_SEMI,    /* ; (fim de definição) */
+    TP_TOK_EQUALS,  /* = (definição) */
 
     TP_TOK_LPAREN,
     TP_TOK_RPAREN,
@@ -25,8 +27,30 @@ typedef enum TP_TokType {
     TP_TOK_INVALID
 } TP_TokType;
 
+/* comandos \xxx reconhecidos no lexer (switch por tamanho, sem strcmp) */
+typedef enum TP_Command {
+    TP_CMD_NONE = 0,    /* token não é comando */
+    TP_CMD_UNKNOWN,
+
+    TP_CMD_SIN,
+    TP_CMD_COS,
+    TP_CMD_TAN,
+    TP_CMD_LOG,
+    TP_CMD_EXP,
+    TP_CMD_SQRT,
+    TP_CMD_FRAC,
+
+    /* layout TeX, ignorados pelo parser */
+    TP_CMD_LEFT,
+    TP_CMD_RIGHT,
+    TP_CMD_QUAD,
+    TP_CMD_QQUAD,
+    TP_CMD_SPACE        /* \; \, \: \! */
+} TP_Command;
+
 typedef struct TP_Token {
     TP_TokType type;
+    TP_Command cmd;
     const char *lexeme;
     size_t len;
 
@@ -36,12 +60,19 @@ typedef struct TP_Token {
     double number;
 } TP_Token;
 
+/* lookahead máximo de tp_lex_peek (potência de 2) */
+#define TP_LEX_LOOKAHEAD 4
+
 typedef struct TP_Lexer {
     const char *src;
     size_t pos;
     size_t col;
 
-    TP_Token current;
+    /* tokens já lidos: ring[head] é o corrente, mais `avail - 1` à frente.
+       Tokens ficam no ring e são usados por ponteiro, sem cópia. */
+    TP_Token ring[TP_LEX_LOOKAHEAD];
+    unsigned int head, avail;
+    const TP_Token *current;
 
     const char *error;
     size_t error_pos;
@@ -51,6 +82,13 @@ typedef struct TP_Lexer {
 void tp_lex_init(TP_Lexer *lx, const char *src);
 void tp_lex_next(TP_Lexer *lx);
 
+/* k-ésimo token à frente (0 = corrente), k < TP_LEX_LOOKAHEAD.
+   Erros de léxico aparecem em lx->error já quando o token é lido. */
+const TP_Token *tp_lex_peek(TP_Lexer *lx, unsigned int k);
+
+/* 1 se o comando é só layout (\left, \quad, \; ...) */
+int tp_cmd_is_noop(TP_Command c);
+
 int tp_tok_is_primary_start(TP_TokType t);
 
 #endif
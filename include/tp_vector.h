@@ -0,0 +1,73 @@
+#ifndef TP_VECTOR_H
+#define TP_VECTOR_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* Saída vetorial (SVG ou PDF) das mesmas linhas que vão para a tela.
+   Segmentos consecutivos que continuam do último ponto viram uma
+   polilinha só; ao fechar, ela é simplificada por Ramer-Douglas-Peucker
+   (tolerância em pixels) e escrita na hora por um buffer próprio: nada
+   do desenho fica inteiro na memória. */
+
+/* erro máximo (px) entre a polilinha gravada e a desenhada */
+#define TP_VEC_TOL_PX 0.25
+
+/* bytes acumulados antes de cada fwrite */
+#define TP_VEC_BUF 65536
+
+typedef enum TP_VecFormat {
+    TP_VEC_SVG,
+    TP_VEC_PDF
+} TP_VecFormat;
+
+typedef struct TP_Vec {
+    FILE *f;
+    TP_VecFormat fmt;
+    int w, h;
+    double tol;
+
+    char buf[TP_VEC_BUF];
+    size_t len;
+    long long off;           /* bytes já escritos (xref do PDF) */
+    int failed;              /* algum fwrite falhou */
+
+    /* polilinha aberta (x, y intercalados) */
+    double *pt;
+    int n, cap;
+    unsigned char *keep;     /* marcas do RDP */
+    int *stack;
+
+    unsigned char r, g, b;
+    int has_color;           /* SVG: <g> da cor atual aberto */
+
+    long long obj_off[6];    /* PDF: offset de cada objeto */
+    long long stream_start;
+} TP_Vec;
+
+/* -1 se path não termina em .svg nem .pdf */
+int tp_vec_format_for(const char *path);
+
+/* Abre path e escreve cabeçalho e fundo (w x h px, tol em px).
+   Retorna 0 se OK; senão 1 com a mensagem em err. */
+int tp_vec_open(TP_Vec *v, const char *path, TP_VecFormat fmt, int w, int h,
+                unsigned char bg_r, unsigned char bg_g, unsigned char bg_b,
+                double tol, char *err, int err_sz);
+
+/* Fecha o arquivo. Retorna 0 se tudo foi escrito. */
+int tp_vec_close(TP_Vec *v);
+
+void tp_vec_color(TP_Vec *v, unsigned char r, unsigned char g, unsigned char b);
+
+/* segmento em coordenadas de tela (px, y para baixo) */
+void tp_vec_line(TP_Vec *v, double x0, double y0, double x1, double y1);
+
+/* ponto isolado (risco de comprimento zero com ponta redonda) */
+void tp_vec_point(TP_Vec *v, double x, double y);
+
+/* Simplificação RDP de pt[0..n) (x, y intercalados) in-place. Retorna o
+   novo n; extremos sempre ficam. keep com n posições e stack com 2n
+   (até n-1 intervalos [a, b] pendentes). */
+int tp_vec_simplify(double *pt, int n, double tol, unsigned char *keep, int *stack);
+
+#endif
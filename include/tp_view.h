@@ -1,6 +1,8 @@
 #ifndef TP_VIEW_H
 #define TP_VIEW_H
 
+#include "tp_dd.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -18,6 +20,24 @@ void tp_view_zoom(TP_View *v, double factor);
 /* zoom com âncora (mantém anchor_x/anchor_y “parado” na tela) */
 void tp_view_zoom_at(TP_View *v, double factor, double anchor_x, double anchor_y);
 
+/* Viewport em precisão estendida (zoom profundo).
+   O canto inferior esquerdo é double-double; a largura cabe em double. */
+typedef struct TP_ViewDD {
+    TP_DD xmin, ymin;
+    double xspan, yspan;
+} TP_ViewDD;
+
+void tp_view_dd_from(TP_ViewDD *d, const TP_View *v);
+void tp_view_dd_to(const TP_ViewDD *d, TP_View *v);
+
+void tp_view_dd_pan(TP_ViewDD *d, double dx, double dy);
+void tp_view_dd_zoom(TP_ViewDD *d, double factor);
+void tp_view_dd_zoom_at(TP_ViewDD *d, double factor, TP_DD anchor_x, TP_DD anchor_y);
+
+/* 1 se um pixel da tela (w x h) é pequeno demais para double nas
+   coordenadas atuais (poucas ulps por pixel) */
+int tp_view_dd_needed(const TP_ViewDD *d, int w, int h);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,4 +1,5 @@
 #include <SDL2/SDL.h>
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
@@ -10,9 +11,73 @@
 #include "tp_parser.h"
 #include "tp_ast.h"
 #include "tp_screenshot.h"
+#include "tp_prog.h"
+#include "tp_heatmap.h"
+#include "tp_sample.h"
+#include "tp_async.h"
+#include "tp_prof.h"
+#include "tp_cache.h"
+#include "tp_deriv.h"
+#include "tp_analysis.h"
+#include "tp_data.h"
+#include "tp_lod.h"
+#include "tp_stream.h"
+#include "tp_vector.h"
+#include "tp_tile.h"
+#include "tp_frame.h"
+#include "tp_daemon.h"
+
+/* heatmap: bloco do primeiro passe após mudar a viewport */
+#define TP_HEAT_COARSE_BLOCK 8
+
+/* cor das marcas (f' e série de dados: tp_frame.h) */
+#define TP_MARK_GRAY 235
+
+/* cor da série ao vivo (--stream) */
+#define TP_STREAM_R 255
+#define TP_STREAM_G 200
+#define TP_STREAM_B 60
+
+/* parâmetros nomeados: passos por faixa ([ ]) e período da animação */
+#define TP_PARAM_STEPS 100
+#define TP_PARAM_ANIM_SECONDS 4.0
+
+/* Parâmetros nomeados em uso: valores vão direto para a avaliação
+   (slots livres da árvore/bytecode), nunca para o parser. */
+typedef struct ParamState {
+    const TP_ParamSpec *spec;
+    int n;
+    double v[TP_PARAM_MAX];
+    int sel;          /* TAB */
+    int animating;    /* ESPACO: onda triangular em [min,max] */
+    double phase;     /* [0,1) */
+} ParamState;
+
+/* valor da onda triangular na fase atual */
+static double param_anim_value(const TP_ParamSpec *sp, double phase) {
+    const double u = phase < 0.5 ? 2.0 * phase : 2.0 - 2.0 * phase;
+    return sp->min + (sp->max - sp->min) * u;
+}
 
-static void update_title(SDL_Window *w, const TP_View *v, const char *expr) {
-    char buf[300];
+/* " | a=1 [k=2.5]": o selecionado entre colchetes */
+static void format_params(char *buf, size_t sz, const ParamState *ps) {
+    size_t o = 0;
+    buf[0] = '\0';
+    for (int i = 0; i < ps->n && o < sz; i++) {
+        const int sel = (i == ps->sel && ps->n > 1);
+        int k = snprintf(buf + o, sz - o, "%s%s%s=%.4g%s",
+                         i == 0 ? " | " : " ", sel ? "[" : "",
+                         ps->spec[i].name, ps->v[i], sel ? "]" : "");
+        if (k < 0) break;
+        o += (size_t)k;
+    }
+}
+
+static void update_title(SDL_Window *w, const TP_ViewDD *vdd, const char *expr,
+                         const ParamState *ps) {
+    char buf[512];
+    char pbuf[160];
+    format_params(pbuf, sizeof(pbuf), ps);
 
     char expr_short[80];
     if (expr) {
@@ -30,50 +95,169 @@ static void update_title(SDL_Window *w, const TP_View *v, const char *expr) {
         strcpy(expr_short, "<null>");
     }
 
-    snprintf(buf, sizeof(buf),
-             "TatuPlot | %s | x:[%.3g,%.3g] y:[%.3g,%.3g] | WASD pan  +/- zoom  P screenshot  R reset  ESC sair",
-             expr_short, v->xmin, v->xmax, v->ymin, v->ymax);
+    int ww = 0, wh = 0;
+    SDL_GetWindowSize(w, &ww, &wh);
+
+    if (tp_view_dd_needed(vdd, ww, wh)) {
+        /* zoom profundo: %.3g não distingue os limites; mostra canto + largura */
+        snprintf(buf, sizeof(buf),
+                 "TatuPlot | %s%s | x:%.17g+%.3g y:%.17g+%.3g (dd) | WASD/arrastar pan  +/-/scroll zoom  P screenshot  R reset  ESC sair",
+                 expr_short, pbuf, tp_dd_to_double(vdd->xmin), vdd->xspan,
+                 tp_dd_to_double(vdd->ymin), vdd->yspan);
+    } else {
+        TP_View v;
+        tp_view_dd_to(vdd, &v);
+        snprintf(buf, sizeof(buf),
+                 "TatuPlot | %s%s | x:[%.3g,%.3g] y:[%.3g,%.3g] | WASD/arrastar pan  +/-/scroll zoom  P screenshot  R reset  ESC sair",
+                 expr_short, pbuf, v.xmin, v.xmax, v.ymin, v.ymax);
+    }
 
     SDL_SetWindowTitle(w, buf);
 }
 
-static int isfinite_d(double x) { return isfinite(x); }
+/* --deriv / --marks / --analysis: f' e f'' simbólicas de y = f(x) */
+typedef struct DerivState {
+    TP_Node *d1, *d2;
+    TP_Program *prog;   /* bytecode de f' (curva) */
+} DerivState;
+
+static void deriv_free(DerivState *d) {
+    tp_prog_free(d->prog);
+    tp_ast_free(d->d2);
+    tp_ast_free(d->d1);
+    memset(d, 0, sizeof(*d));
+}
 
-static void autofit_param_view(TP_View *view,
-                               const TP_Node *xexpr, const TP_Node *yexpr,
-                               double tmin, double tmax,
-                               int fit_x, int fit_y)
+/* grava o cache (se mudou) e libera a expressão; todas as saídas passam aqui */
+static void release_expr(TP_Cache *cache, TP_Compiled *ce, const char *cache_path) {
+    if (cache_path && cache->dirty && tp_cache_save(cache, cache_path) != 0) {
+        fprintf(stderr, "Aviso: nao consegui gravar o cache (%s)\n", cache_path);
+    }
+    tp_compiled_release(ce);
+    tp_cache_free(cache);
+    tp_prof_trace_close();
+}
+
+/* --analysis: "-" = stdout. Retorna 0 se gravou. */
+static int write_analysis(const char *path, const TP_Analysis *a, const TP_AnaCurve *c,
+                          const char *expr, const char *const *names, const ParamState *ps) {
+    const int to_stdout = strcmp(path, "-") == 0;
+    FILE *f = to_stdout ? stdout : fopen(path, "w");
+    if (!f) return 1;
+    int rc = tp_analysis_write_json(a, c, expr, names, ps->v, ps->n, f);
+    if (to_stdout) fflush(f);
+    else if (fclose(f) != 0) rc = 1;
+    return rc;
+}
+
+static int view_eq(const TP_View *a, const TP_View *b) {
+    return a->xmin == b->xmin && a->xmax == b->xmax &&
+           a->ymin == b->ymin && a->ymax == b->ymax;
+}
+
+/* --serve: tiles da viewport inicial, sem janela, até SIGINT/SIGTERM.
+   Retorna o código de saída. */
+static int serve_tiles(const TP_Args *args, const TP_Compiled *ce,
+                       const double *params, int n_params, double tmin, double tmax,
+                       const TP_View *base, const TP_Data *data, const TP_Lod *lod)
 {
-    double minx = 0, maxx = 0, miny = 0, maxy = 0;
-    int have = 0;
+    TP_FrameScene sc;
+    memset(&sc, 0, sizeof(sc));
+    sc.prog_a = ce->prog_a;
+    sc.prog_b = ce->prog_b;
+    sc.is_tuple = ce->is_tuple;
+    sc.is_field = ce->is_field;
+    sc.params = params;
+    sc.n_params = n_params;
+    sc.tmin = tmin;
+    sc.tmax = tmax;
+    sc.data = data;
+    sc.lod = data ? lod : NULL;
+    sc.bg_r = args->bg_r; sc.bg_g = args->bg_g; sc.bg_b = args->bg_b;
+    sc.fg_r = args->fg_r; sc.fg_g = args->fg_g; sc.fg_b = args->fg_b;
+    sc.data_r = TP_DATA_R; sc.data_g = TP_DATA_G; sc.data_b = TP_DATA_B;
+    sc.has_zrange = args->has_zrange;
+    sc.zmin = args->zmin;
+    sc.zmax = args->zmax;
+
+    if (args->show_deriv || args->show_marks || args->analysis_path || args->shot_once) {
+        fprintf(stderr, "Aviso: --deriv/--marks/--analysis/--shot ignorados com --serve\n");
+    }
 
-    const int N = 2500;
-    for (int i = 0; i < N; i++) {
-        double t = tmin + (tmax - tmin) * ((double)i / (double)(N - 1));
-        double xw = tp_eval(xexpr, t);
-        double yw = tp_eval(yexpr, t);
+    /* sem vídeo: os tiles usam renderer por software */
+    if (SDL_Init(0) != 0) {
+        fprintf(stderr, "SDL_Init falhou: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    TP_TileServer srv;
+    char err[256];
+    if (tp_tile_server_init(&srv, &sc, base, args->expr, args->data_path, args->tile_dir) != 0) {
+        fprintf(stderr, "ERRO: sem memoria\n");
+        SDL_Quit();
+        return 1;
+    }
+    if (tp_tile_server_listen(&srv, args->serve_port, err, (int)sizeof(err)) != 0) {
+        fprintf(stderr, "ERRO --serve: %s\n", err);
+        tp_tile_server_free(&srv);
+        SDL_Quit();
+        return 1;
+    }
 
-        if (!isfinite_d(xw) || !isfinite_d(yw)) continue;
+    fprintf(stdout, "Servindo tiles em http://127.0.0.1:%d/{z}/{x}/{y}.bmp (Ctrl+C sai)\n", args->serve_port);
+    fflush(stdout);
+    tp_tile_server_run(&srv);
 
-        if (!have) {
-            minx = maxx = xw;
-            miny = maxy = yw;
-            have = 1;
-        } else {
-            if (xw < minx) minx = xw;
-            if (xw > maxx) maxx = xw;
-            if (yw < miny) miny = yw;
-            if (yw > maxy) maxy = yw;
-        }
+    if (args->show_stats) {
+        fprintf(stderr, "tiles: %lu da memoria, %lu do disco, %lu renderizados, %lu esperaram outro render\n",
+                srv.hits, srv.disk_hits, srv.renders, srv.shared);
+    }
+    tp_tile_server_free(&srv);
+    SDL_Quit();
+    return 0;
+}
+
+/* --daemon: atende pedidos no socket até SIGINT/SIGTERM; o cache de
+   expressões vale para todos. Retorna o código de saída. */
+static int run_daemon(const TP_Args *args) {
+    TP_Cache cache;
+    if (tp_cache_init(&cache, TP_CACHE_CAPACITY) != 0) {
+        fprintf(stderr, "ERRO: sem memoria\n");
+        return 1;
+    }
+    if (args->cache_path && tp_cache_load(&cache, args->cache_path) != 0) {
+        fprintf(stderr, "Aviso: cache invalido (%s); sera regravado\n", args->cache_path);
+        cache.dirty = 1;
     }
 
-    if (!have) return;
+    /* sem vídeo: cada thread desenha num renderer por software */
+    if (SDL_Init(0) != 0) {
+        fprintf(stderr, "SDL_Init falhou: %s\n", SDL_GetError());
+        release_expr(&cache, NULL, NULL);
+        return 1;
+    }
 
-    double padx = (maxx - minx) * 0.05; if (padx <= 0) padx = 1.0;
-    double pady = (maxy - miny) * 0.05; if (pady <= 0) pady = 1.0;
+    TP_Daemon d;
+    char err[256];
+    if (tp_daemon_open(&d, args->daemon_path, &cache, err, (int)sizeof(err)) != 0) {
+        fprintf(stderr, "ERRO --daemon: %s\n", err);
+        release_expr(&cache, NULL, NULL);
+        SDL_Quit();
+        return 1;
+    }
+
+    fprintf(stdout, "Daemon em %s com %d threads (Ctrl+C sai)\n", args->daemon_path, d.pool.nthreads);
+    fflush(stdout);
+    tp_daemon_run(&d);
+    tp_daemon_close(&d);
 
-    if (fit_x) { view->xmin = minx - padx; view->xmax = maxx + padx; }
-    if (fit_y) { view->ymin = miny - pady; view->ymax = maxy + pady; }
+    if (args->show_stats) {
+        fprintf(stderr, "daemon: %d pedidos, %d com erro; cache de expressoes: %lu hits, %lu misses\n",
+                SDL_AtomicGet(&d.requests), SDL_AtomicGet(&d.failures), cache.hits, cache.misses);
+    }
+    release_expr(&cache, NULL, args->cache_path);
+    SDL_Quit();
+    return 0;
 }
 
 int main(int argc, char **argv) {
@@ -81,62 +265,142 @@ int main(int argc, char **argv) {
     char err[256];
 
     int rc = tp_args_parse(argc, argv, &args, err, (int)sizeof(err));
-    if (rc == 2) return 0;
+    if (rc == 2) {
+        tp_args_print_help(argv[0]);
+        return 0;
+    }
     if (rc != 0) {
         fprintf(stderr, "ERRO: %s\n\n", err[0] ? err : "argumentos invalidos");
         tp_args_print_help(argv[0]);
         return 1;
     }
 
-    TP_Parser p;
-    tp_parse_init(&p, args.expr);
-    TP_Node *expr_ast = tp_parse_expr(&p);
-    if (!expr_ast) {
-        fprintf(stderr, "ERRO parse (col %zu): %s\n", p.error_col, p.error ? p.error : "desconhecido");
-        fprintf(stderr, "Expr: %s\n", args.expr);
-        return 1;
+    if (args.trace_path) {
+        const int trc = tp_prof_trace_open(args.trace_path);
+        if (trc == 1) {
+            fprintf(stderr, "Aviso: trace indisponivel (%s): %s\n", args.trace_path, strerror(errno));
+        } else if (trc != 0) {
+            fprintf(stderr, "Aviso: trace indisponivel (%s); compile com PROFILE=1\n", args.trace_path);
+        }
     }
 
-    const int is_tuple = (expr_ast->type == TP_NODE_TUPLE2);
+    if (args.daemon_path) return run_daemon(&args);
 
-    TP_View view = args.view;
-    TP_View view0 = args.view;
+    /* parse + bytecode via cache; --cache-file pula os dois num warm start */
+    TP_Cache cache;
+    if (tp_cache_init(&cache, TP_CACHE_CAPACITY) != 0) {
+        fprintf(stderr, "ERRO: sem memoria\n");
+        tp_prof_trace_close();
+        return 1;
+    }
+    if (args.cache_path && tp_cache_load(&cache, args.cache_path) != 0) {
+        fprintf(stderr, "Aviso: cache invalido (%s); sera regravado\n", args.cache_path);
+        cache.dirty = 1;
+    }
 
-    double tmin = 0.0, tmax = 1.0;
-    int fit_x = 0, fit_y = 0;
+    /* --param: nomes viram slots livres na compilação; valores só na avaliação */
+    ParamState ps;
+    memset(&ps, 0, sizeof(ps));
+    ps.spec = args.params;
+    ps.n = args.n_params;
+    const char *param_names[TP_PARAM_MAX];
+    for (int i = 0; i < ps.n; i++) {
+        param_names[i] = args.params[i].name;
+        ps.v[i] = args.params[i].value;
+    }
+    const double *params = ps.n > 0 ? ps.v : NULL;
 
-    if (is_tuple) {
-        if (args.has_t) {
-            tmin = args.tmin;
-            tmax = args.tmax;
-        } else if (args.has_xrange) {
-            /* compat: xmin/xmax viram t-range quando a expr é tupla */
-            tmin = args.view.xmin;
-            tmax = args.view.xmax;
+    /* título e relatório: a expressão ou, sem ela, o arquivo/fonte */
+    const char *label = args.expr ? args.expr
+                      : args.data_path ? args.data_path
+                      : strcmp(args.stream_path, "-") == 0 ? "stdin" : args.stream_path;
 
-            fit_x = 1;
-            fit_y = args.has_yrange ? 0 : 1;
+    TP_Compiled *ce = NULL;
+    TP_PROF_BEGIN(TP_STAGE_PARSE);
+    rc = tp_cache_get(&cache, args.expr ? args.expr : TP_NO_EXPR, param_names, ps.n, &ce, err, (int)sizeof(err));
+    TP_PROF_END(TP_STAGE_PARSE);
+    if (rc != 0) {
+        fprintf(stderr, "ERRO %s\n", err);
+        if (rc == 1) fprintf(stderr, "Expr: %s\n", args.expr);
+        release_expr(&cache, NULL, args.cache_path);
+        return 1;
+    }
 
-            /* antes do autofit, deixe X neutro */
-            view.xmin = -10.0; view.xmax = 10.0;
-        } else {
-            tmin = 0.0;
-            tmax = 6.283185307179586;
-            fit_x = 1;
-            fit_y = args.has_yrange ? 0 : 1;
+    const TP_Node *expr_ast = ce->ast;
+    const int is_tuple = ce->is_tuple;
+
+    /* z = f(x,y): campo escalar desenhado como heatmap */
+    const int is_field = ce->is_field;
+
+    /* bytecode para avaliação em lote (tupla: x(t) e y(t)) */
+    const TP_Program *prog_a = ce->prog_a, *prog_b = ce->prog_b;
+
+    /* derivadas fora do cache: saem da AST já resolvida (parâmetros são constantes) */
+    DerivState deriv;
+    memset(&deriv, 0, sizeof(deriv));
+    int show_deriv = args.show_deriv, show_marks = args.show_marks;
+    const char *analysis_path = args.analysis_path;
+    int analyze = show_marks || analysis_path;
+    if ((show_deriv || analyze) && (is_tuple || is_field)) {
+        fprintf(stderr, "Aviso: --deriv/--marks/--analysis so valem para y = f(x); ignorados\n");
+        show_deriv = show_marks = analyze = 0;
+        analysis_path = NULL;
+    } else if (show_deriv || analyze) {
+        deriv.d1 = tp_ast_derive(expr_ast);
+        if (deriv.d1 && analyze) deriv.d2 = tp_ast_derive(deriv.d1);
+        if (deriv.d1 && show_deriv) deriv.prog = tp_prog_compile(deriv.d1);
+        if (!deriv.d1 || (analyze && !deriv.d2) || (show_deriv && !deriv.prog)) {
+            fprintf(stderr, "Aviso: derivada indisponivel (sem memoria)\n");
         }
+        if (!deriv.prog) show_deriv = 0;
+    }
 
-        autofit_param_view(&view,
-                           expr_ast->as.tuple2.a, expr_ast->as.tuple2.b,
-                           tmin, tmax,
-                           fit_x, fit_y);
+    /* --data: mapeia o arquivo; a pirâmide min/max (paralela, ou do
+       sidecar --lod-file) dá contagem e limites e deixa o frame O(largura) */
+    TP_Data data;
+    memset(&data, 0, sizeof(data));
+    TP_Lod lod;
+    tp_lod_init(&lod);
+    const int has_data = args.data_path != NULL;
+    if (has_data) {
+        TP_PROF_BEGIN(TP_STAGE_PARSE);
+        rc = tp_frame_open_data(&data, &lod, args.data_path, args.lod_path, err, (int)sizeof(err));
+        TP_PROF_END(TP_STAGE_PARSE);
+        if (rc != 0) {
+            fprintf(stderr, "ERRO %s\n", err);
+            deriv_free(&deriv);
+            release_expr(&cache, ce, args.cache_path);
+            return 1;
+        }
+    }
 
-        view0 = view;
+    /* tupla: t-range e autofit na curva; série: autofit nos dados */
+    TP_View view;
+    double tmin, tmax;
+    tp_frame_initial_view(&args, expr_ast, is_tuple, params, has_data ? &data : NULL,
+                          &view, &tmin, &tmax);
+    const TP_View view0 = view;
+
+    if (args.serve_port) {
+        rc = serve_tiles(&args, ce, params, ps.n, tmin, tmax, &view0,
+                         has_data ? &data : NULL, &lod);
+        deriv_free(&deriv);
+        tp_data_close(&data);
+        tp_lod_free(&lod);
+        release_expr(&cache, ce, args.cache_path);
+        return rc;
     }
 
+    /* navegação sempre em double-double; `view` é a cópia em double */
+    TP_ViewDD vdd;
+    tp_view_dd_from(&vdd, &view);
+
     if (SDL_Init(SDL_INIT_VIDEO) != 0) {
         fprintf(stderr, "SDL_Init falhou: %s\n", SDL_GetError());
-        tp_ast_free(expr_ast);
+        deriv_free(&deriv);
+        tp_data_close(&data);
+        tp_lod_free(&lod);
+        release_expr(&cache, ce, args.cache_path);
         return 1;
     }
 
@@ -150,7 +414,10 @@ int main(int argc, char **argv) {
     if (!window) {
         fprintf(stderr, "SDL_CreateWindow falhou: %s\n", SDL_GetError());
         SDL_Quit();
-        tp_ast_free(expr_ast);
+        deriv_free(&deriv);
+        tp_data_close(&data);
+        tp_lod_free(&lod);
+        release_expr(&cache, ce, args.cache_path);
         return 1;
     }
 
@@ -162,11 +429,39 @@ int main(int argc, char **argv) {
         fprintf(stderr, "SDL_CreateRenderer falhou: %s\n", SDL_GetError());
         SDL_DestroyWindow(window);
         SDL_Quit();
-        tp_ast_free(expr_ast);
+        deriv_free(&deriv);
+        tp_data_close(&data);
+        tp_lod_free(&lod);
+        release_expr(&cache, ce, args.cache_path);
         return 1;
     }
 
-    update_title(window, &view, args.expr);
+    /* --stream: thread leitora -> anel SPSC -> janela dos últimos N pontos */
+    TP_Stream stream;
+    TP_StreamWin swin;
+    memset(&swin, 0, sizeof(swin));
+    const int has_stream = args.stream_path != NULL;
+    if (has_stream) {
+        rc = tp_stream_win_init(&swin, (unsigned long long)args.stream_window);
+        if (rc != 0) snprintf(err, sizeof(err), "sem memoria");
+        else rc = tp_stream_open(&stream, args.stream_path, err, (int)sizeof(err));
+        if (rc != 0) {
+            fprintf(stderr, "ERRO --stream: %s\n", err);
+            tp_stream_win_free(&swin);
+            SDL_DestroyRenderer(renderer);
+            SDL_DestroyWindow(window);
+            SDL_Quit();
+            deriv_free(&deriv);
+            tp_data_close(&data);
+            tp_lod_free(&lod);
+            release_expr(&cache, ce, args.cache_path);
+            return 1;
+        }
+    }
+    /* viewport acompanha a janela ao vivo até o usuário navegar (R volta) */
+    int follow = has_stream;
+
+    update_title(window, &vdd, label, &ps);
 
     int running = 1;
 
@@ -175,7 +470,70 @@ int main(int argc, char **argv) {
     int screenshot_and_exit = args.shot_once ? 1 : 0;
     const char *out_path = args.out_path ? args.out_path : "tatuplot.bmp";
 
+    /* --out .svg/.pdf: o frame do screenshot também vai para o arquivo
+       vetorial, pelas mesmas chamadas de desenho */
+    const int vec_fmt = tp_vec_format_for(out_path);
+    TP_Out out = { renderer, NULL, NULL };
+    TP_Vec vec;
+
+    /* heatmap: textura reaproveitada; re-render só quando a viewport muda */
+    TP_Heatmap heat;
+    tp_heatmap_init(&heat, 0);
+    SDL_Texture *heat_tex = NULL;
+    int heat_tex_w = 0, heat_tex_h = 0;
+    TP_View heat_view = view;
+    int heat_valid = 0;
+    int heat_refine = 0;   /* 1: falta o passe em resolução cheia */
+
+    /* curvas: amostras progressivas, refinadas dentro de budget_ms por frame */
+    TP_Sampler sampler;
+    tp_sampler_init(&sampler);
+
+    /* f' tem sampler (ou worker) próprio, com a mesma chave da curva */
+    TP_Sampler dsampler;
+    tp_sampler_init(&dsampler);
+
+    /* zeros/extremos/cruzamentos sobre as amostras completas de f (e f') */
+    TP_Analysis analysis;
+    tp_analysis_init(&analysis);
+    TP_AnaCurve curves[2];
+    memset(curves, 0, sizeof(curves));
+    curves[0].name = "f";
+    curves[1].name = "f'";
+    int analysis_written = 0;
+
+    /* --async: worker amostra; aqui só apresenta o último resultado */
+    TP_AsyncSampler async;
+    int use_async = args.async_sampling && !is_field;
+    if (use_async && tp_async_start(&async, prog_a, prog_b, args.budget_ms) != 0) {
+        fprintf(stderr, "Aviso: falha ao iniciar thread de amostragem; usando modo sincrono\n");
+        use_async = 0;
+    }
+    TP_AsyncSampler dasync;
+    int use_dasync = use_async && show_deriv;
+    if (use_dasync && tp_async_start(&dasync, deriv.prog, NULL, args.budget_ms) != 0) {
+        fprintf(stderr, "Aviso: falha ao iniciar thread de amostragem de f'; usando modo sincrono\n");
+        use_dasync = 0;
+    }
+
+    /* mouse: arrastar com botão esquerdo faz pan */
+    int dragging = 0;
+
+    /* F3: barras de tempo por estágio */
+    int show_stats = args.show_stats;
+
+    Uint64 last_tick = SDL_GetPerformanceCounter();
+
     while (running) {
+        TP_PROF_BEGIN(TP_STAGE_FRAME);
+
+        /* eventos do ciclo são acumulados e aplicados uma vez só:
+           uma rajada de scroll/motion vira 1 update de viewport */
+        int view_changed = 0;
+        unsigned params_changed = 0;   /* bit i: parâmetro i mudou neste frame */
+        double wheel_steps = 0.0;
+        int drag_dx = 0, drag_dy = 0;
+
         SDL_Event e;
         while (SDL_PollEvent(&e)) {
             switch (e.type) {
@@ -185,33 +543,86 @@ int main(int argc, char **argv) {
 
                 case SDL_WINDOWEVENT:
                     if (e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
-                        update_title(window, &view, args.expr);
+                        view_changed = 1;
                     }
                     break;
 
-                case SDL_KEYDOWN: {
-                    const SDL_Keycode key = e.key.keysym.sym;
+                case SDL_MOUSEWHEEL: {
+                    follow = 0;
+                    int steps = e.wheel.y;
+                    if (e.wheel.direction == SDL_MOUSEWHEEL_FLIPPED) steps = -steps;
+                    wheel_steps += (double)steps;
+                } break;
 
-                    if (key == SDLK_ESCAPE) { running = 0; break; }
+                case SDL_MOUSEBUTTONDOWN:
+                    if (e.button.button == SDL_BUTTON_LEFT) dragging = 1;
+                    break;
 
-                    const double dx = (view.xmax - view.xmin) * 0.05;
-                    const double dy = (view.ymax - view.ymin) * 0.05;
+                case SDL_MOUSEBUTTONUP:
+                    if (e.button.button == SDL_BUTTON_LEFT) dragging = 0;
+                    break;
 
-                    if (key == SDLK_a) tp_view_pan(&view, -dx, 0.0);
-                    if (key == SDLK_d) tp_view_pan(&view, +dx, 0.0);
-                    if (key == SDLK_w) tp_view_pan(&view, 0.0, +dy);
-                    if (key == SDLK_s) tp_view_pan(&view, 0.0, -dy);
+                case SDL_MOUSEMOTION:
+                    if (dragging) {
+                        follow = 0;
+                        drag_dx += e.motion.xrel;
+                        drag_dy += e.motion.yrel;
+                    }
+                    break;
 
-                    if (key == SDLK_EQUALS || key == SDLK_KP_PLUS) tp_view_zoom(&view, 0.85);
-                    if (key == SDLK_MINUS  || key == SDLK_KP_MINUS) tp_view_zoom(&view, 1.15);
+                case SDL_KEYDOWN: {
+                    const SDL_Keycode key = e.key.keysym.sym;
+
+                    if (key == SDLK_ESCAPE) { running = 0; break; }
 
-                    if (key == SDLK_r) view = view0;
+                    const double dx = vdd.xspan * 0.05;
+                    const double dy = vdd.yspan * 0.05;
+
+                    if (key == SDLK_a) tp_view_dd_pan(&vdd, -dx, 0.0);
+                    if (key == SDLK_d) tp_view_dd_pan(&vdd, +dx, 0.0);
+                    if (key == SDLK_w) tp_view_dd_pan(&vdd, 0.0, +dy);
+                    if (key == SDLK_s) tp_view_dd_pan(&vdd, 0.0, -dy);
+
+                    if (key == SDLK_EQUALS || key == SDLK_KP_PLUS) tp_view_dd_zoom(&vdd, 0.85);
+                    if (key == SDLK_MINUS  || key == SDLK_KP_MINUS) tp_view_dd_zoom(&vdd, 1.15);
+
+                    if (key == SDLK_r) tp_view_dd_from(&vdd, &view0);
+
+                    /* navegar solta a janela ao vivo; R volta a seguir */
+                    if (key == SDLK_a || key == SDLK_d || key == SDLK_w || key == SDLK_s ||
+                        key == SDLK_EQUALS || key == SDLK_KP_PLUS ||
+                        key == SDLK_MINUS || key == SDLK_KP_MINUS) follow = 0;
+                    if (key == SDLK_r) follow = has_stream;
+
+                    if (key == SDLK_F3) show_stats = !show_stats;
+
+                    if (ps.n > 0) {
+                        const TP_ParamSpec *sp = &ps.spec[ps.sel];
+                        const double step = (sp->max - sp->min) / TP_PARAM_STEPS;
+                        if (key == SDLK_TAB) {
+                            ps.sel = (ps.sel + 1) % ps.n;
+                            ps.animating = 0;
+                        }
+                        if (key == SDLK_LEFTBRACKET || key == SDLK_RIGHTBRACKET) {
+                            double v = ps.v[ps.sel] + (key == SDLK_LEFTBRACKET ? -step : step);
+                            if (v < sp->min) v = sp->min;
+                            if (v > sp->max) v = sp->max;
+                            if (v != ps.v[ps.sel]) params_changed |= 1u << ps.sel;
+                            ps.v[ps.sel] = v;
+                            ps.animating = 0;
+                        }
+                        if (key == SDLK_SPACE) {
+                            /* começa subindo a partir do valor atual */
+                            ps.animating = !ps.animating;
+                            ps.phase = 0.5 * (ps.v[ps.sel] - sp->min) / (sp->max - sp->min);
+                        }
+                    }
 
                     if (key == SDLK_p) {
                         screenshot_requested = 1;
                     }
 
-                    update_title(window, &view, args.expr);
+                    view_changed = 1;
                 } break;
 
                 default:
@@ -223,34 +634,247 @@ int main(int argc, char **argv) {
         SDL_GetWindowSize(window, &w, &h);
         TP_Screen screen = { .w = w, .h = h };
 
+        if (drag_dx != 0 || drag_dy != 0) {
+            /* arrastar move o "papel": delta de tela invertido em X */
+            const double wx = vdd.xspan / (double)(w > 1 ? w - 1 : 1);
+            const double wy = vdd.yspan / (double)(h > 1 ? h - 1 : 1);
+            tp_view_dd_pan(&vdd, -(double)drag_dx * wx, (double)drag_dy * wy);
+            view_changed = 1;
+        }
+
+        if (wheel_steps != 0.0) {
+            /* zoom com âncora no cursor: o ponto sob o mouse fica parado */
+            int mx = 0, my = 0;
+            SDL_GetMouseState(&mx, &my);
+            TP_DD ax, ay;
+            tp_screen_to_world_dd(&vdd, screen, mx, my, &ax, &ay);
+            tp_view_dd_zoom_at(&vdd, pow(0.85, wheel_steps), ax, ay);
+            view_changed = 1;
+        }
+
+        const Uint64 now = SDL_GetPerformanceCounter();
+        const double dt = (double)(now - last_tick) / (double)SDL_GetPerformanceFrequency();
+        last_tick = now;
+        if (ps.animating && !screenshot_and_exit) {
+            ps.phase += dt / TP_PARAM_ANIM_SECONDS;
+            ps.phase -= floor(ps.phase);
+            const double v = param_anim_value(&ps.spec[ps.sel], ps.phase);
+            if (v != ps.v[ps.sel]) params_changed |= 1u << ps.sel;
+            ps.v[ps.sel] = v;
+        }
+
+        /* ao vivo: só o que chegou desde o último frame entra na janela;
+           a leitora nunca é esperada */
+        int stream_done = 0;
+        if (has_stream) {
+            stream_done = tp_stream_ended(&stream);
+            /* por frame: PARSE só é zerado no início, acumularia a sessão */
+            TP_PROF_BEGIN(TP_STAGE_RASTER);
+            const size_t n_new = tp_stream_drain(&stream, &swin);
+            TP_PROF_END(TP_STAGE_RASTER);
+            if (follow) {
+                TP_View sv;
+                tp_view_dd_to(&vdd, &sv);
+                if (tp_stream_win_view(&swin, &sv, !args.has_yrange)) tp_view_dd_from(&vdd, &sv);
+                if (n_new > 0) view_changed = 1;
+            }
+        }
+
+        tp_view_dd_to(&vdd, &view);
+        if (view_changed || params_changed) update_title(window, &vdd, label, &ps);
+
+        /* y = f(x) com pixel menor que algumas ulps: coordenadas e eval em dd */
+        const int deep = !is_tuple && !is_field && tp_view_dd_needed(&vdd, w, h);
+
+        /* auto-shot: dispara no primeiro frame
+           (ao vivo: quando a fonte acabar e tudo tiver sido drenado) */
+        if (screenshot_and_exit && (!has_stream || stream_done)) screenshot_requested = 1;
+
+        if (screenshot_requested && vec_fmt >= 0) {
+            if (tp_vec_open(&vec, out_path, (TP_VecFormat)vec_fmt, w, h,
+                            args.bg_r, args.bg_g, args.bg_b, TP_VEC_TOL_PX, err, (int)sizeof(err)) == 0) {
+                out.vec = &vec;
+                if (is_field) fprintf(stderr, "Aviso: heatmap nao sai em %s; so grade e eixos\n", out_path);
+            } else {
+                fprintf(stderr, "Falha ao salvar screenshot (%s): %s\n", out_path, err);
+            }
+        }
+
         SDL_SetRenderDrawColor(renderer, args.bg_r, args.bg_g, args.bg_b, 255);
         SDL_RenderClear(renderer);
 
-        tp_draw_grid(renderer, &view, screen);
-        tp_draw_axes(renderer, &view, screen);
+        if (is_field) {
+            if (!heat_tex || heat_tex_w != w || heat_tex_h != h) {
+                if (heat_tex) SDL_DestroyTexture(heat_tex);
+                heat_tex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                                             SDL_TEXTUREACCESS_STREAMING, w, h);
+                heat_tex_w = w;
+                heat_tex_h = h;
+                heat_valid = 0;
+            }
+
+            /* progressivo: blocos grossos logo após a mudança, depois resolução cheia */
+            int block = 0;
+            /* parâmetro que o campo não lê não re-renderiza */
+            if (!heat_valid || !view_eq(&view, &heat_view) || (prog_a->params & params_changed)) {
+                block = screenshot_and_exit ? 1 : TP_HEAT_COARSE_BLOCK;
+                heat_refine = (block > 1);
+            } else if (heat_refine) {
+                block = 1;
+                heat_refine = 0;
+            }
+
+            if (block > 0 && heat_tex) {
+                TP_PROF_BEGIN(TP_STAGE_SAMPLE);
+                int hm_rc = tp_heatmap_render(&heat, prog_a, params, &view, screen, block,
+                                              args.has_zrange, args.zmin, args.zmax);
+                TP_PROF_END(TP_STAGE_SAMPLE);
+                if (hm_rc == 0) {
+                    SDL_UpdateTexture(heat_tex, NULL, heat.pixels, w * (int)sizeof(Uint32));
+                }
+                heat_view = view;
+                heat_valid = 1;
+            }
 
-        if (!is_tuple) {
-            tp_draw_function(renderer, &view, screen, expr_ast, args.fg_r, args.fg_g, args.fg_b);
+            if (heat_tex) SDL_RenderCopy(renderer, heat_tex, NULL, NULL);
+        }
+
+        if (deep) {
+            TP_PROF_BEGIN(TP_STAGE_RASTER);
+            tp_draw_grid_dd(&out, &vdd, screen);
+            tp_draw_axes_dd(&out, &vdd, screen);
+            if (has_data) tp_draw_data(&out, &view, screen, &data, &lod, TP_DATA_R, TP_DATA_G, TP_DATA_B);
+            if (has_stream) tp_draw_stream(&out, &view, screen, &swin, TP_STREAM_R, TP_STREAM_G, TP_STREAM_B);
+            TP_PROF_END(TP_STAGE_RASTER);
+            /* eval em dd domina; linhas entram junto */
+            TP_PROF_BEGIN(TP_STAGE_SAMPLE);
+            if (show_deriv) {
+                tp_draw_function_dd(&out, &vdd, screen, deriv.d1, params,
+                                    TP_DERIV_R, TP_DERIV_G, TP_DERIV_B);
+            }
+            tp_draw_function_dd(&out, &vdd, screen, expr_ast, params,
+                                args.fg_r, args.fg_g, args.fg_b);
+            TP_PROF_END(TP_STAGE_SAMPLE);
         } else {
-            tp_draw_parametric(renderer, &view, screen,
-                               expr_ast->as.tuple2.a, expr_ast->as.tuple2.b,
-                               tmin, tmax, 3000,
-                               args.fg_r, args.fg_g, args.fg_b);
+            TP_PROF_BEGIN(TP_STAGE_RASTER);
+            tp_draw_grid(&out, &view, screen);
+            tp_draw_axes(&out, &view, screen);
+            if (has_data) tp_draw_data(&out, &view, screen, &data, &lod, TP_DATA_R, TP_DATA_G, TP_DATA_B);
+            if (has_stream) tp_draw_stream(&out, &view, screen, &swin, TP_STREAM_R, TP_STREAM_G, TP_STREAM_B);
+            TP_PROF_END(TP_STAGE_RASTER);
         }
 
-        /* auto-shot: dispara assim que tiver um frame desenhado */
-        if (screenshot_and_exit) screenshot_requested = 1;
+        if (!is_field && !deep) {
+            /* y = f(x): 1 amostra por coluna; só X da viewport invalida.
+               paramétrica: amostras em t não dependem da viewport. */
+            const int n_samples = is_tuple ? 3000 : w;
+            const double t0 = is_tuple ? tmin : view.xmin;
+            const double t1 = is_tuple ? tmax : view.xmax;
+            const TP_Sampler *sm = &sampler;
+            const TP_Sampler *dsm = &dsampler;
+            /* subamostras onde a corda se afasta mais que meio pixel da curva */
+            const double tol = is_tuple ? 0.0
+                                        : TP_CURVE_TOL_PX * (view.ymax - view.ymin) / (double)(h > 1 ? h - 1 : 1);
+
+            if (use_async) {
+                tp_async_request(&async, n_samples, t0, t1, params, tol);
+                /* screenshot sempre sai com a curva completa */
+                const TP_AsyncFrame *f = screenshot_requested ? tp_async_wait(&async)
+                                                              : tp_async_latest(&async);
+                sm = &f->samples;
+                if (screenshot_requested && f->failed) fprintf(stderr, "Aviso: curva sem memoria\n");
+            } else {
+                TP_PROF_BEGIN(TP_STAGE_SAMPLE);
+                tp_sampler_reset(&sampler, n_samples, t0, t1);
+                /* só parâmetros mudaram: refaz só a coordenada que os lê */
+                if (params) tp_sampler_set_params(&sampler, params, prog_a, prog_b);
+                tp_sampler_set_tolerance(&sampler, tol);
+                const double budget = screenshot_requested ? 0.0 : args.budget_ms;
+                tp_sampler_refine(&sampler, prog_a, prog_b, budget);
+                TP_PROF_END(TP_STAGE_SAMPLE);
+            }
+
+            if (use_dasync) {
+                tp_async_request(&dasync, n_samples, t0, t1, params, tol);
+                const TP_AsyncFrame *f = screenshot_requested ? tp_async_wait(&dasync)
+                                                              : tp_async_latest(&dasync);
+                dsm = &f->samples;
+                if (screenshot_requested && f->failed) fprintf(stderr, "Aviso: derivada sem memoria\n");
+            } else if (show_deriv) {
+                TP_PROF_BEGIN(TP_STAGE_SAMPLE);
+                tp_sampler_reset(&dsampler, n_samples, t0, t1);
+                if (params) tp_sampler_set_params(&dsampler, params, deriv.prog, NULL);
+                tp_sampler_set_tolerance(&dsampler, tol);
+                tp_sampler_refine(&dsampler, deriv.prog, NULL,
+                                  screenshot_requested ? 0.0 : args.budget_ms);
+                TP_PROF_END(TP_STAGE_SAMPLE);
+            }
+
+            /* análise só sobre curvas completas; mesma chave => reaproveita */
+            if (analyze) {
+                curves[0].f = expr_ast;
+                curves[0].df = deriv.d1;
+                curves[0].d2f = deriv.d2;
+                curves[0].s = sm;
+                curves[1].f = deriv.d1;
+                curves[1].df = deriv.d2;
+                curves[1].s = dsm;
+                TP_PROF_BEGIN(TP_STAGE_SAMPLE);
+                const int a_rc = tp_analysis_update(&analysis, curves, show_deriv ? 2 : 1);
+                TP_PROF_END(TP_STAGE_SAMPLE);
+                if (a_rc == 1) analysis_written = 0;
+                else if (a_rc < 0) fprintf(stderr, "Aviso: analise sem memoria\n");
+            }
+
+            TP_PROF_BEGIN(TP_STAGE_RASTER);
+            if (!is_tuple) {
+                if (show_deriv) {
+                    tp_draw_function_samples(&out, &view, screen, dsm,
+                                             TP_DERIV_R, TP_DERIV_G, TP_DERIV_B);
+                }
+                tp_draw_function_samples(&out, &view, screen, sm,
+                                         args.fg_r, args.fg_g, args.fg_b);
+                if (show_marks && tp_sampler_complete(sm)) {
+                    tp_draw_features(&out, &view, screen, &analysis,
+                                     TP_MARK_GRAY, TP_MARK_GRAY, TP_MARK_GRAY);
+                }
+            } else {
+                tp_draw_parametric_samples(&out, &view, screen, sm,
+                                           args.fg_r, args.fg_g, args.fg_b);
+            }
+            TP_PROF_END(TP_STAGE_RASTER);
+        }
 
         if (screenshot_requested) {
             char sbuf[256];
-            int s_rc = tp_screenshot_save_bmp(renderer, w, h, out_path, sbuf, (int)sizeof(sbuf));
+            TP_PROF_BEGIN(TP_STAGE_SCREENSHOT);
+            int s_rc = 1;
+            sbuf[0] = '\0';
+            if (vec_fmt < 0) {
+                s_rc = tp_screenshot_save_bmp(renderer, w, h, out_path, sbuf, (int)sizeof(sbuf));
+            } else if (out.vec) {
+                s_rc = tp_vec_close(&vec);
+                out.vec = NULL;
+                if (s_rc != 0) snprintf(sbuf, sizeof(sbuf), "erro de escrita");
+            }
+            TP_PROF_END(TP_STAGE_SCREENSHOT);
             if (s_rc == 0) {
-                fprintf(stdout, "Screenshot salvo: %s\n", out_path);
-                fflush(stdout);
-            } else {
+                /* --analysis -: stdout é só o JSON */
+                FILE *status = analysis_path && strcmp(analysis_path, "-") == 0 ? stderr : stdout;
+                fprintf(status, "Screenshot salvo: %s\n", out_path);
+                fflush(status);
+            } else if (vec_fmt < 0 || sbuf[0]) {
                 fprintf(stderr, "Falha ao salvar screenshot (%s): %s\n", out_path, sbuf[0] ? sbuf : "erro desconhecido");
             }
 
+            /* relatório junto com o screenshot (mesmas amostras) */
+            if (analysis_path && analysis.valid && !analysis_written) {
+                if (write_analysis(analysis_path, &analysis, curves, label, param_names, &ps) != 0) {
+                    fprintf(stderr, "Falha ao gravar analise (%s)\n", analysis_path);
+                }
+                analysis_written = 1;
+            }
+
             screenshot_requested = 0;
 
             if (screenshot_and_exit) {
@@ -258,13 +882,43 @@ int main(int argc, char **argv) {
             }
         }
 
+        /* depois do screenshot: overlay não vai para o BMP */
+        if (show_stats) tp_prof_draw_overlay(renderer, screen);
+
+        TP_PROF_BEGIN(TP_STAGE_PRESENT);
         SDL_RenderPresent(renderer);
+        TP_PROF_END(TP_STAGE_PRESENT);
+
+        TP_PROF_END(TP_STAGE_FRAME);
+        TP_PROF_FRAME_END();
+    }
+
+    if (use_async) tp_async_stop(&async);
+    if (use_dasync) tp_async_stop(&dasync);
+    if (has_stream) tp_stream_close(&stream);
+    tp_stream_win_free(&swin);
+
+    if (analysis_path && analysis.valid && !analysis_written &&
+        write_analysis(analysis_path, &analysis, curves, label, param_names, &ps) != 0) {
+        fprintf(stderr, "Falha ao gravar analise (%s)\n", analysis_path);
     }
+    tp_analysis_free(&analysis);
+
+    if (heat_tex) SDL_DestroyTexture(heat_tex);
+    tp_heatmap_free(&heat);
 
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
 
-    tp_ast_free(expr_ast);
+    tp_sampler_free(&sampler);
+    tp_sampler_free(&dsampler);
+    deriv_free(&deriv);
+    tp_data_close(&data);
+    tp_lod_free(&lod);
+    if (args.show_stats) {
+        fprintf(stderr, "cache de expressoes: %lu hits, %lu misses\n", cache.hits, cache.misses);
+    }
+    release_expr(&cache, ce, args.cache_path);
     return 0;
 }
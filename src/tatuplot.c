@@ -0,0 +1,210 @@
+#include "tatuplot.h"
+#include "tp_cache.h"
+#include "tp_deriv.h"
+#include "tp_frame.h"
+#include "tp_lines.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if TATUPLOT_MAX_PARAMS != TP_PARAM_MAX
+#error "TATUPLOT_MAX_PARAMS precisa ser TP_PARAM_MAX"
+#endif
+
+struct TatuPlot {
+    TP_Cache cache;
+    TP_FrameCtx ctx;
+    TP_Lines lines;
+    char err[256];
+};
+
+/* Pedido resolvido: expressão do cache, f' e viewport final */
+typedef struct Prepared {
+    TP_Compiled *ce;
+    TP_Node *d1;
+    TP_Program *dprog;
+    TP_FrameScene sc;
+    TP_View view;
+    double params[TP_PARAM_MAX];   /* por dentro são sempre TP_PARAM_MAX */
+} Prepared;
+
+int tatuplot_version(void) {
+    return TATUPLOT_VERSION_MAJOR * 100 + TATUPLOT_VERSION_MINOR;
+}
+
+TatuPlot *tatuplot_new(void) {
+    TatuPlot *tp = (TatuPlot*)malloc(sizeof(TatuPlot));
+    if (!tp) return NULL;
+    if (tp_cache_init(&tp->cache, TP_CACHE_CAPACITY) != 0) {
+        free(tp);
+        return NULL;
+    }
+    tp_frame_ctx_init(&tp->ctx);
+    tp_lines_init(&tp->lines);
+    tp->err[0] = '\0';
+    return tp;
+}
+
+void tatuplot_free(TatuPlot *tp) {
+    if (!tp) return;
+    tp_lines_free(&tp->lines);
+    tp_frame_ctx_free(&tp->ctx);
+    tp_cache_free(&tp->cache);
+    free(tp);
+}
+
+void tatuplot_request_init(TatuPlotRequest *req) {
+    memset(req, 0, sizeof(*req));
+    req->width = 900;
+    req->height = 600;
+    req->xmin = -10.0; req->xmax = 10.0;
+    req->ymin = -10.0; req->ymax = 10.0;
+    req->fit = 1;
+    req->tmin = 0.0;
+    req->tmax = 6.283185307179586;
+    req->zmin = 0.0;
+    req->zmax = 1.0;
+    req->fg[1] = 220;
+}
+
+const char *tatuplot_error(const TatuPlot *tp) {
+    return tp->err;
+}
+
+/* mesmas regras de --param */
+static int valid_name(const char *s) {
+    if (!s || !s[0] || strlen(s) >= TP_PARAM_NAME_MAX) return 0;
+    if (strcmp(s, "x") == 0 || strcmp(s, "y") == 0 || strcmp(s, "e") == 0 || strcmp(s, "pi") == 0) return 0;
+    for (size_t i = 0; s[i]; i++) {
+        const char c = s[i];
+        const int alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+        if (!alpha && !(i > 0 && c >= '0' && c <= '9')) return 0;
+    }
+    return 1;
+}
+
+static int check(TatuPlot *tp, const TatuPlotRequest *q) {
+    const char *msg = NULL;
+    if (!q->expr) msg = "faltou expr";
+    else if (q->width < 1 || q->width > TATUPLOT_MAX_SIZE || q->height < 1 || q->height > TATUPLOT_MAX_SIZE)
+        msg = "tamanho invalido";
+    else if (!(q->xmin < q->xmax) || !(q->ymin < q->ymax) || !isfinite(q->xmax - q->xmin) || !isfinite(q->ymax - q->ymin))
+        msg = "viewport invalida: min precisa ser < max";
+    else if (!(q->tmin < q->tmax) || !isfinite(q->tmax - q->tmin))
+        msg = "range t invalido: tmin precisa ser < tmax";
+    else if (q->has_zrange && !(q->zmin < q->zmax))
+        msg = "range z invalido: zmin precisa ser < zmax";
+    else if (q->n_params < 0 || q->n_params > TATUPLOT_MAX_PARAMS || (q->n_params > 0 && (!q->param_names || !q->param_values)))
+        msg = "parametros invalidos";
+    for (int i = 0; !msg && i < q->n_params; i++) {
+        if (!valid_name(q->param_names[i])) msg = "nome de parametro invalido";
+        for (int j = 0; !msg && j < i; j++) {
+            if (strcmp(q->param_names[i], q->param_names[j]) == 0) msg = "parametro repetido";
+        }
+    }
+    if (msg) snprintf(tp->err, sizeof(tp->err), "%s", msg);
+    return msg ? TATUPLOT_EINVAL : TATUPLOT_OK;
+}
+
+static void release(Prepared *p) {
+    tp_prog_free(p->dprog);
+    tp_ast_free(p->d1);
+    tp_compiled_release(p->ce);
+}
+
+static int prepare(TatuPlot *tp, const TatuPlotRequest *q, int want_deriv, Prepared *p) {
+    memset(p, 0, sizeof(*p));
+    tp->err[0] = '\0';
+    int rc = check(tp, q);
+    if (rc != TATUPLOT_OK) return rc;
+
+    rc = tp_cache_get(&tp->cache, q->expr, q->param_names, q->n_params, &p->ce, tp->err, (int)sizeof(tp->err));
+    if (rc != 0) return rc == 1 ? TATUPLOT_EINVAL : TATUPLOT_ENOMEM;
+    const TP_Compiled *ce = p->ce;
+
+    /* f' fora do cache, como na janela */
+    if (want_deriv && q->deriv && !ce->is_tuple && !ce->is_field) {
+        p->d1 = tp_ast_derive(ce->ast);
+        p->dprog = p->d1 ? tp_prog_compile(p->d1) : NULL;
+        if (!p->dprog) {
+            snprintf(tp->err, sizeof(tp->err), "sem memoria");
+            release(p);
+            return TATUPLOT_ENOMEM;
+        }
+    }
+
+    TP_FrameScene *sc = &p->sc;
+    sc->prog_a = ce->prog_a;
+    sc->prog_b = ce->prog_b;
+    sc->prog_d = p->dprog;
+    sc->is_tuple = ce->is_tuple;
+    sc->is_field = ce->is_field;
+    for (int i = 0; i < q->n_params; i++) p->params[i] = q->param_values[i];
+    sc->params = q->n_params > 0 ? p->params : NULL;
+    sc->n_params = q->n_params;
+    sc->tmin = q->tmin;
+    sc->tmax = q->tmax;
+    sc->bg_r = q->bg[0]; sc->bg_g = q->bg[1]; sc->bg_b = q->bg[2];
+    sc->fg_r = q->fg[0]; sc->fg_g = q->fg[1]; sc->fg_b = q->fg[2];
+    sc->has_zrange = q->has_zrange;
+    sc->zmin = q->zmin;
+    sc->zmax = q->zmax;
+
+    /* outra expressão com o mesmo range acharia as amostras prontas */
+    tp_frame_ctx_reset(&tp->ctx);
+
+    p->view.xmin = q->xmin; p->view.xmax = q->xmax;
+    p->view.ymin = q->ymin; p->view.ymax = q->ymax;
+    if (ce->is_tuple && q->fit) tp_frame_fit_tuple(&p->view, ce->ast, sc->params, q->tmin, q->tmax);
+    return TATUPLOT_OK;
+}
+
+int tatuplot_render(TatuPlot *tp, const TatuPlotRequest *req, TatuPlotImage *out) {
+    Prepared p;
+    int rc = prepare(tp, req, 1, &p);
+    if (rc != TATUPLOT_OK) return rc;
+
+    if (tp_frame_draw(&p.sc, &tp->ctx, &p.view, req->width, req->height, NULL) != 0) {
+        snprintf(tp->err, sizeof(tp->err), "sem memoria");
+        rc = TATUPLOT_ENOMEM;
+    } else {
+        out->width = req->width;
+        out->height = req->height;
+        out->pitch = req->width * (int)sizeof(Uint32);
+        out->pixels = (const uint32_t*)tp->ctx.pixels;
+        out->xmin = p.view.xmin; out->xmax = p.view.xmax;
+        out->ymin = p.view.ymin; out->ymax = p.view.ymax;
+    }
+    release(&p);
+    return rc;
+}
+
+int tatuplot_lines(TatuPlot *tp, const TatuPlotRequest *req, TatuPlotLines *out) {
+    Prepared p;
+    int rc = prepare(tp, req, 0, &p);
+    if (rc != TATUPLOT_OK) return rc;
+
+    if (p.ce->is_field) {
+        snprintf(tp->err, sizeof(tp->err), "z = f(x,y) nao tem polilinha");
+        release(&p);
+        return TATUPLOT_EINVAL;
+    }
+
+    tp_lines_clear(&tp->lines);
+    const TP_Out o = { NULL, NULL, &tp->lines };
+    if (tp_frame_draw_curves(&p.sc, &tp->ctx, &p.view, req->width, req->height, &o) != 0 || tp->lines.failed) {
+        snprintf(tp->err, sizeof(tp->err), "sem memoria");
+        rc = TATUPLOT_ENOMEM;
+    } else {
+        static const int no_lines = 0;
+        out->xy = tp->lines.pt;
+        out->n_points = tp->lines.n;
+        out->starts = tp->lines.starts ? tp->lines.starts : &no_lines;
+        out->n_lines = tp->lines.n_lines;
+        out->xmin = p.view.xmin; out->xmax = p.view.xmax;
+        out->ymin = p.view.ymin; out->ymax = p.view.ymax;
+    }
+    release(&p);
+    return rc;
+}
@@ -0,0 +1,449 @@
+#include "tp_analysis.h"
+#include <SDL2/SDL.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TP_ANALYSIS_MAX_THREADS 32
+
+/* intervalos por thread abaixo disso não compensam criar a thread */
+#define TP_ANALYSIS_PER_THREAD 16
+
+/* iterações por intervalo (bissecção pura fecha qualquer intervalo de
+   double bem antes disso) */
+#define TP_ANALYSIS_ITERS 100
+
+void tp_analysis_init(TP_Analysis *a) {
+    memset(a, 0, sizeof(*a));
+    a->nthreads = SDL_GetCPUCount();
+    if (a->nthreads < 1) a->nthreads = 1;
+    if (a->nthreads > TP_ANALYSIS_MAX_THREADS) a->nthreads = TP_ANALYSIS_MAX_THREADS;
+}
+
+void tp_analysis_free(TP_Analysis *a) {
+    free(a->feat);
+    a->feat = NULL;
+    a->n = a->cap = 0;
+    a->valid = 0;
+}
+
+/* ---------- g(x) de um intervalo: fa(x) - fb(x) (fb NULL = 0) ---------- */
+
+typedef struct Fn {
+    const TP_Node *a, *b;
+} Fn;
+
+static double fn_eval(Fn g, double x, const double *params) {
+    const double v = tp_eval_p(g.a, x, NAN, params);
+    return g.b ? v - tp_eval_p(g.b, x, NAN, params) : v;
+}
+
+/* intervalo [x0,x1] com g(x0), g(x1) de sinais opostos (x0 == x1: zero
+   exato numa amostra, nada a refinar) */
+typedef struct Bracket {
+    TP_FeatureKind kind;
+    int curve, other;
+    double x0, x1, g0, g1;
+    Fn g, dg;          /* dg.a NULL: sem derivada (Brent) */
+    Fn val;            /* y do ponto */
+
+    /* saída */
+    double x, y;
+    int ok;
+} Bracket;
+
+/* Newton com dg; passo fora do intervalo (ou dg = 0/NaN) vira bissecção */
+static double newton(const Bracket *br, const double *params, int *ok) {
+    double a = br->x0, b = br->x1, x = 0.5 * (a + b);
+    for (int it = 0; it < TP_ANALYSIS_ITERS; it++) {
+        const double gx = fn_eval(br->g, x, params);
+        if (gx == 0.0) break;
+        if (!isfinite(gx)) { *ok = 0; return x; }
+        if ((gx < 0.0) == (br->g0 < 0.0)) a = x; else b = x;
+
+        double nx = x - gx / fn_eval(br->dg, x, params);
+        if (!(nx > a && nx < b)) nx = 0.5 * (a + b);
+
+        const double tol = 2.0 * DBL_EPSILON * fmax(fabs(x), DBL_MIN);
+        const int done = fabs(nx - x) <= tol || b - a <= tol;
+        x = nx;
+        if (done) break;
+    }
+    *ok = 1;
+    return x;
+}
+
+/* Brent: interpolação inversa quadrática/secante com bissecção de garantia */
+static double brent(const Bracket *br, const double *params, int *ok) {
+    double a = br->x0, b = br->x1, c = b;
+    double fa = br->g0, fb = br->g1, fc = fb;
+    double d = b - a, e = d;
+
+    *ok = 1;
+    for (int it = 0; it < TP_ANALYSIS_ITERS; it++) {
+        if ((fb > 0.0) == (fc > 0.0)) {
+            c = a; fc = fa;
+            d = e = b - a;
+        }
+        if (fabs(fc) < fabs(fb)) {
+            a = b; b = c; c = a;
+            fa = fb; fb = fc; fc = fa;
+        }
+        const double tol = 2.0 * DBL_EPSILON * fabs(b) + DBL_MIN;
+        const double xm = 0.5 * (c - b);
+        if (fabs(xm) <= tol || fb == 0.0) return b;
+
+        if (fabs(e) >= tol && fabs(fa) > fabs(fb)) {
+            const double s = fb / fa;
+            double p, q;
+            if (a == c) {
+                p = 2.0 * xm * s;
+                q = 1.0 - s;
+            } else {
+                const double qq = fa / fc, r = fb / fc;
+                p = s * (2.0 * xm * qq * (qq - r) - (b - a) * (r - 1.0));
+                q = (qq - 1.0) * (r - 1.0) * (s - 1.0);
+            }
+            if (p > 0.0) q = -q;
+            p = fabs(p);
+            const double min1 = 3.0 * xm * q - fabs(tol * q), min2 = fabs(e * q);
+            if (2.0 * p < (min1 < min2 ? min1 : min2)) {
+                e = d;
+                d = p / q;
+            } else {
+                d = xm;
+                e = d;
+            }
+        } else {
+            d = xm;
+            e = d;
+        }
+        a = b;
+        fa = fb;
+        b += (fabs(d) > tol) ? d : (xm > 0.0 ? tol : -tol);
+        fb = fn_eval(br->g, b, params);
+        if (!isfinite(fb)) { *ok = 0; return b; }
+    }
+    return b;
+}
+
+static void refine(Bracket *br, const double *params) {
+    int ok = 1;
+    double x = br->x0;
+    if (br->x1 != br->x0) {
+        x = br->dg.a ? newton(br, params, &ok) : brent(br, params, &ok);
+        /* polo: troca de sinal por infinito, |g| cresce em vez de cair */
+        if (ok) ok = fabs(fn_eval(br->g, x, params)) <= fmin(fabs(br->g0), fabs(br->g1));
+    }
+    br->x = x;
+    br->y = (br->kind == TP_FEAT_ROOT) ? 0.0 : fn_eval(br->val, x, params);
+    br->ok = ok && isfinite(br->y);
+}
+
+/* ---------- refinamento paralelo ---------- */
+
+typedef struct RefineJob {
+    Bracket *br;
+    int n;
+    const double *params;
+    SDL_atomic_t next;
+} RefineJob;
+
+static int refine_worker(void *data) {
+    RefineJob *job = (RefineJob*)data;
+    for (;;) {
+        const int i = SDL_AtomicAdd(&job->next, 1);
+        if (i >= job->n) break;
+        refine(&job->br[i], job->params);
+    }
+    return 0;
+}
+
+/* roda em nthreads (a thread chamadora participa) */
+static void run_parallel(RefineJob *job, int nthreads) {
+    SDL_Thread *th[TP_ANALYSIS_MAX_THREADS];
+
+    for (int i = 1; i < nthreads; i++) {
+        th[i] = SDL_CreateThread(refine_worker, "tp_analysis", job);
+    }
+    refine_worker(job);
+    for (int i = 1; i < nthreads; i++) {
+        if (th[i]) SDL_WaitThread(th[i], NULL);
+    }
+}
+
+/* ---------- varredura das amostras ---------- */
+
+typedef struct Scan {
+    Bracket *br;
+    int n, cap;
+    int failed;
+} Scan;
+
+static Bracket *push(Scan *sc, TP_FeatureKind kind, int curve, int other,
+                     double x0, double x1, double g0, double g1) {
+    if (sc->n == TP_ANALYSIS_MAX) return NULL;
+    if (sc->n == sc->cap) {
+        const int ncap = sc->cap ? sc->cap * 2 : 64;
+        Bracket *nb = (Bracket*)realloc(sc->br, (size_t)ncap * sizeof(Bracket));
+        if (!nb) { sc->failed = 1; return NULL; }
+        sc->br = nb;
+        sc->cap = ncap;
+    }
+    Bracket *b = &sc->br[sc->n++];
+    memset(b, 0, sizeof(*b));
+    b->kind = kind;
+    b->curve = curve;
+    b->other = other;
+    b->x0 = x0;
+    b->x1 = x1;
+    b->g0 = g0;
+    b->g1 = g1;
+    return b;
+}
+
+/* Zeros pela sequência desenhada (amostras + subamostras por curvatura:
+   pega oscilações entre colunas). Zero exato conta uma vez por sequência. */
+static void scan_roots(Scan *sc, const TP_AnaCurve *c, int ci) {
+    const TP_Sampler *s = c->s;
+    double px = NAN, py = NAN;
+    int sub = 0;
+    for (int i = 0; i < s->n; i++) {
+        const int ns = (i < s->adapted) ? s->sub_n[i] : 0;
+        for (int j = -1; j < ns; j++) {
+            const double x = j < 0 ? s->xs[i] : s->sub_x[sub];
+            const double y = j < 0 ? s->ys[i] : s->sub_y[sub];
+            if (j >= 0) sub++;
+
+            Bracket *b = NULL;
+            if (y == 0.0 && !(py == 0.0)) b = push(sc, TP_FEAT_ROOT, ci, -1, x, x, 0.0, 0.0);
+            else if (py * y < 0.0) b = push(sc, TP_FEAT_ROOT, ci, -1, px, x, py, y);
+            if (b) {
+                b->g.a = c->f;
+                b->dg.a = c->df;
+                b->val.a = c->f;
+            }
+            px = x;
+            py = y;
+        }
+    }
+}
+
+/* Extremos: f' de cada amostra já veio do jato do sampler */
+static void scan_extrema(Scan *sc, const TP_AnaCurve *c, int ci) {
+    const TP_Sampler *s = c->s;
+    if (!c->df) return;
+    for (int i = 0; i < s->n; i++) {
+        const double d = s->d1s[i];
+        const double dp = i > 0 ? s->d1s[i - 1] : NAN;
+        if (!isfinite(s->ys[i])) continue;
+
+        Bracket *b = NULL;
+        if (d == 0.0 && !(dp == 0.0)) {
+            /* f'' decide; 0 é inflexão (x^3) */
+            const double c2 = s->d2s[i];
+            if (c2 != 0.0 && isfinite(c2)) {
+                b = push(sc, c2 > 0.0 ? TP_FEAT_MIN : TP_FEAT_MAX, ci, -1, s->xs[i], s->xs[i], 0.0, 0.0);
+            }
+        } else if (dp * d < 0.0 && isfinite(s->ys[i - 1])) {
+            b = push(sc, d > 0.0 ? TP_FEAT_MIN : TP_FEAT_MAX, ci, -1, s->xs[i - 1], s->xs[i], dp, d);
+        }
+        if (b) {
+            b->g.a = c->df;
+            b->dg.a = c->d2f;
+            b->val.a = c->f;
+        }
+    }
+}
+
+/* Cruzamentos de duas curvas na mesma grade: troca de sinal de y_a - y_b */
+static void scan_cross(Scan *sc, const TP_AnaCurve *c, int ca, int cb) {
+    const TP_Sampler *sa = c[ca].s, *sb = c[cb].s;
+    double px = NAN, pd = NAN;
+    for (int i = 0; i < sa->n; i++) {
+        const double x = sa->xs[i];
+        const double d = sa->ys[i] - sb->ys[i];
+
+        Bracket *b = NULL;
+        if (d == 0.0 && !(pd == 0.0)) b = push(sc, TP_FEAT_CROSS, ca, cb, x, x, 0.0, 0.0);
+        else if (pd * d < 0.0) b = push(sc, TP_FEAT_CROSS, ca, cb, px, x, pd, d);
+        if (b) {
+            b->g.a = c[ca].f;
+            b->g.b = c[cb].f;
+            if (c[ca].df && c[cb].df) {
+                b->dg.a = c[ca].df;
+                b->dg.b = c[cb].df;
+            }
+            b->val.a = c[ca].f;
+        }
+        px = x;
+        pd = d;
+    }
+}
+
+static void key_of(TP_AnaKey *k, const TP_Sampler *s) {
+    k->n = s->n;
+    k->t0 = s->t0;
+    k->t1 = s->t1;
+    k->tol = s->tol;
+    if (s->has_params) memcpy(k->params, s->params, sizeof(k->params));
+    else memset(k->params, 0, sizeof(k->params));
+}
+
+static int key_eq(const TP_AnaKey *a, const TP_AnaKey *b) {
+    if (a->n != b->n || a->t0 != b->t0 || a->t1 != b->t1 || a->tol != b->tol) return 0;
+    for (int i = 0; i < TP_PARAM_MAX; i++) {
+        if (a->params[i] != b->params[i]) return 0;
+    }
+    return 1;
+}
+
+static int same_grid(const TP_Sampler *a, const TP_Sampler *b) {
+    return a->n == b->n && a->t0 == b->t0 && a->t1 == b->t1;
+}
+
+static int cmp_feature(const void *pa, const void *pb) {
+    const TP_Feature *a = (const TP_Feature*)pa, *b = (const TP_Feature*)pb;
+    if (a->x != b->x) return (a->x > b->x) - (a->x < b->x);
+    if (a->kind != b->kind) return (int)a->kind - (int)b->kind;
+    return a->curve - b->curve;
+}
+
+int tp_analysis_update(TP_Analysis *a, const TP_AnaCurve *c, int n_curves) {
+    if (n_curves > TP_ANALYSIS_MAX_CURVES) n_curves = TP_ANALYSIS_MAX_CURVES;
+
+    TP_AnaKey key[TP_ANALYSIS_MAX_CURVES];
+    int same = a->valid && a->n_curves == n_curves;
+    for (int i = 0; i < n_curves; i++) {
+        if (!tp_sampler_complete(c[i].s)) return 0;
+        key_of(&key[i], c[i].s);
+        same = same && key_eq(&key[i], &a->key[i]);
+    }
+    if (same) return 0;
+
+    /* intervalos na ordem da varredura; refino independente por intervalo */
+    Scan sc = { NULL, 0, 0, 0 };
+    for (int i = 0; i < n_curves; i++) {
+        scan_roots(&sc, &c[i], i);
+        scan_extrema(&sc, &c[i], i);
+    }
+    for (int i = 0; i < n_curves; i++) {
+        for (int j = i + 1; j < n_curves; j++) {
+            if (same_grid(c[i].s, c[j].s)) scan_cross(&sc, c, i, j);
+        }
+    }
+    if (sc.failed) {
+        free(sc.br);
+        return -1;
+    }
+
+    /* parâmetros: todas as curvas vêm da mesma expressão */
+    const double *params = (n_curves > 0 && c[0].s->has_params) ? c[0].s->params : NULL;
+    RefineJob job;
+    job.br = sc.br;
+    job.n = sc.n;
+    job.params = params;
+    SDL_AtomicSet(&job.next, 0);
+
+    int nthreads = sc.n / TP_ANALYSIS_PER_THREAD;
+    if (nthreads > a->nthreads) nthreads = a->nthreads;
+    if (nthreads < 1) nthreads = 1;
+    run_parallel(&job, nthreads);
+
+    if (sc.n > a->cap) {
+        TP_Feature *nf = (TP_Feature*)realloc(a->feat, (size_t)sc.n * sizeof(TP_Feature));
+        if (!nf) {
+            free(sc.br);
+            return -1;
+        }
+        a->feat = nf;
+        a->cap = sc.n;
+    }
+
+    a->n = 0;
+    for (int i = 0; i < sc.n; i++) {
+        const Bracket *b = &sc.br[i];
+        if (!b->ok) continue;
+        TP_Feature *f = &a->feat[a->n++];
+        f->kind = b->kind;
+        f->curve = b->curve;
+        f->other = b->other;
+        f->x = b->x;
+        f->y = b->y;
+    }
+    qsort(a->feat, (size_t)a->n, sizeof(TP_Feature), cmp_feature);
+    free(sc.br);
+
+    a->n_curves = n_curves;
+    memcpy(a->key, key, (size_t)n_curves * sizeof(TP_AnaKey));
+    a->valid = 1;
+    return 1;
+}
+
+/* ---------- JSON ---------- */
+
+static void json_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        const unsigned char ch = (unsigned char)*s;
+        if (ch == '"' || ch == '\\') fprintf(f, "\\%c", ch);
+        else if (ch < 0x20) fprintf(f, "\\u%04x", ch);
+        else fputc(ch, f);
+    }
+    fputc('"', f);
+}
+
+/* JSON não tem NaN/Inf */
+static void json_number(FILE *f, double v) {
+    if (isfinite(v)) fprintf(f, "%.17g", v);
+    else fputs("null", f);
+}
+
+static const char *kind_name(TP_FeatureKind k) {
+    switch (k) {
+        case TP_FEAT_ROOT: return "root";
+        case TP_FEAT_MIN:  return "min";
+        case TP_FEAT_MAX:  return "max";
+        default:           return "cross";
+    }
+}
+
+int tp_analysis_write_json(const TP_Analysis *a, const TP_AnaCurve *c,
+                           const char *expr,
+                           const char *const *names, const double *values, int n_params,
+                           FILE *f) {
+    fputs("{\n  \"expr\": ", f);
+    json_string(f, expr ? expr : "");
+
+    fputs(",\n  \"x_range\": [", f);
+    json_number(f, a->valid && a->n_curves > 0 ? a->key[0].t0 : NAN);
+    fputs(", ", f);
+    json_number(f, a->valid && a->n_curves > 0 ? a->key[0].t1 : NAN);
+    fputs("],\n  \"params\": {", f);
+    for (int i = 0; i < n_params; i++) {
+        fputs(i ? ", " : "", f);
+        json_string(f, names[i]);
+        fputs(": ", f);
+        json_number(f, values[i]);
+    }
+
+    fputs("},\n  \"features\": [", f);
+    for (int i = 0; i < a->n; i++) {
+        const TP_Feature *p = &a->feat[i];
+        fprintf(f, "%s\n    {\"kind\": \"%s\", \"curve\": ", i ? "," : "", kind_name(p->kind));
+        json_string(f, c[p->curve].name);
+        if (p->kind == TP_FEAT_CROSS) {
+            fputs(", \"other\": ", f);
+            json_string(f, c[p->other].name);
+        }
+        fputs(", \"x\": ", f);
+        json_number(f, p->x);
+        fputs(", \"y\": ", f);
+        json_number(f, p->y);
+        fputc('}', f);
+    }
+    fputs(a->n ? "\n  ]\n}\n" : "]\n}\n", f);
+
+    return ferror(f) ? 1 : 0;
+}
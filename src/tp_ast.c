@@ -1,6 +1,7 @@
 #include "tp_ast.h"
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 static TP_Node *tp_new_node(TP_NodeType t) {
     TP_Node *n = (TP_Node*)calloc(1, sizeof(TP_Node));
@@ -20,6 +21,10 @@ TP_Node *tp_node_var_x(void) {
     return tp_new_node(TP_NODE_VAR_X);
 }
 
+TP_Node *tp_node_var_y(void) {
+    return tp_new_node(TP_NODE_VAR_Y);
+}
+
 TP_Node *tp_node_unary(TP_NodeType t, TP_Node *a) {
     TP_Node *n = tp_new_node(t);
     if (!n) return NULL;
@@ -59,67 +64,430 @@ TP_Node *tp_node_tuple2(TP_Node *a, TP_Node *b) {
     return n;
 }
 
-void tp_ast_free(TP_Node *n) {
-    if (!n) return;
+TP_Node *tp_node_let(int slot, TP_Node *value, TP_Node *body) {
+    TP_Node *n = tp_new_node(TP_NODE_LET);
+    if (!n) return NULL;
+    n->as.let.slot = slot;
+    n->as.let.value = value;
+    n->as.let.body = body;
+    return n;
+}
+
+TP_Node *tp_node_slot(int slot) {
+    TP_Node *n = tp_new_node(TP_NODE_SLOT);
+    if (!n) return NULL;
+    n->as.slot = slot;
+    return n;
+}
+
+TP_Node *tp_node_param(int index) {
+    TP_Node *n = tp_new_node(TP_NODE_PARAM);
+    if (!n) return NULL;
+    n->as.slot = index;
+    return n;
+}
 
+/* ---------- filhos e percurso ---------- */
+
+int tp_ast_nchildren(const TP_Node *n) {
     switch (n->type) {
         case TP_NODE_UNARY_NEG:
-            tp_ast_free(n->as.unary.a);
-            break;
+        case TP_NODE_FUNC1:
+            return 1;
 
         case TP_NODE_ADD:
         case TP_NODE_SUB:
         case TP_NODE_MUL:
         case TP_NODE_DIV:
         case TP_NODE_POW:
-            tp_ast_free(n->as.bin.a);
-            tp_ast_free(n->as.bin.b);
-            break;
+        case TP_NODE_FRAC:
+        case TP_NODE_TUPLE2:
+        case TP_NODE_LET:
+            return 2;
+
+        default:
+            return 0;
+    }
+}
+
+static TP_Node **child_slot(TP_Node *n, int i) {
+    switch (n->type) {
+        case TP_NODE_UNARY_NEG: return &n->as.unary.a;
+        case TP_NODE_FUNC1:     return &n->as.func1.arg;
+
+        case TP_NODE_ADD:
+        case TP_NODE_SUB:
+        case TP_NODE_MUL:
+        case TP_NODE_DIV:
+        case TP_NODE_POW:
+            return i ? &n->as.bin.b : &n->as.bin.a;
+
+        case TP_NODE_FRAC:   return i ? &n->as.frac.den : &n->as.frac.num;
+        case TP_NODE_TUPLE2: return i ? &n->as.tuple2.b : &n->as.tuple2.a;
+        case TP_NODE_LET:    return i ? &n->as.let.body : &n->as.let.value;
+
+        default: return NULL;
+    }
+}
+
+TP_Node *tp_ast_child(const TP_Node *n, int i) {
+    TP_Node **s = child_slot((TP_Node*)n, i);
+    return s ? *s : NULL;
+}
+
+void tp_ast_set_child(TP_Node *n, int i, TP_Node *c) {
+    TP_Node **s = child_slot(n, i);
+    if (s) *s = c;
+}
+
+/* endereços dos filhos de n (NULL se não houver); um switch só */
+static void slots(TP_Node *n, TP_Node ***l, TP_Node ***r) {
+    *l = *r = NULL;
+    switch (n->type) {
+        case TP_NODE_UNARY_NEG: *l = &n->as.unary.a;   break;
+        case TP_NODE_FUNC1:     *l = &n->as.func1.arg; break;
+
+        case TP_NODE_ADD:
+        case TP_NODE_SUB:
+        case TP_NODE_MUL:
+        case TP_NODE_DIV:
+        case TP_NODE_POW:
+            *l = &n->as.bin.a; *r = &n->as.bin.b; break;
+
+        case TP_NODE_FRAC:   *l = &n->as.frac.num; *r = &n->as.frac.den; break;
+        case TP_NODE_TUPLE2: *l = &n->as.tuple2.a; *r = &n->as.tuple2.b; break;
+        case TP_NODE_LET:    *l = &n->as.let.value; *r = &n->as.let.body; break;
+
+        default: break;
+    }
+}
+
+/* Sem pilha: rotaciona à direita até o nó não ter filho esquerdo,
+   então libera e segue pelo direito. */
+void tp_ast_free(TP_Node *n) {
+    while (n) {
+        TP_Node **ls, **rs;
+        slots(n, &ls, &rs);
+
+        if (ls && *ls) {
+            TP_Node *l = *ls;
+            TP_Node **lls, **lrs;
+            slots(l, &lls, &lrs);
+            if (lrs) {
+                /* n vira filho direito de l */
+                *ls = *lrs;
+                *lrs = n;
+                n = l;
+            } else {
+                /* l tem no máximo um filho: sobe o neto */
+                *ls = lls ? *lls : NULL;
+                free(l);
+            }
+            continue;
+        }
+
+        TP_Node *r = rs ? *rs : NULL;
+        free(n);
+        n = r;
+    }
+}
+
+/* pilha que começa no array local e passa para o heap ao crescer */
+static int stack_grow(void **st, int *cap, const void *local, size_t elem) {
+    const int ncap = *cap * 2;
+    void *ns;
+    if (*st == local) {
+        ns = malloc((size_t)ncap * elem);
+        if (ns) memcpy(ns, local, (size_t)*cap * elem);
+    } else {
+        ns = realloc(*st, (size_t)ncap * elem);
+    }
+    if (!ns) return 0;
+    *st = ns;
+    *cap = ncap;
+    return 1;
+}
+
+static int walk_push(TP_AstWalk *w, TP_Node *n) {
+    if (w->sp == w->cap) {
+        void *st = w->st;
+        if (!stack_grow(&st, &w->cap, w->local, sizeof(TP_AstWalkFrame))) {
+            w->failed = 1;
+            return 0;
+        }
+        w->st = (TP_AstWalkFrame*)st;
+    }
+    w->st[w->sp].n = n;
+    w->st[w->sp].next = 0;
+    w->sp++;
+    return 1;
+}
+
+void tp_ast_walk_init(TP_AstWalk *w, const TP_Node *root) {
+    w->st = w->local;
+    w->sp = 0;
+    w->cap = TP_WALK_LOCAL;
+    w->failed = 0;
+    if (root) walk_push(w, (TP_Node*)root);
+}
+
+const TP_Node *tp_ast_walk_next(TP_AstWalk *w) {
+    while (w->sp > 0 && !w->failed) {
+        TP_AstWalkFrame *top = &w->st[w->sp - 1];
+        if (top->next < tp_ast_nchildren(top->n)) {
+            TP_Node *c = *child_slot(top->n, top->next++);
+            if (c) walk_push(w, c);
+            continue;
+        }
+        w->sp--;
+        return top->n;
+    }
+    return NULL;
+}
+
+void tp_ast_walk_free(TP_AstWalk *w) {
+    if (w->st != w->local) free(w->st);
+    w->st = w->local;
+    w->sp = 0;
+}
+
+/* Pós-ordem: cada nó copiado recebe os filhos já copiados do topo da
+   pilha de resultados. */
+TP_Node *tp_ast_clone_map(const TP_Node *n, TP_LeafMap leaf, void *ctx) {
+    if (!n) return NULL;
+
+    TP_Node *local[TP_WALK_LOCAL];
+    TP_Node **res = local;
+    int sp = 0, cap = TP_WALK_LOCAL, ok = 1;
+    TP_AstWalk w;
+    const TP_Node *c;
+
+    tp_ast_walk_init(&w, n);
+    while (ok && (c = tp_ast_walk_next(&w)) != NULL) {
+        const int nc = tp_ast_nchildren(c);
+        TP_Node *cp = NULL;
+        if (nc == 0 && leaf && !leaf(ctx, c, &cp)) { ok = 0; break; }
+        if (!cp) {
+            cp = tp_new_node(c->type);
+            if (!cp) { ok = 0; break; }
+            cp->as = c->as;
+        }
+        for (int i = nc - 1; i >= 0; i--) {
+            /* filho NULL no original continua NULL */
+            *child_slot(cp, i) = *child_slot((TP_Node*)c, i) ? res[--sp] : NULL;
+        }
+        if (sp == cap) {
+            void *p = res;
+            if (!stack_grow(&p, &cap, local, sizeof(TP_Node*))) { tp_ast_free(cp); ok = 0; break; }
+            res = (TP_Node**)p;
+        }
+        res[sp++] = cp;
+    }
+    if (w.failed) ok = 0;
+    tp_ast_walk_free(&w);
+
+    TP_Node *out = (ok && sp == 1) ? res[0] : NULL;
+    if (!out) while (sp > 0) tp_ast_free(res[--sp]);
+    if (res != local) free(res);
+    return out;
+}
+
+TP_Node *tp_ast_clone(const TP_Node *n) {
+    return tp_ast_clone_map(n, NULL, NULL);
+}
+
+/* ---------- avaliação ---------- */
+
+/* a, b: valores dos filhos (os que existirem) */
+static double apply(const TP_Node *n, double a, double b, double x, double y) {
+    switch (n->type) {
+        case TP_NODE_NUMBER: return n->as.number;
+        case TP_NODE_VAR_X:  return x;
+        case TP_NODE_VAR_Y:  return y;
+
+        case TP_NODE_UNARY_NEG: return -a;
+
+        case TP_NODE_ADD: return a + b;
+        case TP_NODE_SUB: return a - b;
+        case TP_NODE_MUL: return a * b;
+        case TP_NODE_DIV: return a / b;
+        case TP_NODE_POW: return pow(a, b);
 
         case TP_NODE_FUNC1:
-            tp_ast_free(n->as.func1.arg);
-            break;
+            switch (n->as.func1.f) {
+                case TP_F_SIN:  return sin(a);
+                case TP_F_COS:  return cos(a);
+                case TP_F_TAN:  return tan(a);
+                case TP_F_LOG:  return log(a);
+                case TP_F_EXP:  return exp(a);
+                case TP_F_SQRT: return sqrt(a);
+                default: return NAN;
+            }
 
         case TP_NODE_FRAC:
-            tp_ast_free(n->as.frac.num);
-            tp_ast_free(n->as.frac.den);
-            break;
+            return a / b;
+
+        case TP_NODE_LET:
+            return b;
 
+        /* Tupla não é "avaliável" como escalar */
         case TP_NODE_TUPLE2:
-            tp_ast_free(n->as.tuple2.a);
-            tp_ast_free(n->as.tuple2.b);
-            break;
+            return NAN;
 
         default:
-            break;
+            return NAN;
     }
+}
 
-    free(n);
+double tp_ast_apply(const TP_Node *n, const double *a, double x, double y) {
+    const int nc = tp_ast_nchildren(n);
+    return apply(n, nc > 0 ? a[0] : 0.0, nc > 1 ? a[1] : 0.0, x, y);
 }
 
 double tp_eval(const TP_Node *n, double x) {
+    return tp_eval2(n, x, NAN);
+}
+
+/* filhos de n em l e r (r NULL nos unários); devolve quantos */
+static int children(const TP_Node *n, const TP_Node **l, const TP_Node **r) {
+    switch (n->type) {
+        case TP_NODE_UNARY_NEG: *l = n->as.unary.a;   *r = NULL; return 1;
+        case TP_NODE_FUNC1:     *l = n->as.func1.arg; *r = NULL; return 1;
+
+        case TP_NODE_ADD:
+        case TP_NODE_SUB:
+        case TP_NODE_MUL:
+        case TP_NODE_DIV:
+        case TP_NODE_POW:
+            *l = n->as.bin.a; *r = n->as.bin.b; return 2;
+
+        case TP_NODE_FRAC:   *l = n->as.frac.num; *r = n->as.frac.den; return 2;
+        case TP_NODE_TUPLE2: *l = n->as.tuple2.a; *r = n->as.tuple2.b; return 2;
+        case TP_NODE_LET:    *l = n->as.let.value; *r = n->as.let.body; return 2;
+
+        default: return 0;
+    }
+}
+
+static int is_unary(const TP_Node *n) {
+    return n->type == TP_NODE_UNARY_NEG || n->type == TP_NODE_FUNC1;
+}
+
+/* Valores dos slots (LET) durante uma avaliação. Slots são numerados
+   em sequência por expressão (tp_sym), então o array local quase
+   sempre basta. Sem memória: o slot fica de fora e lê NAN. */
+#define ENV_LOCAL 16
+
+typedef struct Env {
+    double *v;
+    int cap;
+    double local[ENV_LOCAL];
+} Env;
+
+/* params: SLOTs livres 0..TP_PARAM_MAX-1 já começam com os valores;
+   sem params, parâmetro sem valor lê NAN (não lixo da pilha) */
+static void env_init(Env *e, const double *params) {
+    e->v = e->local;
+    e->cap = ENV_LOCAL;
+    for (int i = 0; i < TP_PARAM_MAX; i++) e->local[i] = params ? params[i] : NAN;
+}
+static void env_free(Env *e) { if (e->v != e->local) free(e->v); }
+
+static void env_set(Env *e, int slot, double v) {
+    while (slot >= e->cap) {
+        void *p = e->v;
+        if (!stack_grow(&p, &e->cap, e->local, sizeof(double))) return;
+        e->v = (double*)p;
+    }
+    if (slot >= 0) e->v[slot] = v;
+}
+
+static double env_get(const Env *e, int slot) {
+    return (slot >= 0 && slot < e->cap) ? e->v[slot] : NAN;
+}
+
+/* Frame da avaliação: nó pendente, filho direito ainda não visitado
+   e o valor do lado esquerdo já calculado. */
+typedef struct EvalFrame {
+    const TP_Node *n;
+    const TP_Node *r;   /* NULL: só falta aplicar */
+    double lhs;
+} EvalFrame;
+
+/* Desce pela esquerda empilhando, avalia a folha e sobe aplicando;
+   binários descem pela direita guardando o lado esquerdo no frame.
+   Pilha local; heap só para árvores fundas. */
+static double eval_iter(const TP_Node *n, double x, double y, Env *env) {
+    EvalFrame local[TP_WALK_LOCAL];
+    EvalFrame *st = local;
+    int sp = 0, cap = TP_WALK_LOCAL;
+    double v = NAN;
+
+    while (n) {
+        const TP_Node *l, *r;
+        while (n && children(n, &l, &r) > 0) {
+            if (sp == cap) {
+                void *p = st;
+                if (!stack_grow(&p, &cap, local, sizeof(EvalFrame))) { n = NULL; break; }
+                st = (EvalFrame*)p;
+            }
+            st[sp].n = n;
+            st[sp].r = r;
+            sp++;
+            n = l;
+        }
+        if (!n) { v = NAN; break; }   /* filho ausente ou sem memória */
+
+        v = (n->type == TP_NODE_SLOT) ? env_get(env, n->as.slot) : apply(n, 0.0, 0.0, x, y);
+        n = NULL;
+
+        while (sp > 0) {
+            EvalFrame *f = &st[sp - 1];
+            if (f->r) {
+                if (f->n->type == TP_NODE_LET) env_set(env, f->n->as.let.slot, v);
+                f->lhs = v;
+                n = f->r;
+                f->r = NULL;
+                break;
+            }
+            v = is_unary(f->n) ? apply(f->n, v, 0.0, x, y) : apply(f->n, f->lhs, v, x, y);
+            sp--;
+        }
+    }
+
+    if (st != local) free(st);
+    return v;
+}
+
+/* Recursão só até TP_EVAL_REC_MAX níveis (caminho rápido das expressões
+   comuns, sem passar por apply); subárvores mais fundas seguem na pilha
+   explícita. */
+static double eval_rec(const TP_Node *n, double x, double y, Env *env, int depth) {
     if (!n) return NAN;
+    if (depth >= TP_EVAL_REC_MAX) return eval_iter(n, x, y, env);
+    depth++;
 
     switch (n->type) {
         case TP_NODE_NUMBER: return n->as.number;
         case TP_NODE_VAR_X:  return x;
+        case TP_NODE_VAR_Y:  return y;
 
         case TP_NODE_UNARY_NEG:
-            return -tp_eval(n->as.unary.a, x);
+            return -eval_rec(n->as.unary.a, x, y, env, depth);
 
         case TP_NODE_ADD:
-            return tp_eval(n->as.bin.a, x) + tp_eval(n->as.bin.b, x);
+            return eval_rec(n->as.bin.a, x, y, env, depth) + eval_rec(n->as.bin.b, x, y, env, depth);
         case TP_NODE_SUB:
-            return tp_eval(n->as.bin.a, x) - tp_eval(n->as.bin.b, x);
+            return eval_rec(n->as.bin.a, x, y, env, depth) - eval_rec(n->as.bin.b, x, y, env, depth);
         case TP_NODE_MUL:
-            return tp_eval(n->as.bin.a, x) * tp_eval(n->as.bin.b, x);
+            return eval_rec(n->as.bin.a, x, y, env, depth) * eval_rec(n->as.bin.b, x, y, env, depth);
         case TP_NODE_DIV:
-            return tp_eval(n->as.bin.a, x) / tp_eval(n->as.bin.b, x);
+            return eval_rec(n->as.bin.a, x, y, env, depth) / eval_rec(n->as.bin.b, x, y, env, depth);
         case TP_NODE_POW:
-            return pow(tp_eval(n->as.bin.a, x), tp_eval(n->as.bin.b, x));
+            return pow(eval_rec(n->as.bin.a, x, y, env, depth), eval_rec(n->as.bin.b, x, y, env, depth));
 
         case TP_NODE_FUNC1: {
-            double a = tp_eval(n->as.func1.arg, x);
+            double a = eval_rec(n->as.func1.arg, x, y, env, depth);
             switch (n->as.func1.f) {
                 case TP_F_SIN:  return sin(a);
                 case TP_F_COS:  return cos(a);
@@ -132,7 +500,13 @@ double tp_eval(const TP_Node *n, double x) {
         }
 
         case TP_NODE_FRAC:
-            return tp_eval(n->as.frac.num, x) / tp_eval(n->as.frac.den, x);
+            return eval_rec(n->as.frac.num, x, y, env, depth) / eval_rec(n->as.frac.den, x, y, env, depth);
+
+        case TP_NODE_SLOT:
+            return env_get(env, n->as.slot);
+        case TP_NODE_LET:
+            env_set(env, n->as.let.slot, eval_rec(n->as.let.value, x, y, env, depth));
+            return eval_rec(n->as.let.body, x, y, env, depth);
 
         /* Tupla não é "avaliável" como escalar */
         case TP_NODE_TUPLE2:
@@ -142,3 +516,339 @@ double tp_eval(const TP_Node *n, double x) {
             return NAN;
     }
 }
+
+double tp_eval2(const TP_Node *n, double x, double y) {
+    return tp_eval_p(n, x, y, NULL);
+}
+
+double tp_eval_p(const TP_Node *n, double x, double y, const double *params) {
+    Env env;
+    env_init(&env, params);
+    const double v = eval_rec(n, x, y, &env, 0);
+    env_free(&env);
+    return v;
+}
+
+int tp_ast_uses_y(const TP_Node *n) {
+    TP_AstWalk w;
+    tp_ast_walk_init(&w, n);
+    const TP_Node *c;
+    int found = 0;
+    while (!found && (c = tp_ast_walk_next(&w)) != NULL) {
+        found = (c->type == TP_NODE_VAR_Y);
+    }
+    tp_ast_walk_free(&w);
+    return found;
+}
+
+static TP_DD dd_powi(TP_DD a, int k) {
+    unsigned int e = (unsigned int)(k < 0 ? -k : k);
+    TP_DD r = tp_dd(1.0);
+    while (e) {
+        if (e & 1u) r = tp_dd_mul(r, a);
+        a = tp_dd_mul(a, a);
+        e >>= 1;
+    }
+    return k < 0 ? tp_dd_div(tp_dd(1.0), r) : r;
+}
+
+/* f(hi + lo) ~= f(hi) + f'(hi) * lo */
+static TP_DD dd_first_order(double f, double df, double lo) {
+    if (!isfinite(f) || !isfinite(df)) return tp_dd(f);
+    return tp_dd_two_sum(f, df * lo);
+}
+
+/* a, b: valores dos filhos (os que existirem) */
+static TP_DD dd_apply(const TP_Node *n, TP_DD a, TP_DD b, TP_DD x) {
+    switch (n->type) {
+        case TP_NODE_NUMBER: return tp_dd(n->as.number);
+        case TP_NODE_VAR_X:  return x;
+        case TP_NODE_VAR_Y:  return tp_dd(NAN);
+
+        case TP_NODE_UNARY_NEG: return tp_dd_neg(a);
+
+        case TP_NODE_ADD: return tp_dd_add(a, b);
+        case TP_NODE_SUB: return tp_dd_sub(a, b);
+        case TP_NODE_MUL: return tp_dd_mul(a, b);
+        case TP_NODE_DIV: return tp_dd_div(a, b);
+
+        case TP_NODE_POW: {
+            if (b.lo == 0.0 && b.hi == floor(b.hi) && fabs(b.hi) <= 64.0) {
+                return dd_powi(a, (int)b.hi);
+            }
+            /* d/da a^b = b a^(b-1); d/db = a^b log a */
+            double r = pow(a.hi, b.hi);
+            double d = r * (b.hi * a.lo / a.hi + log(a.hi) * b.lo);
+            if (!isfinite(d)) return tp_dd(r);
+            return tp_dd_two_sum(r, d);
+        }
+
+        case TP_NODE_FUNC1: {
+            switch (n->as.func1.f) {
+                case TP_F_SIN:  return dd_first_order(sin(a.hi), cos(a.hi), a.lo);
+                case TP_F_COS:  return dd_first_order(cos(a.hi), -sin(a.hi), a.lo);
+                case TP_F_TAN: {
+                    double t = tan(a.hi);
+                    return dd_first_order(t, 1.0 + t * t, a.lo);
+                }
+                case TP_F_LOG:  return dd_first_order(log(a.hi), 1.0 / a.hi, a.lo);
+                case TP_F_EXP: {
+                    double e = exp(a.hi);
+                    return dd_first_order(e, e, a.lo);
+                }
+                case TP_F_SQRT: {
+                    double r = sqrt(a.hi);
+                    return dd_first_order(r, 0.5 / r, a.lo);
+                }
+                default: return tp_dd(NAN);
+            }
+        }
+
+        case TP_NODE_FRAC:
+            return tp_dd_div(a, b);
+
+        case TP_NODE_LET:
+            return b;
+
+        default:
+            return tp_dd(NAN);
+    }
+}
+
+typedef struct EnvDD {
+    TP_DD *v;
+    int cap;
+    TP_DD local[ENV_LOCAL];
+} EnvDD;
+
+static void env_dd_init(EnvDD *e, const double *params) {
+    e->v = e->local;
+    e->cap = ENV_LOCAL;
+    for (int i = 0; i < TP_PARAM_MAX; i++) e->local[i] = tp_dd(params ? params[i] : NAN);
+}
+static void env_dd_free(EnvDD *e) { if (e->v != e->local) free(e->v); }
+
+static void env_dd_set(EnvDD *e, int slot, TP_DD v) {
+    while (slot >= e->cap) {
+        void *p = e->v;
+        if (!stack_grow(&p, &e->cap, e->local, sizeof(TP_DD))) return;
+        e->v = (TP_DD*)p;
+    }
+    if (slot >= 0) e->v[slot] = v;
+}
+
+static TP_DD env_dd_get(const EnvDD *e, int slot) {
+    return (slot >= 0 && slot < e->cap) ? e->v[slot] : tp_dd(NAN);
+}
+
+typedef struct EvalFrameDD {
+    const TP_Node *n;
+    const TP_Node *r;
+    TP_DD lhs;
+} EvalFrameDD;
+
+/* mesmo percurso de eval_iter */
+static TP_DD eval_dd_iter(const TP_Node *n, TP_DD x, EnvDD *env) {
+    EvalFrameDD local[TP_WALK_LOCAL];
+    EvalFrameDD *st = local;
+    int sp = 0, cap = TP_WALK_LOCAL;
+    TP_DD v = tp_dd(NAN);
+
+    while (n) {
+        const TP_Node *l, *r;
+        while (n && children(n, &l, &r) > 0) {
+            if (sp == cap) {
+                void *p = st;
+                if (!stack_grow(&p, &cap, local, sizeof(EvalFrameDD))) { n = NULL; break; }
+                st = (EvalFrameDD*)p;
+            }
+            st[sp].n = n;
+            st[sp].r = r;
+            sp++;
+            n = l;
+        }
+        if (!n) { v = tp_dd(NAN); break; }
+
+        v = (n->type == TP_NODE_SLOT) ? env_dd_get(env, n->as.slot) : dd_apply(n, v, v, x);
+        n = NULL;
+
+        while (sp > 0) {
+            EvalFrameDD *f = &st[sp - 1];
+            if (f->r) {
+                if (f->n->type == TP_NODE_LET) env_dd_set(env, f->n->as.let.slot, v);
+                f->lhs = v;
+                n = f->r;
+                f->r = NULL;
+                break;
+            }
+            v = is_unary(f->n) ? dd_apply(f->n, v, v, x) : dd_apply(f->n, f->lhs, v, x);
+            sp--;
+        }
+    }
+
+    if (st != local) free(st);
+    return v;
+}
+
+static TP_DD eval_dd_rec(const TP_Node *n, TP_DD x, EnvDD *env, int depth) {
+    const TP_Node *l, *r;
+    if (!n) return tp_dd(NAN);
+    if (depth >= TP_EVAL_REC_MAX) return eval_dd_iter(n, x, env);
+
+    switch (n->type) {
+        case TP_NODE_SLOT:
+            return env_dd_get(env, n->as.slot);
+        case TP_NODE_LET:
+            env_dd_set(env, n->as.let.slot, eval_dd_rec(n->as.let.value, x, env, depth + 1));
+            return eval_dd_rec(n->as.let.body, x, env, depth + 1);
+        default:
+            break;
+    }
+
+    switch (children(n, &l, &r)) {
+        case 0:
+            return dd_apply(n, x, x, x);
+        case 1: {
+            const TP_DD a = eval_dd_rec(l, x, env, depth + 1);
+            return dd_apply(n, a, a, x);
+        }
+        default: {
+            const TP_DD a = eval_dd_rec(l, x, env, depth + 1);
+            return dd_apply(n, a, eval_dd_rec(r, x, env, depth + 1), x);
+        }
+    }
+}
+
+TP_DD tp_eval_dd(const TP_Node *n, TP_DD x) {
+    return tp_eval_dd_p(n, x, NULL);
+}
+
+TP_DD tp_eval_dd_p(const TP_Node *n, TP_DD x, const double *params) {
+    EnvDD env;
+    env_dd_init(&env, params);
+    const TP_DD v = eval_dd_rec(n, x, &env, 0);
+    env_dd_free(&env);
+    return v;
+}
+
+/* ---------- serialização (cache em disco) ---------- */
+
+/* pré-ordem, um token por nó: n <hex> | x | y | ~ | + - * / ^ | f<id> | q (frac) | t (tupla)
+   | l<slot> (let) | s<slot> */
+static int write_token(const TP_Node *n, FILE *f) {
+    switch (n->type) {
+        case TP_NODE_NUMBER:    return fprintf(f, " n %a", n->as.number) > 0;
+        case TP_NODE_VAR_X:     return fputs(" x", f) >= 0;
+        case TP_NODE_VAR_Y:     return fputs(" y", f) >= 0;
+        case TP_NODE_UNARY_NEG: return fputs(" ~", f) >= 0;
+
+        case TP_NODE_ADD:
+        case TP_NODE_SUB:
+        case TP_NODE_MUL:
+        case TP_NODE_DIV:
+        case TP_NODE_POW: {
+            static const char ops[] = "+-*/^";
+            return fprintf(f, " %c", ops[n->type - TP_NODE_ADD]) > 0;
+        }
+
+        case TP_NODE_FUNC1:  return fprintf(f, " f%d", (int)n->as.func1.f) > 0;
+        case TP_NODE_FRAC:   return fputs(" q", f) >= 0;
+        case TP_NODE_TUPLE2: return fputs(" t", f) >= 0;
+        case TP_NODE_LET:    return fprintf(f, " l%d", n->as.let.slot) > 0;
+        case TP_NODE_SLOT:   return fprintf(f, " s%d", n->as.slot) > 0;
+
+        default:
+            return 0;
+    }
+}
+
+int tp_ast_write(const TP_Node *n, FILE *f) {
+    if (!n) return 0;
+
+    /* pilha de nós pendentes; filhos empilhados do último para o primeiro */
+    TP_AstWalk w;
+    tp_ast_walk_init(&w, n);
+    int ok = 1;
+    while (ok && w.sp > 0) {
+        TP_Node *c = w.st[--w.sp].n;
+        ok = write_token(c, f);
+        for (int i = tp_ast_nchildren(c) - 1; ok && i >= 0; i--) {
+            TP_Node *ch = *child_slot(c, i);
+            ok = ch && walk_push(&w, ch);
+        }
+    }
+    tp_ast_walk_free(&w);
+    return ok;
+}
+
+/* nó com filhos ainda NULL; NULL se o token for inválido */
+static TP_Node *read_token(FILE *f) {
+    char tok[64];
+    if (fscanf(f, " %63s", tok) != 1) return NULL;
+
+    if (strcmp(tok, "n") == 0) {
+        char num[64];
+        char *end;
+        if (fscanf(f, " %63s", num) != 1) return NULL;
+        double v = strtod(num, &end);
+        if (*end != '\0') return NULL;
+        return tp_node_number(v);
+    }
+    if (strcmp(tok, "x") == 0) return tp_node_var_x();
+    if (strcmp(tok, "y") == 0) return tp_node_var_y();
+    if (strcmp(tok, "~") == 0) return tp_node_unary(TP_NODE_UNARY_NEG, NULL);
+
+    if (tok[0] == 'f' && tok[1] != '\0') {
+        char *end;
+        long id = strtol(tok + 1, &end, 10);
+        if (*end != '\0' || id < TP_F_SIN || id > TP_F_SQRT) return NULL;
+        return tp_node_func1((TP_Func1)id, NULL);
+    }
+    if ((tok[0] == 'l' || tok[0] == 's') && tok[1] != '\0') {
+        char *end;
+        long slot = strtol(tok + 1, &end, 10);
+        if (*end != '\0' || slot < 0 || slot >= TP_SLOT_MAX) return NULL;
+        return tok[0] == 'l' ? tp_node_let((int)slot, NULL, NULL) : tp_node_slot((int)slot);
+    }
+
+    if (tok[1] != '\0') return NULL;
+    const char *ops = "+-*/^qt";
+    const char *op = strchr(ops, tok[0]);
+    if (!op) return NULL;
+
+    if (tok[0] == 'q') return tp_node_frac(NULL, NULL);
+    if (tok[0] == 't') return tp_node_tuple2(NULL, NULL);
+    return tp_node_bin((TP_NodeType)(TP_NODE_ADD + (op - ops)), NULL, NULL);
+}
+
+TP_Node *tp_ast_read(FILE *f) {
+    /* pilha de nós com filhos faltando; next = quantos já foram lidos */
+    TP_AstWalk w;
+    tp_ast_walk_init(&w, NULL);
+    TP_Node *root = NULL;
+
+    do {
+        TP_Node *n = read_token(f);
+        if (!n) {
+            tp_ast_free(root);
+            root = NULL;
+            break;
+        }
+        if (!root) {
+            root = n;
+        } else {
+            TP_AstWalkFrame *top = &w.st[w.sp - 1];
+            *child_slot(top->n, top->next++) = n;
+        }
+
+        if (tp_ast_nchildren(n) > 0 && !walk_push(&w, n)) {
+            tp_ast_free(root);
+            root = NULL;
+            break;
+        }
+        while (w.sp > 0 && w.st[w.sp - 1].next == tp_ast_nchildren(w.st[w.sp - 1].n)) w.sp--;
+    } while (w.sp > 0);
+
+    tp_ast_walk_free(&w);
+    return root;
+}
@@ -0,0 +1,168 @@
+#include "tp_async.h"
+#include "tp_prof.h"
+#include <string.h>
+
+#define TP_ASYNC_FRESH 4   /* bit em `middle`: há frame novo não lido */
+
+/* work == NULL ou cópia sem memória: publica o frame como falho, para
+   tp_async_wait não esperar um resultado que não vem */
+static void publish(TP_AsyncSampler *as, const TP_Sampler *work, unsigned int seq) {
+    TP_AsyncFrame *f = &as->frames[as->back];
+    f->failed = !work || !tp_sampler_copy(&f->samples, work);
+    if (f->failed) tp_sampler_invalidate(&f->samples);
+    f->seq = seq;
+
+    /* troca back <-> middle (SDL_AtomicSet é exchange com barreira total) */
+    as->back = SDL_AtomicSet(&as->middle, as->back | TP_ASYNC_FRESH) & ~TP_ASYNC_FRESH;
+}
+
+static int worker_main(void *data) {
+    TP_AsyncSampler *as = (TP_AsyncSampler*)data;
+
+    TP_Sampler work;
+    tp_sampler_init(&work);
+
+    unsigned int cur = 0;
+    int idle = 1;   /* nada a refinar para `cur` */
+
+    for (;;) {
+        SDL_LockMutex(as->lock);
+        while (!SDL_AtomicGet(&as->quit) &&
+               (unsigned int)SDL_AtomicGet(&as->req_seq) == cur && idle) {
+            SDL_CondWait(as->wake, as->lock);
+        }
+        if (SDL_AtomicGet(&as->quit)) {
+            SDL_UnlockMutex(as->lock);
+            break;
+        }
+        const unsigned int seq = (unsigned int)SDL_AtomicGet(&as->req_seq);
+        const int n = as->req_n;
+        const double t0 = as->req_t0, t1 = as->req_t1;
+        double params[TP_PARAM_MAX];
+        const int has_params = as->req_has_params;
+        const double tol = as->req_tol;
+        memcpy(params, as->req_params, sizeof(params));
+        SDL_UnlockMutex(as->lock);
+
+        if (seq != cur) {
+            /* requisição nova: trabalho antigo é descartado aqui; só
+               parâmetros mudaram: refaz só a coordenada afetada */
+            cur = seq;
+            idle = 0;
+            if (tp_sampler_reset(&work, n, t0, t1) < 0) {
+                publish(as, NULL, cur);
+                idle = 1;
+                continue;
+            }
+            if (has_params) tp_sampler_set_params(&work, params, as->px, as->py);
+            tp_sampler_set_tolerance(&work, tol);
+        }
+
+        /* fatia curta: publica parcial e volta a checar requisições */
+        TP_PROF_BEGIN(TP_STAGE_SAMPLE);
+        int complete = tp_sampler_refine(&work, as->px, as->py, as->slice_ms);
+        TP_PROF_END(TP_STAGE_SAMPLE);
+        publish(as, &work, cur);
+        if (complete) idle = 1;
+    }
+
+    tp_sampler_free(&work);
+    return 0;
+}
+
+int tp_async_start(TP_AsyncSampler *as,
+                   const TP_Program *px, const TP_Program *py,
+                   double slice_ms)
+{
+    memset(as, 0, sizeof(*as));
+    as->px = px;
+    as->py = py;
+    as->slice_ms = (slice_ms > 0.0) ? slice_ms : 4.0;
+
+    for (int i = 0; i < 3; i++) tp_sampler_init(&as->frames[i].samples);
+    as->back = 0;
+    SDL_AtomicSet(&as->middle, 1);
+    as->front = 2;
+
+    SDL_AtomicSet(&as->req_seq, 0);
+    SDL_AtomicSet(&as->quit, 0);
+
+    as->lock = SDL_CreateMutex();
+    as->wake = SDL_CreateCond();
+    if (!as->lock || !as->wake) {
+        tp_async_stop(as);
+        return 1;
+    }
+
+    as->thread = SDL_CreateThread(worker_main, "tp_sampler", as);
+    if (!as->thread) {
+        tp_async_stop(as);
+        return 2;
+    }
+    return 0;
+}
+
+void tp_async_stop(TP_AsyncSampler *as) {
+    if (as->thread) {
+        SDL_LockMutex(as->lock);
+        SDL_AtomicSet(&as->quit, 1);
+        SDL_CondSignal(as->wake);
+        SDL_UnlockMutex(as->lock);
+        SDL_WaitThread(as->thread, NULL);
+        as->thread = NULL;
+    }
+    if (as->wake) SDL_DestroyCond(as->wake);
+    if (as->lock) SDL_DestroyMutex(as->lock);
+    as->wake = NULL;
+    as->lock = NULL;
+
+    for (int i = 0; i < 3; i++) tp_sampler_free(&as->frames[i].samples);
+}
+
+static int params_eq(const TP_AsyncSampler *as, const double *params) {
+    if (!params) return !as->req_has_params;
+    if (!as->req_has_params) return 0;
+    for (int i = 0; i < TP_PARAM_MAX; i++) {
+        if (as->req_params[i] != params[i]) return 0;
+    }
+    return 1;
+}
+
+void tp_async_request(TP_AsyncSampler *as, int n, double t0, double t1,
+                      const double *params, double tol) {
+    SDL_LockMutex(as->lock);
+    if (SDL_AtomicGet(&as->req_seq) == 0 ||
+        as->req_n != n || as->req_t0 != t0 || as->req_t1 != t1 ||
+        !params_eq(as, params) || as->req_tol != tol) {
+        as->req_n = n;
+        as->req_t0 = t0;
+        as->req_t1 = t1;
+        as->req_tol = tol;
+        as->req_has_params = (params != NULL);
+        if (params) memcpy(as->req_params, params, sizeof(as->req_params));
+        SDL_AtomicAdd(&as->req_seq, 1);
+        SDL_CondSignal(as->wake);
+    }
+    SDL_UnlockMutex(as->lock);
+}
+
+const TP_AsyncFrame *tp_async_latest(TP_AsyncSampler *as) {
+    if (SDL_AtomicGet(&as->middle) & TP_ASYNC_FRESH) {
+        as->front = SDL_AtomicSet(&as->middle, as->front) & ~TP_ASYNC_FRESH;
+    }
+    return &as->frames[as->front];
+}
+
+int tp_async_frame_current(TP_AsyncSampler *as, const TP_AsyncFrame *f) {
+    return f->seq == (unsigned int)SDL_AtomicGet(&as->req_seq) &&
+           tp_sampler_complete(&f->samples);
+}
+
+const TP_AsyncFrame *tp_async_wait(TP_AsyncSampler *as) {
+    for (;;) {
+        const TP_AsyncFrame *f = tp_async_latest(as);
+        if (tp_async_frame_current(as, f)) return f;
+        if (f->failed && f->seq == (unsigned int)SDL_AtomicGet(&as->req_seq)) return f;
+        SDL_Delay(1);
+    }
+}
@@ -0,0 +1,468 @@
+#include "tp_cache.h"
+#include "tp_parser.h"
+#include "tp_token.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TP_CACHE_MAGIC "tatuplot-cache 2"
+
+/* ---------- chave normalizada ---------- */
+
+/* 1 se `prev` seguido de `next` sem espaço viraria outro token */
+static int would_merge(TP_TokType prev, char next) {
+    if (prev == TP_TOK_IDENT || prev == TP_TOK_COMMAND) {
+        return isalnum((unsigned char)next) || next == '_';
+    }
+    if (prev == TP_TOK_NUMBER) return isdigit((unsigned char)next) || next == '.';
+    return 0;
+}
+
+/* Reemite os tokens, com espaço só onde dois tokens colariam
+   ("2 3", "\sin x"). Erro de léxico: chave = texto original. */
+char *tp_cache_normalize(const char *src) {
+    if (!src) src = "";
+    const size_t n = strlen(src);
+    char *out = (char*)malloc(2 * n + 1);
+    if (!out) return NULL;
+
+    size_t o = 0;
+    TP_TokType prev = TP_TOK_EOF;
+    TP_Lexer lx;
+    tp_lex_init(&lx, src);
+    while (lx.current->type != TP_TOK_EOF) {
+        const TP_Token *t = lx.current;
+        if (t->type == TP_TOK_INVALID) {
+            memcpy(out, src, n + 1);
+            return out;
+        }
+        if (!tp_cmd_is_noop(t->cmd)) {
+            const int cmd = (t->type == TP_TOK_COMMAND);
+            if (would_merge(prev, cmd ? '\\' : t->lexeme[0])) out[o++] = ' ';
+            if (cmd) out[o++] = '\\';
+            memcpy(out + o, t->lexeme, t->len);
+            o += t->len;
+            prev = t->type;
+        }
+        tp_lex_next(&lx);
+    }
+    out[o] = '\0';
+    return out;
+}
+
+static unsigned long hash_str(const char *s) {
+    unsigned long h = 2166136261ul;   /* FNV-1a */
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 16777619ul;
+    }
+    return h;
+}
+
+/* ---------- entradas ---------- */
+
+static void compiled_destroy(TP_Compiled *e) {
+    tp_prog_free(e->prog_a);
+    tp_prog_free(e->prog_b);
+    tp_ast_free(e->ast);
+    free(e->key);
+    free(e->raw);
+    free(e);
+}
+
+void tp_compiled_release(TP_Compiled *e) {
+    if (e && SDL_AtomicDecRef(&e->refs)) compiled_destroy(e);
+}
+
+/* assume ast, key; NULL (e tudo liberado) se falhar */
+static TP_Compiled *compiled_new(TP_Node *ast, char *key, TP_Program *pa, TP_Program *pb) {
+    TP_Compiled *e = (TP_Compiled*)calloc(1, sizeof(TP_Compiled));
+    if (!e) {
+        tp_ast_free(ast); free(key);
+        tp_prog_free(pa); tp_prog_free(pb);
+        return NULL;
+    }
+    e->ast = ast;
+    e->key = key;
+    e->hash = hash_str(key);
+    e->is_tuple = (ast->type == TP_NODE_TUPLE2);
+    e->is_field = !e->is_tuple && tp_ast_uses_y(ast);
+
+    if (pa) {
+        e->prog_a = pa;
+        e->prog_b = pb;
+    } else if (e->is_tuple) {
+        e->prog_a = tp_prog_compile(ast->as.tuple2.a);
+        e->prog_b = tp_prog_compile(ast->as.tuple2.b);
+    } else {
+        e->prog_a = tp_prog_compile(ast);
+    }
+    if (!e->prog_a || (e->is_tuple && !e->prog_b)) {
+        compiled_destroy(e);
+        return NULL;
+    }
+    /* x(t) e y(t) juntos; sem memória fica a avaliação separada */
+    if (e->is_tuple) e->prog_a->pair = tp_prog_compile_tuple(ast);
+
+    SDL_AtomicSet(&e->refs, 1);   /* referência da cache */
+    return e;
+}
+
+/* ---------- LRU (chamadas com lock) ---------- */
+
+static TP_Compiled *find(TP_Cache *c, const char *key, unsigned long h) {
+    TP_Compiled *e = c->buckets[h & (unsigned long)(c->n_buckets - 1)];
+    for (; e; e = e->chain) {
+        if (e->hash == h && strcmp(e->key, key) == 0) return e;
+    }
+    return NULL;
+}
+
+static TP_Compiled *find_raw(TP_Cache *c, const char *src, unsigned long h) {
+    TP_Compiled *e = c->raw_buckets[h & (unsigned long)(c->n_buckets - 1)];
+    for (; e; e = e->raw_chain) {
+        if (e->raw_hash == h && strcmp(e->raw, src) == 0) return e;
+    }
+    return NULL;
+}
+
+static void raw_unlink(TP_Cache *c, TP_Compiled *e) {
+    if (!e->raw) return;
+    TP_Compiled **pp = &c->raw_buckets[e->raw_hash & (unsigned long)(c->n_buckets - 1)];
+    while (*pp != e) pp = &(*pp)->raw_chain;
+    *pp = e->raw_chain;
+    free(e->raw);
+    e->raw = NULL;
+}
+
+/* troca a grafia crua associada à entrada (sem memória: fica sem) */
+static void raw_set(TP_Cache *c, TP_Compiled *e, const char *src, unsigned long h) {
+    raw_unlink(c, e);
+    if (find_raw(c, src, h)) return;
+
+    size_t n = strlen(src);
+    e->raw = (char*)malloc(n + 1);
+    if (!e->raw) return;
+    memcpy(e->raw, src, n + 1);
+    e->raw_hash = h;
+
+    TP_Compiled **b = &c->raw_buckets[h & (unsigned long)(c->n_buckets - 1)];
+    e->raw_chain = *b;
+    *b = e;
+}
+
+static void list_unlink(TP_Cache *c, TP_Compiled *e) {
+    if (e->prev) e->prev->next = e->next; else c->head = e->next;
+    if (e->next) e->next->prev = e->prev; else c->tail = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void list_push_front(TP_Cache *c, TP_Compiled *e) {
+    e->prev = NULL;
+    e->next = c->head;
+    if (c->head) c->head->prev = e; else c->tail = e;
+    c->head = e;
+}
+
+static void list_push_back(TP_Cache *c, TP_Compiled *e) {
+    e->next = NULL;
+    e->prev = c->tail;
+    if (c->tail) c->tail->next = e; else c->head = e;
+    c->tail = e;
+}
+
+static void evict_tail(TP_Cache *c) {
+    TP_Compiled *e = c->tail;
+    if (!e) return;
+
+    TP_Compiled **pp = &c->buckets[e->hash & (unsigned long)(c->n_buckets - 1)];
+    while (*pp != e) pp = &(*pp)->chain;
+    *pp = e->chain;
+    raw_unlink(c, e);
+
+    list_unlink(c, e);
+    c->count--;
+    tp_compiled_release(e);   /* quem ainda usa mantém viva */
+}
+
+static void insert(TP_Cache *c, TP_Compiled *e, int at_back) {
+    TP_Compiled **b = &c->buckets[e->hash & (unsigned long)(c->n_buckets - 1)];
+    e->chain = *b;
+    *b = e;
+    if (at_back) list_push_back(c, e); else list_push_front(c, e);
+    c->count++;
+    while (c->count > c->capacity) evict_tail(c);
+}
+
+/* ---------- API ---------- */
+
+int tp_cache_init(TP_Cache *c, int capacity) {
+    memset(c, 0, sizeof(*c));
+    c->capacity = capacity > 0 ? capacity : 1;
+
+    c->n_buckets = 16;
+    while (c->n_buckets < c->capacity) c->n_buckets *= 2;
+
+    c->buckets = (TP_Compiled**)calloc((size_t)c->n_buckets, sizeof(TP_Compiled*));
+    c->raw_buckets = (TP_Compiled**)calloc((size_t)c->n_buckets, sizeof(TP_Compiled*));
+    c->lock = SDL_CreateMutex();
+    if (!c->buckets || !c->raw_buckets || !c->lock) {
+        tp_cache_free(c);
+        return 1;
+    }
+    return 0;
+}
+
+void tp_cache_free(TP_Cache *c) {
+    TP_Compiled *e = c->head;
+    while (e) {
+        TP_Compiled *nx = e->next;
+        tp_compiled_release(e);
+        e = nx;
+    }
+    free(c->buckets);
+    free(c->raw_buckets);
+    if (c->lock) SDL_DestroyMutex(c->lock);
+    memset(c, 0, sizeof(*c));
+}
+
+/* "@a,b@" + s: os nomes dos parâmetros (e a ordem, que dá os slots)
+   mudam a árvore. '@' não é token válido, então não colide com
+   expressão sem parâmetros. */
+static char *param_tag(const char *const *params, int n_params, const char *s) {
+    size_t n = strlen(s) + 3;
+    for (int i = 0; i < n_params; i++) n += strlen(params[i]) + 1;
+    char *out = (char*)malloc(n);
+    if (!out) return NULL;
+
+    size_t o = 0;
+    out[o++] = '@';
+    for (int i = 0; i < n_params; i++) {
+        if (i > 0) out[o++] = ',';
+        const size_t len = strlen(params[i]);
+        memcpy(out + o, params[i], len);
+        o += len;
+    }
+    out[o++] = '@';
+    memcpy(out + o, s, strlen(s) + 1);
+    return out;
+}
+
+int tp_cache_get(TP_Cache *c, const char *src,
+                 const char *const *params, int n_params,
+                 TP_Compiled **out, char *errbuf, int errbuf_sz)
+{
+    *out = NULL;
+    if (errbuf && errbuf_sz > 0) errbuf[0] = '\0';
+    if (!src) src = "";
+
+    const char *raw = src;
+    char *tagged = NULL;
+    if (n_params > 0) {
+        tagged = param_tag(params, n_params, src);
+        if (!tagged) {
+            snprintf(errbuf, (size_t)errbuf_sz, "sem memoria");
+            return 2;
+        }
+        raw = tagged;
+    }
+
+    /* 1) mesmo texto de antes: só hash */
+    const unsigned long rh = hash_str(raw);
+    SDL_LockMutex(c->lock);
+    TP_Compiled *e = find_raw(c, raw, rh);
+    if (e) {
+        c->hits++;
+        list_unlink(c, e);
+        list_push_front(c, e);
+        SDL_AtomicIncRef(&e->refs);
+        SDL_UnlockMutex(c->lock);
+        free(tagged);
+        *out = e;
+        return 0;
+    }
+    SDL_UnlockMutex(c->lock);
+
+    /* 2) outra grafia da mesma expressão */
+    char *key = tp_cache_normalize(src);
+    if (key && n_params > 0) {
+        char *k = param_tag(params, n_params, key);
+        free(key);
+        key = k;
+    }
+    if (!key) {
+        snprintf(errbuf, (size_t)errbuf_sz, "sem memoria");
+        free(tagged);
+        return 2;
+    }
+    const unsigned long h = hash_str(key);
+
+    SDL_LockMutex(c->lock);
+    e = find(c, key, h);
+    if (e) {
+        c->hits++;
+        list_unlink(c, e);
+        list_push_front(c, e);
+        raw_set(c, e, raw, rh);
+        SDL_AtomicIncRef(&e->refs);
+        SDL_UnlockMutex(c->lock);
+        free(key);
+        free(tagged);
+        *out = e;
+        return 0;
+    }
+    c->misses++;
+    SDL_UnlockMutex(c->lock);
+
+    /* parse + compile fora do lock */
+    TP_Parser p;
+    tp_parse_init(&p, src);
+    p.params = params;
+    p.n_params = n_params;
+    TP_Node *ast = tp_parse_expr(&p);
+    if (!ast) {
+        snprintf(errbuf, (size_t)errbuf_sz, "parse (col %zu): %s",
+                 p.error_col, p.error ? p.error : "desconhecido");
+        free(key);
+        free(tagged);
+        return 1;
+    }
+
+    e = compiled_new(ast, key, NULL, NULL);
+    if (!e) {
+        snprintf(errbuf, (size_t)errbuf_sz, "falha ao compilar expressao");
+        free(tagged);
+        return 2;
+    }
+
+    SDL_LockMutex(c->lock);
+    TP_Compiled *other = find(c, e->key, h);
+    if (other) {
+        /* outra thread compilou a mesma chave enquanto isso */
+        list_unlink(c, other);
+        list_push_front(c, other);
+        SDL_AtomicIncRef(&other->refs);
+        SDL_UnlockMutex(c->lock);
+        tp_compiled_release(e);
+        free(tagged);
+        *out = other;
+        return 0;
+    }
+    SDL_AtomicIncRef(&e->refs);
+    insert(c, e, 0);
+    raw_set(c, e, raw, rh);
+    c->dirty = 1;
+    SDL_UnlockMutex(c->lock);
+
+    free(tagged);
+    *out = e;
+    return 0;
+}
+
+/* ---------- arquivo ----------
+   tatuplot-cache 2
+   K <len> <chave>
+   A <ast em pré-ordem>
+   P <bytecode>            (tupla: duas linhas P)
+   ... entradas da mais recente para a mais antiga */
+
+static int expect_tag(FILE *f, const char *tag) {
+    char t[8];
+    return fscanf(f, " %7s", t) == 1 && strcmp(t, tag) == 0;
+}
+
+static TP_Compiled *read_entry(FILE *f, int *eof) {
+    size_t len;
+    *eof = 0;
+    if (fscanf(f, " K %zu", &len) != 1) { *eof = feof(f); return NULL; }
+    if (len > 65536 || fgetc(f) != ' ') return NULL;
+
+    char *key = (char*)malloc(len + 1);
+    if (!key) return NULL;
+    if (fread(key, 1, len, f) != len) { free(key); return NULL; }
+    key[len] = '\0';
+
+    TP_Node *ast = NULL;
+    TP_Program *pa = NULL, *pb = NULL;
+    int ok = expect_tag(f, "A") && (ast = tp_ast_read(f)) != NULL;
+    ok = ok && expect_tag(f, "P") && (pa = tp_prog_read(f)) != NULL;
+    if (ok && ast->type == TP_NODE_TUPLE2) {
+        ok = expect_tag(f, "P") && (pb = tp_prog_read(f)) != NULL;
+    }
+    if (!ok) {
+        free(key);
+        tp_ast_free(ast);
+        tp_prog_free(pa);
+        tp_prog_free(pb);
+        return NULL;
+    }
+    /* a forma não vai para o arquivo: sai da AST de novo */
+    tp_prog_specialize(pa, pb ? ast->as.tuple2.a : ast);
+    if (pb) tp_prog_specialize(pb, ast->as.tuple2.b);
+    return compiled_new(ast, key, pa, pb);
+}
+
+int tp_cache_load(TP_Cache *c, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;   /* primeira execução */
+
+    char magic[32];
+    if (!fgets(magic, (int)sizeof(magic), f) ||
+        strncmp(magic, TP_CACHE_MAGIC, strlen(TP_CACHE_MAGIC)) != 0) {
+        fclose(f);
+        return 1;
+    }
+
+    int rc = 0;
+    SDL_LockMutex(c->lock);
+    while (c->count < c->capacity) {
+        int eof;
+        TP_Compiled *e = read_entry(f, &eof);
+        if (!e) { rc = eof ? 0 : 1; break; }
+
+        if (find(c, e->key, e->hash)) {
+            tp_compiled_release(e);
+        } else {
+            insert(c, e, 1);
+            raw_set(c, e, e->key, e->hash);
+        }
+    }
+    SDL_UnlockMutex(c->lock);
+
+    fclose(f);
+    return rc;
+}
+
+int tp_cache_save(TP_Cache *c, const char *path) {
+    char tmp[1024];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) return 1;
+
+    FILE *f = fopen(tmp, "w");
+    if (!f) return 1;
+
+    int ok = fprintf(f, "%s\n", TP_CACHE_MAGIC) > 0;
+
+    SDL_LockMutex(c->lock);
+    for (TP_Compiled *e = c->head; e && ok; e = e->next) {
+        ok = fprintf(f, "K %zu %s\nA", strlen(e->key), e->key) > 0 &&
+             tp_ast_write(e->ast, f) &&
+             fputs("\nP ", f) >= 0 && tp_prog_write(e->prog_a, f);
+        if (ok && e->prog_b) ok = fputs("\nP ", f) >= 0 && tp_prog_write(e->prog_b, f);
+        ok = ok && fputc('\n', f) != EOF;
+    }
+    SDL_UnlockMutex(c->lock);
+
+    if (fclose(f) != 0) ok = 0;
+
+    /* troca atômica: leitores nunca veem arquivo pela metade */
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        return 1;
+    }
+
+    SDL_LockMutex(c->lock);
+    c->dirty = 0;
+    SDL_UnlockMutex(c->lock);
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <math.h>
 
 static int parse_int(const char *s, int *out) {
     errno = 0;
@@ -35,30 +36,130 @@ static int parse_rgb(const char *s, unsigned char *r, unsigned char *g, unsigned
 
 static int streq(const char *a, const char *b) { return strcmp(a, b) == 0; }
 
+static int is_ident(const char *s, size_t len) {
+    if (len == 0) return 0;
+    for (size_t i = 0; i < len; i++) {
+        const char c = s[i];
+        const int alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+        if (!alpha && !(i > 0 && c >= '0' && c <= '9')) return 0;
+    }
+    return 1;
+}
+
+/* nome=valor[:min:max]; sem faixa: [-10,10] estendida até o valor */
+static int parse_param(const char *s, TP_Args *out, char *errbuf, int errbuf_sz) {
+    const char *eq = strchr(s, '=');
+    const size_t len = eq ? (size_t)(eq - s) : 0;
+    if (!eq || !is_ident(s, len) || len >= TP_PARAM_NAME_MAX) {
+        snprintf(errbuf, errbuf_sz, "valor invalido para --param (use nome=valor[:min:max])");
+        return 0;
+    }
+    if ((len == 1 && (s[0] == 'x' || s[0] == 'y' || s[0] == 'e')) ||
+        (len == 2 && s[0] == 'p' && s[1] == 'i')) {
+        snprintf(errbuf, errbuf_sz, "--param: nome reservado (x, y, pi, e)");
+        return 0;
+    }
+    for (int i = 0; i < out->n_params; i++) {
+        if (strlen(out->params[i].name) == len && memcmp(out->params[i].name, s, len) == 0) {
+            snprintf(errbuf, errbuf_sz, "--param: parametro repetido");
+            return 0;
+        }
+    }
+    if (out->n_params == TP_PARAM_MAX) {
+        snprintf(errbuf, errbuf_sz, "--param: muitos parametros (max %d)", TP_PARAM_MAX);
+        return 0;
+    }
+
+    TP_ParamSpec *p = &out->params[out->n_params];
+    char buf[128];
+    char *part[3];
+    int n_part = 0;
+    if (strlen(eq + 1) >= sizeof(buf)) {
+        snprintf(errbuf, errbuf_sz, "valor invalido para --param");
+        return 0;
+    }
+    strcpy(buf, eq + 1);
+    part[n_part++] = buf;
+    for (char *c = buf; *c && n_part < 3; c++) {
+        if (*c == ':') { *c = '\0'; part[n_part++] = c + 1; }
+    }
+
+    if (n_part == 2 || !parse_double(part[0], &p->value) || !isfinite(p->value)) {
+        snprintf(errbuf, errbuf_sz, "valor invalido para --param (use nome=valor[:min:max])");
+        return 0;
+    }
+    if (n_part == 3) {
+        if (!parse_double(part[1], &p->min) || !parse_double(part[2], &p->max) ||
+            !(p->min < p->max) || !isfinite(p->max - p->min)) {
+            snprintf(errbuf, errbuf_sz, "--param: faixa invalida (min < max)");
+            return 0;
+        }
+        if (p->value < p->min || p->value > p->max) {
+            snprintf(errbuf, errbuf_sz, "--param: valor fora da faixa [min,max]");
+            return 0;
+        }
+    } else {
+        p->min = p->value < -10.0 ? p->value : -10.0;
+        p->max = p->value > 10.0 ? p->value : 10.0;
+    }
+
+    memcpy(p->name, s, len);
+    p->name[len] = '\0';
+    out->n_params++;
+    return 1;
+}
+
 void tp_args_print_help(const char *prog) {
     printf("Uso:\n");
     printf("  %s --expr \"<expressao>\" [opcoes]\n\n", prog);
     printf("Opcoes:\n");
-    printf("  --expr   \"...\"        (obrigatorio)\n");
+    printf("  --expr   \"...\"        (obrigatorio, exceto com --data/--stream/--daemon)\n");
     printf("  --xmin A  --xmax B     viewport X (ou t-range se expr for tupla e --tmin/--tmax nao forem passados)\n");
     printf("  --ymin C  --ymax D     viewport Y\n");
     printf("  --tmin T  --tmax U     range do parametro t (para expr tupla)\n");
+    printf("  --zmin E  --zmax F     range do colormap (heatmap z=f(x,y); default auto)\n");
     printf("  --width W --height H   tamanho da janela (default 900x600)\n");
     printf("  --bg R,G,B             cor do fundo (default 0,0,0)\n");
     printf("  --fg R,G,B             cor do grafico (default 0,220,0)\n");
-    printf("  --out caminho.bmp      caminho do screenshot (default tatuplot.bmp)\n");
+    printf("  --budget-ms MS         orcamento de amostragem por frame (default 8; 0 = sem limite)\n");
+    printf("  --async                amostra as curvas numa thread separada\n");
+    printf("  --stats                overlay com tempo por estagio do frame (F3 alterna)\n");
+    printf("  --trace arquivo.json   exporta Chrome trace (chrome://tracing, Perfetto)\n");
+    printf("  --param a=V[:MIN:MAX]  parametro nomeado usado na expr (repetivel, max %d; faixa default [-10,10])\n", TP_PARAM_MAX);
+    printf("  --deriv                desenha tambem f'(x) (derivada simbolica; so y = f(x))\n");
+    printf("  --marks                marca zeros, extremos locais e cruzamentos (f e f')\n");
+    printf("  --analysis arq.json    grava zeros/extremos/cruzamentos em JSON (- = stdout)\n");
+    printf("  --data arquivo         serie de dados: CSV (x,y ou y) ou .f64 (pares x,y double LE), via mmap\n");
+    printf("  --lod-file arquivo     grava/le a piramide min/max de --data (reabre instantaneo)\n");
+    printf("  --stream FONTE         serie ao vivo: linhas y ou x,y de stdin (-) ou de um socket Unix (caminho)\n");
+    printf("  --stream-window N      pontos mais recentes na janela ao vivo (default %d)\n", TP_STREAM_WINDOW_DEFAULT);
+    printf("  --serve PORTA          sem janela: serve tiles 256x256 em http://127.0.0.1:PORTA/{z}/{x}/{y}.bmp\n");
+    printf("  --tile-dir DIR         cache em disco dos tiles de --serve (reaproveitado entre execucoes)\n");
+    printf("  --daemon SOCKET        sem janela: atende pedidos de render (uma linha de opcoes cada) num socket Unix\n");
+    printf("  --cache-file arquivo   cache de expressoes compiladas (pula parse no warm start)\n");
+    printf("  --out caminho.bmp      caminho do screenshot (default tatuplot.bmp; .svg/.pdf: vetorial)\n");
     printf("  --shot                 tira screenshot na primeira render e sai\n");
     printf("  -h, --help             mostra ajuda\n\n");
 
     printf("Atalhos:\n");
-    printf("  P   salva screenshot (usa --out se passado)\n");
-    printf("  WASD pan | +/- zoom | R reset | ESC sair\n\n");
+    printf("  P   salva screenshot (usa --out se passado; BMP, SVG ou PDF)\n");
+    printf("  WASD pan | +/- zoom | R reset | F3 stats | ESC sair\n");
+    printf("  TAB proximo parametro | [ ] diminui/aumenta | ESPACO anima o parametro\n");
+    printf("  mouse: arrastar (botao esquerdo) pan | scroll zoom no cursor\n\n");
 
     printf("Exemplos:\n");
     printf("  %s --expr \"\\\\sin(x)\"\n", prog);
     printf("  %s --expr \"\\\\frac{\\\\sin(x)}{x}\" --xmin -20 --xmax 20 --ymin -2 --ymax 2\n", prog);
+    printf("  %s --expr \"\\\\sin(x)\\\\cos(y)\"   (heatmap z=f(x,y))\n", prog);
     printf("  %s --expr \"\\\\left(16\\\\sin^{3}(x),\\;13\\\\cos(x)-5\\\\cos(2x)-2\\\\cos(3x)-\\\\cos(4x)\\\\right)\" \\\n", prog);
     printf("     --xmin 0 --xmax 6.283185307179586 --ymin -18 --ymax 14 --out heart.bmp --shot\n");
+    printf("  %s --expr \"a\\\\sin(k x)\" --param a=1 --param k=2:0.5:8\n", prog);
+    printf("  %s --expr \"x^3-3x\" --xmin -3 --xmax 3 --deriv --marks\n", prog);
+    printf("  %s --expr \"\\\\sin(x)\" --analysis - --shot\n", prog);
+    printf("  %s --data medidas.csv --expr \"a\\\\exp(-k x)\" --param a=1 --param k=0.5\n", prog);
+    printf("  sensor | %s --stream - --stream-window 50000\n", prog);
+    printf("  %s --expr \"\\\\sin(x)\\\\cos(y)\" --serve 8080 --tile-dir tiles\n", prog);
+    printf("  %s --daemon /tmp/tatuplot.sock --cache-file exprs.cache\n", prog);
 }
 
 int tp_args_parse(int argc, char **argv, TP_Args *out,
@@ -83,16 +184,42 @@ int tp_args_parse(int argc, char **argv, TP_Args *out,
     out->tmin = 0.0;
     out->tmax = 1.0;
 
+    out->has_zrange = 0;
+    out->zmin = 0.0;
+    out->zmax = 1.0;
+
+    out->budget_ms = 8.0;
+    out->async_sampling = 0;
+
+    out->show_stats = 0;
+    out->trace_path = NULL;
+
+    out->n_params = 0;
+
+    out->show_deriv = 0;
+    out->show_marks = 0;
+    out->analysis_path = NULL;
+
+    out->data_path = NULL;
+    out->lod_path = NULL;
+
+    out->stream_path = NULL;
+    out->stream_window = TP_STREAM_WINDOW_DEFAULT;
+
+    out->serve_port = 0;
+    out->tile_dir = NULL;
+
+    out->daemon_path = NULL;
+
+    out->cache_path = NULL;
+
     out->out_path = NULL;
     out->shot_once = 0;
 
     for (int i = 1; i < argc; i++) {
         const char *a = argv[i];
 
-        if (streq(a, "-h") || streq(a, "--help")) {
-            tp_args_print_help(argv[0]);
-            return 2;
-        }
+        if (streq(a, "-h") || streq(a, "--help")) return 2;
 
         if (streq(a, "--expr")) {
             if (i + 1 >= argc) { snprintf(errbuf, errbuf_sz, "faltou valor para --expr"); return 1; }
@@ -143,6 +270,17 @@ int tp_args_parse(int argc, char **argv, TP_Args *out,
             i++; continue;
         }
 
+        if (streq(a, "--zmin")) {
+            if (i + 1 >= argc || !parse_double(argv[i+1], &out->zmin)) { snprintf(errbuf, errbuf_sz, "valor invalido para --zmin"); return 1; }
+            out->has_zrange = 1;
+            i++; continue;
+        }
+        if (streq(a, "--zmax")) {
+            if (i + 1 >= argc || !parse_double(argv[i+1], &out->zmax)) { snprintf(errbuf, errbuf_sz, "valor invalido para --zmax"); return 1; }
+            out->has_zrange = 1;
+            i++; continue;
+        }
+
         if (streq(a, "--bg")) {
             if (i + 1 >= argc || !parse_rgb(argv[i+1], &out->bg_r, &out->bg_g, &out->bg_b)) {
                 snprintf(errbuf, errbuf_sz, "valor invalido para --bg (use R,G,B)");
@@ -159,6 +297,111 @@ int tp_args_parse(int argc, char **argv, TP_Args *out,
             i++; continue;
         }
 
+        if (streq(a, "--budget-ms")) {
+            if (i + 1 >= argc || !parse_double(argv[i+1], &out->budget_ms) || out->budget_ms < 0.0) {
+                snprintf(errbuf, errbuf_sz, "valor invalido para --budget-ms");
+                return 1;
+            }
+            i++; continue;
+        }
+
+        if (streq(a, "--async")) {
+            out->async_sampling = 1;
+            continue;
+        }
+
+        if (streq(a, "--stats")) {
+            out->show_stats = 1;
+            continue;
+        }
+
+        if (streq(a, "--trace")) {
+            if (i + 1 >= argc) { snprintf(errbuf, errbuf_sz, "faltou valor para --trace"); return 1; }
+            out->trace_path = argv[++i];
+            continue;
+        }
+
+        if (streq(a, "--param")) {
+            if (i + 1 >= argc) { snprintf(errbuf, errbuf_sz, "faltou valor para --param"); return 1; }
+            if (!parse_param(argv[++i], out, errbuf, errbuf_sz)) return 1;
+            continue;
+        }
+
+        if (streq(a, "--deriv")) {
+            out->show_deriv = 1;
+            continue;
+        }
+
+        if (streq(a, "--marks")) {
+            out->show_marks = 1;
+            continue;
+        }
+
+        if (streq(a, "--analysis")) {
+            if (i + 1 >= argc) { snprintf(errbuf, errbuf_sz, "faltou valor para --analysis"); return 1; }
+            out->analysis_path = argv[++i];
+            continue;
+        }
+
+        if (streq(a, "--data")) {
+            if (i + 1 >= argc) { snprintf(errbuf, errbuf_sz, "faltou valor para --data"); return 1; }
+            out->data_path = argv[++i];
+            continue;
+        }
+
+        if (streq(a, "--lod-file")) {
+            if (i + 1 >= argc) { snprintf(errbuf, errbuf_sz, "faltou valor para --lod-file"); return 1; }
+            out->lod_path = argv[++i];
+            continue;
+        }
+
+        if (streq(a, "--stream")) {
+            if (i + 1 >= argc) { snprintf(errbuf, errbuf_sz, "faltou valor para --stream"); return 1; }
+            out->stream_path = argv[++i];
+            continue;
+        }
+
+        if (streq(a, "--stream-window")) {
+            /* parse_int é só para tamanho de janela */
+            double n = 0.0;
+            if (i + 1 >= argc || !parse_double(argv[i+1], &n) || !(n >= 2 && n <= 1e9) || n != floor(n)) {
+                snprintf(errbuf, errbuf_sz, "valor invalido para --stream-window (inteiro em [2, 1e9])");
+                return 1;
+            }
+            out->stream_window = (int)n;
+            i++;
+            continue;
+        }
+
+        if (streq(a, "--serve")) {
+            double port = 0.0;
+            if (i + 1 >= argc || !parse_double(argv[i+1], &port) || !(port >= 1 && port <= 65535) || port != floor(port)) {
+                snprintf(errbuf, errbuf_sz, "valor invalido para --serve (porta em [1, 65535])");
+                return 1;
+            }
+            out->serve_port = (int)port;
+            i++;
+            continue;
+        }
+
+        if (streq(a, "--tile-dir")) {
+            if (i + 1 >= argc) { snprintf(errbuf, errbuf_sz, "faltou valor para --tile-dir"); return 1; }
+            out->tile_dir = argv[++i];
+            continue;
+        }
+
+        if (streq(a, "--daemon")) {
+            if (i + 1 >= argc) { snprintf(errbuf, errbuf_sz, "faltou valor para --daemon"); return 1; }
+            out->daemon_path = argv[++i];
+            continue;
+        }
+
+        if (streq(a, "--cache-file")) {
+            if (i + 1 >= argc) { snprintf(errbuf, errbuf_sz, "faltou valor para --cache-file"); return 1; }
+            out->cache_path = argv[++i];
+            continue;
+        }
+
         if (streq(a, "--out")) {
             if (i + 1 >= argc) { snprintf(errbuf, errbuf_sz, "faltou valor para --out"); return 1; }
             out->out_path = argv[++i];
@@ -174,8 +417,21 @@ int tp_args_parse(int argc, char **argv, TP_Args *out,
         return 1;
     }
 
-    if (!out->expr) {
-        snprintf(errbuf, errbuf_sz, "faltou --expr (obrigatorio)");
+    if (!out->expr && !out->data_path && !out->stream_path && !out->daemon_path) {
+        snprintf(errbuf, errbuf_sz, "faltou --expr (obrigatorio sem --data/--stream/--daemon)");
+        return 1;
+    }
+
+    if (out->serve_port && out->stream_path) {
+        snprintf(errbuf, errbuf_sz, "--serve nao combina com --stream (tiles sao imutaveis)");
+        return 1;
+    }
+    if (out->daemon_path && (out->serve_port || out->stream_path)) {
+        snprintf(errbuf, errbuf_sz, "--daemon nao combina com --serve/--stream");
+        return 1;
+    }
+    if (out->tile_dir && !out->serve_port) {
+        snprintf(errbuf, errbuf_sz, "--tile-dir precisa de --serve");
         return 1;
     }
 
@@ -191,6 +447,21 @@ int tp_args_parse(int argc, char **argv, TP_Args *out,
         snprintf(errbuf, errbuf_sz, "range t invalido: tmin precisa ser < tmax");
         return 1;
     }
+    if (out->has_zrange && !(out->zmin < out->zmax)) {
+        snprintf(errbuf, errbuf_sz, "range z invalido: zmin precisa ser < zmax");
+        return 1;
+    }
 
     return 0;
 }
+
+int tp_path_has_ext(const char *path, const char *ext) {
+    const size_t n = strlen(path), m = strlen(ext);
+    if (n < m) return 0;
+    for (size_t i = 0; i < m; i++) {
+        char ch = path[n - m + i];
+        if (ch >= 'A' && ch <= 'Z') ch = (char)(ch - 'A' + 'a');
+        if (ch != ext[i]) return 0;
+    }
+    return 1;
+}
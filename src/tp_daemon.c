@@ -0,0 +1,319 @@
+/* poll não faz parte do C99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include "tp_daemon.h"
+#include "tp_cli.h"
+#include "tp_frame.h"
+#include "tp_deriv.h"
+#include "tp_screenshot.h"
+#include "tp_vector.h"
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* cliente lento: desiste do envio ou da linha começada */
+#define TP_DAEMON_IO_MS 5000
+
+/* ---------- pedido ---------- */
+
+int tp_daemon_split(char *line, char **argv, int max) {
+    int argc = 0;
+    char *p = line;
+    argv[argc++] = (char*)"tatuplot";
+
+    for (;;) {
+        while (*p == ' ' || *p == '\t' || *p == '\r') p++;
+        if (*p == '\0') break;
+        if (argc == max) return -1;
+
+        /* copia para trás dentro da própria linha (aspas somem) */
+        char *dst = p;
+        argv[argc++] = dst;
+        int quoted = 0;
+        while (*p && (quoted || (*p != ' ' && *p != '\t' && *p != '\r'))) {
+            if (*p == '"') {
+                quoted = !quoted;
+                p++;
+            } else if (quoted && p[0] == '\\' && p[1] == '"') {
+                *dst++ = '"';
+                p += 2;
+            } else {
+                *dst++ = *p++;
+            }
+        }
+        if (quoted) return -1;
+        const int end = *p == '\0';
+        *dst = '\0';
+        if (end) break;
+        p++;
+    }
+    return argc;
+}
+
+static int reply_error(int fd, const char *msg) {
+    char buf[320];
+    const int k = snprintf(buf, sizeof(buf), "ERRO %s\n", msg);
+    return tp_net_send_all(fd, buf, (size_t)k < sizeof(buf) ? (size_t)k : sizeof(buf) - 1, TP_DAEMON_IO_MS);
+}
+
+/* opção da linha de comando que não vale num pedido (NULL se nenhuma):
+   modos do processo, estado global (trace, cache) ou só da janela */
+static const char *cli_only(const TP_Args *a) {
+    if (a->stream_path) return "--stream";
+    if (a->serve_port) return "--serve";
+    if (a->daemon_path) return "--daemon";
+    if (a->show_marks) return "--marks";
+    if (a->analysis_path) return "--analysis";
+    if (a->trace_path) return "--trace";
+    if (a->cache_path) return "--cache-file";
+    if (a->async_sampling) return "--async";
+    if (a->shot_once) return "--shot";
+    return NULL;
+}
+
+/* Renderiza um pedido e responde. Retorna -1 se a conexão caiu. */
+static int handle(TP_Daemon *d, TP_FrameCtx *ctx, char *line, int fd) {
+    char *argv[TP_DAEMON_ARGS];
+    char err[256];
+    TP_Args a;
+
+    const int argc = tp_daemon_split(line, argv, TP_DAEMON_ARGS);
+    if (argc == 1) return 0;   /* linha vazia: sem resposta */
+    SDL_AtomicIncRef(&d->requests);
+    if (argc < 0) {
+        SDL_AtomicIncRef(&d->failures);
+        return reply_error(fd, "pedido invalido (aspa aberta ou argumentos demais)");
+    }
+
+    int rc = tp_args_parse(argc, argv, &a, err, (int)sizeof(err));
+    if (rc == 0 && cli_only(&a)) {
+        snprintf(err, sizeof(err), "%s nao vale no daemon", cli_only(&a));
+        rc = 1;
+    }
+    if (rc != 0) {
+        SDL_AtomicIncRef(&d->failures);
+        return reply_error(fd, rc == 2 ? "ajuda so na linha de comando" : err);
+    }
+
+    const char *names[TP_PARAM_MAX];
+    double values[TP_PARAM_MAX];
+    for (int i = 0; i < a.n_params; i++) {
+        names[i] = a.params[i].name;
+        values[i] = a.params[i].value;
+    }
+    const double *params = a.n_params > 0 ? values : NULL;
+
+    TP_Compiled *ce = NULL;
+    rc = tp_cache_get(d->cache, a.expr ? a.expr : TP_NO_EXPR, names, a.n_params, &ce, err, (int)sizeof(err));
+    if (rc != 0) {
+        SDL_AtomicIncRef(&d->failures);
+        return reply_error(fd, err);
+    }
+
+    /* f' fora do cache, como na janela */
+    TP_Node *d1 = NULL;
+    TP_Program *dprog = NULL;
+    if (a.show_deriv && !ce->is_tuple && !ce->is_field) {
+        d1 = tp_ast_derive(ce->ast);
+        dprog = d1 ? tp_prog_compile(d1) : NULL;
+    }
+
+    TP_Data data;
+    memset(&data, 0, sizeof(data));
+    TP_Lod lod;
+    tp_lod_init(&lod);
+    int status = 0;   /* 0 OK, 1 erro em err */
+    if (a.data_path) status = tp_frame_open_data(&data, &lod, a.data_path, a.lod_path, err, (int)sizeof(err));
+
+    TP_FrameScene sc;
+    memset(&sc, 0, sizeof(sc));
+    TP_View view;
+    if (status == 0) {
+        sc.prog_a = ce->prog_a;
+        sc.prog_b = ce->prog_b;
+        sc.prog_d = dprog;
+        sc.is_tuple = ce->is_tuple;
+        sc.is_field = ce->is_field;
+        sc.params = params;
+        sc.n_params = a.n_params;
+        sc.data = a.data_path ? &data : NULL;
+        sc.lod = a.data_path ? &lod : NULL;
+        sc.bg_r = a.bg_r; sc.bg_g = a.bg_g; sc.bg_b = a.bg_b;
+        sc.fg_r = a.fg_r; sc.fg_g = a.fg_g; sc.fg_b = a.fg_b;
+        sc.data_r = TP_DATA_R; sc.data_g = TP_DATA_G; sc.data_b = TP_DATA_B;
+        sc.has_zrange = a.has_zrange;
+        sc.zmin = a.zmin;
+        sc.zmax = a.zmax;
+        tp_frame_initial_view(&a, ce->ast, ce->is_tuple, params, sc.data, &view, &sc.tmin, &sc.tmax);
+    }
+
+    /* --out: arquivo (vetorial pelas mesmas linhas); sem: BMP na resposta */
+    const int vec_fmt = a.out_path ? tp_vec_format_for(a.out_path) : -1;
+    TP_Vec *vec = NULL;
+    if (status == 0 && vec_fmt >= 0) {
+        vec = (TP_Vec*)malloc(sizeof(TP_Vec));
+        if (!vec) {
+            snprintf(err, sizeof(err), "sem memoria");
+            status = 1;
+        } else {
+            if (tp_vec_open(vec, a.out_path, (TP_VecFormat)vec_fmt, a.width, a.height,
+                            a.bg_r, a.bg_g, a.bg_b, TP_VEC_TOL_PX, err, (int)sizeof(err)) != 0) {
+                free(vec);
+                vec = NULL;
+                status = 1;
+            }
+        }
+    }
+
+    tp_frame_ctx_reset(ctx);
+    if (status == 0 && tp_frame_draw(&sc, ctx, &view, a.width, a.height, vec) != 0) {
+        snprintf(err, sizeof(err), "sem memoria");
+        status = 1;
+    }
+    if (vec) {
+        if (tp_vec_close(vec) != 0 && status == 0) {
+            snprintf(err, sizeof(err), "erro de escrita em %s", a.out_path);
+            status = 1;
+        }
+        free(vec);
+    }
+
+    unsigned char *bmp = NULL;
+    size_t bmp_size = 0;
+    if (status == 0 && a.out_path && vec_fmt < 0) {
+        char sbuf[256];
+        if (tp_screenshot_save_bmp(ctx->r, a.width, a.height, a.out_path, sbuf, (int)sizeof(sbuf)) != 0) {
+            snprintf(err, sizeof(err), "%s", sbuf);
+            status = 1;
+        }
+    } else if (status == 0 && !a.out_path) {
+        bmp_size = tp_screenshot_bmp_size(a.width, a.height);
+        bmp = (unsigned char*)malloc(bmp_size);
+        if (bmp) {
+            tp_screenshot_encode_bmp(ctx->pixels, a.width * (int)sizeof(Uint32), a.width, a.height, bmp);
+        } else {
+            snprintf(err, sizeof(err), "sem memoria");
+            status = 1;
+        }
+    }
+
+    tp_data_close(&data);
+    tp_lod_free(&lod);
+    tp_prog_free(dprog);
+    tp_ast_free(d1);
+    tp_compiled_release(ce);
+
+    int sent;
+    if (status != 0) {
+        SDL_AtomicIncRef(&d->failures);
+        sent = reply_error(fd, err);
+    } else if (bmp) {
+        char head[64];
+        const int k = snprintf(head, sizeof(head), "IMG %lu\n", (unsigned long)bmp_size);
+        sent = tp_net_send_all(fd, head, (size_t)k, TP_DAEMON_IO_MS);
+        if (sent == 0) sent = tp_net_send_all(fd, bmp, bmp_size, TP_DAEMON_IO_MS);
+    } else {
+        char head[TP_DAEMON_LINE + 8];
+        const int k = snprintf(head, sizeof(head), "OK %s\n", a.out_path);
+        sent = tp_net_send_all(fd, head, (size_t)k < sizeof(head) ? (size_t)k : sizeof(head) - 1, TP_DAEMON_IO_MS);
+    }
+    free(bmp);
+    return sent;
+}
+
+/* Lê linhas da conexão até o cliente fechar (ou o daemon sair). Entre
+   pedidos, a thread volta ao pool se há conexões na fila: cliente
+   ocioso não segura uma thread que outro espera. */
+static void serve_conn(TP_Daemon *d, TP_FrameCtx *ctx, int fd) {
+    char *buf = (char*)malloc(TP_DAEMON_LINE + 1);
+    if (!buf) return;
+    size_t len = 0;
+    int idle_ms = 0;
+
+    while (!SDL_AtomicGet(&d->pool.quit)) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        const int pr = poll(&pfd, 1, TP_NET_POLL_MS);
+        if (pr < 0 && errno == EINTR) continue;
+        if (pr < 0) break;
+        if (pr == 0) {
+            idle_ms += TP_NET_POLL_MS;
+            if (len == 0 && tp_net_pool_waiting(&d->pool) > 0) break;
+            if (len > 0 && idle_ms >= TP_DAEMON_IO_MS) {
+                reply_error(fd, "pedido incompleto (sem fim de linha)");
+                break;
+            }
+            continue;
+        }
+
+        const ssize_t k = read(fd, buf + len, TP_DAEMON_LINE - len);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) break;
+        len += (size_t)k;
+        idle_ms = 0;
+
+        /* cada linha completa é um pedido */
+        size_t start = 0;
+        int dead = 0;
+        for (size_t i = 0; i < len && !dead; i++) {
+            if (buf[i] != '\n') continue;
+            buf[i] = '\0';
+            dead = handle(d, ctx, buf + start, fd) != 0;
+            start = i + 1;
+        }
+        if (dead) break;
+        memmove(buf, buf + start, len - start);
+        len -= start;
+        if (len == TP_DAEMON_LINE) {
+            reply_error(fd, "linha longa demais");
+            break;
+        }
+    }
+    free(buf);
+}
+
+static int worker_main(void *data) {
+    TP_Daemon *d = (TP_Daemon*)data;
+    TP_FrameCtx ctx;
+    tp_frame_ctx_init(&ctx);
+
+    int fd;
+    while ((fd = tp_net_pool_next(&d->pool)) >= 0) {
+        serve_conn(d, &ctx, fd);
+        close(fd);
+    }
+
+    tp_frame_ctx_free(&ctx);
+    return 0;
+}
+
+/* ---------- socket ---------- */
+
+int tp_daemon_open(TP_Daemon *d, const char *path, TP_Cache *cache, char *err, int err_sz) {
+    memset(d, 0, sizeof(*d));
+    d->cache = cache;
+    d->fd = tp_net_listen_unix(path, 64, err, err_sz);
+    if (d->fd < 0) return 1;
+    d->path = path;
+
+    if (tp_net_pool_start(&d->pool, d->fd, TP_DAEMON_QUEUE, worker_main, "tp_daemon", d, err, err_sz) != 0) {
+        tp_daemon_close(d);
+        return 1;
+    }
+    return 0;
+}
+
+void tp_daemon_close(TP_Daemon *d) {
+    tp_net_pool_stop(&d->pool);
+    if (d->fd >= 0) close(d->fd);
+    d->fd = -1;
+    if (d->path) unlink(d->path);
+    d->path = NULL;
+}
+
+void tp_daemon_run(TP_Daemon *d) {
+    static const char busy[] = "ERRO daemon ocupado\n";
+    tp_net_pool_run(&d->pool, busy, sizeof(busy) - 1);
+}
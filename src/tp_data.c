@@ -0,0 +1,306 @@
+/* mmap/fstat não fazem parte do C99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include "tp_data.h"
+#include "tp_cli.h"
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* par (x, y) de .f64 */
+#define TP_DATA_F64_STRIDE 16
+
+/* número mais longo aceito pelo caminho lento (strtod) */
+#define TP_DATA_NUM_MAX 512
+
+/* ---------- parser de double ---------- */
+
+/* potências de 10 exatas em double */
+static const double pow10_exact[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static int lower(char ch) {
+    return (ch >= 'A' && ch <= 'Z') ? ch - 'A' + 'a' : ch;
+}
+
+/* prefixo sem diferenciar maiúsculas */
+static int has_word(const char *p, const char *end, const char *w) {
+    for (; *w; w++, p++) {
+        if (p >= end || lower(*p) != *w) return 0;
+    }
+    return 1;
+}
+
+const char *tp_parse_double(const char *p, const char *end, double *out) {
+    const char *start = p;
+    int neg = 0;
+    if (p < end && (*p == '+' || *p == '-')) neg = (*p++ == '-');
+
+    if (p < end && (*p == 'n' || *p == 'N' || *p == 'i' || *p == 'I')) {
+        if (has_word(p, end, "nan")) { *out = NAN; return p + 3; }
+        if (has_word(p, end, "infinity")) { *out = neg ? -INFINITY : INFINITY; return p + 8; }
+        if (has_word(p, end, "inf")) { *out = neg ? -INFINITY : INFINITY; return p + 3; }
+        return NULL;
+    }
+
+    /* mantissa em inteiro: até 19 dígitos significativos cabem em uint64 */
+    uint64_t mant = 0;
+    int sig = 0, exp10 = 0, digits = 0, exact = 1;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+        if (sig < 19) {
+            mant = mant * 10 + (uint64_t)(*p - '0');
+            if (mant) sig++;
+        } else {
+            exp10++;
+            if (*p != '0') exact = 0;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+            if (sig < 19) {
+                mant = mant * 10 + (uint64_t)(*p - '0');
+                if (mant) sig++;
+                exp10--;
+            } else if (*p != '0') {
+                exact = 0;
+            }
+        }
+    }
+    if (digits == 0) return NULL;
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        int eneg = 0, e = 0, edigits = 0;
+        if (q < end && (*q == '+' || *q == '-')) eneg = (*q++ == '-');
+        for (; q < end && *q >= '0' && *q <= '9'; q++, edigits++) {
+            if (e < 100000) e = e * 10 + (*q - '0');
+        }
+        /* "1e" sem dígitos: o número acaba antes do 'e' */
+        if (edigits) {
+            exp10 += eneg ? -e : e;
+            p = q;
+        }
+    }
+
+    /* mantissa e 10^|e| exatos: uma só divisão/multiplicação arredonda certo */
+    if (exact && mant <= ((uint64_t)1 << 53) && exp10 >= -22 && exp10 <= 22) {
+        double v = (double)mant;
+        v = exp10 < 0 ? v / pow10_exact[-exp10] : v * pow10_exact[exp10];
+        *out = neg ? -v : v;
+        return p;
+    }
+
+    /* caminho lento: strtod exige '\0' */
+    char buf[TP_DATA_NUM_MAX];
+    const size_t len = (size_t)(p - start);
+    if (len >= sizeof(buf)) return NULL;
+    memcpy(buf, start, len);
+    buf[len] = '\0';
+    *out = strtod(buf, NULL);
+    return p;
+}
+
+/* ---------- CSV ---------- */
+
+static int is_blank(char ch) { return ch == ' ' || ch == '\t'; }
+
+int tp_data_fields(const char *p, const char *eol, double v[2]) {
+    int k = 0;
+    while (k < 2) {
+        while (p < eol && is_blank(*p)) p++;
+        const char *q = tp_parse_double(p, eol, &v[k]);
+        if (!q) break;
+        /* "12abc" não é número */
+        if (q < eol && !is_blank(*q) && *q != ',' && *q != ';' && *q != '\r') break;
+        k++;
+        p = q;
+        while (p < eol && is_blank(*p)) p++;
+        if (p < eol && (*p == ',' || *p == ';')) p++;
+    }
+    return k;
+}
+
+/* Colunas numéricas da linha em *pos e avança para a próxima linha */
+static int csv_line(const char *base, size_t size, size_t *pos, double v[2]) {
+    const char *p = base + *pos, *end = base + size;
+    const char *eol = (const char*)memchr(p, '\n', (size_t)(end - p));
+    if (!eol) eol = end;
+    *pos = (size_t)(eol - base) + (eol < end);
+    return tp_data_fields(p, eol, v);
+}
+
+/* ---------- .f64 ---------- */
+
+static double rd_f64le(const char *p) {
+    const unsigned char *b = (const unsigned char*)p;
+    uint64_t u = 0;
+    for (int k = 7; k >= 0; k--) u = (u << 8) | b[k];
+    double v;
+    memcpy(&v, &u, sizeof(v));
+    return v;
+}
+
+/* ---------- abertura ---------- */
+
+int tp_data_map(TP_Data *d, const char *path, char *err, int err_sz) {
+    memset(d, 0, sizeof(*d));
+    d->fmt = (tp_path_has_ext(path, ".f64") || tp_path_has_ext(path, ".bin")) ? TP_DATA_F64 : TP_DATA_CSV;
+
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        snprintf(err, (size_t)err_sz, "nao consegui abrir %s", path);
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        snprintf(err, (size_t)err_sz, "arquivo vazio ou ilegivel: %s", path);
+        return 1;
+    }
+    if (d->fmt == TP_DATA_F64 && st.st_size % TP_DATA_F64_STRIDE != 0) {
+        close(fd);
+        snprintf(err, (size_t)err_sz, "%s: tamanho nao e multiplo de %d bytes (pares x,y double)",
+                 path, TP_DATA_F64_STRIDE);
+        return 1;
+    }
+
+    void *m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);   /* o mapeamento segura o arquivo */
+    if (m == MAP_FAILED) {
+        snprintf(err, (size_t)err_sz, "mmap falhou: %s", path);
+        return 1;
+    }
+    d->base = (const char*)m;
+    d->size = (size_t)st.st_size;
+    d->mtime = (long long)st.st_mtime;
+
+    /* leitura sequencial (kernel lê adiante) */
+    posix_madvise(m, d->size, POSIX_MADV_SEQUENTIAL);
+
+    if (d->fmt == TP_DATA_CSV) {
+        size_t pos = 0;
+        double v[2];
+        int k = 0;
+        while (pos < d->size && (k = csv_line(d->base, d->size, &pos, v)) == 0) {}
+        d->y_only = (k == 1);
+    }
+    return 0;
+}
+
+int tp_data_scan(TP_Data *d) {
+    TP_DataCursor c;
+    tp_data_cursor(d, &c);
+    double x, y, px = -INFINITY;
+    d->has_bounds = 0;
+    d->x_sorted = 1;
+    while (tp_data_next(&c, &x, &y)) {
+        if (x < px) d->x_sorted = 0;
+        if (x == x) px = x;
+        if (!isfinite(x) || !isfinite(y)) continue;
+        if (!d->has_bounds) {
+            d->xmin = d->xmax = x;
+            d->ymin = d->ymax = y;
+            d->has_bounds = 1;
+        } else {
+            if (x < d->xmin) d->xmin = x;
+            if (x > d->xmax) d->xmax = x;
+            if (y < d->ymin) d->ymin = y;
+            if (y > d->ymax) d->ymax = y;
+        }
+    }
+    d->n = c.i;
+    return d->n > 0 ? 0 : 1;
+}
+
+int tp_data_open(TP_Data *d, const char *path, char *err, int err_sz) {
+    if (tp_data_map(d, path, err, err_sz) != 0) return 1;
+    if (tp_data_scan(d) != 0) {
+        tp_data_close(d);
+        snprintf(err, (size_t)err_sz, "%s: nenhum ponto", path);
+        return 1;
+    }
+    return 0;
+}
+
+void tp_data_close(TP_Data *d) {
+    if (d->base) munmap((void*)d->base, d->size);
+    memset(d, 0, sizeof(*d));
+}
+
+/* ---------- percurso ---------- */
+
+void tp_data_cursor(const TP_Data *d, TP_DataCursor *c) {
+    tp_data_cursor_at(d, c, 0, d->size, 0);
+}
+
+void tp_data_cursor_at(const TP_Data *d, TP_DataCursor *c, size_t pos, size_t end, size_t i) {
+    c->d = d;
+    c->pos = pos;
+    c->end = end < d->size ? end : d->size;
+    c->i = i;
+}
+
+size_t tp_data_line_start(const TP_Data *d, size_t pos) {
+    if (pos == 0 || pos >= d->size) return pos < d->size ? pos : d->size;
+    if (d->fmt == TP_DATA_F64) {
+        pos = (pos + TP_DATA_F64_STRIDE - 1) / TP_DATA_F64_STRIDE * TP_DATA_F64_STRIDE;
+        return pos < d->size ? pos : d->size;
+    }
+    /* pos já no início de linha se o byte anterior é '\n' */
+    const char *nl = (const char*)memchr(d->base + pos - 1, '\n', d->size - pos + 1);
+    return nl ? (size_t)(nl - d->base) + 1 : d->size;
+}
+
+void tp_data_seek(TP_DataCursor *c, double x0) {
+    const TP_Data *d = c->d;
+    tp_data_cursor(d, c);
+    if (d->fmt != TP_DATA_F64 || !d->x_sorted) return;
+
+    /* primeiro índice com x >= x0 */
+    size_t lo = 0, hi = d->n;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (rd_f64le(d->base + mid * TP_DATA_F64_STRIDE) < x0) lo = mid + 1;
+        else hi = mid;
+    }
+    lo = lo > 0 ? lo - 1 : 0;
+    tp_data_cursor_at(d, c, lo * TP_DATA_F64_STRIDE, d->size, lo);
+}
+
+int tp_data_next(TP_DataCursor *c, double *x, double *y) {
+    const TP_Data *d = c->d;
+
+    if (d->fmt == TP_DATA_F64) {
+        if (c->pos + TP_DATA_F64_STRIDE > c->end) return 0;
+        *x = rd_f64le(d->base + c->pos);
+        *y = rd_f64le(d->base + c->pos + 8);
+        c->pos += TP_DATA_F64_STRIDE;
+        c->i++;
+        return 1;
+    }
+
+    while (c->pos < c->end) {
+        double v[2];
+        const int k = csv_line(d->base, d->size, &c->pos, v);
+        if (k == 0) continue;
+        if (d->y_only) {
+            *x = (double)c->i;
+            *y = v[0];
+        } else {
+            /* "x," sem y: buraco na série */
+            *x = v[0];
+            *y = k == 2 ? v[1] : NAN;
+        }
+        c->i++;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,327 @@
+#include "tp_deriv.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------- construtores com simplificação ----------
+   Todos assumem os argumentos (liberados também em erro) e propagam
+   NULL (sem memória). */
+
+static int is_num(const TP_Node *n, double v) {
+    return n && n->type == TP_NODE_NUMBER && n->as.number == v;
+}
+
+static int is_const(const TP_Node *n) {
+    return n && n->type == TP_NODE_NUMBER;
+}
+
+static TP_Node *drop2(TP_Node *a, TP_Node *b) {
+    tp_ast_free(a);
+    tp_ast_free(b);
+    return NULL;
+}
+
+/* n vira o número v (reaproveita o nó) */
+static TP_Node *become_num(TP_Node *n, double v, TP_Node *other) {
+    tp_ast_free(other);
+    if (n->type != TP_NODE_NUMBER) {
+        tp_ast_free(n);
+        return tp_node_number(v);
+    }
+    n->as.number = v;
+    return n;
+}
+
+static TP_Node *mk_neg(TP_Node *a) {
+    if (!a) return NULL;
+    if (is_const(a)) return become_num(a, -a->as.number, NULL);
+    if (a->type == TP_NODE_UNARY_NEG) {
+        TP_Node *in = a->as.unary.a;
+        a->as.unary.a = NULL;
+        tp_ast_free(a);
+        return in;
+    }
+    TP_Node *n = tp_node_unary(TP_NODE_UNARY_NEG, a);
+    if (!n) tp_ast_free(a);
+    return n;
+}
+
+static TP_Node *mk_bin(TP_NodeType t, TP_Node *a, TP_Node *b) {
+    if (!a || !b) return drop2(a, b);
+    if (is_const(a) && is_const(b)) {
+        const TP_Node tmp = { t, { 0 } };
+        const double k[2] = { a->as.number, b->as.number };
+        return become_num(a, tp_ast_apply(&tmp, k, 0.0, NAN), b);
+    }
+    TP_Node *n = tp_node_bin(t, a, b);
+    if (!n) return drop2(a, b);
+    return n;
+}
+
+static TP_Node *mk_add(TP_Node *a, TP_Node *b) {
+    if (!a || !b) return drop2(a, b);
+    if (is_num(a, 0.0)) { tp_ast_free(a); return b; }
+    if (is_num(b, 0.0)) { tp_ast_free(b); return a; }
+    if (b->type == TP_NODE_UNARY_NEG) {
+        TP_Node *in = b->as.unary.a;
+        b->as.unary.a = NULL;
+        tp_ast_free(b);
+        return mk_bin(TP_NODE_SUB, a, in);
+    }
+    return mk_bin(TP_NODE_ADD, a, b);
+}
+
+static TP_Node *mk_sub(TP_Node *a, TP_Node *b) {
+    if (!a || !b) return drop2(a, b);
+    if (is_num(b, 0.0)) { tp_ast_free(b); return a; }
+    if (is_num(a, 0.0)) { tp_ast_free(a); return mk_neg(b); }
+    return mk_bin(TP_NODE_SUB, a, b);
+}
+
+static TP_Node *mk_mul(TP_Node *a, TP_Node *b) {
+    if (!a || !b) return drop2(a, b);
+    if (is_num(a, 0.0)) { tp_ast_free(b); return a; }
+    if (is_num(b, 0.0)) { tp_ast_free(a); return b; }
+    if (is_num(a, 1.0)) { tp_ast_free(a); return b; }
+    if (is_num(b, 1.0)) { tp_ast_free(b); return a; }
+    if (is_num(a, -1.0)) { tp_ast_free(a); return mk_neg(b); }
+    if (is_num(b, -1.0)) { tp_ast_free(b); return mk_neg(a); }
+    if (is_const(b) && !is_const(a)) return mk_bin(TP_NODE_MUL, b, a);   /* k * expr */
+    return mk_bin(TP_NODE_MUL, a, b);
+}
+
+static TP_Node *mk_div(TP_Node *a, TP_Node *b) {
+    if (!a || !b) return drop2(a, b);
+    if (is_num(a, 0.0)) { tp_ast_free(b); return a; }
+    if (is_num(b, 1.0)) { tp_ast_free(b); return a; }
+    return mk_bin(TP_NODE_DIV, a, b);
+}
+
+static TP_Node *mk_pow(TP_Node *a, TP_Node *b) {
+    if (!a || !b) return drop2(a, b);
+    if (is_num(b, 0.0)) return become_num(b, 1.0, a);
+    if (is_num(b, 1.0)) { tp_ast_free(b); return a; }
+    return mk_bin(TP_NODE_POW, a, b);
+}
+
+static TP_Node *mk_func(TP_Func1 f, TP_Node *a) {
+    if (!a) return NULL;
+    if (is_const(a)) {
+        TP_Node tmp = { TP_NODE_FUNC1, { 0 } };
+        tmp.as.func1.f = f;
+        return become_num(a, tp_ast_apply(&tmp, &a->as.number, 0.0, NAN), NULL);
+    }
+    TP_Node *n = tp_node_func1(f, a);
+    if (!n) tp_ast_free(a);
+    return n;
+}
+
+static TP_Node *num(double v) { return tp_node_number(v); }
+
+/* 1 e o valor em *k se a subárvore não depende de x, y nem de slots */
+static int const_value(const TP_Node *n, double *k) {
+    if (n->type == TP_NODE_NUMBER) { *k = n->as.number; return 1; }
+    TP_AstWalk w;
+    const TP_Node *c;
+    int is_k = 1;
+    tp_ast_walk_init(&w, n);
+    while (is_k && (c = tp_ast_walk_next(&w)) != NULL) {
+        is_k = c->type != TP_NODE_VAR_X && c->type != TP_NODE_VAR_Y &&
+               c->type != TP_NODE_SLOT && c->type != TP_NODE_PARAM &&
+               c->type != TP_NODE_TUPLE2;
+    }
+    if (w.failed) is_k = 0;
+    tp_ast_walk_free(&w);
+    if (is_k) *k = tp_eval2(n, 0.0, NAN);
+    return is_k;
+}
+
+/* cópia de uma subárvore do original; constante vira um número só */
+static TP_Node *cl(const TP_Node *n) {
+    double k;
+    return const_value(n, &k) ? num(k) : tp_ast_clone(n);
+}
+
+/* ---------- regras ---------- */
+
+/* derivada do slot de cada LET: constante (a maioria: definição que não
+   depende de x) ou SLOT do LET irmão com a derivada */
+typedef struct DSlot {
+    int bound;
+    int is_const;
+    double k;
+} DSlot;
+
+typedef struct Deriv {
+    DSlot *ds;
+    int n_ds;     /* = deslocamento dos slots de derivada */
+} Deriv;
+
+/* d(n) dados os filhos derivados em d[]; assume d[] */
+static TP_Node *rule(const Deriv *D, const TP_Node *n, TP_Node **d) {
+    TP_Node *da = d[0], *db = d[1];
+
+    switch (n->type) {
+        case TP_NODE_NUMBER:
+        case TP_NODE_VAR_Y:
+            return num(0.0);
+        case TP_NODE_VAR_X:
+            return num(1.0);
+
+        case TP_NODE_SLOT: {
+            const int s = n->as.slot;
+            /* livre (parâmetro nomeado): constante */
+            if (s < 0 || s >= D->n_ds || !D->ds[s].bound) return num(0.0);
+            if (D->ds[s].is_const) return num(D->ds[s].k);
+            return tp_node_slot(s + D->n_ds);
+        }
+
+        case TP_NODE_UNARY_NEG: return mk_neg(da);
+        case TP_NODE_ADD:       return mk_add(da, db);
+        case TP_NODE_SUB:       return mk_sub(da, db);
+
+        case TP_NODE_MUL: {
+            const TP_Node *a = n->as.bin.a, *b = n->as.bin.b;
+            TP_Node *l = is_num(da, 0.0) ? (tp_ast_free(da), num(0.0)) : mk_mul(da, cl(b));
+            TP_Node *r = is_num(db, 0.0) ? (tp_ast_free(db), num(0.0)) : mk_mul(cl(a), db);
+            return mk_add(l, r);
+        }
+
+        case TP_NODE_DIV:
+        case TP_NODE_FRAC: {
+            const TP_Node *a = n->type == TP_NODE_DIV ? n->as.bin.a : n->as.frac.num;
+            const TP_Node *b = n->type == TP_NODE_DIV ? n->as.bin.b : n->as.frac.den;
+            /* a'/b - a b'/b^2 */
+            TP_Node *l = is_num(da, 0.0) ? (tp_ast_free(da), num(0.0)) : mk_div(da, cl(b));
+            if (is_num(db, 0.0)) { tp_ast_free(db); return l; }
+            return mk_sub(l, mk_div(mk_mul(cl(a), db), mk_pow(cl(b), num(2.0))));
+        }
+
+        case TP_NODE_POW: {
+            const TP_Node *a = n->as.bin.a, *b = n->as.bin.b;
+            if (is_num(db, 0.0)) {
+                /* expoente constante: b a^(b-1) a' */
+                tp_ast_free(db);
+                if (is_num(da, 0.0)) return da;
+                return mk_mul(mk_mul(cl(b), mk_pow(cl(a), mk_sub(cl(b), num(1.0)))), da);
+            }
+            if (is_num(da, 0.0)) {
+                /* base constante: a^b log(a) b' */
+                tp_ast_free(da);
+                return mk_mul(mk_mul(mk_pow(cl(a), cl(b)), mk_func(TP_F_LOG, cl(a))), db);
+            }
+            /* a^b (b' log a + b a'/a) */
+            return mk_mul(mk_pow(cl(a), cl(b)),
+                          mk_add(mk_mul(db, mk_func(TP_F_LOG, cl(a))),
+                                 mk_div(mk_mul(cl(b), da), cl(a))));
+        }
+
+        case TP_NODE_FUNC1: {
+            const TP_Node *a = n->as.func1.arg;
+            if (is_num(da, 0.0)) return da;
+            switch (n->as.func1.f) {
+                case TP_F_SIN:  return mk_mul(mk_func(TP_F_COS, cl(a)), da);
+                case TP_F_COS:  return mk_neg(mk_mul(mk_func(TP_F_SIN, cl(a)), da));
+                case TP_F_TAN:  return mk_div(da, mk_pow(mk_func(TP_F_COS, cl(a)), num(2.0)));
+                case TP_F_LOG:  return mk_div(da, cl(a));
+                case TP_F_EXP:  return mk_mul(mk_func(TP_F_EXP, cl(a)), da);
+                case TP_F_SQRT: return mk_div(da, mk_mul(num(2.0), mk_func(TP_F_SQRT, cl(a))));
+                default:        return drop2(da, NULL);
+            }
+        }
+
+        case TP_NODE_LET: {
+            /* let s = v in let s' = v' in body' */
+            const int s = n->as.let.slot;
+            TP_Node *body = db;
+            if (!D->ds[s].is_const) {
+                body = da && db ? tp_node_let(s + D->n_ds, da, db) : NULL;
+                if (!body) return drop2(da, db);
+            } else {
+                tp_ast_free(da);
+            }
+            TP_Node *v = body ? cl(n->as.let.value) : NULL;
+            TP_Node *l = v ? tp_node_let(s, v, body) : NULL;
+            if (!l) drop2(v, body);
+            return l;
+        }
+
+        case TP_NODE_TUPLE2: {
+            TP_Node *t = da && db ? tp_node_tuple2(da, db) : NULL;
+            if (!t) drop2(da, db);
+            return t;
+        }
+
+        default:   /* PARAM: só em templates */
+            return drop2(da, db);
+    }
+}
+
+/* maior slot de LET + 1 (0 sem LETs); -1 se a árvore tem PARAM */
+static int slot_span(const TP_Node *n) {
+    TP_AstWalk w;
+    const TP_Node *c;
+    int span = 0;
+    tp_ast_walk_init(&w, n);
+    while (span >= 0 && (c = tp_ast_walk_next(&w)) != NULL) {
+        if (c->type == TP_NODE_PARAM) span = -1;
+        else if (c->type == TP_NODE_LET && c->as.let.slot >= span) span = c->as.let.slot + 1;
+    }
+    if (w.failed) span = -1;
+    tp_ast_walk_free(&w);
+    return span;
+}
+
+/* Pós-ordem sobre o original com pilha de derivadas (como
+   tp_ast_clone_map); as cópias do original são iterativas também. */
+TP_Node *tp_ast_derive(const TP_Node *root) {
+    if (!root) return NULL;
+
+    Deriv D;
+    D.n_ds = slot_span(root);
+    if (D.n_ds < 0 || D.n_ds > TP_SLOT_MAX / 2) return NULL;
+    D.ds = (DSlot*)calloc((size_t)D.n_ds + 1, sizeof(DSlot));
+    if (!D.ds) return NULL;
+
+    TP_Node *local[TP_WALK_LOCAL];
+    TP_Node **res = local;
+    int sp = 0, cap = TP_WALK_LOCAL, ok = 1;
+    TP_AstWalk w;
+    const TP_Node *c;
+
+    tp_ast_walk_init(&w, root);
+    while (ok && (c = tp_ast_walk_next(&w)) != NULL) {
+        TP_Node *d[2] = { NULL, NULL };
+        const int nc = tp_ast_nchildren(c);
+        for (int i = nc - 1; i >= 0; i--) d[i] = res[--sp];
+
+        TP_Node *r = rule(&D, c, d);
+        if (!r) { ok = 0; break; }
+
+        if (sp == cap) {
+            TP_Node **nr = (TP_Node**)malloc((size_t)cap * 2 * sizeof(TP_Node*));
+            if (!nr) { tp_ast_free(r); ok = 0; break; }
+            memcpy(nr, res, (size_t)sp * sizeof(TP_Node*));
+            if (res != local) free(res);
+            res = nr;
+            cap *= 2;
+        }
+        res[sp++] = r;
+
+        /* acabou o valor de um LET: o corpo já sabe a derivada do slot */
+        if (w.sp > 0 && w.st[w.sp - 1].n->type == TP_NODE_LET && w.st[w.sp - 1].next == 1) {
+            DSlot *ds = &D.ds[w.st[w.sp - 1].n->as.let.slot];
+            ds->bound = 1;
+            ds->is_const = is_const(r);
+            ds->k = ds->is_const ? r->as.number : 0.0;
+        }
+    }
+    if (w.failed) ok = 0;
+    tp_ast_walk_free(&w);
+
+    TP_Node *out = (ok && sp == 1) ? res[0] : NULL;
+    if (!out) while (sp > 0) tp_ast_free(res[--sp]);
+    if (res != local) free(res);
+    free(D.ds);
+    return out;
+}
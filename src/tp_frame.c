@@ -0,0 +1,237 @@
+#include "tp_frame.h"
+#include "tp_plot.h"
+#include "tp_render.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------- contexto ---------- */
+
+void tp_frame_ctx_init(TP_FrameCtx *c) {
+    memset(c, 0, sizeof(*c));
+    tp_sampler_init(&c->sampler);
+    tp_sampler_init(&c->dsampler);
+    /* quem usa vários contextos já paraleliza entre frames */
+    tp_heatmap_init(&c->heat, 1);
+}
+
+static void release_target(TP_FrameCtx *c) {
+    if (c->heat_tex) SDL_DestroyTexture(c->heat_tex);
+    if (c->r) SDL_DestroyRenderer(c->r);
+    if (c->surf) SDL_FreeSurface(c->surf);
+    free(c->pixels);
+    c->heat_tex = NULL;
+    c->r = NULL;
+    c->surf = NULL;
+    c->pixels = NULL;
+    c->w = c->h = 0;
+}
+
+void tp_frame_ctx_free(TP_FrameCtx *c) {
+    release_target(c);
+    tp_sampler_free(&c->sampler);
+    tp_sampler_free(&c->dsampler);
+    tp_heatmap_free(&c->heat);
+}
+
+void tp_frame_ctx_reset(TP_FrameCtx *c) {
+    tp_sampler_invalidate(&c->sampler);
+    tp_sampler_invalidate(&c->dsampler);
+}
+
+static int ensure_target(TP_FrameCtx *c, int w, int h) {
+    if (c->r && c->w == w && c->h == h) return 0;
+    release_target(c);
+    c->surf = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+    c->r = c->surf ? SDL_CreateSoftwareRenderer(c->surf) : NULL;
+    c->pixels = (Uint32*)malloc(sizeof(Uint32) * (size_t)w * (size_t)h);
+    if (!c->r || !c->pixels) {
+        release_target(c);
+        return -1;
+    }
+    c->w = w;
+    c->h = h;
+    return 0;
+}
+
+/* ---------- frame ---------- */
+
+/* amostras completas (orçamento 0 = sem limite) */
+static int sample_full(TP_Sampler *sm, const TP_FrameScene *s,
+                       const TP_Program *pa, const TP_Program *pb,
+                       const TP_View *v, int w, int h) {
+    const int n = s->is_tuple ? TP_FRAME_PARAM_STEPS : w;
+    const double t0 = s->is_tuple ? s->tmin : v->xmin;
+    const double t1 = s->is_tuple ? s->tmax : v->xmax;
+    const double tol = s->is_tuple ? 0.0
+                                   : TP_CURVE_TOL_PX * (v->ymax - v->ymin) / (double)(h > 1 ? h - 1 : 1);
+    if (tp_sampler_reset(sm, n, t0, t1) < 0) return -1;
+    if (s->params) tp_sampler_set_params(sm, s->params, pa, pb);
+    tp_sampler_set_tolerance(sm, tol);
+    tp_sampler_refine(sm, pa, pb, 0.0);
+    return 0;
+}
+
+int tp_frame_draw_curves(const TP_FrameScene *s, TP_FrameCtx *c,
+                         const TP_View *v, int w, int h, const TP_Out *out)
+{
+    if (s->is_field) return 0;
+    const TP_Screen screen = { w, h };
+
+    /* tupla: a chave não depende da viewport, o sampler não refaz nada */
+    if (s->prog_d && !s->is_tuple) {
+        if (sample_full(&c->dsampler, s, s->prog_d, NULL, v, w, h) != 0) return -1;
+        tp_draw_function_samples(out, v, screen, &c->dsampler, TP_DERIV_R, TP_DERIV_G, TP_DERIV_B);
+    }
+    if (sample_full(&c->sampler, s, s->prog_a, s->prog_b, v, w, h) != 0) return -1;
+    if (s->is_tuple) {
+        tp_draw_parametric_samples(out, v, screen, &c->sampler, s->fg_r, s->fg_g, s->fg_b);
+    } else {
+        tp_draw_function_samples(out, v, screen, &c->sampler, s->fg_r, s->fg_g, s->fg_b);
+    }
+    return 0;
+}
+
+int tp_frame_draw(const TP_FrameScene *s, TP_FrameCtx *c,
+                  const TP_View *v, int w, int h, TP_Vec *vec)
+{
+    if (ensure_target(c, w, h) != 0) return -1;
+    const TP_Screen screen = { w, h };
+    const TP_Out out = { c->r, vec, NULL };
+
+    SDL_SetRenderDrawColor(c->r, s->bg_r, s->bg_g, s->bg_b, 255);
+    SDL_RenderClear(c->r);
+
+    if (s->is_field) {
+        if (tp_heatmap_render(&c->heat, s->prog_a, s->params, v, screen, 1,
+                              s->has_zrange, s->zmin, s->zmax) != 0) return -1;
+        if (!c->heat_tex) {
+            c->heat_tex = SDL_CreateTexture(c->r, SDL_PIXELFORMAT_ARGB8888,
+                                            SDL_TEXTUREACCESS_STREAMING, w, h);
+            if (!c->heat_tex) return -1;
+        }
+        SDL_UpdateTexture(c->heat_tex, NULL, c->heat.pixels, w * (int)sizeof(Uint32));
+        SDL_RenderCopy(c->r, c->heat_tex, NULL, NULL);
+    }
+
+    tp_draw_grid(&out, v, screen);
+    tp_draw_axes(&out, v, screen);
+    if (s->data) tp_draw_data(&out, v, screen, s->data, s->lod, s->data_r, s->data_g, s->data_b);
+
+    if (tp_frame_draw_curves(s, c, v, w, h, &out) != 0) return -1;
+
+    /* mesmo caminho do screenshot: lê o que o renderer desenhou */
+    return SDL_RenderReadPixels(c->r, NULL, SDL_PIXELFORMAT_ARGB8888, c->pixels,
+                                w * (int)sizeof(Uint32)) == 0 ? 0 : -1;
+}
+
+/* ---------- série e viewport inicial ---------- */
+
+int tp_frame_open_data(TP_Data *d, TP_Lod *lod, const char *path, const char *lod_path,
+                       char *err, int err_sz)
+{
+    if (tp_data_map(d, path, err, err_sz) != 0) return 1;
+    if (tp_lod_open(lod, d, lod_path) < 0) {
+        fprintf(stderr, "Aviso: LOD sem memoria; desenhando ponto a ponto\n");
+        tp_data_scan(d);
+    }
+    if (d->n == 0) {
+        snprintf(err, (size_t)err_sz, "%s: nenhum ponto", path);
+        tp_data_close(d);
+        return 1;
+    }
+    return 0;
+}
+
+static void autofit_param_view(TP_View *view,
+                               const TP_Node *xexpr, const TP_Node *yexpr,
+                               const double *params,
+                               double tmin, double tmax,
+                               int fit_x, int fit_y)
+{
+    double minx = 0, maxx = 0, miny = 0, maxy = 0;
+    int have = 0;
+
+    const int N = 2500;
+    for (int i = 0; i < N; i++) {
+        double t = tmin + (tmax - tmin) * ((double)i / (double)(N - 1));
+        double xw = tp_eval_p(xexpr, t, NAN, params);
+        double yw = tp_eval_p(yexpr, t, NAN, params);
+
+        if (!isfinite(xw) || !isfinite(yw)) continue;
+
+        if (!have) {
+            minx = maxx = xw;
+            miny = maxy = yw;
+            have = 1;
+        } else {
+            if (xw < minx) minx = xw;
+            if (xw > maxx) maxx = xw;
+            if (yw < miny) miny = yw;
+            if (yw > maxy) maxy = yw;
+        }
+    }
+
+    if (!have) return;
+
+    double padx = (maxx - minx) * 0.05; if (padx <= 0) padx = 1.0;
+    double pady = (maxy - miny) * 0.05; if (pady <= 0) pady = 1.0;
+
+    if (fit_x) { view->xmin = minx - padx; view->xmax = maxx + padx; }
+    if (fit_y) { view->ymin = miny - pady; view->ymax = maxy + pady; }
+}
+
+void tp_frame_fit_tuple(TP_View *view, const TP_Node *ast, const double *params,
+                        double tmin, double tmax)
+{
+    autofit_param_view(view, ast->as.tuple2.a, ast->as.tuple2.b, params, tmin, tmax, 1, 1);
+}
+
+/* viewport nos limites da série (+5%), nos eixos sem range explícito */
+static void autofit_data_view(TP_View *view, const TP_Data *d, int fit_x, int fit_y) {
+    if (!d->has_bounds) return;
+
+    double padx = (d->xmax - d->xmin) * 0.05; if (padx <= 0) padx = 1.0;
+    double pady = (d->ymax - d->ymin) * 0.05; if (pady <= 0) pady = 1.0;
+
+    if (fit_x) { view->xmin = d->xmin - padx; view->xmax = d->xmax + padx; }
+    if (fit_y) { view->ymin = d->ymin - pady; view->ymax = d->ymax + pady; }
+}
+
+void tp_frame_initial_view(const TP_Args *a, const TP_Node *ast, int is_tuple,
+                           const double *params, const TP_Data *data,
+                           TP_View *view, double *tmin, double *tmax)
+{
+    *view = a->view;
+    *tmin = 0.0;
+    *tmax = 1.0;
+
+    if (is_tuple) {
+        int fit_x = 0, fit_y = 0;
+        if (a->has_t) {
+            *tmin = a->tmin;
+            *tmax = a->tmax;
+        } else if (a->has_xrange) {
+            /* compat: xmin/xmax viram t-range quando a expr é tupla */
+            *tmin = a->view.xmin;
+            *tmax = a->view.xmax;
+
+            fit_x = 1;
+            fit_y = a->has_yrange ? 0 : 1;
+
+            /* antes do autofit, deixe X neutro */
+            view->xmin = -10.0; view->xmax = 10.0;
+        } else {
+            *tmin = 0.0;
+            *tmax = 6.283185307179586;
+            fit_x = 1;
+            fit_y = a->has_yrange ? 0 : 1;
+        }
+
+        autofit_param_view(view, ast->as.tuple2.a, ast->as.tuple2.b,
+                           params, *tmin, *tmax, fit_x, fit_y);
+    } else if (data) {
+        autofit_data_view(view, data, !a->has_xrange, !a->has_yrange);
+    }
+}
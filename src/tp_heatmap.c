@@ -0,0 +1,351 @@
+#include "tp_heatmap.h"
+#include <math.h>
+#include <stdlib.h>
+
+/* pontos de controle aproximados do viridis */
+static const unsigned char viridis_ctrl[9][3] = {
+    {  68,   1,  84 },
+    {  71,  44, 122 },
+    {  59,  81, 139 },
+    {  44, 113, 142 },
+    {  33, 144, 141 },
+    {  39, 173, 129 },
+    {  92, 200,  99 },
+    { 170, 220,  50 },
+    { 253, 231,  37 }
+};
+
+void tp_colormap_viridis(Uint32 lut[TP_HEAT_LUT_SIZE]) {
+    const int nctrl = 9;
+    for (int i = 0; i < TP_HEAT_LUT_SIZE; i++) {
+        double t = (double)i / (double)(TP_HEAT_LUT_SIZE - 1) * (double)(nctrl - 1);
+        int k = (int)t;
+        if (k >= nctrl - 1) k = nctrl - 2;
+        double f = t - (double)k;
+
+        Uint32 rgb[3];
+        for (int c = 0; c < 3; c++) {
+            double a = viridis_ctrl[k][c];
+            double b = viridis_ctrl[k + 1][c];
+            rgb[c] = (Uint32)lround(a + (b - a) * f);
+        }
+        lut[i] = 0xFF000000u | (rgb[0] << 16) | (rgb[1] << 8) | rgb[2];
+    }
+}
+
+/* ---------- pool ---------- */
+
+static int pool_main(void *data) {
+    TP_Heatmap *hm = (TP_Heatmap*)data;
+    unsigned seen = 0;   /* gen começa em 0: a primeira tarefa nunca se perde */
+
+    SDL_LockMutex(hm->lock);
+    const int idx = hm->started++;
+    for (;;) {
+        while (hm->gen == seen && !hm->quit) SDL_CondWait(hm->go, hm->lock);
+        if (hm->quit) break;
+        seen = hm->gen;
+
+        void (*task)(void*, int) = hm->task;
+        void *job = hm->task_job;
+        const int n = hm->task_n;
+        SDL_UnlockMutex(hm->lock);
+        if (idx < n) task(job, idx);
+        SDL_LockMutex(hm->lock);
+
+        if (--hm->running == 0) SDL_CondSignal(hm->done);
+    }
+    SDL_UnlockMutex(hm->lock);
+    return 0;
+}
+
+/* roda task(job, i) para i em 0..n-1 (a thread chamadora faz o 0) */
+static void run_parallel(TP_Heatmap *hm, void (*task)(void*, int), void *job, int n) {
+    if (n <= 1 || hm->nthreads <= 1) {
+        task(job, 0);
+        return;
+    }
+
+    SDL_LockMutex(hm->lock);
+    hm->task = task;
+    hm->task_job = job;
+    hm->task_n = n;
+    hm->running = hm->nthreads - 1;
+    hm->gen++;
+    SDL_CondBroadcast(hm->go);
+    SDL_UnlockMutex(hm->lock);
+
+    task(job, 0);
+
+    SDL_LockMutex(hm->lock);
+    while (hm->running > 0) SDL_CondWait(hm->done, hm->lock);
+    SDL_UnlockMutex(hm->lock);
+}
+
+static void pool_start(TP_Heatmap *hm, int nthreads) {
+    hm->nthreads = 1;
+    if (nthreads <= 1) return;
+
+    hm->lock = SDL_CreateMutex();
+    hm->go = SDL_CreateCond();
+    hm->done = SDL_CreateCond();
+    if (!hm->lock || !hm->go || !hm->done) return;
+
+    hm->started = 1;
+    for (int i = 1; i < nthreads; i++) {
+        SDL_Thread *th = SDL_CreateThread(pool_main, "tp_heatmap", hm);
+        if (!th) break;
+        hm->threads[hm->nthreads++] = th;
+    }
+}
+
+static void pool_stop(TP_Heatmap *hm) {
+    if (hm->nthreads > 1) {
+        SDL_LockMutex(hm->lock);
+        hm->quit = 1;
+        SDL_CondBroadcast(hm->go);
+        SDL_UnlockMutex(hm->lock);
+        for (int i = 1; i < hm->nthreads; i++) SDL_WaitThread(hm->threads[i], NULL);
+    }
+    if (hm->done) SDL_DestroyCond(hm->done);
+    if (hm->go) SDL_DestroyCond(hm->go);
+    if (hm->lock) SDL_DestroyMutex(hm->lock);
+    hm->done = hm->go = NULL;
+    hm->lock = NULL;
+    hm->nthreads = 1;
+}
+
+void tp_heatmap_init(TP_Heatmap *hm, int nthreads) {
+    hm->w = 0;
+    hm->h = 0;
+    hm->z = NULL;
+    hm->pixels = NULL;
+    tp_colormap_viridis(hm->lut);
+    hm->nan_color = 0xFF000000u;
+
+    hm->lock = NULL;
+    hm->go = hm->done = NULL;
+    hm->gen = 0;
+    hm->started = 0;
+    hm->running = 0;
+    hm->quit = 0;
+    hm->task = NULL;
+    hm->task_job = NULL;
+    hm->task_n = 0;
+
+    if (nthreads <= 0) nthreads = SDL_GetCPUCount();
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > TP_HEAT_MAX_THREADS) nthreads = TP_HEAT_MAX_THREADS;
+    pool_start(hm, nthreads);
+
+    hm->zmin = 0.0;
+    hm->zmax = 1.0;
+}
+
+void tp_heatmap_free(TP_Heatmap *hm) {
+    pool_stop(hm);
+    free(hm->z);
+    free(hm->pixels);
+    hm->z = NULL;
+    hm->pixels = NULL;
+    hm->w = hm->h = 0;
+}
+
+static int ensure_size(TP_Heatmap *hm, int w, int h) {
+    if (hm->w == w && hm->h == h && hm->z && hm->pixels) return 1;
+
+    float *z = (float*)malloc((size_t)w * (size_t)h * sizeof(float));
+    Uint32 *px = (Uint32*)malloc((size_t)w * (size_t)h * sizeof(Uint32));
+    if (!z || !px) { free(z); free(px); return 0; }
+
+    free(hm->z);
+    free(hm->pixels);
+    hm->z = z;
+    hm->pixels = px;
+    hm->w = w;
+    hm->h = h;
+    return 1;
+}
+
+/* ---------- jobs paralelos por linha ---------- */
+
+typedef struct HeatJob {
+    TP_Heatmap *hm;
+    const TP_Program *prog;
+    const double *params;
+    const TP_View *v;
+    TP_Screen s;
+    int block;
+
+    int direct;          /* range fixo: escreve ARGB direto */
+    double zmin, scale;  /* índice = (z - zmin) * scale */
+
+    int n_rows;          /* em linhas de blocos */
+    SDL_atomic_t next_row;
+} HeatJob;
+
+typedef struct HeatWorker {
+    HeatJob *job;
+    double zmin, zmax;
+    int have;
+    int ok;
+} HeatWorker;
+
+static Uint32 color_of(const TP_Heatmap *hm, double z, double zmin, double scale) {
+    if (!isfinite(z)) return hm->nan_color;
+    double t = (z - zmin) * scale;
+    int idx = (int)t;
+    if (t < 0.0) idx = 0;
+    if (idx > TP_HEAT_LUT_SIZE - 1) idx = TP_HEAT_LUT_SIZE - 1;
+    return hm->lut[idx];
+}
+
+static void eval_worker(void *data, int idx) {
+    HeatWorker *wk = (HeatWorker*)data + idx;
+    HeatJob *job = wk->job;
+    TP_Heatmap *hm = job->hm;
+    const int w = job->s.w, h = job->s.h, block = job->block;
+    const int nb = (w + block - 1) / block;
+
+    double *buf = (double*)malloc((size_t)nb * 3 * sizeof(double));
+    if (!buf) { wk->ok = 0; return; }
+    double *xs = buf, *ys = buf + nb, *zs = buf + 2 * nb;
+
+    for (int bx = 0; bx < nb; bx++) {
+        int sx = bx * block + block / 2;
+        if (sx > w - 1) sx = w - 1;
+        tp_screen_to_world(job->v, job->s, sx, 0, &xs[bx], NULL);
+    }
+
+    for (;;) {
+        const int row = SDL_AtomicAdd(&job->next_row, 1);
+        if (row >= job->n_rows) break;
+
+        const int y0 = row * block;
+        int sy = y0 + block / 2;
+        if (sy > h - 1) sy = h - 1;
+
+        double yw = 0.0;
+        tp_screen_to_world(job->v, job->s, 0, sy, NULL, &yw);
+        for (int bx = 0; bx < nb; bx++) ys[bx] = yw;
+
+        tp_prog_eval_batch_p(job->prog, job->params, xs, ys, zs, nb);
+
+        for (int bx = 0; bx < nb; bx++) {
+            double z = zs[bx];
+            if (!isfinite(z)) continue;
+            if (!wk->have) { wk->zmin = wk->zmax = z; wk->have = 1; }
+            else {
+                if (z < wk->zmin) wk->zmin = z;
+                if (z > wk->zmax) wk->zmax = z;
+            }
+        }
+
+        const int y1 = (y0 + block < h) ? y0 + block : h;
+        for (int py = y0; py < y1; py++) {
+            Uint32 *dst_px = hm->pixels + (size_t)py * (size_t)w;
+            float *dst_z = hm->z + (size_t)py * (size_t)w;
+
+            for (int bx = 0; bx < nb; bx++) {
+                const int x0 = bx * block;
+                const int x1 = (x0 + block < w) ? x0 + block : w;
+                if (job->direct) {
+                    const Uint32 c = color_of(hm, zs[bx], job->zmin, job->scale);
+                    for (int px = x0; px < x1; px++) dst_px[px] = c;
+                } else {
+                    const float z = (float)zs[bx];
+                    for (int px = x0; px < x1; px++) dst_z[px] = z;
+                }
+            }
+        }
+    }
+
+    free(buf);
+}
+
+static void colorize_worker(void *data, int idx) {
+    HeatWorker *wk = (HeatWorker*)data + idx;
+    HeatJob *job = wk->job;
+    TP_Heatmap *hm = job->hm;
+    const int w = job->s.w;
+
+    for (;;) {
+        const int row = SDL_AtomicAdd(&job->next_row, 1);
+        if (row >= job->n_rows) break;
+
+        const float *src = hm->z + (size_t)row * (size_t)w;
+        Uint32 *dst = hm->pixels + (size_t)row * (size_t)w;
+        for (int px = 0; px < w; px++) {
+            dst[px] = color_of(hm, (double)src[px], job->zmin, job->scale);
+        }
+    }
+}
+
+int tp_heatmap_render(TP_Heatmap *hm, const TP_Program *prog, const double *params,
+                      const TP_View *v, TP_Screen s, int block,
+                      int fixed_range, double zmin, double zmax)
+{
+    if (!hm || !prog || !v || s.w <= 0 || s.h <= 0) return 1;
+    if (block < 1) block = 1;
+    if (!ensure_size(hm, s.w, s.h)) return 2;
+
+    HeatJob job;
+    job.hm = hm;
+    job.prog = prog;
+    job.params = params;
+    job.v = v;
+    job.s = s;
+    job.block = block;
+    job.direct = fixed_range;
+    job.zmin = zmin;
+    job.scale = (zmax > zmin) ? (double)TP_HEAT_LUT_SIZE / (zmax - zmin) : 0.0;
+    job.n_rows = (s.h + block - 1) / block;
+    SDL_AtomicSet(&job.next_row, 0);
+
+    int nthreads = hm->nthreads;
+    if (nthreads > job.n_rows) nthreads = job.n_rows;
+    if (nthreads < 1) nthreads = 1;
+
+    HeatWorker wk[TP_HEAT_MAX_THREADS];
+    for (int i = 0; i < nthreads; i++) {
+        wk[i].job = &job;
+        wk[i].have = 0;
+        wk[i].zmin = wk[i].zmax = 0.0;
+        wk[i].ok = 1;
+    }
+
+    run_parallel(hm, eval_worker, wk, nthreads);
+
+    int have = 0;
+    double lo = 0.0, hi = 0.0;
+    for (int i = 0; i < nthreads; i++) {
+        if (!wk[i].ok) return 2;
+        if (!wk[i].have) continue;
+        if (!have) { lo = wk[i].zmin; hi = wk[i].zmax; have = 1; }
+        else {
+            if (wk[i].zmin < lo) lo = wk[i].zmin;
+            if (wk[i].zmax > hi) hi = wk[i].zmax;
+        }
+    }
+
+    if (fixed_range) {
+        hm->zmin = zmin;
+        hm->zmax = zmax;
+        return 0;
+    }
+
+    hm->zmin = lo;
+    hm->zmax = hi;
+
+    job.zmin = lo;
+    job.scale = (hi > lo) ? (double)TP_HEAT_LUT_SIZE / (hi - lo) : 0.0;
+    job.n_rows = s.h;
+    SDL_AtomicSet(&job.next_row, 0);
+
+    nthreads = hm->nthreads;
+    if (nthreads > job.n_rows) nthreads = job.n_rows;
+    for (int i = 0; i < nthreads; i++) wk[i].job = &job;
+    run_parallel(hm, colorize_worker, wk, nthreads);
+
+    return 0;
+}
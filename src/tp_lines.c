@@ -0,0 +1,66 @@
+#include "tp_lines.h"
+#include <stdlib.h>
+#include <string.h>
+
+void tp_lines_init(TP_Lines *l) {
+    memset(l, 0, sizeof(*l));
+}
+
+void tp_lines_free(TP_Lines *l) {
+    free(l->pt);
+    free(l->starts);
+    tp_lines_init(l);
+}
+
+void tp_lines_clear(TP_Lines *l) {
+    l->n = 0;
+    l->n_lines = 0;
+    l->failed = 0;
+    if (l->starts) l->starts[0] = 0;
+}
+
+static int add(TP_Lines *l, double x, double y) {
+    if (l->n == l->cap) {
+        const int cap = l->cap ? l->cap * 2 : 1024;
+        double *pt = (double*)realloc(l->pt, sizeof(double) * 2 * (size_t)cap);
+        if (!pt) { l->failed = 1; return -1; }
+        l->pt = pt;
+        l->cap = cap;
+    }
+    l->pt[2 * l->n] = x;
+    l->pt[2 * l->n + 1] = y;
+    l->n++;
+    l->starts[l->n_lines] = l->n;
+    return 0;
+}
+
+/* nova polilinha começando no ponto (x, y) */
+static int open_line(TP_Lines *l, double x, double y) {
+    /* +1: starts[n_lines] fecha a última */
+    if (l->n_lines + 1 >= l->cap_lines) {
+        const int cap = l->cap_lines ? l->cap_lines * 2 : 64;
+        int *starts = (int*)realloc(l->starts, sizeof(int) * (size_t)cap);
+        if (!starts) { l->failed = 1; return -1; }
+        l->starts = starts;
+        l->cap_lines = cap;
+    }
+    l->starts[l->n_lines] = l->n;
+    l->n_lines++;
+    l->starts[l->n_lines] = l->n;
+    if (add(l, x, y) != 0) {
+        l->n_lines--;
+        return -1;
+    }
+    return 0;
+}
+
+void tp_lines_line(TP_Lines *l, double x0, double y0, double x1, double y1) {
+    const int cont = l->n_lines > 0 && l->n > 0 &&
+                     l->pt[2 * (l->n - 1)] == x0 && l->pt[2 * (l->n - 1) + 1] == y0;
+    if (!cont && open_line(l, x0, y0) != 0) return;
+    add(l, x1, y1);
+}
+
+void tp_lines_point(TP_Lines *l, double x, double y) {
+    open_line(l, x, y);
+}
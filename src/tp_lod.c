@@ -0,0 +1,415 @@
+#include "tp_lod.h"
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TP_LOD_MAGIC "tatuplot-lod 1"
+
+#define TP_LOD_MAX_THREADS 32
+
+/* pedaços por thread (balanceia arquivo com trechos mais caros) */
+#define TP_LOD_CHUNKS_PER_THREAD 4
+
+/* pedaço mínimo: menos que isso não paga a thread */
+#define TP_LOD_MIN_CHUNK (1u << 20)
+
+void tp_lod_init(TP_Lod *l) {
+    memset(l, 0, sizeof(*l));
+    l->nthreads = SDL_GetCPUCount();
+    if (l->nthreads < 1) l->nthreads = 1;
+    if (l->nthreads > TP_LOD_MAX_THREADS) l->nthreads = TP_LOD_MAX_THREADS;
+}
+
+void tp_lod_free(TP_Lod *l) {
+    free(l->blk);
+    for (int i = 1; i < l->n_levels; i++) {
+        free(l->ymin[i]);
+        free(l->ymax[i]);
+    }
+    const int nthreads = l->nthreads;
+    memset(l, 0, sizeof(*l));
+    l->nthreads = nthreads;
+}
+
+/* ---------- nível 0 em paralelo ---------- */
+
+/* Um pedaço do arquivo (linhas inteiras): blocos, contagem e limites
+   locais. Índices (e x de CSV de uma coluna) começam em 0 e são
+   corrigidos ao juntar os pedaços. */
+typedef struct Chunk {
+    size_t pos0, pos1;
+    TP_LodBlock *blk;
+    size_t n_blk, cap;
+    size_t n;
+    double xmin, xmax, ymin, ymax;
+    int has_bounds;
+    int sorted;
+    double xfirst, xlast;     /* x finitos das pontas (ordem entre pedaços) */
+    int failed;
+} Chunk;
+
+typedef struct BuildJob {
+    const TP_Data *d;
+    Chunk *ch;
+    int n_ch;
+    SDL_atomic_t next;
+} BuildJob;
+
+static TP_LodBlock *new_block(Chunk *c) {
+    if (c->n_blk == c->cap) {
+        const size_t ncap = c->cap ? c->cap * 2 : 1024;
+        TP_LodBlock *nb = (TP_LodBlock*)realloc(c->blk, ncap * sizeof(TP_LodBlock));
+        if (!nb) return NULL;
+        c->blk = nb;
+        c->cap = ncap;
+    }
+    return &c->blk[c->n_blk++];
+}
+
+static void build_chunk(const TP_Data *d, Chunk *c) {
+    TP_DataCursor cur;
+    tp_data_cursor_at(d, &cur, c->pos0, c->pos1, 0);
+
+    c->sorted = 1;
+    c->xfirst = c->xlast = NAN;
+
+    TP_LodBlock *b = NULL;
+    size_t pos = cur.pos;
+    double x, y;
+    while (tp_data_next(&cur, &x, &y)) {
+        const int fx = isfinite(x), fy = isfinite(y);
+
+        if (!b || cur.i - 1 - b->i0 == TP_LOD_BLOCK) {
+            b = new_block(c);
+            if (!b) { c->failed = 1; return; }
+            b->pos = pos;
+            b->i0 = cur.i - 1;
+            b->x0 = b->x1 = fx ? x : NAN;
+            b->y0 = fx ? y : NAN;
+            b->ymin = INFINITY;
+            b->ymax = -INFINITY;
+        }
+        pos = cur.pos;
+
+        b->y1 = fx ? y : NAN;
+        if (!fx) continue;
+        if (!(b->x0 == b->x0)) b->x0 = x;
+        b->x1 = x;
+
+        if (c->xlast == c->xlast) {
+            if (x < c->xlast) c->sorted = 0;
+        } else {
+            c->xfirst = x;
+        }
+        c->xlast = x;
+
+        if (!fy) continue;
+        if (y < b->ymin) b->ymin = y;
+        if (y > b->ymax) b->ymax = y;
+        if (!c->has_bounds) {
+            c->xmin = c->xmax = x;
+            c->ymin = c->ymax = y;
+            c->has_bounds = 1;
+        } else {
+            if (x < c->xmin) c->xmin = x;
+            if (x > c->xmax) c->xmax = x;
+            if (y < c->ymin) c->ymin = y;
+            if (y > c->ymax) c->ymax = y;
+        }
+    }
+    c->n = cur.i;
+}
+
+static int build_worker(void *data) {
+    BuildJob *job = (BuildJob*)data;
+    for (;;) {
+        const int i = SDL_AtomicAdd(&job->next, 1);
+        if (i >= job->n_ch) break;
+        build_chunk(job->d, &job->ch[i]);
+    }
+    return 0;
+}
+
+/* roda em nthreads (a thread chamadora participa) */
+static void run_parallel(BuildJob *job, int nthreads) {
+    SDL_Thread *th[TP_LOD_MAX_THREADS];
+
+    for (int i = 1; i < nthreads; i++) {
+        th[i] = SDL_CreateThread(build_worker, "tp_lod", job);
+    }
+    build_worker(job);
+    for (int i = 1; i < nthreads; i++) {
+        if (th[i]) SDL_WaitThread(th[i], NULL);
+    }
+}
+
+/* junta os pedaços em ordem: índices globais, limites e ordem de x */
+static int merge_chunks(TP_Lod *l, TP_Data *d, Chunk *ch, int n_ch) {
+    size_t n_blk = 0;
+    for (int i = 0; i < n_ch; i++) n_blk += ch[i].n_blk;
+    if (n_blk == 0) return 1;
+
+    l->blk = (TP_LodBlock*)malloc(n_blk * sizeof(TP_LodBlock));
+    if (!l->blk) return -1;
+
+    size_t base = 0, k = 0;
+    double xlast = NAN;
+    d->has_bounds = 0;
+    d->x_sorted = 1;
+    for (int i = 0; i < n_ch; i++) {
+        Chunk *c = &ch[i];
+        /* CSV de uma coluna: x é o índice */
+        const double dx = d->y_only ? (double)base : 0.0;
+
+        for (size_t j = 0; j < c->n_blk; j++) {
+            TP_LodBlock *b = &l->blk[k++];
+            *b = c->blk[j];
+            b->i0 += base;
+            b->x0 += dx;
+            b->x1 += dx;
+        }
+
+        if (!c->sorted) d->x_sorted = 0;
+        if (c->xfirst == c->xfirst) {
+            if (c->xfirst + dx < xlast) d->x_sorted = 0;
+            xlast = c->xlast + dx;
+        }
+        if (c->has_bounds) {
+            if (!d->has_bounds) {
+                d->xmin = c->xmin + dx; d->xmax = c->xmax + dx;
+                d->ymin = c->ymin;      d->ymax = c->ymax;
+                d->has_bounds = 1;
+            } else {
+                if (c->xmin + dx < d->xmin) d->xmin = c->xmin + dx;
+                if (c->xmax + dx > d->xmax) d->xmax = c->xmax + dx;
+                if (c->ymin < d->ymin) d->ymin = c->ymin;
+                if (c->ymax > d->ymax) d->ymax = c->ymax;
+            }
+        }
+        base += c->n;
+    }
+    l->n_blk = n_blk;
+    d->n = base;
+
+    /* bloco sem x finito: herda o anterior (x0 fica monótono para a busca) */
+    double px = -INFINITY;
+    for (size_t j = 0; j < n_blk; j++) {
+        TP_LodBlock *b = &l->blk[j];
+        if (!(b->x0 == b->x0)) b->x0 = b->x1 = px;
+        px = b->x1;
+    }
+    return 0;
+}
+
+static int build_level0(TP_Lod *l, TP_Data *d) {
+    int n_ch = l->nthreads * TP_LOD_CHUNKS_PER_THREAD;
+    const size_t max_ch = d->size / TP_LOD_MIN_CHUNK + 1;
+    if ((size_t)n_ch > max_ch) n_ch = (int)max_ch;
+
+    Chunk *ch = (Chunk*)calloc((size_t)n_ch, sizeof(Chunk));
+    if (!ch) return -1;
+    for (int i = 0; i < n_ch; i++) {
+        ch[i].pos0 = tp_data_line_start(d, (size_t)((double)d->size * i / n_ch));
+        ch[i].pos1 = i + 1 < n_ch ? tp_data_line_start(d, (size_t)((double)d->size * (i + 1) / n_ch))
+                                  : d->size;
+    }
+
+    BuildJob job;
+    job.d = d;
+    job.ch = ch;
+    job.n_ch = n_ch;
+    SDL_AtomicSet(&job.next, 0);
+    run_parallel(&job, n_ch < l->nthreads ? n_ch : l->nthreads);
+
+    int rc = 0;
+    for (int i = 0; i < n_ch; i++) {
+        if (ch[i].failed) rc = -1;
+    }
+    if (rc == 0) rc = merge_chunks(l, d, ch, n_ch);
+
+    for (int i = 0; i < n_ch; i++) free(ch[i].blk);
+    free(ch);
+    return rc;
+}
+
+/* ---------- níveis de cima ---------- */
+
+static int build_levels(TP_Lod *l) {
+    size_t n = l->n_blk;
+    l->n_node[0] = n;
+    l->n_levels = 1;
+    while (n > TP_LOD_FANOUT && l->n_levels < TP_LOD_MAX_LEVELS) {
+        const int lev = l->n_levels;
+        const size_t m = (n + TP_LOD_FANOUT - 1) / TP_LOD_FANOUT;
+        double *mn = (double*)malloc(m * sizeof(double));
+        double *mx = (double*)malloc(m * sizeof(double));
+        if (!mn || !mx) { free(mn); free(mx); return -1; }
+
+        for (size_t j = 0; j < m; j++) {
+            double lo = INFINITY, hi = -INFINITY;
+            const size_t e = (j + 1) * TP_LOD_FANOUT < n ? (j + 1) * TP_LOD_FANOUT : n;
+            for (size_t k = j * TP_LOD_FANOUT; k < e; k++) {
+                const double a = lev == 1 ? l->blk[k].ymin : l->ymin[lev - 1][k];
+                const double b = lev == 1 ? l->blk[k].ymax : l->ymax[lev - 1][k];
+                if (a < lo) lo = a;
+                if (b > hi) hi = b;
+            }
+            mn[j] = lo;
+            mx[j] = hi;
+        }
+        l->ymin[lev] = mn;
+        l->ymax[lev] = mx;
+        l->n_node[lev] = m;
+        l->n_levels++;
+        n = m;
+    }
+    return 0;
+}
+
+/* ---------- sidecar ---------- */
+
+/* cabeçalho binário depois da linha mágica (máquina que gravou = que lê) */
+typedef struct LodHeader {
+    uint32_t order;            /* 0x01020304: mesma ordem de bytes */
+    uint32_t block, blk_size;  /* TP_LOD_BLOCK, sizeof(TP_LodBlock) */
+    uint32_t fmt, y_only, x_sorted, has_bounds;
+    uint64_t size;
+    int64_t mtime;
+    uint64_t n, n_blk;
+    double xmin, xmax, ymin, ymax;
+} LodHeader;
+
+static int load_sidecar(TP_Lod *l, TP_Data *d, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 1;
+
+    char magic[32];
+    LodHeader h;
+    int ok = fgets(magic, (int)sizeof(magic), f) &&
+             strncmp(magic, TP_LOD_MAGIC "\n", sizeof(TP_LOD_MAGIC)) == 0 &&
+             fread(&h, sizeof(h), 1, f) == 1 &&
+             h.order == 0x01020304u && h.block == TP_LOD_BLOCK &&
+             h.blk_size == sizeof(TP_LodBlock) && h.fmt == (uint32_t)d->fmt &&
+             h.size == (uint64_t)d->size && h.mtime == (int64_t)d->mtime &&
+             h.n_blk > 0 && h.n_blk <= h.n;
+    if (ok) {
+        l->blk = (TP_LodBlock*)malloc((size_t)h.n_blk * sizeof(TP_LodBlock));
+        ok = l->blk && fread(l->blk, sizeof(TP_LodBlock), (size_t)h.n_blk, f) == h.n_blk;
+    }
+    fclose(f);
+    if (!ok) {
+        free(l->blk);
+        l->blk = NULL;
+        return 1;
+    }
+
+    l->n_blk = (size_t)h.n_blk;
+    d->n = (size_t)h.n;
+    d->y_only = (int)h.y_only;
+    d->x_sorted = (int)h.x_sorted;
+    d->has_bounds = (int)h.has_bounds;
+    d->xmin = h.xmin; d->xmax = h.xmax;
+    d->ymin = h.ymin; d->ymax = h.ymax;
+    return 0;
+}
+
+static int save_sidecar(const TP_Lod *l, const TP_Data *d, const char *path) {
+    char tmp[1024];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) return 1;
+
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return 1;
+
+    LodHeader h;
+    memset(&h, 0, sizeof(h));
+    h.order = 0x01020304u;
+    h.block = TP_LOD_BLOCK;
+    h.blk_size = sizeof(TP_LodBlock);
+    h.fmt = (uint32_t)d->fmt;
+    h.y_only = (uint32_t)d->y_only;
+    h.x_sorted = (uint32_t)d->x_sorted;
+    h.has_bounds = (uint32_t)d->has_bounds;
+    h.size = d->size;
+    h.mtime = d->mtime;
+    h.n = d->n;
+    h.n_blk = l->n_blk;
+    h.xmin = d->xmin; h.xmax = d->xmax;
+    h.ymin = d->ymin; h.ymax = d->ymax;
+
+    int ok = fprintf(f, "%s\n", TP_LOD_MAGIC) > 0 &&
+             fwrite(&h, sizeof(h), 1, f) == 1 &&
+             fwrite(l->blk, sizeof(TP_LodBlock), l->n_blk, f) == l->n_blk;
+    if (fclose(f) != 0) ok = 0;
+
+    /* troca atômica, como o cache de expressões */
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        return 1;
+    }
+    return 0;
+}
+
+int tp_lod_open(TP_Lod *l, TP_Data *d, const char *path) {
+    tp_lod_free(l);
+
+    int rc = 1;
+    const int loaded = path && load_sidecar(l, d, path) == 0;
+    if (!loaded) {
+        rc = build_level0(l, d);
+        if (rc != 0) {
+            tp_lod_free(l);
+            return rc;
+        }
+    }
+    if (build_levels(l) != 0) {
+        tp_lod_free(l);
+        return -1;
+    }
+    if (path && !loaded && save_sidecar(l, d, path) != 0) {
+        fprintf(stderr, "Aviso: nao consegui gravar o LOD (%s)\n", path);
+    }
+    return 0;
+}
+
+/* ---------- consulta ---------- */
+
+void tp_lod_range(const TP_Lod *l, size_t k0, size_t k1, double *ymin, double *ymax) {
+    double lo = INFINITY, hi = -INFINITY;
+    size_t a = k0, b = k1;
+
+    /* pontas desalinhadas no nível atual, o miolo sobe um nível */
+    for (int lev = 0; a < b; lev++) {
+        const double *mn = lev ? l->ymin[lev] : NULL;
+        const double *mx = lev ? l->ymax[lev] : NULL;
+        const int top = (lev + 1 >= l->n_levels);
+        while (a < b && (top || a % TP_LOD_FANOUT)) {
+            const double p = mn ? mn[a] : l->blk[a].ymin, q = mx ? mx[a] : l->blk[a].ymax;
+            if (p < lo) lo = p;
+            if (q > hi) hi = q;
+            a++;
+        }
+        while (a < b && b % TP_LOD_FANOUT) {
+            b--;
+            const double p = mn ? mn[b] : l->blk[b].ymin, q = mx ? mx[b] : l->blk[b].ymax;
+            if (p < lo) lo = p;
+            if (q > hi) hi = q;
+        }
+        a /= TP_LOD_FANOUT;
+        b /= TP_LOD_FANOUT;
+    }
+    *ymin = lo;
+    *ymax = hi;
+}
+
+size_t tp_lod_find(const TP_Lod *l, size_t from, double x) {
+    size_t lo = from, hi = l->n_blk;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (l->blk[mid].x0 < x) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
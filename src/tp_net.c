@@ -0,0 +1,175 @@
+/* sockets Unix, poll, sigaction e lstat não fazem parte do C99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include "tp_net.h"
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* ---------- sockets ---------- */
+
+int tp_net_listen_unix(const char *path, int backlog, char *err, int err_sz) {
+    struct sockaddr_un a;
+    memset(&a, 0, sizeof(a));
+    a.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(a.sun_path)) {
+        snprintf(err, (size_t)err_sz, "caminho de socket longo demais: %s", path);
+        return -1;
+    }
+    strcpy(a.sun_path, path);
+
+    /* socket esquecido por uma execução anterior; arquivo comum não */
+    struct stat sb;
+    if (lstat(path, &sb) == 0 && S_ISSOCK(sb.st_mode)) unlink(path);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        snprintf(err, (size_t)err_sz, "socket falhou: %s", strerror(errno));
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr*)&a, sizeof(a)) != 0 || listen(fd, backlog) != 0) {
+        snprintf(err, (size_t)err_sz, "nao consegui escutar em %s: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int tp_net_send_all(int fd, const void *p, size_t n, int timeout_ms) {
+    const char *b = (const char*)p;
+    while (n > 0) {
+        struct pollfd pfd = { fd, POLLOUT, 0 };
+        const int pr = poll(&pfd, 1, timeout_ms);
+        if (pr < 0 && errno == EINTR) continue;
+        if (pr <= 0) return -1;
+        /* sem bloquear: o socket é bloqueante e send esperaria caber tudo */
+        const ssize_t k = send(fd, b, n, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (k < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            return -1;
+        }
+        b += k;
+        n -= (size_t)k;
+    }
+    return 0;
+}
+
+/* ---------- pool ---------- */
+
+int tp_net_pool_start(TP_NetPool *p, int fd, int q_max,
+                      SDL_ThreadFunction worker, const char *name, void *user,
+                      char *err, int err_sz)
+{
+    memset(p, 0, sizeof(*p));
+    p->fd = fd;
+    p->q_max = (q_max > 0 && q_max < TP_NET_QUEUE) ? q_max : TP_NET_QUEUE;
+
+    p->lock = SDL_CreateMutex();
+    p->conn_ready = SDL_CreateCond();
+    if (!p->lock || !p->conn_ready) {
+        snprintf(err, (size_t)err_sz, "sem memoria");
+        tp_net_pool_stop(p);
+        return 1;
+    }
+
+    /* as mesmas threads fazem a E/S: cliente lento não pode segurar todas */
+    int n = SDL_GetCPUCount();
+    if (n < TP_NET_MIN_THREADS) n = TP_NET_MIN_THREADS;
+    if (n > TP_NET_MAX_THREADS) n = TP_NET_MAX_THREADS;
+    for (int i = 0; i < n; i++) {
+        SDL_Thread *th = SDL_CreateThread(worker, name, user);
+        if (!th) break;
+        p->threads[p->nthreads++] = th;
+    }
+    if (p->nthreads == 0) {
+        snprintf(err, (size_t)err_sz, "SDL_CreateThread falhou: %s", SDL_GetError());
+        tp_net_pool_stop(p);
+        return 1;
+    }
+    return 0;
+}
+
+int tp_net_pool_next(TP_NetPool *p) {
+    SDL_LockMutex(p->lock);
+    while (p->q_count == 0 && !SDL_AtomicGet(&p->quit)) SDL_CondWait(p->conn_ready, p->lock);
+    if (SDL_AtomicGet(&p->quit)) {
+        SDL_UnlockMutex(p->lock);
+        return -1;
+    }
+    const int fd = p->queue[p->q_head];
+    p->q_head = (p->q_head + 1) % TP_NET_QUEUE;
+    p->q_count--;
+    SDL_UnlockMutex(p->lock);
+    return fd;
+}
+
+int tp_net_pool_waiting(TP_NetPool *p) {
+    SDL_LockMutex(p->lock);
+    const int n = p->q_count;
+    SDL_UnlockMutex(p->lock);
+    return n;
+}
+
+static volatile sig_atomic_t got_signal;
+
+static void on_signal(int sig) {
+    (void)sig;
+    got_signal = 1;
+}
+
+void tp_net_pool_run(TP_NetPool *p, const void *busy, size_t busy_len) {
+    struct sigaction sa, old_int, old_term;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, &old_int);
+    sigaction(SIGTERM, &sa, &old_term);
+    got_signal = 0;
+
+    while (!got_signal && !SDL_AtomicGet(&p->quit)) {
+        struct pollfd pfd = { p->fd, POLLIN, 0 };
+        if (poll(&pfd, 1, TP_NET_POLL_MS) <= 0) continue;
+        const int fd = accept(p->fd, NULL, NULL);
+        if (fd < 0) continue;
+
+        SDL_LockMutex(p->lock);
+        const int full = p->q_count == p->q_max;
+        if (!full) {
+            p->queue[(p->q_head + p->q_count) % TP_NET_QUEUE] = fd;
+            p->q_count++;
+            SDL_CondSignal(p->conn_ready);
+        }
+        SDL_UnlockMutex(p->lock);
+        if (full) {
+            /* uma tentativa, sem bloquear: cliente lento não trava o accept */
+            if (busy_len > 0) send(fd, busy, busy_len, MSG_NOSIGNAL | MSG_DONTWAIT);
+            close(fd);
+        }
+    }
+
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+}
+
+void tp_net_pool_stop(TP_NetPool *p) {
+    SDL_AtomicSet(&p->quit, 1);
+    if (p->nthreads > 0) {
+        SDL_LockMutex(p->lock);
+        SDL_CondBroadcast(p->conn_ready);
+        SDL_UnlockMutex(p->lock);
+        for (int i = 0; i < p->nthreads; i++) SDL_WaitThread(p->threads[i], NULL);
+        p->nthreads = 0;
+    }
+    for (int i = 0; i < p->q_count; i++) close(p->queue[(p->q_head + i) % TP_NET_QUEUE]);
+    p->q_count = 0;
+    if (p->conn_ready) SDL_DestroyCond(p->conn_ready);
+    if (p->lock) SDL_DestroyMutex(p->lock);
+    p->conn_ready = NULL;
+    p->lock = NULL;
+}
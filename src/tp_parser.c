@@ -1,4 +1,6 @@
 #include "tp_parser.h"
+#include "tp_sym.h"
+#include <stdlib.h>
 #include <string.h>
 
 typedef enum {
@@ -12,12 +14,12 @@ typedef enum {
 static void set_err(TP_Parser *p, const char *msg) {
     if (!p->error) {
         p->error = msg;
-        p->error_pos = p->lx.current.pos;
-        p->error_col = p->lx.current.col;
+        p->error_pos = p->lx.current->pos;
+        p->error_col = p->lx.current->col;
     }
 }
 
-static TP_Token cur(TP_Parser *p) { return p->lx.current; }
+static const TP_Token *cur(const TP_Parser *p) { return p->lx.current; }
 
 static void next(TP_Parser *p) {
     tp_lex_next(&p->lx);
@@ -30,34 +32,17 @@ static void next(TP_Parser *p) {
     }
 }
 
-static int tok_is(TP_Parser *p, TP_TokType t) { return cur(p).type == t; }
-
-static int is_command(TP_Token t, const char *name) {
-    size_t n = strlen(name);
-    return t.type == TP_TOK_COMMAND && t.len == n && strncmp(t.lexeme, name, n) == 0;
-}
-
-static int is_cmd_1char(TP_Token t, char c) {
-    return t.type == TP_TOK_COMMAND && t.len == 1 && t.lexeme[0] == c;
-}
-
-/* comandos que ignoramos (layout TeX / wrappers) */
-static int is_noop_command(TP_Token t) {
-    if (t.type != TP_TOK_COMMAND) return 0;
-    if (is_command(t, "left") || is_command(t, "right")) return 1;
-    if (is_command(t, "quad") || is_command(t, "qquad")) return 1;
-    if (is_cmd_1char(t, ';') || is_cmd_1char(t, ',') || is_cmd_1char(t, ':') || is_cmd_1char(t, '!')) return 1;
-    return 0;
-}
+static int tok_is(const TP_Parser *p, TP_TokType t) { return cur(p)->type == t; }
 
+/* comandos que ignoramos (layout TeX / wrappers); cmd já vem do lexer */
 static void skip_noops(TP_Parser *p) {
-    while (!p->error && cur(p).type == TP_TOK_COMMAND && is_noop_command(cur(p))) {
+    while (!p->error && tp_cmd_is_noop(cur(p)->cmd)) {
         next(p);
     }
 }
 
 static Prec infix_prec(TP_Parser *p) {
-    TP_TokType t = cur(p).type;
+    TP_TokType t = cur(p)->type;
 
     if (t == TP_TOK_PLUS || t == TP_TOK_MINUS) return PREC_ADD;
     if (t == TP_TOK_STAR || t == TP_TOK_SLASH) return PREC_MUL;
@@ -72,251 +57,478 @@ static Prec infix_prec(TP_Parser *p) {
     return PREC_NONE;
 }
 
-static TP_Node *parse_expr_prec(TP_Parser *p, Prec prec);
-
 static int consume(TP_Parser *p, TP_TokType t, const char *msg) {
     if (tok_is(p, t)) { next(p); return 1; }
     set_err(p, msg);
     return 0;
 }
 
-/* Forward */
-static TP_Node *parse_primary(TP_Parser *p);
+/* ---------- parser com pilha explícita ----------
 
-static TP_Node *parse_prefix(TP_Parser *p) {
-    skip_noops(p);
+   Mesma gramática do descendente recursivo (precedence climbing), mas
+   cada chamada pendente vira um frame: a profundidade de aninhamento
+   fica limitada por p->max_depth, não pela pilha de C.
 
-    if (tok_is(p, TP_TOK_MINUS)) {
-        next(p);
-        TP_Node *rhs = parse_prefix(p);
-        if (!rhs) return NULL;
-        return tp_node_unary(TP_NODE_UNARY_NEG, rhs);
-    }
-    return parse_primary(p);
-}
-
-/* Parse primary:
-   - number
-   - x | pi | e
-   - (expr) ou (a,b)
-   - {expr} ou {a,b}
-   - \frac{a}{b}
-   - \sin^{k}(x) (TeX) -> (sin(x))^k
+   expr    := prefix (op expr)*           F_EXPR
+   prefix  := '-' prefix | primary        F_NEG
+   primary := number | ident
+            | '(' expr [',' expr] ')'     F_GROUP
+            | '{' expr [',' expr] '}'     F_GROUP
+            | \frac{expr}{expr}           F_FRAC
+            | \sin[^prefix] primary       F_FUNC   (\sin^{k}(x) -> (sin(x))^k)
+            | nome '(' expr {',' expr} ')' F_CALL   (função definida)
 */
-static TP_Node *parse_group_paren(TP_Parser *p) {
-    /* já consumiu '(' */
-    skip_noops(p);
-    TP_Node *first = parse_expr_prec(p, PREC_NONE);
-    if (!first) return NULL;
-
-    skip_noops(p);
 
-    if (tok_is(p, TP_TOK_COMMA)) {
-        /* tuple */
-        next(p);
-        skip_noops(p);
-        TP_Node *second = parse_expr_prec(p, PREC_NONE);
-        if (!second) { tp_ast_free(first); return NULL; }
-        skip_noops(p);
-        if (!consume(p, TP_TOK_RPAREN, "faltou ')' apos tupla (a,b)")) {
-            tp_ast_free(first); tp_ast_free(second); return NULL;
+typedef enum {
+    F_EXPR,
+    F_NEG,
+    F_GROUP,
+    F_FRAC,
+    F_FUNC,
+    F_CALL
+} FrameKind;
+
+typedef struct Frame {
+    FrameKind kind;
+    int state;          /* 0: esperando o 1o filho; 1: o 2o */
+    Prec prec;          /* F_EXPR */
+    TP_NodeType op;     /* F_EXPR: operador pendente */
+    TP_TokType close;   /* F_GROUP: ')' ou '}' */
+    TP_Func1 f;         /* F_FUNC */
+    TP_Node *held;      /* lado esquerdo / 1o da tupla / numerador / expoente */
+    int sym, nargs;     /* F_CALL: função e argumentos já lidos */
+    TP_Node **args;
+} Frame;
+
+#define PARSE_LOCAL 64
+
+typedef struct Stack {
+    Frame *fr;
+    int sp, cap;
+    Frame local[PARSE_LOCAL];
+} Stack;
+
+static Frame *push(TP_Parser *p, Stack *s, FrameKind kind) {
+    if (s->sp >= p->max_depth) {
+        set_err(p, "expressao muito aninhada");
+        return NULL;
+    }
+    if (s->sp == s->cap) {
+        int ncap = s->cap * 2;
+        Frame *nf;
+        if (s->fr == s->local) {
+            nf = (Frame*)malloc((size_t)ncap * sizeof(Frame));
+            if (nf) memcpy(nf, s->local, sizeof(s->local));
+        } else {
+            nf = (Frame*)realloc(s->fr, (size_t)ncap * sizeof(Frame));
         }
-        return tp_node_tuple2(first, second);
+        if (!nf) { set_err(p, "sem memoria"); return NULL; }
+        s->fr = nf;
+        s->cap = ncap;
     }
-
-    if (!consume(p, TP_TOK_RPAREN, "faltou ')'")) { tp_ast_free(first); return NULL; }
-    return first;
+    Frame *f = &s->fr[s->sp++];
+    f->kind = kind;
+    f->state = 0;
+    f->held = NULL;
+    return f;
 }
 
-static TP_Node *parse_group_brace(TP_Parser *p) {
-    /* já consumiu '{' */
-    skip_noops(p);
-    TP_Node *first = parse_expr_prec(p, PREC_NONE);
-    if (!first) return NULL;
-
-    skip_noops(p);
-
-    if (tok_is(p, TP_TOK_COMMA)) {
-        next(p);
-        skip_noops(p);
-        TP_Node *second = parse_expr_prec(p, PREC_NONE);
-        if (!second) { tp_ast_free(first); return NULL; }
-        skip_noops(p);
-        if (!consume(p, TP_TOK_RBRACE, "faltou '}' apos tupla {a,b}")) {
-            tp_ast_free(first); tp_ast_free(second); return NULL;
-        }
-        return tp_node_tuple2(first, second);
+typedef enum {
+    GO_EXPR,      /* iniciar expr com precedência go_prec */
+    GO_PREFIX,
+    GO_PRIMARY,
+    GO_RETURN     /* entregar ret ao frame do topo */
+} Mode;
+
+/* índice do parâmetro nomeado (--param) ou -1 */
+static int named_param(const TP_Parser *p, const char *name, size_t len) {
+    for (int i = 0; i < p->n_params; i++) {
+        if (strlen(p->params[i]) == len && memcmp(p->params[i], name, len) == 0) return i;
     }
-
-    if (!consume(p, TP_TOK_RBRACE, "faltou '}'")) { tp_ast_free(first); return NULL; }
-    return first;
+    return -1;
 }
 
-static TP_Node *parse_primary(TP_Parser *p) {
-    skip_noops(p);
-    TP_Token t = cur(p);
-
-    if (t.type == TP_TOK_NUMBER) {
+/* number | ident: nó folha ou NULL com erro */
+static TP_Node *parse_atom(TP_Parser *p, const TP_Token *t) {
+    if (t->type == TP_TOK_NUMBER) {
+        const double v = t->number;
         next(p);
-        return tp_node_number(t.number);
+        return tp_node_number(v);
     }
 
-    if (t.type == TP_TOK_IDENT) {
-        if (t.len == 1 && t.lexeme[0] == 'x') {
+    /* parâmetro da definição em curso, depois variável definida */
+    const TP_SymTab *st = p->syms;
+    if (st && (st->n_param > 0 || st->n > 0)) {
+        const int pi = tp_sym_param(st, t->lexeme, t->len);
+        if (pi >= 0) {
             next(p);
-            return tp_node_var_x();
+            return tp_node_param(pi);
         }
-        if (t.len == 2 && strncmp(t.lexeme, "pi", 2) == 0) {
+        const int si = tp_sym_find(st, t->lexeme, t->len);
+        if (si >= 0 && st->syms[si].n_params < 0) {
             next(p);
-            return tp_node_number(3.14159265358979323846);
+            return tp_node_slot(st->syms[si].slot);
         }
-        if (t.len == 1 && t.lexeme[0] == 'e') {
-            next(p);
-            return tp_node_number(2.71828182845904523536);
+        if (si >= 0) {
+            set_err(p, "funcao usada sem argumentos");
+            return NULL;
         }
-
-        set_err(p, "identificador desconhecido (v1 suporta: x, pi, e)");
-        return NULL;
     }
 
-    if (t.type == TP_TOK_LPAREN) {
+    const int np = named_param(p, t->lexeme, t->len);
+    if (np >= 0) {
         next(p);
-        return parse_group_paren(p);
+        return tp_node_slot(np);
     }
 
-    if (t.type == TP_TOK_LBRACE) {
+    if (t->len == 1 && t->lexeme[0] == 'x') {
         next(p);
-        return parse_group_brace(p);
+        return tp_node_var_x();
+    }
+    if (t->len == 1 && t->lexeme[0] == 'y') {
+        next(p);
+        return tp_node_var_y();
+    }
+    if (t->len == 2 && strncmp(t->lexeme, "pi", 2) == 0) {
+        next(p);
+        return tp_node_number(3.14159265358979323846);
+    }
+    if (t->len == 1 && t->lexeme[0] == 'e') {
+        next(p);
+        return tp_node_number(2.71828182845904523536);
     }
 
-    if (t.type == TP_TOK_COMMAND) {
-        /* no-op commands já foram pulados, então aqui é comando real */
-        if (is_command(t, "frac")) {
-            next(p);
+    set_err(p, "identificador desconhecido (use x, y, pi, e ou defina: a = ...;)");
+    return NULL;
+}
 
-            skip_noops(p);
-            if (!consume(p, TP_TOK_LBRACE, "faltou '{' apos \\frac")) return NULL;
-            TP_Node *num = parse_expr_prec(p, PREC_NONE);
-            if (!num) return NULL;
-            skip_noops(p);
-            if (!consume(p, TP_TOK_RBRACE, "faltou '}' no numerador de \\frac")) {
-                tp_ast_free(num); return NULL;
-            }
+static int func1_of(TP_Command c, TP_Func1 *f) {
+    switch (c) {
+        case TP_CMD_SIN:  *f = TP_F_SIN;  return 1;
+        case TP_CMD_COS:  *f = TP_F_COS;  return 1;
+        case TP_CMD_TAN:  *f = TP_F_TAN;  return 1;
+        case TP_CMD_LOG:  *f = TP_F_LOG;  return 1;
+        case TP_CMD_EXP:  *f = TP_F_EXP;  return 1;
+        case TP_CMD_SQRT: *f = TP_F_SQRT; return 1;
+        default: return 0;
+    }
+}
+
+/* Início de um primary. Devolve o próximo modo; GO_RETURN com *ret
+   quando o termo é uma folha. Erros ficam em p->error. */
+static Mode start_primary(TP_Parser *p, Stack *s, TP_Node **ret) {
+    skip_noops(p);
+    const TP_Token *t = cur(p);
 
+    if (t->type == TP_TOK_IDENT && p->syms && p->syms->n > 0 &&
+        tp_sym_param(p->syms, t->lexeme, t->len) < 0) {
+        const int si = tp_sym_find(p->syms, t->lexeme, t->len);
+        if (si >= 0 && p->syms->syms[si].n_params >= 0) {
+            next(p);
             skip_noops(p);
-            if (!consume(p, TP_TOK_LBRACE, "faltou '{' no denominador de \\frac")) {
-                tp_ast_free(num); return NULL;
+            if (!tok_is(p, TP_TOK_LPAREN)) {
+                set_err(p, "funcao usada sem argumentos");
+                return GO_RETURN;
             }
-            TP_Node *den = parse_expr_prec(p, PREC_NONE);
-            if (!den) { tp_ast_free(num); return NULL; }
+            next(p);
+            Frame *f = push(p, s, F_CALL);
+            if (!f) return GO_RETURN;
+            f->sym = si;
+            f->nargs = 0;
+            f->args = (TP_Node**)malloc((size_t)p->syms->syms[si].n_params * sizeof(TP_Node*));
+            if (!f->args) set_err(p, "sem memoria");
             skip_noops(p);
-            if (!consume(p, TP_TOK_RBRACE, "faltou '}' no denominador de \\frac")) {
-                tp_ast_free(num); tp_ast_free(den); return NULL;
-            }
+            return GO_EXPR;
+        }
+    }
 
-            return tp_node_frac(num, den);
+    if (t->type == TP_TOK_NUMBER || t->type == TP_TOK_IDENT) {
+        *ret = parse_atom(p, t);
+        return GO_RETURN;
+    }
+
+    if (t->type == TP_TOK_LPAREN || t->type == TP_TOK_LBRACE) {
+        const TP_TokType close = (t->type == TP_TOK_LPAREN) ? TP_TOK_RPAREN : TP_TOK_RBRACE;
+        next(p);
+        Frame *f = push(p, s, F_GROUP);
+        if (f) f->close = close;
+        skip_noops(p);
+        return GO_EXPR;
+    }
+
+    if (t->type == TP_TOK_COMMAND) {
+        /* no-op commands já foram pulados, então aqui é comando real */
+        if (t->cmd == TP_CMD_FRAC) {
+            next(p);
+            skip_noops(p);
+            if (consume(p, TP_TOK_LBRACE, "faltou '{' apos \\frac")) push(p, s, F_FRAC);
+            return GO_EXPR;
         }
 
-        TP_Func1 f;
-        if      (is_command(t, "sin"))  f = TP_F_SIN;
-        else if (is_command(t, "cos"))  f = TP_F_COS;
-        else if (is_command(t, "tan"))  f = TP_F_TAN;
-        else if (is_command(t, "log"))  f = TP_F_LOG;
-        else if (is_command(t, "exp"))  f = TP_F_EXP;
-        else if (is_command(t, "sqrt")) f = TP_F_SQRT;
-        else {
+        TP_Func1 fn;
+        if (!func1_of(t->cmd, &fn)) {
             set_err(p, "comando \\... desconhecido (v1)");
-            return NULL;
+            return GO_RETURN;
         }
 
         next(p);
         skip_noops(p);
+        Frame *f = push(p, s, F_FUNC);
+        if (!f) return GO_RETURN;
+        f->f = fn;
 
-        /* Suporte TeX: \sin^{3}(x) => (sin(x))^3 */
-        TP_Node *exponent = NULL;
+        /* expoente pode ser {expr} ou primary simples */
         if (tok_is(p, TP_TOK_CARET)) {
             next(p);
             skip_noops(p);
-            /* expoente pode ser {expr} ou primary simples */
-            exponent = parse_prefix(p);
-            if (!exponent) { set_err(p, "faltou expoente apos '^'"); return NULL; }
-            skip_noops(p);
+            return GO_PREFIX;
         }
-
         /* argumento pode ser (...) ou {...} ou primary direto */
-        TP_Node *arg = parse_primary(p);
-        if (!arg) { set_err(p, "faltou argumento para funcao"); tp_ast_free(exponent); return NULL; }
+        f->state = 1;
+        return GO_PRIMARY;
+    }
+
+    set_err(p, "token inesperado no inicio de termo");
+    return GO_RETURN;
+}
 
-        TP_Node *fn = tp_node_func1(f, arg);
-        if (!fn) { tp_ast_free(arg); tp_ast_free(exponent); return NULL; }
+/* Lado esquerdo de F_EXPR pronto: decide se há mais um operador.
+   Devolve GO_EXPR (com *go_prec) para ler o lado direito, ou
+   GO_RETURN com o frame desempilhado. */
+static Mode expr_continue(TP_Parser *p, Stack *s, Frame *f, Prec *go_prec, TP_Node **ret) {
+    skip_noops(p);
+
+    const Prec pcur = infix_prec(p);
+    const TP_TokType op = cur(p)->type;
+
+    if (!p->error && pcur != PREC_NONE && pcur > f->prec) {
+        if (op == TP_TOK_CARET) {
+            next(p);
+            f->op = TP_NODE_POW;
+            *go_prec = (Prec)(pcur - 1); /* direita-assoc */
+            return GO_EXPR;
+        }
 
-        if (exponent) {
-            TP_Node *pow_node = tp_node_bin(TP_NODE_POW, fn, exponent);
-            if (!pow_node) { tp_ast_free(fn); tp_ast_free(exponent); return NULL; }
-            return pow_node;
+        if (tp_tok_is_primary_start(op)) {
+            f->op = TP_NODE_MUL;       /* multiplicação implícita */
+            *go_prec = PREC_MUL;
+            return GO_EXPR;
         }
 
-        return fn;
+        if (op == TP_TOK_PLUS || op == TP_TOK_MINUS ||
+            op == TP_TOK_STAR || op == TP_TOK_SLASH) {
+            next(p);
+            if (op == TP_TOK_PLUS)  f->op = TP_NODE_ADD;
+            if (op == TP_TOK_MINUS) f->op = TP_NODE_SUB;
+            if (op == TP_TOK_STAR)  f->op = TP_NODE_MUL;
+            if (op == TP_TOK_SLASH) f->op = TP_NODE_DIV;
+            *go_prec = pcur;
+            return GO_EXPR;
+        }
     }
 
-    set_err(p, "token inesperado no inicio de termo");
-    return NULL;
+    *ret = f->held;
+    s->sp--;
+    return GO_RETURN;
 }
 
-static TP_Node *parse_expr_prec(TP_Parser *p, Prec prec) {
-    TP_Node *left = parse_prefix(p);
-    if (!left) return NULL;
+/* Entrega *ret ao frame do topo. Devolve o próximo modo. */
+static Mode deliver(TP_Parser *p, Stack *s, Prec *go_prec, TP_Node **ret) {
+    Frame *f = &s->fr[s->sp - 1];
+    TP_Node *r = *ret;
+    *ret = NULL;
+
+    switch (f->kind) {
+        case F_NEG:
+            s->sp--;
+            *ret = tp_node_unary(TP_NODE_UNARY_NEG, r);
+            if (!*ret) tp_ast_free(r);
+            return GO_RETURN;
+
+        case F_EXPR:
+            if (!f->held) {
+                f->held = r;
+            } else {
+                TP_Node *n = tp_node_bin(f->op, f->held, r);
+                if (!n) { tp_ast_free(r); return GO_RETURN; }
+                f->held = n;
+            }
+            return expr_continue(p, s, f, go_prec, ret);
 
-    while (!p->error) {
-        skip_noops(p);
+        case F_GROUP: {
+            const int brace = (f->close == TP_TOK_RBRACE);
+            skip_noops(p);
 
-        Prec pcur = infix_prec(p);
-        if (pcur == PREC_NONE || pcur <= prec) break;
+            if (f->state == 0) {
+                if (tok_is(p, TP_TOK_COMMA)) {
+                    /* tupla */
+                    next(p);
+                    skip_noops(p);
+                    f->held = r;
+                    f->state = 1;
+                    *go_prec = PREC_NONE;
+                    return GO_EXPR;
+                }
+                if (!consume(p, f->close, brace ? "faltou '}'" : "faltou ')'")) {
+                    tp_ast_free(r);
+                    return GO_RETURN;
+                }
+                s->sp--;
+                *ret = r;
+                return GO_RETURN;
+            }
 
-        TP_Token op = cur(p);
+            if (!consume(p, f->close, brace ? "faltou '}' apos tupla {a,b}"
+                                            : "faltou ')' apos tupla (a,b)")) {
+                tp_ast_free(r);
+                return GO_RETURN;
+            }
+            *ret = tp_node_tuple2(f->held, r);
+            if (!*ret) { tp_ast_free(r); return GO_RETURN; }
+            s->sp--;
+            return GO_RETURN;
+        }
 
-        if (op.type == TP_TOK_CARET) {
-            next(p);
-            TP_Node *rhs = parse_expr_prec(p, (Prec)(pcur - 1)); /* direita-assoc */
-            if (!rhs) { tp_ast_free(left); return NULL; }
-            left = tp_node_bin(TP_NODE_POW, left, rhs);
-            continue;
+        case F_FRAC:
+            skip_noops(p);
+            if (f->state == 0) {
+                f->held = r;
+                if (!consume(p, TP_TOK_RBRACE, "faltou '}' no numerador de \\frac")) return GO_RETURN;
+                skip_noops(p);
+                if (!consume(p, TP_TOK_LBRACE, "faltou '{' no denominador de \\frac")) return GO_RETURN;
+                f->state = 1;
+                *go_prec = PREC_NONE;
+                return GO_EXPR;
+            }
+            if (!consume(p, TP_TOK_RBRACE, "faltou '}' no denominador de \\frac")) {
+                tp_ast_free(r);
+                return GO_RETURN;
+            }
+            *ret = tp_node_frac(f->held, r);
+            if (!*ret) { tp_ast_free(r); return GO_RETURN; }
+            s->sp--;
+            return GO_RETURN;
+
+        case F_FUNC: {
+            if (f->state == 0) {
+                f->held = r;   /* expoente */
+                skip_noops(p);
+                f->state = 1;
+                return GO_PRIMARY;
+            }
+            TP_Node *fn = tp_node_func1(f->f, r);
+            if (!fn) { tp_ast_free(r); return GO_RETURN; }
+            if (f->held) {
+                TP_Node *pw = tp_node_bin(TP_NODE_POW, fn, f->held);
+                if (!pw) { tp_ast_free(fn); return GO_RETURN; }
+                fn = pw;
+            }
+            s->sp--;
+            *ret = fn;
+            return GO_RETURN;
         }
 
-        if (tp_tok_is_primary_start(op.type)) {
-            TP_Node *rhs = parse_expr_prec(p, PREC_MUL);
-            if (!rhs) { tp_ast_free(left); return NULL; }
-            left = tp_node_bin(TP_NODE_MUL, left, rhs);
-            continue;
+        case F_CALL: {
+            const int np = p->syms->syms[f->sym].n_params;
+            f->args[f->nargs++] = r;
+            skip_noops(p);
+            if (f->nargs < np && tok_is(p, TP_TOK_COMMA)) {
+                next(p);
+                skip_noops(p);
+                *go_prec = PREC_NONE;
+                return GO_EXPR;
+            }
+            if (f->nargs < np || tok_is(p, TP_TOK_COMMA)) {
+                set_err(p, "numero errado de argumentos");
+                return GO_RETURN;
+            }
+            if (!consume(p, TP_TOK_RPAREN, "faltou ')' apos argumentos")) return GO_RETURN;
+
+            *ret = tp_sym_call(p->syms, f->sym, f->args);   /* consome os argumentos */
+            free(f->args);
+            s->sp--;
+            return GO_RETURN;
+        }
+    }
+    return GO_RETURN;
+}
+
+/* Libera o que os frames ainda seguram (erro no meio da expressão) */
+static void unwind(Stack *s) {
+    while (s->sp > 0) {
+        Frame *f = &s->fr[--s->sp];
+        tp_ast_free(f->held);
+        if (f->kind == F_CALL && f->args) {
+            for (int i = 0; i < f->nargs; i++) tp_ast_free(f->args[i]);
+            free(f->args);
         }
+    }
+}
 
-        if (op.type == TP_TOK_PLUS || op.type == TP_TOK_MINUS ||
-            op.type == TP_TOK_STAR || op.type == TP_TOK_SLASH) {
+static TP_Node *parse_expr_iter(TP_Parser *p) {
+    Stack s;
+    s.fr = s.local;
+    s.sp = 0;
+    s.cap = PARSE_LOCAL;
 
-            next(p);
-            TP_Node *rhs = parse_expr_prec(p, pcur);
-            if (!rhs) { tp_ast_free(left); return NULL; }
+    Mode mode = GO_EXPR;
+    Prec go_prec = PREC_NONE;
+    TP_Node *ret = NULL;
+
+    for (;;) {
+        if (p->error) break;
 
-            TP_NodeType nt = TP_NODE_ADD;
-            if (op.type == TP_TOK_PLUS)  nt = TP_NODE_ADD;
-            if (op.type == TP_TOK_MINUS) nt = TP_NODE_SUB;
-            if (op.type == TP_TOK_STAR)  nt = TP_NODE_MUL;
-            if (op.type == TP_TOK_SLASH) nt = TP_NODE_DIV;
+        if (mode == GO_EXPR) {
+            Frame *f = push(p, &s, F_EXPR);
+            if (f) f->prec = go_prec;
+            mode = GO_PREFIX;
+            continue;
+        }
+
+        if (mode == GO_PREFIX) {
+            skip_noops(p);
+            if (tok_is(p, TP_TOK_MINUS)) {
+                next(p);
+                push(p, &s, F_NEG);
+                continue;
+            }
+            mode = GO_PRIMARY;
+            continue;
+        }
 
-            left = tp_node_bin(nt, left, rhs);
+        if (mode == GO_PRIMARY) {
+            mode = start_primary(p, &s, &ret);
+            go_prec = PREC_NONE;   /* grupos e \frac abrem expr completa */
             continue;
         }
 
-        break;
+        /* GO_RETURN */
+        if (!ret) {
+            /* nó não alocado sem erro de sintaxe */
+            set_err(p, "sem memoria");
+            break;
+        }
+        if (s.sp == 0) break;
+        mode = deliver(p, &s, &go_prec, &ret);
     }
 
-    return left;
+    if (p->error) {
+        tp_ast_free(ret);
+        ret = NULL;
+        unwind(&s);
+    }
+    if (s.fr != s.local) free(s.fr);
+    return ret;
 }
 
 void tp_parse_init(TP_Parser *p, const char *src) {
     p->error = NULL;
     p->error_pos = 0;
     p->error_col = 1;
+    p->max_depth = TP_PARSE_MAX_DEPTH;
+    p->syms = NULL;
+    p->params = NULL;
+    p->n_params = 0;
 
     tp_lex_init(&p->lx, src);
     if (p->lx.error) {
@@ -326,13 +538,101 @@ void tp_parse_init(TP_Parser *p, const char *src) {
     }
 }
 
-TP_Node *tp_parse_expr(TP_Parser *p) {
-    TP_Node *root = parse_expr_prec(p, PREC_NONE);
+/* ---------- definições ---------- */
+
+static int is_reserved(const char *s, size_t len) {
+    return (len == 1 && (s[0] == 'x' || s[0] == 'y' || s[0] == 'e')) ||
+           (len == 2 && s[0] == 'p' && s[1] == 'i');
+}
+
+/* Instrução seguida de ';' que começa como definição ("nome =" ou
+   "nome(", fora x/y/pi/e que multiplicam). "\;" é espaço TeX, não
+   separador. O resto segue como expressão (e erra no lugar certo). */
+static int at_definition(TP_Parser *p) {
+    const TP_Token *t = cur(p);
+    if (t->type != TP_TOK_IDENT) return 0;
+
+    const char *src = p->lx.src;
+    const char *q = strchr(src + t->pos, ';');
+    while (q && q > src && q[-1] == '\\') q = strchr(q + 1, ';');
+    if (!q) return 0;
+
+    const TP_TokType n1 = tp_lex_peek(&p->lx, 1)->type;
+    return n1 == TP_TOK_EQUALS || (n1 == TP_TOK_LPAREN && !is_reserved(t->lexeme, t->len));
+}
+
+/* nome = expr ;   ou   nome(p1, ..., pk) = expr ; */
+static void parse_definition(TP_Parser *p) {
+    TP_SymTab *st = p->syms;
+    const TP_Token *t = cur(p);
+    const char *name = t->lexeme;
+    const size_t len = t->len;
+    if (is_reserved(name, len)) {
+        set_err(p, "nome reservado (x, y, pi, e)");
+        return;
+    }
+    if (tp_sym_find(st, name, len) >= 0 || named_param(p, name, len) >= 0) {
+        set_err(p, "nome ja definido");
+        return;
+    }
+    next(p);
+    skip_noops(p);
+
+    int n_params = -1;
+    if (tok_is(p, TP_TOK_LPAREN)) {
+        next(p);
+        n_params = 0;
+        for (;;) {
+            skip_noops(p);
+            t = cur(p);
+            if (t->type != TP_TOK_IDENT) { set_err(p, "faltou nome de parametro"); return; }
+            if (tp_sym_param(st, t->lexeme, t->len) >= 0) { set_err(p, "parametro repetido"); return; }
+            if (n_params == TP_SYM_MAX_PARAMS) { set_err(p, "muitos parametros (max 8)"); return; }
+            st->param[n_params] = t->lexeme;
+            st->param_len[n_params] = t->len;
+            st->n_param = ++n_params;
+            next(p);
+            skip_noops(p);
+            if (!tok_is(p, TP_TOK_COMMA)) break;
+            next(p);
+        }
+        if (!consume(p, TP_TOK_RPAREN, "faltou ')' apos parametros")) return;
+        skip_noops(p);
+    }
+    if (!consume(p, TP_TOK_EQUALS, "faltou '=' na definicao")) return;
+
+    const int mark = st->n_slots;
+    TP_Node *body = parse_expr_iter(p);
+    st->n_param = 0;
+    if (!body) return;
+
+    skip_noops(p);
+    if (body->type == TP_NODE_TUPLE2) {
+        set_err(p, "tupla so vale na expressao final");
+        tp_ast_free(body);
+        return;
+    }
+    if (!consume(p, TP_TOK_SEMI, "faltou ';' apos definicao")) {
+        tp_ast_free(body);
+        return;
+    }
+    if (tp_sym_define(st, name, len, n_params, body, mark) < 0) set_err(p, "sem memoria");
+}
+
+static TP_Node *parse_program(TP_Parser *p) {
+    skip_noops(p);
+    while (!p->error && at_definition(p)) {
+        parse_definition(p);
+        skip_noops(p);
+    }
+    if (p->error) return NULL;
+
+    TP_Node *root = parse_expr_iter(p);
     if (!root) return NULL;
 
     skip_noops(p);
 
-    if (!p->error && cur(p).type != TP_TOK_EOF) {
+    if (!p->error && cur(p)->type != TP_TOK_EOF) {
         set_err(p, "sobrou texto apos o fim da expressao");
         tp_ast_free(root);
         return NULL;
@@ -343,3 +643,25 @@ TP_Node *tp_parse_expr(TP_Parser *p) {
     }
     return root;
 }
+
+TP_Node *tp_parse_expr(TP_Parser *p) {
+    if (p->n_params > TP_PARAM_MAX) {
+        set_err(p, "muitos parametros nomeados (max 8)");
+        return NULL;
+    }
+
+    TP_SymTab syms;
+    tp_sym_init(&syms);
+    syms.n_slots = p->n_params;   /* slots 0..n_params-1: parâmetros nomeados */
+    p->syms = &syms;
+
+    TP_Node *root = parse_program(p);
+    if (root && syms.n > 0) {
+        root = tp_sym_finish(&syms, root);
+        if (!root) set_err(p, "sem memoria");
+    }
+
+    tp_sym_free(&syms);
+    p->syms = NULL;
+    return root;
+}
@@ -1,95 +1,527 @@
 #include "tp_plot.h"
 #include <math.h>
+#include <string.h>
+
+/* raio das marcas em pixels */
+#define TP_MARK_RADIUS 4
 
 static int tp_isfinite(double x) { return isfinite(x); }
 
-void tp_draw_function(SDL_Renderer *r,
+/* ---------- pipeline de pontos das curvas ----------
+   Estágios sobre um bloco SoA de até TP_PIPE_CHUNK pontos, cada um um
+   laço simples sobre os arrays:
+
+   carregar   (x, y) no mundo na ordem da curva (amostras prontas do
+              sampler, ou avaliação direta) e quebras forçadas (cut)
+   classificar  ok = desenhável; link = liga ao ponto anterior
+   projetar   afim mundo -> tela, sem arredondar
+   trechos    sequências ligadas viram uma polilinha cada (emitir)
+
+   O índice 0 repete o último ponto do bloco anterior, então um trecho
+   continua entre blocos. O bloco fica na pilha: nada é alocado por
+   frame (as amostras em si já vivem no buffer reaproveitado do sampler). */
+
+#define TP_PIPE_CHUNK 256
+
+typedef struct Pipe {
+    const TP_Out *o;
+    const TP_View *v;
+    TP_Screen s;
+
+    /* regras: y = f(x) quebra fora de [ylo, yhi] e em |dy| > jump;
+       tupla quebra em ponto não finito e em distância > jump */
+    int param;
+    int x_is_column;   /* x já é a coluna de pixel (tp_draw_function) */
+    double ylo, yhi, jump;
+
+    int n, carry;      /* pontos no bloco; 1 se o 0 veio do bloco anterior */
+    double wx[TP_PIPE_CHUNK], wy[TP_PIPE_CHUNK];
+    double sx[TP_PIPE_CHUNK], sy[TP_PIPE_CHUNK];
+    unsigned char cut[TP_PIPE_CHUNK];
+    unsigned char ok[TP_PIPE_CHUNK];
+    unsigned char link[TP_PIPE_CHUNK];
+} Pipe;
+
+static void pipe_init(Pipe *p, const TP_Out *o, const TP_View *v, TP_Screen s, int param) {
+    p->o = o;
+    p->v = v;
+    p->s = s;
+    p->param = param;
+    p->x_is_column = 0;
+    if (param) {
+        /* salto gigante em coords do mundo não é costurado */
+        p->ylo = p->yhi = 0.0;
+        p->jump = ((v->xmax - v->xmin) + (v->ymax - v->ymin)) * 0.25;
+    } else {
+        const double y_range = v->ymax - v->ymin;
+        p->ylo = v->ymin - y_range;
+        p->yhi = v->ymax + y_range;
+        p->jump = y_range * 2.0;
+    }
+    p->n = 0;
+    p->carry = 0;
+}
+
+static void pipe_classify(Pipe *p) {
+    const int b = p->carry, n = p->n;
+    const double *x = p->wx, *y = p->wy;
+    unsigned char *ok = p->ok, *link = p->link;
+
+    if (p->param) {
+        const double j2 = p->jump * p->jump;
+        for (int i = b; i < n; i++) ok[i] = tp_isfinite(x[i]) && tp_isfinite(y[i]);
+        for (int i = b > 0 ? b : 1; i < n; i++) {
+            const double dx = x[i] - x[i - 1], dy = y[i] - y[i - 1];
+            link[i] = !p->cut[i] && ok[i] && ok[i - 1] && !(dx * dx + dy * dy > j2);
+        }
+    } else {
+        /* NaN e infinito falham nas duas comparações */
+        const double lo = p->ylo, hi = p->yhi, jump = p->jump;
+        for (int i = b; i < n; i++) ok[i] = y[i] >= lo && y[i] <= hi;
+        for (int i = b > 0 ? b : 1; i < n; i++) {
+            link[i] = !p->cut[i] && ok[i] && ok[i - 1] && !(fabs(y[i] - y[i - 1]) > jump);
+        }
+    }
+    if (b == 0 && n > 0) link[0] = 0;
+}
+
+/* mesma conta de tp_world_to_screen_f, em lote */
+static void pipe_project(Pipe *p) {
+    const TP_View *v = p->v;
+    const double xmin = v->xmin, xspan = v->xmax - v->xmin;
+    const double ymin = v->ymin, yspan = v->ymax - v->ymin;
+    const double w1 = (double)(p->s.w - 1), h1 = (double)(p->s.h - 1);
+    const int b = p->carry, n = p->n;
+
+    if (p->x_is_column) memcpy(p->sx + b, p->wx + b, (size_t)(n - b) * sizeof(double));
+    else for (int i = b; i < n; i++) p->sx[i] = ((p->wx[i] - xmin) / xspan) * w1;
+    for (int i = b; i < n; i++) p->sy[i] = (1.0 - (p->wy[i] - ymin) / yspan) * h1;
+}
+
+static void pipe_emit(Pipe *p) {
+    const int n = p->n;
+    int i = 0;
+    while (i < n - 1) {
+        if (!p->link[i + 1]) { i++; continue; }
+        const int a = i;
+        while (i < n - 1 && p->link[i + 1]) i++;
+        tp_out_polyline(p->o, p->sx + a, p->sy + a, i - a + 1);
+    }
+}
+
+static void pipe_flush(Pipe *p) {
+    if (p->n <= p->carry) return;
+    pipe_classify(p);
+    pipe_project(p);
+    pipe_emit(p);
+
+    /* o último ponto abre o próximo bloco */
+    const int l = p->n - 1;
+    p->wx[0] = p->wx[l];
+    p->wy[0] = p->wy[l];
+    p->sx[0] = p->sx[l];
+    p->sy[0] = p->sy[l];
+    p->ok[0] = p->ok[l];
+    p->n = 1;
+    p->carry = 1;
+}
+
+static void pipe_point(Pipe *p, double x, double y, int cut) {
+    if (p->n == TP_PIPE_CHUNK) pipe_flush(p);
+    p->wx[p->n] = x;
+    p->wy[p->n] = y;
+    p->cut[p->n] = (unsigned char)cut;
+    p->n++;
+}
+
+void tp_draw_function(const TP_Out *o,
                       const TP_View *v, TP_Screen s,
                       const TP_Node *expr,
                       unsigned char fr, unsigned char fg, unsigned char fb)
 {
-    SDL_SetRenderDrawColor(r, fr, fg, fb, 255);
+    tp_out_color(o, fr, fg, fb);
+
+    Pipe p;
+    pipe_init(&p, o, v, s, 0);
+    p.x_is_column = 1;
+
+    for (int sx = 0; sx < s.w; sx++) {
+        double xw = 0.0, dummy = 0.0;
+        tp_screen_to_world(v, s, sx, 0, &xw, &dummy);
+        pipe_point(&p, (double)sx, tp_eval(expr, xw), 0);
+    }
+    pipe_flush(&p);
+}
+
+void tp_draw_parametric(const TP_Out *o,
+                        const TP_View *v, TP_Screen s,
+                        const TP_Node *xexpr, const TP_Node *yexpr,
+                        double tmin, double tmax, int steps,
+                        unsigned char fr, unsigned char fg, unsigned char fb)
+{
+    if (steps < 100) steps = 100;
+
+    tp_out_color(o, fr, fg, fb);
+
+    Pipe p;
+    pipe_init(&p, o, v, s, 1);
+
+    for (int i = 0; i < steps; i++) {
+        double t = tmin + (tmax - tmin) * ((double)i / (double)(steps - 1));
+        pipe_point(&p, tp_eval(xexpr, t), tp_eval(yexpr, t), 0);
+    }
+    pipe_flush(&p);
+}
+
+void tp_draw_function_samples(const TP_Out *o,
+                              const TP_View *v, TP_Screen s,
+                              const TP_Sampler *sm,
+                              unsigned char fr, unsigned char fg, unsigned char fb)
+{
+    if (!sm->valid) return;
+
+    tp_out_color(o, fr, fg, fb);
+
+    Pipe p;
+    pipe_init(&p, o, v, s, 0);
+
+    /* subamostras por curvatura entre i e i+1 (estágio final do sampler);
+       descontinuidade: o ponto seguinte não liga a i */
+    int sub = 0, cut = 0;
+    for (int i = 0; i < sm->n; i++) {
+        if (!sm->done[i]) continue;
+        pipe_point(&p, sm->xs[i], sm->ys[i], cut);
+        cut = 0;
+
+        if (i >= sm->adapted) continue;
+        cut = sm->brk[i];
+        for (int j = 0; j < sm->sub_n[i]; j++, sub++) {
+            pipe_point(&p, sm->sub_x[sub], sm->sub_y[sub], cut);
+            cut = 0;
+        }
+    }
+    pipe_flush(&p);
+}
+
+void tp_draw_parametric_samples(const TP_Out *o,
+                                const TP_View *v, TP_Screen s,
+                                const TP_Sampler *sm,
+                                unsigned char fr, unsigned char fg, unsigned char fb)
+{
+    if (!sm->valid) return;
+
+    tp_out_color(o, fr, fg, fb);
+
+    Pipe p;
+    pipe_init(&p, o, v, s, 1);
+    for (int i = 0; i < sm->n; i++) {
+        if (sm->done[i]) pipe_point(&p, sm->xs[i], sm->ys[i], 0);
+    }
+    pipe_flush(&p);
+}
+
+void tp_draw_function_dd(const TP_Out *o,
+                         const TP_ViewDD *v, TP_Screen s,
+                         const TP_Node *expr, const double *params,
+                         unsigned char fr, unsigned char fg, unsigned char fb)
+{
+    tp_out_color(o, fr, fg, fb);
 
-    const double y_range = (v->ymax - v->ymin);
+    const double y_range = v->yspan;
     const double jump_break = y_range * 2.0;
 
     int have_prev = 0;
-    int prev_sx = 0, prev_sy = 0;
-    double prev_y = 0.0;
+    double prev_sy = 0.0;
+    int prev_sx = 0;
+    double prev_oy = 0.0;
 
     for (int sx = 0; sx < s.w; sx++) {
-        double xw = 0.0, dummy = 0.0;
-        tp_screen_to_world(v, s, sx, 0, &xw, &dummy);
+        TP_DD xw;
+        tp_screen_to_world_dd(v, s, sx, 0, &xw, NULL);
 
-        double yw = tp_eval(expr, xw);
+        TP_DD yw = tp_eval_dd_p(expr, xw, params);
+        if (!tp_isfinite(yw.hi)) { have_prev = 0; continue; }
 
-        if (!tp_isfinite(yw)) { have_prev = 0; continue; }
-        if (yw < v->ymin - y_range || yw > v->ymax + y_range) { have_prev = 0; continue; }
+        /* y relativo ao canto da viewport (cabe em double) */
+        const double oy = tp_dd_to_double(tp_dd_sub(yw, v->ymin));
+        if (oy < -y_range || oy > 2.0 * y_range) { have_prev = 0; continue; }
 
-        int sy = 0;
-        tp_world_to_screen(v, s, xw, yw, NULL, &sy);
+        const double sy = (1.0 - oy / v->yspan) * (double)(s.h - 1);
 
         if (have_prev) {
-            if (fabs(yw - prev_y) > jump_break) {
+            if (fabs(oy - prev_oy) > jump_break) {
                 have_prev = 0;
             } else {
-                SDL_RenderDrawLine(r, prev_sx, prev_sy, sx, sy);
+                tp_out_line(o, prev_sx, prev_sy, sx, sy);
             }
         }
 
         have_prev = 1;
         prev_sx = sx;
         prev_sy = sy;
-        prev_y = yw;
+        prev_oy = oy;
     }
 }
 
-void tp_draw_parametric(SDL_Renderer *r,
-                        const TP_View *v, TP_Screen s,
-                        const TP_Node *xexpr, const TP_Node *yexpr,
-                        double tmin, double tmax, int steps,
-                        unsigned char fr, unsigned char fg, unsigned char fb)
+/* pontos mais longe que isso (em larguras/alturas da viewport) quebram a
+   linha: lround em tp_world_to_screen não pode estourar int */
+#define TP_DATA_FAR 1e6
+
+/* ponto que tp_world_to_screen projeta sem estourar int */
+static int data_near(const TP_View *v, double x, double y) {
+    const double xr = (v->xmax - v->xmin) * TP_DATA_FAR;
+    const double yr = (v->ymax - v->ymin) * TP_DATA_FAR;
+    return tp_isfinite(x) && tp_isfinite(y) &&
+           x >= v->xmin - xr && x <= v->xmax + xr &&
+           y >= v->ymin - yr && y <= v->ymax + yr;
+}
+
+/* polilinha que quebra em ponto não desenhável; segmento dentro do
+   mesmo pixel não é emitido (a linha segue do último ponto emitido) */
+typedef struct LinePen {
+    const TP_Out *o;
+    const TP_View *v;
+    TP_Screen s;
+    int have_prev;
+    int prev_sx, prev_sy;
+    double prev_fx, prev_fy;
+} LinePen;
+
+static void line_point(LinePen *p, double xw, double yw) {
+    if (!data_near(p->v, xw, yw)) {
+        p->have_prev = 0;
+        return;
+    }
+    double fx, fy;
+    tp_world_to_screen_f(p->v, p->s, xw, yw, &fx, &fy);
+    const int sx = (int)lround(fx), sy = (int)lround(fy);
+    if (!p->have_prev) {
+        tp_out_point(p->o, fx, fy);
+    } else if (sx != p->prev_sx || sy != p->prev_sy) {
+        tp_out_line(p->o, p->prev_fx, p->prev_fy, fx, fy);
+    } else {
+        return;
+    }
+    p->have_prev = 1;
+    p->prev_sx = sx;
+    p->prev_sy = sy;
+    p->prev_fx = fx;
+    p->prev_fy = fy;
+}
+
+/* ponto a ponto a partir do cursor */
+static void draw_points(const TP_Out *o, const TP_View *v, TP_Screen s,
+                        const TP_Data *d, TP_DataCursor *c)
 {
-    if (steps < 100) steps = 100;
+    LinePen p;
+    memset(&p, 0, sizeof(p));
+    p.o = o;
+    p.v = v;
+    p.s = s;
+    double xw, yw;
+    while (tp_data_next(c, &xw, &yw)) {
+        line_point(&p, xw, yw);
 
-    SDL_SetRenderDrawColor(r, fr, fg, fb, 255);
+        /* x ordenado: passou da borda direita, acabou */
+        if (d->x_sorted && xw > v->xmax) break;
+    }
+}
 
-    int have_prev = 0;
-    int prev_sx = 0, prev_sy = 0;
-    double prev_x = 0.0, prev_y = 0.0;
+/* M4: por coluna de pixels basta primeiro, último, mínimo e máximo.
+   O segmento vertical min..max cobre as linhas entre pontos da mesma
+   coluna; a ligação último -> primeiro entre colunas é a linha que o
+   desenho ponto a ponto faria. */
+typedef struct M4Pen {
+    const TP_Out *o;
+    const TP_View *v;
+    TP_Screen s;
+    int col, has_col;
+    double mn, mx;          /* y no mundo */
+    int last_ok;            /* último ponto desenhável (senão quebra) */
+    int last_sx, last_sy;
+} M4Pen;
 
-    for (int i = 0; i < steps; i++) {
-        double t = tmin + (tmax - tmin) * ((double)i / (double)(steps - 1));
+static int m4_column(const M4Pen *m, double x) {
+    int sx;
+    tp_world_to_screen(m->v, m->s, x, m->v->ymin, &sx, NULL);
+    return sx;
+}
 
-        double xw = tp_eval(xexpr, t);
-        double yw = tp_eval(yexpr, t);
+static void m4_flush(M4Pen *m) {
+    if (!m->has_col || !(m->mn <= m->mx)) return;
+    const double yr = (m->v->ymax - m->v->ymin) * TP_DATA_FAR;
+    int sy0, sy1;
+    tp_world_to_screen(m->v, m->s, m->v->xmin, fmax(m->mn, m->v->ymin - yr), NULL, &sy0);
+    tp_world_to_screen(m->v, m->s, m->v->xmin, fmin(m->mx, m->v->ymax + yr), NULL, &sy1);
+    tp_out_line(m->o, m->col, sy0, m->col, sy1);
+}
 
-        if (!tp_isfinite(xw) || !tp_isfinite(yw)) {
-            have_prev = 0;
-            continue;
+/* trecho todo na coluna col: de (x0,y0) a (x1,y1), com y em [mn, mx] */
+static void m4_item(M4Pen *m, int col, double x0, double y0, double x1, double y1,
+                    double mn, double mx) {
+    if (!m->has_col || col != m->col) {
+        m4_flush(m);
+        if (m->last_ok && data_near(m->v, x0, y0)) {
+            int sx, sy;
+            tp_world_to_screen(m->v, m->s, x0, y0, &sx, &sy);
+            tp_out_line(m->o, m->last_sx, m->last_sy, sx, sy);
         }
+        m->col = col;
+        m->has_col = 1;
+        m->mn = INFINITY;
+        m->mx = -INFINITY;
+    }
+    if (mn < m->mn) m->mn = mn;
+    if (mx > m->mx) m->mx = mx;
 
-        int sx, sy;
-        tp_world_to_screen(v, s, xw, yw, &sx, &sy);
+    m->last_ok = data_near(m->v, x1, y1);
+    if (m->last_ok) tp_world_to_screen(m->v, m->s, x1, y1, &m->last_sx, &m->last_sy);
+}
 
-        if (have_prev) {
-            /* quebra se der um salto gigante em coords do mundo (evita "costurar" o desenho) */
-            double dx = xw - prev_x;
-            double dy = yw - prev_y;
-            double dist2 = dx*dx + dy*dy;
-            double range = (v->xmax - v->xmin) + (v->ymax - v->ymin);
-            double max_jump = range * 0.25;
-            if (dist2 > max_jump * max_jump) {
-                have_prev = 0;
+static void m4_point(M4Pen *m, double x, double y) {
+    if (!data_near(m->v, x, y)) {
+        m->last_ok = 0;
+        return;
+    }
+    m4_item(m, m4_column(m, x), x, y, x, y, y, y);
+}
+
+size_t tp_draw_data(const TP_Out *o,
+                    const TP_View *v, TP_Screen s,
+                    const TP_Data *d, const TP_Lod *lod,
+                    unsigned char fr, unsigned char fg, unsigned char fb)
+{
+    tp_out_color(o, fr, fg, fb);
+
+    TP_DataCursor c;
+    if (!lod || lod->n_blk == 0 || !d->x_sorted) {
+        tp_data_cursor(d, &c);
+        tp_data_seek(&c, v->xmin);
+        draw_points(o, v, s, d, &c);
+        return 0;
+    }
+
+    /* blocos visíveis: do que cruza a borda esquerda ao primeiro além da direita */
+    const size_t n = lod->n_blk;
+    const double dx = (v->xmax - v->xmin) / (double)(s.w > 1 ? s.w - 1 : 1);
+    size_t kb = tp_lod_find(lod, 0, v->xmin - 0.5 * dx);
+    if (kb > 0) kb--;
+    const size_t ke = tp_lod_find(lod, kb, v->xmax + 0.5 * dx);
+
+    /* menos de um bloco por coluna: ponto a ponto desde o bloco da borda */
+    const size_t i_end = ke < n ? lod->blk[ke].i0 : d->n;
+    if (i_end - lod->blk[kb].i0 < (size_t)s.w * TP_LOD_BLOCK) {
+        tp_data_cursor_at(d, &c, lod->blk[kb].pos, d->size, lod->blk[kb].i0);
+        draw_points(o, v, s, d, &c);
+        return ke - kb;
+    }
+
+    M4Pen m;
+    memset(&m, 0, sizeof(m));
+    m.o = o;
+    m.v = v;
+    m.s = s;
+
+    /* Por coluna: o bloco que começa nela e os seguintes que terminam
+       nela entram de uma vez, min/max pelos níveis de cima
+       (tp_lod_range). O que cruza borda de coluna (no máximo um por
+       borda) é lido ponto a ponto. */
+    size_t steps = 0;
+    size_t k = kb;
+    while (k < ke) {
+        const TP_LodBlock *b = &lod->blk[k];
+        steps++;
+        if (data_near(v, b->x0, v->ymin) && data_near(v, b->x1, v->ymin)) {
+            const int col = m4_column(&m, b->x0);
+            if (col == m4_column(&m, b->x1)) {
+                size_t e = tp_lod_find(lod, k + 1, v->xmin + ((double)col + 0.5) * dx);
+                if (e > ke) e = ke;
+                while (e > k + 1 && m4_column(&m, lod->blk[e - 1].x1) != col) e--;
+                double mn, mx;
+                tp_lod_range(lod, k, e, &mn, &mx);
+                m4_item(&m, col, b->x0, b->y0, lod->blk[e - 1].x1, lod->blk[e - 1].y1, mn, mx);
+                k = e;
+                continue;
+            }
+        }
+        const size_t cnt = (k + 1 < n ? lod->blk[k + 1].i0 : d->n) - b->i0;
+        tp_data_cursor_at(d, &c, b->pos, d->size, b->i0);
+        double xw, yw;
+        for (size_t i = 0; i < cnt && tp_data_next(&c, &xw, &yw); i++) m4_point(&m, xw, yw);
+        k++;
+    }
+
+    /* sai pela borda direita: primeiro ponto além dela */
+    if (ke < n) {
+        double xw, yw;
+        tp_data_cursor_at(d, &c, lod->blk[ke].pos, d->size, lod->blk[ke].i0);
+        if (tp_data_next(&c, &xw, &yw)) m4_point(&m, xw, yw);
+    }
+    m4_flush(&m);
+    return steps;
+}
+
+void tp_draw_stream(const TP_Out *o,
+                    const TP_View *v, TP_Screen s,
+                    const TP_StreamWin *w,
+                    unsigned char fr, unsigned char fg, unsigned char fb)
+{
+    tp_out_color(o, fr, fg, fb);
+
+    unsigned long long j0;
+    const int nb = tp_stream_win_bins(w, &j0);
+
+    LinePen p;
+    memset(&p, 0, sizeof(p));
+    p.o = o;
+    p.v = v;
+    p.s = s;
+
+    /* balde: primeiro, extremos na ordem de chegada, último */
+    for (int i = 0; i < nb; i++) {
+        const TP_StreamBin *b = &w->bin[(j0 + (unsigned long long)i) % (unsigned long long)w->n_bin];
+        line_point(&p, b->x0, b->y0);
+        if (w->k > 1 && b->lo_y <= b->hi_y) {
+            if (b->lo_first) {
+                line_point(&p, b->lo_x, b->lo_y);
+                line_point(&p, b->hi_x, b->hi_y);
             } else {
-                SDL_RenderDrawLine(r, prev_sx, prev_sy, sx, sy);
+                line_point(&p, b->hi_x, b->hi_y);
+                line_point(&p, b->lo_x, b->lo_y);
             }
+            line_point(&p, b->x1, b->y1);
         }
+    }
+}
 
-        have_prev = 1;
-        prev_sx = sx;
-        prev_sy = sy;
-        prev_x = xw;
-        prev_y = yw;
+void tp_draw_features(const TP_Out *o,
+                      const TP_View *v, TP_Screen s,
+                      const TP_Analysis *a,
+                      unsigned char fr, unsigned char fg, unsigned char fb)
+{
+    tp_out_color(o, fr, fg, fb);
+
+    const double k = TP_MARK_RADIUS;
+    for (int i = 0; i < a->n; i++) {
+        const TP_Feature *m = &a->feat[i];
+        if (m->x < v->xmin || m->x > v->xmax || m->y < v->ymin || m->y > v->ymax) continue;
+
+        double sx, sy;
+        tp_world_to_screen_f(v, s, m->x, m->y, &sx, &sy);
+
+        if (m->kind == TP_FEAT_ROOT) {
+            tp_out_line(o, sx, sy - k, sx + k, sy);
+            tp_out_line(o, sx + k, sy, sx, sy + k);
+            tp_out_line(o, sx, sy + k, sx - k, sy);
+            tp_out_line(o, sx - k, sy, sx, sy - k);
+        } else if (m->kind == TP_FEAT_CROSS) {
+            tp_out_line(o, sx - k, sy - k, sx + k, sy + k);
+            tp_out_line(o, sx - k, sy + k, sx + k, sy - k);
+        } else {
+            const double dir = (m->kind == TP_FEAT_MAX) ? -1.0 : 1.0;
+            tp_out_line(o, sx, sy + dir * k, sx + k, sy - dir * k);
+            tp_out_line(o, sx + k, sy - dir * k, sx - k, sy - dir * k);
+            tp_out_line(o, sx - k, sy - dir * k, sx, sy + dir * k);
+        }
     }
 }
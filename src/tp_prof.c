@@ -0,0 +1,139 @@
+#include "tp_prof.h"
+#include <stdio.h>
+
+static const char *stage_names[TP_STAGE_COUNT] = {
+    "parse", "sample", "raster", "present", "screenshot", "frame"
+};
+
+const char *tp_prof_stage_name(TP_ProfStage st) {
+    if ((int)st < 0 || st >= TP_STAGE_COUNT) return "?";
+    return stage_names[st];
+}
+
+#ifdef TP_PROFILE
+
+/* peso da média móvel exponencial por frame */
+#define TP_PROF_EMA 0.1
+
+static SDL_SpinLock prof_lock;
+
+static Uint64 frame_ticks[TP_STAGE_COUNT];   /* acumulado no frame corrente */
+static double avg_ms[TP_STAGE_COUNT];
+
+static FILE *trace_file;
+static Uint64 trace_t0;
+static int trace_events;
+
+void tp_prof_record(TP_ProfStage st, Uint64 t0, Uint64 t1) {
+    if ((int)st < 0 || st >= TP_STAGE_COUNT) return;
+
+    SDL_AtomicLock(&prof_lock);
+    frame_ticks[st] += t1 - t0;
+
+    if (trace_file) {
+        const double us = 1e6 / (double)SDL_GetPerformanceFrequency();
+        fprintf(trace_file,
+                "%s\n{\"name\":\"%s\",\"cat\":\"tatuplot\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%lu}",
+                trace_events ? "," : "", stage_names[st],
+                (double)(t0 - trace_t0) * us, (double)(t1 - t0) * us,
+                (unsigned long)SDL_ThreadID());
+        trace_events++;
+    }
+    SDL_AtomicUnlock(&prof_lock);
+}
+
+void tp_prof_frame_end(void) {
+    const double ms = 1000.0 / (double)SDL_GetPerformanceFrequency();
+
+    SDL_AtomicLock(&prof_lock);
+    for (int i = 0; i < TP_STAGE_COUNT; i++) {
+        if (i == TP_STAGE_PARSE) continue;   /* só acontece no início */
+        avg_ms[i] += ((double)frame_ticks[i] * ms - avg_ms[i]) * TP_PROF_EMA;
+        frame_ticks[i] = 0;
+    }
+    SDL_AtomicUnlock(&prof_lock);
+}
+
+double tp_prof_stage_ms(TP_ProfStage st) {
+    if ((int)st < 0 || st >= TP_STAGE_COUNT) return 0.0;
+
+    /* workers (heatmap, análise) gravam em tp_prof_record ao mesmo tempo */
+    SDL_AtomicLock(&prof_lock);
+    const double ms = st == TP_STAGE_PARSE
+        ? (double)frame_ticks[st] * 1000.0 / (double)SDL_GetPerformanceFrequency()
+        : avg_ms[st];
+    SDL_AtomicUnlock(&prof_lock);
+    return ms;
+}
+
+int tp_prof_trace_open(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) return 1;
+
+    SDL_AtomicLock(&prof_lock);
+    trace_file = f;
+    trace_t0 = SDL_GetPerformanceCounter();
+    trace_events = 0;
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    SDL_AtomicUnlock(&prof_lock);
+    return 0;
+}
+
+void tp_prof_trace_close(void) {
+    SDL_AtomicLock(&prof_lock);
+    if (trace_file) {
+        fprintf(trace_file, "\n]}\n");
+        fclose(trace_file);
+        trace_file = NULL;
+    }
+    SDL_AtomicUnlock(&prof_lock);
+}
+
+void tp_prof_draw_overlay(SDL_Renderer *r, TP_Screen s) {
+    static const unsigned char colors[TP_STAGE_COUNT][3] = {
+        { 200, 200, 200 },  /* parse */
+        { 240, 160,  40 },  /* sample */
+        {  60, 160, 240 },  /* raster */
+        { 200,  80, 200 },  /* present */
+        { 240,  60,  60 },  /* screenshot */
+        { 120, 120, 120 }   /* frame */
+    };
+    const double frame_ms = 1000.0 / 60.0;
+    const int x0 = 8, y0 = 8, bar_h = 6, gap = 3;
+    int full_w = s.w / 3;
+    if (full_w < 60) full_w = 60;
+
+    SDL_SetRenderDrawBlendMode(r, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(r, 0, 0, 0, 160);
+    SDL_Rect bg = { x0 - 4, y0 - 4, full_w + 8, (bar_h + gap) * (TP_STAGE_COUNT - 1) + 8 };
+    SDL_RenderFillRect(r, &bg);
+    SDL_SetRenderDrawBlendMode(r, SDL_BLENDMODE_NONE);
+
+    /* uma barra por estágio (sem parse), largura total = 16.7 ms */
+    int row = 0;
+    for (int i = TP_STAGE_SAMPLE; i < TP_STAGE_COUNT; i++, row++) {
+        double ms = tp_prof_stage_ms((TP_ProfStage)i);
+        int bw = (int)(ms / frame_ms * (double)full_w);
+        if (bw > full_w) bw = full_w;
+        if (bw < 1 && ms > 0.0) bw = 1;
+
+        SDL_Rect bar = { x0, y0 + row * (bar_h + gap), bw, bar_h };
+        SDL_SetRenderDrawColor(r, colors[i][0], colors[i][1], colors[i][2], 255);
+        SDL_RenderFillRect(r, &bar);
+    }
+
+    /* marca de 60 Hz */
+    SDL_SetRenderDrawColor(r, 255, 255, 255, 255);
+    SDL_RenderDrawLine(r, x0 + full_w, y0 - 2, x0 + full_w, y0 + row * (bar_h + gap));
+}
+
+#else /* !TP_PROFILE */
+
+void tp_prof_record(TP_ProfStage st, Uint64 t0, Uint64 t1) { (void)st; (void)t0; (void)t1; }
+void tp_prof_frame_end(void) {}
+double tp_prof_stage_ms(TP_ProfStage st) { (void)st; return 0.0; }
+int tp_prof_trace_open(const char *path) { (void)path; return 2; }
+void tp_prof_trace_close(void) {}
+void tp_prof_draw_overlay(SDL_Renderer *r, TP_Screen s) { (void)r; (void)s; }
+
+#endif
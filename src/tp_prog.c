@@ -0,0 +1,900 @@
+#include "tp_prog.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------- compilação (AST -> SSA -> registradores) ---------- */
+
+typedef struct Builder {
+    TP_Instr *code;
+    int n, cap;
+    int out;      /* registrador SSA do resultado */
+    int failed;
+
+    /* numeração de valores: instrução igual (op, a, b, k) já emitida é
+       reaproveitada. Tabela aberta de índices em code (-1 = vazio) */
+    int *vn;
+    int vn_cap;
+
+    int joint;    /* programa de tupla: sincos e recorrência de Chebyshev */
+} Builder;
+
+static unsigned long instr_hash(TP_OpCode op, int a, int bb, double k) {
+    unsigned char kb[sizeof(double)];
+    unsigned long h = 2166136261u;
+    memcpy(kb, &k, sizeof(kb));
+    h = (h ^ (unsigned)op) * 16777619u;
+    h = (h ^ (unsigned)a) * 16777619u;
+    h = (h ^ (unsigned)bb) * 16777619u;
+    for (size_t i = 0; i < sizeof(kb); i++) h = (h ^ kb[i]) * 16777619u;
+    return h;
+}
+
+static int same_instr(const TP_Instr *in, TP_OpCode op, int a, int bb, double k) {
+    /* k por bits: 0.0 e -0.0 são constantes diferentes */
+    return in->op == op && in->a == a && in->b == bb && memcmp(&in->k, &k, sizeof(k)) == 0;
+}
+
+/* slot da instrução (op, a, b, k) na tabela: achada ou vazio */
+static int *vn_slot(const Builder *b, TP_OpCode op, int a, int bb, double k) {
+    const unsigned long mask = (unsigned long)b->vn_cap - 1;
+    unsigned long h = instr_hash(op, a, bb, k) & mask;
+    while (b->vn[h] >= 0 && !same_instr(&b->code[b->vn[h]], op, a, bb, k)) h = (h + 1) & mask;
+    return &b->vn[h];
+}
+
+/* tabela com folga de 2x sobre o código */
+static int vn_grow(Builder *b) {
+    const int ncap = b->vn_cap ? b->vn_cap * 2 : 64;
+    int *nv = (int*)malloc((size_t)ncap * sizeof(int));
+    if (!nv) return 0;
+    for (int i = 0; i < ncap; i++) nv[i] = -1;
+    free(b->vn);
+    b->vn = nv;
+    b->vn_cap = ncap;
+    for (int i = 0; i < b->n; i++) {
+        const TP_Instr *in = &b->code[i];
+        *vn_slot(b, in->op, in->a, in->b, in->k) = i;
+    }
+    return 1;
+}
+
+static int emit(Builder *b, TP_OpCode op, int a, int bb, double k) {
+    if (b->failed) return -1;
+    if (2 * (b->n + 1) > b->vn_cap && !vn_grow(b)) { b->failed = 1; return -1; }
+    int *slot = vn_slot(b, op, a, bb, k);
+    if (*slot >= 0) return *slot;
+
+    if (b->n == b->cap) {
+        int ncap = b->cap ? b->cap * 2 : 32;
+        TP_Instr *nc = (TP_Instr*)realloc(b->code, (size_t)ncap * sizeof(TP_Instr));
+        if (!nc) { b->failed = 1; return -1; }
+        b->code = nc;
+        b->cap = ncap;
+    }
+    TP_Instr *in = &b->code[b->n];
+    in->op = op;
+    in->dst = b->n;   /* SSA: registrador virtual = índice da instrução */
+    in->a = a;
+    in->b = bb;
+    in->k = k;
+    *slot = b->n;
+    return b->n++;
+}
+
+/* maior k de cos(k r)/sin(k r) montado pela recorrência: cada passo são
+   duas instruções no lote, e acima disso um sincos direto de k r (também
+   compartilhado por sin e cos) sai mais barato */
+#define TP_PROG_CHEB_MAX 4
+
+/* sin/cos no programa de tupla: os dois saem juntos (SINCOS seguido do
+   COS do mesmo argumento); o que ficar sem uso some no DCE */
+static int emit_sincos(Builder *b, int r, int want_cos) {
+    const int s = emit(b, TP_OP_SINCOS, r, -1, 0.0);
+    const int c = emit(b, TP_OP_COS, r, -1, 0.0);
+    return want_cos ? c : s;
+}
+
+/* argumento k*r com k inteiro em 2..TP_PROG_CHEB_MAX: r (e k), ou -1 */
+static int int_multiple(const Builder *b, int reg, int *k) {
+    const TP_Instr *in = &b->code[reg];
+    if (in->op != TP_OP_MUL) return -1;
+    for (int side = 0; side < 2; side++) {
+        const TP_Instr *c = &b->code[side ? in->b : in->a];
+        if (c->op == TP_OP_CONST && c->k == floor(c->k) && c->k >= 2.0 && c->k <= TP_PROG_CHEB_MAX) {
+            *k = (int)c->k;
+            return side ? in->a : in->b;
+        }
+    }
+    return -1;
+}
+
+/* sin/cos(k r) pela recorrência de Chebyshev a partir de sin(r) e
+   cos(r): T_j = 2 cos(r) T_{j-1} - T_{j-2}. Os passos passam pela
+   numeração de valores, então cos(2t), cos(3t)... dividem a cadeia. */
+static int emit_trig(Builder *b, int r, int want_cos) {
+    int k = 1;
+    const int base = int_multiple(b, r, &k);
+    if (base < 0) return emit_sincos(b, r, want_cos);
+
+    const int c1 = emit_sincos(b, base, 1);
+    const int two_c = emit(b, TP_OP_MUL, emit(b, TP_OP_CONST, -1, -1, 2.0), c1, 0.0);
+    int p0 = want_cos ? emit(b, TP_OP_CONST, -1, -1, 1.0) : -1;   /* sin(0) = 0 */
+    int p1 = want_cos ? c1 : emit_sincos(b, base, 0);
+    for (int j = 2; j <= k && !b->failed; j++) {
+        int t = emit(b, TP_OP_MUL, two_c, p1, 0.0);
+        if (p0 >= 0) t = emit(b, TP_OP_SUB, t, p0, 0.0);
+        p0 = p1;
+        p1 = t;
+    }
+    return p1;
+}
+
+static TP_OpCode func1_op(TP_Func1 f) {
+    switch (f) {
+        case TP_F_SIN:  return TP_OP_SIN;
+        case TP_F_COS:  return TP_OP_COS;
+        case TP_F_TAN:  return TP_OP_TAN;
+        case TP_F_LOG:  return TP_OP_LOG;
+        case TP_F_EXP:  return TP_OP_EXP;
+        case TP_F_SQRT: return TP_OP_SQRT;
+        default:        return TP_OP_SQRT;
+    }
+}
+
+static TP_OpCode node_op(const TP_Node *n) {
+    switch (n->type) {
+        case TP_NODE_UNARY_NEG: return TP_OP_NEG;
+        case TP_NODE_ADD:       return TP_OP_ADD;
+        case TP_NODE_SUB:       return TP_OP_SUB;
+        case TP_NODE_MUL:       return TP_OP_MUL;
+        case TP_NODE_POW:       return TP_OP_POW;
+        case TP_NODE_FUNC1:     return func1_op(n->as.func1.f);
+        default:                return TP_OP_DIV;   /* DIV e FRAC */
+    }
+}
+
+/* valor já compilado: registrador SSA ou constante ainda não emitida */
+typedef struct Val {
+    int reg;
+    int is_const;
+    double k;
+} Val;
+
+/* constantes só viram instrução quando um operando não-constante as usa */
+static int materialize(Builder *b, Val v) {
+    return v.is_const ? emit(b, TP_OP_CONST, -1, -1, v.k) : v.reg;
+}
+
+/* valor ligado a um slot (LET); bound = 0 enquanto o LET não passou */
+typedef struct SlotVal {
+    Val v;
+    int bound;
+} SlotVal;
+
+static int bind_slot(SlotVal **sv, int *n_sv, int slot, Val v) {
+    if (slot >= *n_sv) {
+        int n = *n_sv ? *n_sv : 16;
+        while (n <= slot) n *= 2;
+        SlotVal *ns = (SlotVal*)realloc(*sv, (size_t)n * sizeof(SlotVal));
+        if (!ns) return 0;
+        memset(ns + *n_sv, 0, (size_t)(n - *n_sv) * sizeof(SlotVal));
+        *sv = ns;
+        *n_sv = n;
+    }
+    (*sv)[slot].v = v;
+    (*sv)[slot].bound = 1;
+    return 1;
+}
+
+/* Pós-ordem iterativa com pilha de valores. Subárvores constantes são
+   dobradas na subida (mesma aritmética de tp_eval). LET não gera código:
+   o valor fica no registrador (ou constante) e cada SLOT reusa o mesmo. */
+static void compile_tree(Builder *b, const TP_Node *root) {
+    Val local[TP_WALK_LOCAL];
+    Val *vs = local;
+    int vsp = 0, vcap = TP_WALK_LOCAL;
+    SlotVal *sv = NULL;
+    int n_sv = 0;
+
+    TP_AstWalk w;
+    tp_ast_walk_init(&w, root);
+    const TP_Node *n;
+    while (!b->failed && (n = tp_ast_walk_next(&w)) != NULL) {
+        const int nc = tp_ast_nchildren(n);
+        vsp -= nc;
+        const Val *a = vs + vsp;
+        Val r = { -1, 0, 0.0 };
+
+        switch (n->type) {
+            case TP_NODE_NUMBER:
+                r.is_const = 1;
+                r.k = n->as.number;
+                break;
+
+            case TP_NODE_VAR_X: r.reg = emit(b, TP_OP_X, -1, -1, 0.0); break;
+            case TP_NODE_VAR_Y: r.reg = emit(b, TP_OP_Y, -1, -1, 0.0); break;
+
+            case TP_NODE_LET:
+                r = a[1];
+                break;
+
+            case TP_NODE_SLOT:
+                if (n->as.slot < n_sv && sv[n->as.slot].bound) r = sv[n->as.slot].v;
+                else if (n->as.slot < TP_PARAM_MAX) r.reg = emit(b, TP_OP_PARAM, n->as.slot, -1, 0.0);
+                else b->failed = 1;
+                break;
+
+            case TP_NODE_TUPLE2:
+            case TP_NODE_PARAM:
+                b->failed = 1;
+                break;
+
+            default: {
+                int all_const = 1;
+                double k[2] = { 0.0, 0.0 };
+                for (int i = 0; i < nc; i++) {
+                    all_const &= a[i].is_const;
+                    k[i] = a[i].k;
+                }
+
+                if (all_const) {
+                    r.is_const = 1;
+                    r.k = tp_ast_apply(n, k, 0.0, NAN);
+                } else if (n->type == TP_NODE_POW && a[1].is_const &&
+                           a[1].k == floor(a[1].k) && fabs(a[1].k) <= 64.0) {
+                    r.reg = emit(b, TP_OP_POWI, materialize(b, a[0]), -1, a[1].k);
+                } else if (b->joint && n->type == TP_NODE_FUNC1 &&
+                           (n->as.func1.f == TP_F_SIN || n->as.func1.f == TP_F_COS)) {
+                    const int ra = materialize(b, a[0]);
+                    r.reg = ra < 0 ? -1 : emit_trig(b, ra, n->as.func1.f == TP_F_COS);
+                } else {
+                    int ra = materialize(b, a[0]);
+                    int rb = nc == 2 ? materialize(b, a[1]) : -1;
+                    r.reg = emit(b, node_op(n), ra, rb, 0.0);
+                }
+                break;
+            }
+        }
+
+        if (vsp == vcap) {
+            Val *nv = (Val*)malloc((size_t)vcap * 2 * sizeof(Val));
+            if (!nv) { b->failed = 1; break; }
+            memcpy(nv, vs, (size_t)vsp * sizeof(Val));
+            if (vs != local) free(vs);
+            vs = nv;
+            vcap *= 2;
+        }
+        vs[vsp++] = r;
+
+        /* acabou o valor de um LET: liga o slot antes de descer no corpo */
+        if (w.sp > 0 && w.st[w.sp - 1].n->type == TP_NODE_LET && w.st[w.sp - 1].next == 1 &&
+            !bind_slot(&sv, &n_sv, w.st[w.sp - 1].n->as.let.slot, r))
+            b->failed = 1;
+    }
+
+    if (w.failed || vsp != 1) b->failed = 1;
+    else b->out = materialize(b, vs[0]);   /* constante: expressão constante */
+
+    free(sv);
+    if (vs != local) free(vs);
+    tp_ast_walk_free(&w);
+}
+
+static int op_arity(TP_OpCode op) {
+    switch (op) {
+        case TP_OP_CONST:
+        case TP_OP_X:
+        case TP_OP_Y:
+        case TP_OP_PARAM:
+            return 0;
+        case TP_OP_ADD:
+        case TP_OP_SUB:
+        case TP_OP_MUL:
+        case TP_OP_DIV:
+        case TP_OP_POW:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+/* Reaproveita registradores após o último uso (linear scan sobre SSA) */
+static int alloc_registers(TP_Instr *code, int n, int *outs, int n_outs, int *out_nregs) {
+    int *last = (int*)malloc((size_t)n * sizeof(int));
+    int *phys = (int*)calloc((size_t)n, sizeof(int));
+    int *free_list = (int*)malloc((size_t)n * sizeof(int));
+    if (!last || !phys || !free_list) {
+        free(last); free(phys); free(free_list);
+        return 0;
+    }
+
+    for (int i = 0; i < n; i++) last[i] = i;
+    for (int i = 0; i < n; i++) {
+        int ar = op_arity(code[i].op);
+        if (ar >= 1) last[code[i].a] = i;
+        if (ar >= 2) last[code[i].b] = i;
+    }
+    /* resultados vivem até o fim (com LET podem não ser a última) */
+    for (int j = 0; j < n_outs; j++) last[outs[j]] = n;
+
+    int n_free = 0, n_regs = 0;
+    for (int i = 0; i < n; i++) {
+        TP_Instr *in = &code[i];
+        int ar = op_arity(in->op);
+
+        const int va = in->a, vb = in->b;
+        if (ar >= 1) in->a = phys[va];
+        if (ar >= 2) in->b = phys[vb];
+
+        /* operandos que morrem aqui liberam o registrador (ops são elemento
+           a elemento, então dst pode coincidir com a/b) */
+        if (ar >= 1 && last[va] == i) free_list[n_free++] = phys[va];
+        if (ar >= 2 && vb != va && last[vb] == i) free_list[n_free++] = phys[vb];
+
+        if (n_free > 0) phys[i] = free_list[--n_free];
+        else phys[i] = n_regs++;
+        in->dst = phys[i];
+    }
+
+    for (int j = 0; j < n_outs; j++) outs[j] = phys[outs[j]];
+    free(last); free(phys); free(free_list);
+    *out_nregs = n_regs;
+    return 1;
+}
+
+static unsigned params_used(const TP_Instr *code, int n) {
+    unsigned m = 0;
+    for (int i = 0; i < n; i++) {
+        if (code[i].op == TP_OP_PARAM) m |= 1u << code[i].a;
+    }
+    return m;
+}
+
+/* Remove instruções sem uso a partir das saídas (SSA, antes dos
+   registradores). SINCOS cujo COS sumiu volta a ser SIN. */
+static void drop_dead(Builder *b, int *outs, int n_outs) {
+    int *map = (int*)malloc((size_t)b->n * sizeof(int));
+    if (!map) return;   /* sem memória: fica tudo, ainda correto */
+
+    for (int i = 0; i < b->n; i++) map[i] = 0;
+    for (int j = 0; j < n_outs; j++) map[outs[j]] = 1;
+    for (int i = b->n - 1; i >= 0; i--) {
+        if (!map[i]) continue;
+        const int ar = op_arity(b->code[i].op);
+        if (ar >= 1) map[b->code[i].a] = 1;
+        if (ar >= 2) map[b->code[i].b] = 1;
+    }
+
+    int n = 0;
+    for (int i = 0; i < b->n; i++) {
+        if (!map[i]) { map[i] = -1; continue; }
+        TP_Instr in = b->code[i];
+        const int ar = op_arity(in.op);
+        if (ar >= 1) in.a = map[in.a];
+        if (ar >= 2) in.b = map[in.b];
+        in.dst = n;
+        map[i] = n;
+        b->code[n++] = in;
+    }
+    for (int j = 0; j < n_outs; j++) outs[j] = map[outs[j]];
+    b->n = n;
+
+    for (int i = 0; i < n; i++) {
+        TP_Instr *in = &b->code[i];
+        if (in->op == TP_OP_SINCOS &&
+            !(i + 1 < n && b->code[i + 1].op == TP_OP_COS && b->code[i + 1].a == in->a))
+            in->op = TP_OP_SIN;
+    }
+    free(map);
+}
+
+/* SSA pronto -> programa com registradores físicos */
+static TP_Program *finish_program(Builder *b, int *outs, int n_outs) {
+    TP_Program *p = (TP_Program*)calloc(1, sizeof(TP_Program));
+    if (!p) { free(b->code); return NULL; }
+    p->params = params_used(b->code, b->n);
+
+    if (!alloc_registers(b->code, b->n, outs, n_outs, &p->n_regs)) {
+        free(b->code); free(p);
+        return NULL;
+    }
+
+    p->code = b->code;
+    p->n_code = b->n;
+    p->out = outs[0];
+    p->out_b = n_outs > 1 ? outs[1] : -1;
+    return p;
+}
+
+TP_Program *tp_prog_compile(const TP_Node *n) {
+    if (!n || n->type == TP_NODE_TUPLE2) return NULL;
+
+    Builder b = { NULL, 0, 0, -1, 0, NULL, 0, 0 };
+    compile_tree(&b, n);
+    free(b.vn);
+    if (b.failed || b.n == 0) { free(b.code); return NULL; }
+
+    TP_Program *p = finish_program(&b, &b.out, 1);
+    if (p) tp_prog_specialize(p, n);
+    return p;
+}
+
+TP_Program *tp_prog_compile_tuple(const TP_Node *n) {
+    if (!n || n->type != TP_NODE_TUPLE2) return NULL;
+
+    /* mesmo Builder: o que y(t) repete de x(t) sai da numeração de valores */
+    Builder b = { NULL, 0, 0, -1, 0, NULL, 0, 1 };
+    int outs[2];
+    compile_tree(&b, n->as.tuple2.a);
+    outs[0] = b.out;
+    if (!b.failed) compile_tree(&b, n->as.tuple2.b);
+    outs[1] = b.out;
+    free(b.vn);
+    if (b.failed || b.n == 0) { free(b.code); return NULL; }
+
+    drop_dead(&b, outs, 2);
+    return finish_program(&b, outs, 2);
+}
+
+void tp_prog_specialize(TP_Program *p, const TP_Node *n) {
+    free(p->shape);
+    p->shape = tp_shape_detect(n);
+}
+
+void tp_prog_free(TP_Program *p) {
+    if (!p) return;
+    tp_prog_free(p->pair);
+    free(p->shape);
+    free(p->code);
+    free(p);
+}
+
+/* ---------- serialização (cache em disco) ---------- */
+
+int tp_prog_write(const TP_Program *p, FILE *f) {
+    if (fprintf(f, "%d %d %d", p->n_code, p->n_regs, p->out) <= 0) return 0;
+    for (int i = 0; i < p->n_code; i++) {
+        const TP_Instr *in = &p->code[i];
+        if (fprintf(f, " %d %d %d %d %a", (int)in->op, in->dst, in->a, in->b, in->k) <= 0) return 0;
+    }
+    return 1;
+}
+
+#define TP_PROG_READ_MAX 65536
+
+static int read_instr(FILE *f, TP_Instr *in, int n_regs) {
+    int op, dst, a, b;
+    char num[64];
+    char *end;
+    if (fscanf(f, "%d %d %d %d %63s", &op, &dst, &a, &b, num) != 5) return 0;
+    if (op < TP_OP_CONST || op > TP_OP_SINCOS) return 0;
+    if (op == TP_OP_PARAM && (a < 0 || a >= TP_PARAM_MAX)) return 0;
+
+    /* índices precisam caber no banco de registradores */
+    int ar = op_arity((TP_OpCode)op);
+    if (dst < 0 || dst >= n_regs) return 0;
+    if (ar >= 1 && (a < 0 || a >= n_regs)) return 0;
+    if (ar >= 2 && (b < 0 || b >= n_regs)) return 0;
+
+    in->op = (TP_OpCode)op;
+    in->dst = dst;
+    in->a = a;
+    in->b = b;
+    in->k = strtod(num, &end);
+    return *end == '\0';
+}
+
+TP_Program *tp_prog_read(FILE *f) {
+    int n_code, n_regs, out;
+    if (fscanf(f, "%d %d %d", &n_code, &n_regs, &out) != 3) return NULL;
+    /* linear scan nunca usa mais registradores que instruções */
+    if (n_code < 1 || n_code > TP_PROG_READ_MAX) return NULL;
+    if (n_regs < 1 || n_regs > n_code || out < 0 || out >= n_regs) return NULL;
+
+    TP_Program *p = (TP_Program*)calloc(1, sizeof(TP_Program));
+    TP_Instr *code = (TP_Instr*)malloc((size_t)n_code * sizeof(TP_Instr));
+    if (!p || !code) { free(p); free(code); return NULL; }
+
+    for (int i = 0; i < n_code; i++) {
+        if (!read_instr(f, &code[i], n_regs)) {
+            free(code);
+            free(p);
+            return NULL;
+        }
+    }
+
+    /* o avaliador pula a instrução depois de SINCOS: precisa ser o COS */
+    for (int i = 0; i < n_code; i++) {
+        if (code[i].op == TP_OP_SINCOS &&
+            !(i + 1 < n_code && code[i + 1].op == TP_OP_COS && code[i + 1].a == code[i].a &&
+              code[i + 1].dst != code[i].dst && code[i].dst != code[i].a)) {
+            free(code);
+            free(p);
+            return NULL;
+        }
+    }
+
+    p->code = code;
+    p->n_code = n_code;
+    p->n_regs = n_regs;
+    p->out = out;
+    p->out_b = -1;
+    p->params = params_used(code, n_code);
+    return p;
+}
+
+/* ---------- avaliação em lote ---------- */
+
+static double powi(double a, int k) {
+    unsigned int e = (unsigned int)(k < 0 ? -k : k);
+    double r = 1.0;
+    while (e) {
+        if (e & 1u) r *= a;
+        a *= a;
+        e >>= 1;
+    }
+    return k < 0 ? 1.0 / r : r;
+}
+
+#define TP_LOCAL_REGS 16
+
+void tp_prog_eval_batch(const TP_Program *p,
+                        const double *xs, const double *ys,
+                        double *out, int n)
+{
+    tp_prog_eval_batch_p(p, NULL, xs, ys, out, n);
+}
+
+/* sin e cos juntos sem libm no caminho comum: redução por pi/2
+   (Cody-Waite, pi/2 em três partes) e os polinômios de fdlibm em
+   [-pi/4, pi/4], então o laço vetoriza. |u| > TP_SINCOS_MAX ou não
+   finito vai para sin()/cos(). c pode ser o registrador de u. */
+#define TP_SINCOS_MAX 1e5
+
+static void sincos_lanes(const double *u, double *s, double *c, int m) {
+    static const double toint = 6755399441055744.0;   /* 1.5 * 2^52 */
+    static const double invpio2 = 6.36619772367581382433e-01;
+    static const double pio2_1 = 1.57079632673412561417e+00;    /* 33 bits */
+    static const double pio2_2 = 6.07710050630396597660e-11;    /* 33 bits */
+    static const double pio2_2t = 2.02226624879595063154e-21;
+    static const double S1 = -1.66666666666666324348e-01, S2 = 8.33333333332248946124e-03,
+                        S3 = -1.98412698298579493134e-04, S4 = 2.75573137070700676789e-06,
+                        S5 = -2.50507602534068634195e-08, S6 = 1.58969099521155010221e-10;
+    static const double C1 = 4.16666666666666019037e-02, C2 = -1.38888888888741095749e-03,
+                        C3 = 2.48015872894767294178e-05, C4 = -2.75573143513906633035e-07,
+                        C5 = 2.08757232129817482790e-09, C6 = -1.13596475577881948265e-11;
+    double uu[TP_LANES];
+    memcpy(uu, u, (size_t)m * sizeof(double));
+
+    for (int i = 0; i < m; i++) {
+        const double x = (fabs(uu[i]) <= TP_SINCOS_MAX) ? uu[i] : 0.0;
+        const double fn = (x * invpio2 + toint) - toint;   /* arredonda */
+        const int q = (int)fn & 3;
+        /* fn * pio2_1 e fn * pio2_2 são exatos para |fn| < 2^20 */
+        const double r = ((x - fn * pio2_1) - fn * pio2_2) - fn * pio2_2t;
+
+        const double z = r * r, w = z * z;
+        const double ps = S2 + z * (S3 + z * S4) + z * w * (S5 + z * S6);
+        const double ks = r + z * r * (S1 + z * ps);
+        const double pc = z * (C1 + z * (C2 + z * C3)) + w * w * (C4 + z * (C5 + z * C6));
+        const double hz = 0.5 * z, one = 1.0 - hz;
+        const double kc = one + (((1.0 - one) - hz) + z * pc);
+
+        /* quadrante q: sin(q pi/2 + r), cos(q pi/2 + r) */
+        const double ss = (q & 1) ? kc : ks;
+        const double cc = (q & 1) ? ks : kc;
+        s[i] = (q & 2) ? -ss : ss;
+        c[i] = ((q + 1) & 2) ? -cc : cc;
+    }
+    for (int i = 0; i < m; i++) {
+        if (!(fabs(uu[i]) <= TP_SINCOS_MAX)) {
+            s[i] = sin(uu[i]);
+            c[i] = cos(uu[i]);
+        }
+    }
+}
+
+/* Um bloco de m amostras pelo bytecode; o resultado fica nos registradores */
+static void run_block(const TP_Program *p, const double *params,
+                      const double *x, const double *y, double *regs, int m)
+{
+    for (int pc = 0; pc < p->n_code; pc++) {
+        const TP_Instr *in = &p->code[pc];
+        double *d = regs + (size_t)in->dst * TP_LANES;
+        const double *a = regs + (size_t)(in->a < 0 ? 0 : in->a) * TP_LANES;
+        const double *c = regs + (size_t)(in->b < 0 ? 0 : in->b) * TP_LANES;
+
+        switch (in->op) {
+            case TP_OP_CONST: for (int i = 0; i < m; i++) d[i] = in->k; break;
+            case TP_OP_X:     memcpy(d, x, (size_t)m * sizeof(double)); break;
+            case TP_OP_Y:
+                if (y) memcpy(d, y, (size_t)m * sizeof(double));
+                else for (int i = 0; i < m; i++) d[i] = NAN;
+                break;
+            case TP_OP_PARAM: {
+                const double v = params ? params[in->a] : NAN;
+                for (int i = 0; i < m; i++) d[i] = v;
+            } break;
+
+            case TP_OP_NEG: for (int i = 0; i < m; i++) d[i] = -a[i]; break;
+            case TP_OP_ADD: for (int i = 0; i < m; i++) d[i] = a[i] + c[i]; break;
+            case TP_OP_SUB: for (int i = 0; i < m; i++) d[i] = a[i] - c[i]; break;
+            case TP_OP_MUL: for (int i = 0; i < m; i++) d[i] = a[i] * c[i]; break;
+            case TP_OP_DIV: for (int i = 0; i < m; i++) d[i] = a[i] / c[i]; break;
+            case TP_OP_POW: for (int i = 0; i < m; i++) d[i] = pow(a[i], c[i]); break;
+            case TP_OP_POWI: {
+                const int k = (int)in->k;
+                if (k == 2)      for (int i = 0; i < m; i++) d[i] = a[i] * a[i];
+                else if (k == 3) for (int i = 0; i < m; i++) d[i] = a[i] * a[i] * a[i];
+                else             for (int i = 0; i < m; i++) d[i] = powi(a[i], k);
+            } break;
+
+            case TP_OP_SIN:  for (int i = 0; i < m; i++) d[i] = sin(a[i]); break;
+            case TP_OP_COS:  for (int i = 0; i < m; i++) d[i] = cos(a[i]); break;
+            case TP_OP_TAN:  for (int i = 0; i < m; i++) d[i] = tan(a[i]); break;
+            case TP_OP_LOG:  for (int i = 0; i < m; i++) d[i] = log(a[i]); break;
+            case TP_OP_EXP:  for (int i = 0; i < m; i++) d[i] = exp(a[i]); break;
+            case TP_OP_SQRT: for (int i = 0; i < m; i++) d[i] = sqrt(a[i]); break;
+
+            case TP_OP_SINCOS: {
+                /* o COS seguinte (validado na compilação/leitura) sai junto */
+                const TP_Instr *nx = &p->code[++pc];
+                sincos_lanes(a, d, regs + (size_t)nx->dst * TP_LANES, m);
+            } break;
+
+            default: for (int i = 0; i < m; i++) d[i] = NAN; break;
+        }
+    }
+}
+
+/* banco de registradores de p: local se couber, senão heap (NULL sem memória) */
+static double *alloc_regs(const TP_Program *p, size_t banks, double *local) {
+    if ((size_t)p->n_regs <= TP_LOCAL_REGS) return local;
+    return (double*)malloc(banks * (size_t)p->n_regs * TP_LANES * sizeof(double));
+}
+
+void tp_prog_eval_batch_p(const TP_Program *p, const double *params,
+                          const double *xs, const double *ys,
+                          double *out, int n)
+{
+    double local[TP_LOCAL_REGS * TP_LANES];
+
+    if (!p) {
+        for (int i = 0; i < n; i++) out[i] = NAN;
+        return;
+    }
+    if (p->shape) {
+        tp_shape_eval(p->shape, xs, out, n);
+        return;
+    }
+    double *regs = alloc_regs(p, 1, local);
+    if (!regs) {
+        for (int i = 0; i < n; i++) out[i] = NAN;
+        return;
+    }
+
+    for (int base = 0; base < n; base += TP_LANES) {
+        const int m = (n - base < TP_LANES) ? (n - base) : TP_LANES;
+        run_block(p, params, xs + base, ys ? ys + base : NULL, regs, m);
+        memcpy(out + base, regs + (size_t)p->out * TP_LANES, (size_t)m * sizeof(double));
+    }
+
+    if (regs != local) free(regs);
+}
+
+void tp_prog_eval_tuple_p(const TP_Program *px, const TP_Program *py,
+                          const double *params, const double *ts,
+                          double *xs, double *ys, int n)
+{
+    double local[TP_LOCAL_REGS * TP_LANES];
+    const TP_Program *p = px ? px->pair : NULL;
+    double *regs = p ? alloc_regs(p, 1, local) : NULL;
+
+    if (!regs) {
+        tp_prog_eval_batch_p(px, params, ts, NULL, xs, n);
+        tp_prog_eval_batch_p(py, params, ts, NULL, ys, n);
+        return;
+    }
+
+    for (int base = 0; base < n; base += TP_LANES) {
+        const int m = (n - base < TP_LANES) ? (n - base) : TP_LANES;
+        run_block(p, params, ts + base, NULL, regs, m);
+        memcpy(xs + base, regs + (size_t)p->out * TP_LANES, (size_t)m * sizeof(double));
+        memcpy(ys + base, regs + (size_t)p->out_b * TP_LANES, (size_t)m * sizeof(double));
+    }
+
+    if (regs != local) free(regs);
+}
+
+/* ---------- jato (valor, d/dx, d²/dx²) ---------- */
+
+/* regra da cadeia para g(u): g' = d, g'' = dd. Derivada nula não
+   multiplica (g' infinito num argumento constante daria NaN) */
+static void chain(double u1, double u2, double d, double dd, double *o1, double *o2) {
+    *o1 = (u1 != 0.0) ? d * u1 : 0.0;
+    *o2 = ((u1 != 0.0) ? dd * u1 * u1 : 0.0) + ((u2 != 0.0) ? d * u2 : 0.0);
+}
+
+/* a^b com b variável: derivada logarítmica; com b constante no lote
+   (b' = b'' = 0) usa a regra da potência, que vale para a <= 0 */
+static void pow_jet(double a, double a1, double a2, double b, double b1, double b2,
+                    double *v, double *o1, double *o2) {
+    const double r = pow(a, b);
+    *v = r;
+    if (b1 == 0.0 && b2 == 0.0) {
+        const double p1 = pow(a, b - 1.0);
+        const double p2 = (a != 0.0) ? p1 / a : pow(a, b - 2.0);
+        chain(a1, a2, b * p1, b * (b - 1.0) * p2, o1, o2);
+        return;
+    }
+    const double la = log(a);
+    const double q = a1 / a;
+    const double l1 = b1 * la + ((a1 != 0.0) ? b * q : 0.0);
+    const double l2 = b2 * la + ((a1 != 0.0) ? 2.0 * b1 * q - b * q * q : 0.0) +
+                      ((a2 != 0.0) ? b * a2 / a : 0.0);
+    *o1 = r * l1;
+    *o2 = r * (l1 * l1 + l2);
+}
+
+void tp_prog_eval_jet_p(const TP_Program *p, const double *params,
+                        const double *xs, const double *ys,
+                        double *out, double *d1, double *d2, int n)
+{
+    double local[3 * TP_LOCAL_REGS * TP_LANES];
+    double *regs = local;
+
+    if (!p) {
+        for (int i = 0; i < n; i++) out[i] = d1[i] = d2[i] = NAN;
+        return;
+    }
+    if (p->shape) {
+        tp_shape_eval_jet(p->shape, xs, out, d1, d2, n);
+        return;
+    }
+    /* três bancos: valor, 1ª e 2ª derivada */
+    const size_t bank = (size_t)p->n_regs * TP_LANES;
+    if (p->n_regs > TP_LOCAL_REGS) {
+        regs = (double*)malloc(3 * bank * sizeof(double));
+        if (!regs) {
+            for (int i = 0; i < n; i++) out[i] = d1[i] = d2[i] = NAN;
+            return;
+        }
+    }
+    double *V = regs, *G = regs + bank, *H = regs + 2 * bank;
+
+    for (int base = 0; base < n; base += TP_LANES) {
+        const int m = (n - base < TP_LANES) ? (n - base) : TP_LANES;
+        const double *x = xs + base;
+        const double *y = ys ? ys + base : NULL;
+
+        for (int pc = 0; pc < p->n_code; pc++) {
+            const TP_Instr *in = &p->code[pc];
+            const size_t od = (size_t)in->dst * TP_LANES;
+            const size_t oa = (size_t)(in->a < 0 ? 0 : in->a) * TP_LANES;
+            const size_t oc = (size_t)(in->b < 0 ? 0 : in->b) * TP_LANES;
+            double *v = V + od, *g = G + od, *h = H + od;
+            const double *va = V + oa, *ga = G + oa, *ha = H + oa;
+            const double *vc = V + oc, *gc = G + oc, *hc = H + oc;
+
+            /* dst pode ser a/b: cada elemento lê tudo antes de escrever */
+            switch (in->op) {
+                case TP_OP_CONST:
+                case TP_OP_Y:
+                case TP_OP_PARAM: {
+                    double k = in->k;
+                    if (in->op == TP_OP_PARAM) k = params ? params[in->a] : NAN;
+                    for (int i = 0; i < m; i++) {
+                        v[i] = (in->op == TP_OP_Y) ? (y ? y[i] : NAN) : k;
+                        g[i] = 0.0;
+                        h[i] = 0.0;
+                    }
+                } break;
+                case TP_OP_X:
+                    memcpy(v, x, (size_t)m * sizeof(double));
+                    for (int i = 0; i < m; i++) { g[i] = 1.0; h[i] = 0.0; }
+                    break;
+
+                case TP_OP_NEG:
+                    for (int i = 0; i < m; i++) { v[i] = -va[i]; g[i] = -ga[i]; h[i] = -ha[i]; }
+                    break;
+                case TP_OP_ADD:
+                    for (int i = 0; i < m; i++) { v[i] = va[i] + vc[i]; g[i] = ga[i] + gc[i]; h[i] = ha[i] + hc[i]; }
+                    break;
+                case TP_OP_SUB:
+                    for (int i = 0; i < m; i++) { v[i] = va[i] - vc[i]; g[i] = ga[i] - gc[i]; h[i] = ha[i] - hc[i]; }
+                    break;
+                case TP_OP_MUL:
+                    for (int i = 0; i < m; i++) {
+                        const double a0 = va[i], a1 = ga[i], a2 = ha[i];
+                        const double b0 = vc[i], b1 = gc[i], b2 = hc[i];
+                        v[i] = a0 * b0;
+                        g[i] = a1 * b0 + a0 * b1;
+                        h[i] = a2 * b0 + 2.0 * a1 * b1 + a0 * b2;
+                    }
+                    break;
+                case TP_OP_DIV:
+                    for (int i = 0; i < m; i++) {
+                        const double a1 = ga[i], a2 = ha[i];
+                        const double b0 = vc[i], b1 = gc[i], b2 = hc[i];
+                        const double q = va[i] / b0;
+                        const double q1 = (a1 - q * b1) / b0;
+                        v[i] = q;
+                        g[i] = q1;
+                        h[i] = (a2 - 2.0 * q1 * b1 - q * b2) / b0;
+                    }
+                    break;
+                case TP_OP_POW:
+                    for (int i = 0; i < m; i++) {
+                        pow_jet(va[i], ga[i], ha[i], vc[i], gc[i], hc[i], &v[i], &g[i], &h[i]);
+                    }
+                    break;
+                case TP_OP_POWI: {
+                    const int k = (int)in->k;
+                    for (int i = 0; i < m; i++) {
+                        const double a = va[i], a1 = ga[i], a2 = ha[i];
+                        double r, d, dd;
+                        if (k == 0)      { r = powi(a, 0); d = 0.0; dd = 0.0; }
+                        else if (k == 1) { r = powi(a, 1); d = 1.0; dd = 0.0; }
+                        else if (k == 2) { r = a * a; d = 2.0 * a; dd = 2.0; }
+                        else if (k == 3) { r = a * a * a; d = 3.0 * a * a; dd = 6.0 * a; }
+                        else {
+                            r = powi(a, k);
+                            d = k * powi(a, k - 1);
+                            dd = (double)k * (k - 1) * powi(a, k - 2);
+                        }
+                        v[i] = r;
+                        chain(a1, a2, d, dd, &g[i], &h[i]);
+                    }
+                } break;
+
+                case TP_OP_SIN:
+                case TP_OP_COS:
+                case TP_OP_TAN:
+                case TP_OP_LOG:
+                case TP_OP_EXP:
+                case TP_OP_SQRT: {
+                    const TP_OpCode op = in->op;
+                    for (int i = 0; i < m; i++) {
+                        const double u = va[i], u1 = ga[i], u2 = ha[i];
+                        double r, d, dd;
+                        if (op == TP_OP_SIN)      { r = sin(u); d = cos(u); dd = -r; }
+                        else if (op == TP_OP_COS) { r = cos(u); d = -sin(u); dd = -r; }
+                        else if (op == TP_OP_TAN) { r = tan(u); d = 1.0 + r * r; dd = 2.0 * r * d; }
+                        else if (op == TP_OP_LOG) { r = log(u); d = 1.0 / u; dd = -d * d; }
+                        else if (op == TP_OP_EXP) { r = exp(u); d = r; dd = r; }
+                        else                      { r = sqrt(u); d = 0.5 / r; dd = -0.5 * d / u; }
+                        v[i] = r;
+                        chain(u1, u2, d, dd, &g[i], &h[i]);
+                    }
+                } break;
+
+                case TP_OP_SINCOS: {
+                    /* mesmos valores do lote; o COS seguinte pode ser o
+                       registrador de a, então lê u', u'' antes de escrever */
+                    const size_t oc2 = (size_t)p->code[++pc].dst * TP_LANES;
+                    double sv[TP_LANES], cv[TP_LANES];
+                    sincos_lanes(va, sv, cv, m);
+                    for (int i = 0; i < m; i++) {
+                        const double u1 = ga[i], u2 = ha[i];
+                        v[i] = sv[i];
+                        chain(u1, u2, cv[i], -sv[i], &g[i], &h[i]);
+                        V[oc2 + i] = cv[i];
+                        chain(u1, u2, -sv[i], -cv[i], &G[oc2 + i], &H[oc2 + i]);
+                    }
+                } break;
+
+                default:
+                    for (int i = 0; i < m; i++) v[i] = g[i] = h[i] = NAN;
+                    break;
+            }
+        }
+
+        const size_t o = (size_t)p->out * TP_LANES;
+        memcpy(out + base, V + o, (size_t)m * sizeof(double));
+        memcpy(d1 + base, G + o, (size_t)m * sizeof(double));
+        memcpy(d2 + base, H + o, (size_t)m * sizeof(double));
+    }
+
+    if (regs != local) free(regs);
+}
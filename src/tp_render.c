@@ -24,16 +24,61 @@ static double tp_floor_to_step(double x, double step) {
     return floor(x / step) * step;
 }
 
-void tp_world_to_screen(const TP_View *v, TP_Screen s,
-                        double x, double y, int *sx, int *sy) {
+void tp_out_color(const TP_Out *o, unsigned char r, unsigned char g, unsigned char b) {
+    if (o->r) SDL_SetRenderDrawColor(o->r, r, g, b, 255);
+    if (o->vec) tp_vec_color(o->vec, r, g, b);
+}
+
+void tp_out_line(const TP_Out *o, double x0, double y0, double x1, double y1) {
+    if (o->r) SDL_RenderDrawLine(o->r, (int)lround(x0), (int)lround(y0), (int)lround(x1), (int)lround(y1));
+    if (o->vec) tp_vec_line(o->vec, x0, y0, x1, y1);
+    if (o->lines) tp_lines_line(o->lines, x0, y0, x1, y1);
+}
+
+/* pontos por chamada de SDL_RenderDrawLines */
+#define TP_OUT_BATCH 256
+
+void tp_out_polyline(const TP_Out *o, const double *x, const double *y, int n) {
+    if (n < 2) return;
+    if (o->r) {
+        SDL_Point pt[TP_OUT_BATCH];
+        for (int i = 0; i < n - 1; ) {
+            const int m = (n - i < TP_OUT_BATCH) ? (n - i) : TP_OUT_BATCH;
+            for (int k = 0; k < m; k++) {
+                pt[k].x = (int)lround(x[i + k]);
+                pt[k].y = (int)lround(y[i + k]);
+            }
+            SDL_RenderDrawLines(o->r, pt, m);
+            i += m - 1;   /* o último ponto abre o próximo lote */
+        }
+    }
+    for (int i = 1; i < n; i++) {
+        if (o->vec) tp_vec_line(o->vec, x[i - 1], y[i - 1], x[i], y[i]);
+        if (o->lines) tp_lines_line(o->lines, x[i - 1], y[i - 1], x[i], y[i]);
+    }
+}
+
+void tp_out_point(const TP_Out *o, double x, double y) {
+    if (o->r) SDL_RenderDrawPoint(o->r, (int)lround(x), (int)lround(y));
+    if (o->vec) tp_vec_point(o->vec, x, y);
+    if (o->lines) tp_lines_point(o->lines, x, y);
+}
+
+void tp_world_to_screen_f(const TP_View *v, TP_Screen s,
+                          double x, double y, double *sx, double *sy) {
     const double nx = (x - v->xmin) / (v->xmax - v->xmin);
     const double ny = (y - v->ymin) / (v->ymax - v->ymin);
 
-    int px = (int)lround(nx * (double)(s.w - 1));
-    int py = (int)lround((1.0 - ny) * (double)(s.h - 1)); /* Y invertido */
+    if (sx) *sx = nx * (double)(s.w - 1);
+    if (sy) *sy = (1.0 - ny) * (double)(s.h - 1); /* Y invertido */
+}
 
-    if (sx) *sx = px;
-    if (sy) *sy = py;
+void tp_world_to_screen(const TP_View *v, TP_Screen s,
+                        double x, double y, int *sx, int *sy) {
+    double fx, fy;
+    tp_world_to_screen_f(v, s, x, y, &fx, &fy);
+    if (sx) *sx = (int)lround(fx);
+    if (sy) *sy = (int)lround(fy);
 }
 
 void tp_screen_to_world(const TP_View *v, TP_Screen s,
@@ -45,47 +90,47 @@ void tp_screen_to_world(const TP_View *v, TP_Screen s,
     if (y) *y = v->ymin + ny * (v->ymax - v->ymin);
 }
 
-void tp_draw_grid(SDL_Renderer *r, const TP_View *v, TP_Screen s) {
+void tp_draw_grid(const TP_Out *o, const TP_View *v, TP_Screen s) {
     const double x_range = v->xmax - v->xmin;
     const double y_range = v->ymax - v->ymin;
 
     const double x_step = tp_nice_step(x_range, 10);
     const double y_step = tp_nice_step(y_range, 10);
 
-    SDL_SetRenderDrawColor(r, 40, 40, 40, 255);
+    tp_out_color(o, 40, 40, 40);
 
     double x0 = tp_floor_to_step(v->xmin, x_step);
     for (double x = x0; x <= v->xmax; x += x_step) {
-        int sx, sy1, sy2;
-        tp_world_to_screen(v, s, x, v->ymin, &sx, &sy1);
-        tp_world_to_screen(v, s, x, v->ymax, &sx, &sy2);
-        SDL_RenderDrawLine(r, sx, sy1, sx, sy2);
+        double sx, sy1, sy2;
+        tp_world_to_screen_f(v, s, x, v->ymin, &sx, &sy1);
+        tp_world_to_screen_f(v, s, x, v->ymax, &sx, &sy2);
+        tp_out_line(o, sx, sy1, sx, sy2);
     }
 
     double y0 = tp_floor_to_step(v->ymin, y_step);
     for (double y = y0; y <= v->ymax; y += y_step) {
-        int sx1, sx2, sy;
-        tp_world_to_screen(v, s, v->xmin, y, &sx1, &sy);
-        tp_world_to_screen(v, s, v->xmax, y, &sx2, &sy);
-        SDL_RenderDrawLine(r, sx1, sy, sx2, sy);
+        double sx1, sx2, sy;
+        tp_world_to_screen_f(v, s, v->xmin, y, &sx1, &sy);
+        tp_world_to_screen_f(v, s, v->xmax, y, &sx2, &sy);
+        tp_out_line(o, sx1, sy, sx2, sy);
     }
 }
 
-void tp_draw_axes(SDL_Renderer *r, const TP_View *v, TP_Screen s) {
-    SDL_SetRenderDrawColor(r, 160, 160, 160, 255);
+void tp_draw_axes(const TP_Out *o, const TP_View *v, TP_Screen s) {
+    tp_out_color(o, 160, 160, 160);
 
     if (v->xmin <= 0.0 && v->xmax >= 0.0) {
-        int sx, sy1, sy2;
-        tp_world_to_screen(v, s, 0.0, v->ymin, &sx, &sy1);
-        tp_world_to_screen(v, s, 0.0, v->ymax, &sx, &sy2);
-        SDL_RenderDrawLine(r, sx, sy1, sx, sy2);
+        double sx, sy1, sy2;
+        tp_world_to_screen_f(v, s, 0.0, v->ymin, &sx, &sy1);
+        tp_world_to_screen_f(v, s, 0.0, v->ymax, &sx, &sy2);
+        tp_out_line(o, sx, sy1, sx, sy2);
     }
 
     if (v->ymin <= 0.0 && v->ymax >= 0.0) {
-        int sx1, sx2, sy;
-        tp_world_to_screen(v, s, v->xmin, 0.0, &sx1, &sy);
-        tp_world_to_screen(v, s, v->xmax, 0.0, &sx2, &sy);
-        SDL_RenderDrawLine(r, sx1, sy, sx2, sy);
+        double sx1, sx2, sy;
+        tp_world_to_screen_f(v, s, v->xmin, 0.0, &sx1, &sy);
+        tp_world_to_screen_f(v, s, v->xmax, 0.0, &sx2, &sy);
+        tp_out_line(o, sx1, sy, sx2, sy);
     }
 
     const double x_range = v->xmax - v->xmin;
@@ -97,18 +142,106 @@ void tp_draw_axes(SDL_Renderer *r, const TP_View *v, TP_Screen s) {
     if (v->ymin <= 0.0 && v->ymax >= 0.0) {
         double x0 = tp_floor_to_step(v->xmin, x_step);
         for (double x = x0; x <= v->xmax; x += x_step) {
-            int sx, sy;
-            tp_world_to_screen(v, s, x, 0.0, &sx, &sy);
-            SDL_RenderDrawLine(r, sx, sy - tick, sx, sy + tick);
+            double sx, sy;
+            tp_world_to_screen_f(v, s, x, 0.0, &sx, &sy);
+            tp_out_line(o, sx, sy - tick, sx, sy + tick);
         }
     }
 
     if (v->xmin <= 0.0 && v->xmax >= 0.0) {
         double y0 = tp_floor_to_step(v->ymin, y_step);
         for (double y = y0; y <= v->ymax; y += y_step) {
-            int sx, sy;
-            tp_world_to_screen(v, s, 0.0, y, &sx, &sy);
-            SDL_RenderDrawLine(r, sx - tick, sy, sx + tick, sy);
+            double sx, sy;
+            tp_world_to_screen_f(v, s, 0.0, y, &sx, &sy);
+            tp_out_line(o, sx - tick, sy, sx + tick, sy);
+        }
+    }
+}
+
+/* ---------- zoom profundo (double-double) ---------- */
+
+void tp_world_to_screen_dd(const TP_ViewDD *v, TP_Screen s,
+                           TP_DD x, TP_DD y, int *sx, int *sy) {
+    /* a diferença até o canto cabe em double; só ela precisa de dd */
+    const double nx = tp_dd_to_double(tp_dd_sub(x, v->xmin)) / v->xspan;
+    const double ny = tp_dd_to_double(tp_dd_sub(y, v->ymin)) / v->yspan;
+
+    int px = (int)lround(nx * (double)(s.w - 1));
+    int py = (int)lround((1.0 - ny) * (double)(s.h - 1)); /* Y invertido */
+
+    if (sx) *sx = px;
+    if (sy) *sy = py;
+}
+
+void tp_screen_to_world_dd(const TP_ViewDD *v, TP_Screen s,
+                           int sx, int sy, TP_DD *x, TP_DD *y) {
+    const double nx = (double)sx / (double)(s.w - 1);
+    const double ny = 1.0 - ((double)sy / (double)(s.h - 1));
+
+    if (x) *x = tp_dd_add_d(v->xmin, nx * v->xspan);
+    if (y) *y = tp_dd_add_d(v->ymin, ny * v->yspan);
+}
+
+/* fase da grade: primeira linha (múltiplo de step) fica em min + phase */
+static void tp_grid_phase_dd(TP_DD min, double span, double *step, double *phase) {
+    const double st = tp_nice_step(span, 10);
+    const double k = floor(min.hi / st);
+
+    /* k * st exato em dd; o resto cabe em double */
+    double ph = -tp_dd_to_double(tp_dd_sub(min, tp_dd_two_prod(k, st)));
+    ph -= floor(ph / st) * st;
+
+    *step = st;
+    *phase = ph;
+}
+
+void tp_draw_grid_dd(const TP_Out *o, const TP_ViewDD *v, TP_Screen s) {
+    double x_step, x_phase, y_step, y_phase;
+    tp_grid_phase_dd(v->xmin, v->xspan, &x_step, &x_phase);
+    tp_grid_phase_dd(v->ymin, v->yspan, &y_step, &y_phase);
+
+    tp_out_color(o, 40, 40, 40);
+
+    for (double ox = x_phase; ox <= v->xspan; ox += x_step) {
+        const double sx = ox / v->xspan * (double)(s.w - 1);
+        tp_out_line(o, sx, 0, sx, s.h - 1);
+    }
+    for (double oy = y_phase; oy <= v->yspan; oy += y_step) {
+        const double sy = (1.0 - oy / v->yspan) * (double)(s.h - 1);
+        tp_out_line(o, 0, sy, s.w - 1, sy);
+    }
+}
+
+void tp_draw_axes_dd(const TP_Out *o, const TP_ViewDD *v, TP_Screen s) {
+    tp_out_color(o, 160, 160, 160);
+
+    /* offset do zero até o canto (só importa quando o eixo é visível) */
+    const double zx = -tp_dd_to_double(v->xmin);
+    const double zy = -tp_dd_to_double(v->ymin);
+    const int x_axis_visible = (zy >= 0.0 && zy <= v->yspan);
+    const int y_axis_visible = (zx >= 0.0 && zx <= v->xspan);
+
+    const double sx0 = zx / v->xspan * (double)(s.w - 1);
+    const double sy0 = (1.0 - zy / v->yspan) * (double)(s.h - 1);
+
+    if (y_axis_visible) tp_out_line(o, sx0, 0, sx0, s.h - 1);
+    if (x_axis_visible) tp_out_line(o, 0, sy0, s.w - 1, sy0);
+
+    double x_step, x_phase, y_step, y_phase;
+    tp_grid_phase_dd(v->xmin, v->xspan, &x_step, &x_phase);
+    tp_grid_phase_dd(v->ymin, v->yspan, &y_step, &y_phase);
+    const int tick = 6;
+
+    if (x_axis_visible) {
+        for (double ox = x_phase; ox <= v->xspan; ox += x_step) {
+            const double sx = ox / v->xspan * (double)(s.w - 1);
+            tp_out_line(o, sx, sy0 - tick, sx, sy0 + tick);
+        }
+    }
+    if (y_axis_visible) {
+        for (double oy = y_phase; oy <= v->yspan; oy += y_step) {
+            const double sy = (1.0 - oy / v->yspan) * (double)(s.h - 1);
+            tp_out_line(o, sx0 - tick, sy, sx0 + tick, sy);
         }
     }
 }
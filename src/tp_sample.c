@@ -0,0 +1,320 @@
+#include "tp_sample.h"
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* índices avaliados por chamada ao lote (checa o orçamento entre chunks) */
+#define TP_SAMPLE_CHUNK 256
+
+/* salto contra as duas tangentes só é descontinuidade acima de tol * isto */
+#define TP_SAMPLE_JUMP_TOL 32.0
+
+void tp_sampler_init(TP_Sampler *s) {
+    memset(s, 0, sizeof(*s));
+}
+
+void tp_sampler_free(TP_Sampler *s) {
+    free(s->ts);
+    free(s->xs);
+    free(s->ys);
+    free(s->done);
+    free(s->d1s);
+    free(s->d2s);
+    free(s->sub_n);
+    free(s->brk);
+    free(s->sub_x);
+    free(s->sub_y);
+    memset(s, 0, sizeof(*s));
+}
+
+static int ensure_cap(TP_Sampler *s, int n) {
+    if (n <= s->cap) return 1;
+
+    double *ts = (double*)realloc(s->ts, (size_t)n * sizeof(double));
+    if (ts) s->ts = ts;
+    double *xs = (double*)realloc(s->xs, (size_t)n * sizeof(double));
+    if (xs) s->xs = xs;
+    double *ys = (double*)realloc(s->ys, (size_t)n * sizeof(double));
+    if (ys) s->ys = ys;
+    unsigned char *done = (unsigned char*)realloc(s->done, (size_t)n);
+    if (done) s->done = done;
+    double *d1s = (double*)realloc(s->d1s, (size_t)n * sizeof(double));
+    if (d1s) s->d1s = d1s;
+    double *d2s = (double*)realloc(s->d2s, (size_t)n * sizeof(double));
+    if (d2s) s->d2s = d2s;
+    unsigned char *sub_n = (unsigned char*)realloc(s->sub_n, (size_t)n);
+    if (sub_n) s->sub_n = sub_n;
+    unsigned char *brk = (unsigned char*)realloc(s->brk, (size_t)n);
+    if (brk) s->brk = brk;
+
+    if (!ts || !xs || !ys || !done || !d1s || !d2s || !sub_n || !brk) return 0;
+    s->cap = n;
+    return 1;
+}
+
+static int ensure_sub_cap(TP_Sampler *s, int n) {
+    if (n <= s->cap_sub) return 1;
+    int ncap = s->cap_sub ? s->cap_sub : 1024;
+    while (ncap < n) ncap *= 2;
+
+    double *sx = (double*)realloc(s->sub_x, (size_t)ncap * sizeof(double));
+    if (sx) s->sub_x = sx;
+    double *sy = (double*)realloc(s->sub_y, (size_t)ncap * sizeof(double));
+    if (sy) s->sub_y = sy;
+
+    if (!sx || !sy) return 0;
+    s->cap_sub = ncap;
+    return 1;
+}
+
+/* descarta o estágio por curvatura (os passes vão recomeçar ou tol mudou) */
+static void restart_adapt(TP_Sampler *s) {
+    s->adapted = 0;
+    s->n_sub = 0;
+}
+
+static int first_stride(int n) {
+    int st = TP_SAMPLE_COARSE;
+    while (st > 1 && st >= n) st /= 2;
+    return st;
+}
+
+int tp_sampler_reset(TP_Sampler *s, int n, double t0, double t1) {
+    if (n < 2) n = 2;
+    if (s->valid && s->n == n && s->t0 == t0 && s->t1 == t1) return 0;
+
+    if (!ensure_cap(s, n)) { s->valid = 0; return -1; }
+
+    s->n = n;
+    s->t0 = t0;
+    s->t1 = t1;
+    for (int i = 0; i < n; i++) {
+        s->ts[i] = t0 + (t1 - t0) * ((double)i / (double)(n - 1));
+    }
+    memset(s->done, 0, (size_t)n);
+
+    s->stride = first_stride(n);
+    s->cursor = 0;
+    s->valid = 1;
+    s->redo = TP_SAMPLE_X | TP_SAMPLE_Y;
+    restart_adapt(s);
+    return 1;
+}
+
+void tp_sampler_invalidate(TP_Sampler *s) {
+    s->valid = 0;
+}
+
+int tp_sampler_set_params(TP_Sampler *s, const double *params,
+                          const TP_Program *px, const TP_Program *py) {
+    unsigned changed = 0;
+    for (int i = 0; i < TP_PARAM_MAX; i++) {
+        if (!s->has_params || s->params[i] != params[i]) changed |= 1u << i;
+        s->params[i] = params[i];
+    }
+    s->has_params = 1;
+    if (!s->valid) return 0;
+
+    /* y = f(x): px dá y; paramétrica: px dá x, py dá y */
+    int redo = 0;
+    if (py) {
+        if (px && (px->params & changed)) redo |= TP_SAMPLE_X;
+        if (py->params & changed) redo |= TP_SAMPLE_Y;
+    } else if (px && (px->params & changed)) {
+        redo = TP_SAMPLE_Y;
+    }
+    if (!redo) return 0;
+
+    /* no meio de um refinamento as duas podem estar pela metade */
+    s->redo = (s->stride == 0) ? redo : (s->redo | redo);
+    memset(s->done, 0, (size_t)s->n);
+    s->stride = first_stride(s->n);
+    s->cursor = 0;
+    restart_adapt(s);
+    return 1;
+}
+
+int tp_sampler_set_tolerance(TP_Sampler *s, double tol) {
+    if (tol == s->tol) return 0;
+    s->tol = tol;
+    if (!s->valid) return 0;
+    restart_adapt(s);
+    return 1;
+}
+
+int tp_sampler_complete(const TP_Sampler *s) {
+    return s->valid && s->stride == 0 && s->adapted >= s->n - 1;
+}
+
+int tp_sampler_copy(TP_Sampler *dst, const TP_Sampler *src) {
+    if (!src->valid) { dst->valid = 0; return 1; }
+    if (!ensure_cap(dst, src->n) || !ensure_sub_cap(dst, src->n_sub)) { dst->valid = 0; return 0; }
+
+    const size_t n = (size_t)src->n;
+    memcpy(dst->ts, src->ts, n * sizeof(double));
+    memcpy(dst->xs, src->xs, n * sizeof(double));
+    memcpy(dst->ys, src->ys, n * sizeof(double));
+    memcpy(dst->done, src->done, n);
+    memcpy(dst->d1s, src->d1s, n * sizeof(double));
+    memcpy(dst->d2s, src->d2s, n * sizeof(double));
+    /* só a parte já analisada do estágio por curvatura */
+    memcpy(dst->sub_n, src->sub_n, (size_t)src->adapted);
+    memcpy(dst->brk, src->brk, (size_t)src->adapted);
+    memcpy(dst->sub_x, src->sub_x, (size_t)src->n_sub * sizeof(double));
+    memcpy(dst->sub_y, src->sub_y, (size_t)src->n_sub * sizeof(double));
+    dst->n_sub = src->n_sub;
+    dst->adapted = src->adapted;
+    dst->tol = src->tol;
+
+    dst->n = src->n;
+    dst->stride = src->stride;
+    dst->cursor = src->cursor;
+    dst->t0 = src->t0;
+    dst->t1 = src->t1;
+    dst->valid = 1;
+    memcpy(dst->params, src->params, sizeof(src->params));
+    dst->has_params = src->has_params;
+    dst->redo = src->redo;
+    return 1;
+}
+
+/* próximo índice pendente do passe atual (ou -1 ao acabar todos) */
+static int next_index(TP_Sampler *s) {
+    while (s->stride > 0) {
+        while (s->cursor < s->n) {
+            int i = s->cursor;
+            s->cursor += s->stride;
+            if (!s->done[i]) return i;
+        }
+        /* o último ponto entra já no passe grosso */
+        if (!s->done[s->n - 1]) return s->n - 1;
+
+        s->stride /= 2;
+        s->cursor = 0;
+    }
+    return -1;
+}
+
+/* Pedaços do intervalo [i, i+1] (1 = só a corda) e se é descontinuidade. */
+static int interval_pieces(const TP_Sampler *s, int i, unsigned char *brk) {
+    const double h = s->xs[i + 1] - s->xs[i];
+    const double y0 = s->ys[i], y1 = s->ys[i + 1];
+    const double g0 = s->d1s[i], g1 = s->d1s[i + 1];
+    *brk = 0;
+    if (!isfinite(y0) || !isfinite(y1)) return 1;   /* o desenho já quebra */
+
+    /* sobe contra as duas tangentes por muitos pixels: polo/salto */
+    const double dy = y1 - y0;
+    if (dy * g0 < 0.0 && dy * g1 < 0.0 && fabs(dy) > TP_SAMPLE_JUMP_TOL * s->tol) {
+        *brk = 1;
+        return 1;
+    }
+
+    /* erro da corda ~ |f''| h²/8; com k pedaços cai por k² */
+    const double e = fmax(fabs(s->d2s[i]), fabs(s->d2s[i + 1])) * h * h * 0.125;
+    if (e != e || e <= s->tol) return 1;   /* NaN: sem informação */
+    const double k = ceil(sqrt(e / s->tol));
+    return k < TP_SAMPLE_SUB_MAX ? (int)k : TP_SAMPLE_SUB_MAX;
+}
+
+/* Estágio final de y = f(x): subamostras dos intervalos em ordem, em
+   lotes de até TP_SAMPLE_CHUNK pontos. Retorna 0 se faltou memória. */
+static int adapt_chunk(TP_Sampler *s, const TP_Program *pf, const double *params) {
+    int last = s->adapted, m = 0;
+    while (last < s->n - 1) {
+        unsigned char brk;
+        const int k = interval_pieces(s, last, &brk);
+        if (m + k - 1 > TP_SAMPLE_CHUNK) break;
+        if (!ensure_sub_cap(s, s->n_sub + m + k - 1)) return 0;
+
+        const double x0 = s->xs[last], h = s->xs[last + 1] - x0;
+        for (int j = 1; j < k; j++) s->sub_x[s->n_sub + m++] = x0 + h * ((double)j / (double)k);
+        s->sub_n[last] = (unsigned char)(k - 1);
+        s->brk[last] = brk;
+        last++;
+    }
+
+    tp_prog_eval_batch_p(pf, params, s->sub_x + s->n_sub, NULL, s->sub_y + s->n_sub, m);
+    s->n_sub += m;
+    s->adapted = last;
+    return 1;
+}
+
+/* intervalos restantes ficam só com a corda */
+static void skip_adapt(TP_Sampler *s) {
+    const int left = s->n - 1 - s->adapted;
+    if (left > 0) {
+        memset(s->sub_n + s->adapted, 0, (size_t)left);
+        memset(s->brk + s->adapted, 0, (size_t)left);
+    }
+    s->adapted = s->n - 1;
+}
+
+int tp_sampler_refine(TP_Sampler *s,
+                      const TP_Program *px, const TP_Program *py,
+                      double budget_ms)
+{
+    if (!s->valid) return 0;
+    if (tp_sampler_complete(s)) return 1;
+
+    const Uint64 freq = SDL_GetPerformanceFrequency();
+    const Uint64 start = SDL_GetPerformanceCounter();
+    const Uint64 limit = (budget_ms > 0.0) ? (Uint64)(budget_ms * (double)freq / 1000.0) : 0;
+
+    int idx[TP_SAMPLE_CHUNK];
+    double t[TP_SAMPLE_CHUNK], vx[TP_SAMPLE_CHUNK], vy[TP_SAMPLE_CHUNK];
+    double g[TP_SAMPLE_CHUNK], h[TP_SAMPLE_CHUNK];
+    const double *params = s->has_params ? s->params : NULL;
+
+    for (;;) {
+        if (s->stride == 0) {
+            /* paramétrica ou tol = 0: sem estágio por curvatura */
+            if (py || !(s->tol > 0.0)) { skip_adapt(s); break; }
+            if (s->adapted >= s->n - 1) break;
+            if (!adapt_chunk(s, px, params)) { skip_adapt(s); break; }
+            if (limit && SDL_GetPerformanceCounter() - start >= limit) break;
+            continue;
+        }
+
+        int m = 0;
+        while (m < TP_SAMPLE_CHUNK) {
+            int i = next_index(s);
+            if (i < 0) break;
+            idx[m] = i;
+            t[m] = s->ts[i];
+            s->done[i] = 1;   /* marca já para o cursor não repetir */
+            m++;
+        }
+        if (m == 0) continue;   /* passes acabaram: estágio final */
+
+        if (py && s->redo == (TP_SAMPLE_X | TP_SAMPLE_Y)) {
+            tp_prog_eval_tuple_p(px, py, params, t, vx, vy, m);
+            for (int k = 0; k < m; k++) {
+                s->xs[idx[k]] = vx[k];
+                s->ys[idx[k]] = vy[k];
+            }
+        } else if (py) {
+            if (s->redo & TP_SAMPLE_X) {
+                tp_prog_eval_batch_p(px, params, t, NULL, vx, m);
+                for (int k = 0; k < m; k++) s->xs[idx[k]] = vx[k];
+            }
+            if (s->redo & TP_SAMPLE_Y) {
+                tp_prog_eval_batch_p(py, params, t, NULL, vy, m);
+                for (int k = 0; k < m; k++) s->ys[idx[k]] = vy[k];
+            }
+        } else {
+            tp_prog_eval_jet_p(px, params, t, NULL, vy, g, h, m);
+            for (int k = 0; k < m; k++) {
+                s->xs[idx[k]] = t[k];
+                s->ys[idx[k]] = vy[k];
+                s->d1s[idx[k]] = g[k];
+                s->d2s[idx[k]] = h[k];
+            }
+        }
+
+        if (limit && SDL_GetPerformanceCounter() - start >= limit) break;
+    }
+
+    return tp_sampler_complete(s);
+}
@@ -1,5 +1,6 @@
 #include "tp_screenshot.h"
 #include <stdio.h>
+#include <string.h>
 
 int tp_screenshot_save_bmp(SDL_Renderer *renderer,
                            int w, int h,
@@ -43,3 +44,52 @@ int tp_screenshot_save_bmp(SDL_Renderer *renderer,
     SDL_FreeSurface(surf);
     return 0;
 }
+
+/* linhas de 3 bytes por pixel completadas até múltiplo de 4 */
+static size_t bmp_row(int w) { return ((size_t)w * 3u + 3u) & ~(size_t)3u; }
+
+size_t tp_screenshot_bmp_size(int w, int h) {
+    return 54u + bmp_row(w) * (size_t)h;
+}
+
+static void put_le32(unsigned char *p, Uint32 v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+void tp_screenshot_encode_bmp(const Uint32 *argb, int pitch, int w, int h,
+                              unsigned char *out)
+{
+    const size_t row = bmp_row(w);
+    const size_t size = tp_screenshot_bmp_size(w, h);
+
+    /* BITMAPFILEHEADER + BITMAPINFOHEADER, sem compressão */
+    memset(out, 0, 54);
+    out[0] = 'B';
+    out[1] = 'M';
+    put_le32(out + 2, (Uint32)size);
+    put_le32(out + 10, 54);
+    put_le32(out + 14, 40);
+    put_le32(out + 18, (Uint32)w);
+    put_le32(out + 22, (Uint32)h);
+    out[26] = 1;
+    out[28] = 24;
+    put_le32(out + 34, (Uint32)(size - 54u));
+    put_le32(out + 38, 2835);   /* 72 dpi */
+    put_le32(out + 42, 2835);
+
+    /* de baixo para cima, BGR */
+    for (int y = 0; y < h; y++) {
+        const Uint32 *src = (const Uint32*)((const unsigned char*)argb + (size_t)(h - 1 - y) * (size_t)pitch);
+        unsigned char *dst = out + 54 + (size_t)y * row;
+        for (int x = 0; x < w; x++) {
+            const Uint32 c = src[x];
+            dst[3 * x] = (unsigned char)c;
+            dst[3 * x + 1] = (unsigned char)(c >> 8);
+            dst[3 * x + 2] = (unsigned char)(c >> 16);
+        }
+        memset(dst + 3 * (size_t)w, 0, row - 3 * (size_t)w);
+    }
+}
@@ -0,0 +1,472 @@
+#include "tp_shape.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------- reconhecimento (pós-ordem, como compile_tree) ---------- */
+
+typedef enum SvKind { SV_NONE, SV_POLY, SV_RAT, SV_TRIG } SvKind;
+
+/* s sin(f x) + c cos(f x), f > 0 */
+typedef struct Term {
+    double f, s, c;
+} Term;
+
+/* forma de uma subárvore; constante = POLY de grau 0 */
+typedef struct SVal {
+    SvKind kind;
+    int deg, deg_den;
+    double p[TP_SHAPE_MAX_DEG + 1];
+    double q[TP_SHAPE_MAX_DEG + 1];
+    double c0;
+    int n_terms;
+    Term t[TP_SHAPE_MAX_HARM];
+    int calls;    /* sin/cos na subárvore (o kernel faz 2 por amostra) */
+} SVal;
+
+static int is_const(const SVal *v) {
+    return v->kind == SV_POLY && v->deg == 0;
+}
+
+/* um termo só: multiplicar por ele não soma nada (sem expandir) */
+static int is_mono(const SVal *v) {
+    if (v->kind != SV_POLY) return 0;
+    int nz = 0;
+    for (int k = 0; k <= v->deg; k++) nz += v->p[k] != 0.0;
+    return nz <= 1;
+}
+
+static void set_const(SVal *r, double k) {
+    r->kind = SV_POLY;
+    r->deg = 0;
+    r->p[0] = k;
+}
+
+static void trim(SVal *r) {
+    while (r->deg > 0 && r->p[r->deg] == 0.0) r->deg--;
+}
+
+/* constante vira soma de senoides sem termos */
+static void to_trig(const SVal *a, SVal *r) {
+    if (a->kind == SV_TRIG) { *r = *a; return; }
+    r->kind = SV_TRIG;
+    r->c0 = a->p[0];
+    r->n_terms = 0;
+    r->calls = a->calls;
+}
+
+static void scale(SVal *r, double k, int divide) {
+    if (r->kind == SV_TRIG) {
+        r->c0 = divide ? r->c0 / k : r->c0 * k;
+        for (int i = 0; i < r->n_terms; i++) {
+            r->t[i].s = divide ? r->t[i].s / k : r->t[i].s * k;
+            r->t[i].c = divide ? r->t[i].c / k : r->t[i].c * k;
+        }
+    } else {
+        for (int i = 0; i <= r->deg; i++) r->p[i] = divide ? r->p[i] / k : r->p[i] * k;
+    }
+}
+
+static void add(const SVal *a, const SVal *b, double sign, SVal *r) {
+    r->kind = SV_NONE;
+    if (a->kind == SV_POLY && b->kind == SV_POLY) {
+        r->kind = SV_POLY;
+        r->deg = a->deg > b->deg ? a->deg : b->deg;
+        for (int k = 0; k <= r->deg; k++) {
+            const double pa = k <= a->deg ? a->p[k] : 0.0;
+            const double pb = k <= b->deg ? b->p[k] : 0.0;
+            r->p[k] = pa + sign * pb;
+        }
+        trim(r);
+        return;
+    }
+    const int ta = a->kind == SV_TRIG || is_const(a);
+    const int tb = b->kind == SV_TRIG || is_const(b);
+    if (!ta || !tb) return;
+
+    SVal bb;
+    to_trig(a, r);
+    to_trig(b, &bb);
+    r->c0 += sign * bb.c0;
+    for (int j = 0; j < bb.n_terms; j++) {
+        int i = 0;
+        while (i < r->n_terms && r->t[i].f != bb.t[j].f) i++;
+        if (i == r->n_terms) {
+            if (i == TP_SHAPE_MAX_HARM) { r->kind = SV_NONE; return; }
+            r->t[i].f = bb.t[j].f;
+            r->t[i].s = r->t[i].c = 0.0;
+            r->n_terms++;
+        }
+        r->t[i].s += sign * bb.t[j].s;
+        r->t[i].c += sign * bb.t[j].c;
+    }
+    r->calls += bb.calls;
+}
+
+static void mul(const SVal *a, const SVal *b, SVal *r) {
+    r->kind = SV_NONE;
+    if (a->kind == SV_POLY && b->kind == SV_POLY && (is_mono(a) || is_mono(b)) &&
+        a->deg + b->deg <= TP_SHAPE_MAX_DEG) {
+        r->kind = SV_POLY;
+        r->deg = a->deg + b->deg;
+        for (int k = 0; k <= r->deg; k++) r->p[k] = 0.0;
+        for (int i = 0; i <= a->deg; i++) {
+            if (a->p[i] == 0.0) continue;
+            for (int j = 0; j <= b->deg; j++) {
+                if (b->p[j] != 0.0) r->p[i + j] += a->p[i] * b->p[j];
+            }
+        }
+        trim(r);
+        return;
+    }
+    /* constante vezes soma de senoides ou racional */
+    const SVal *k = is_const(a) ? a : is_const(b) ? b : NULL;
+    const SVal *o = k == a ? b : a;
+    if (k && (o->kind == SV_TRIG || o->kind == SV_RAT)) {
+        *r = *o;
+        scale(r, k->p[0], 0);
+    }
+}
+
+static void divide(const SVal *a, const SVal *b, SVal *r) {
+    r->kind = SV_NONE;
+    if (is_const(b)) {
+        if (b->p[0] == 0.0 || a->kind == SV_NONE) return;
+        *r = *a;
+        scale(r, b->p[0], 1);
+        return;
+    }
+    if (a->kind == SV_POLY && b->kind == SV_POLY) {
+        r->kind = SV_RAT;
+        r->deg = a->deg;
+        r->deg_den = b->deg;
+        memcpy(r->p, a->p, sizeof(a->p));
+        memcpy(r->q, b->p, sizeof(b->p));
+    }
+}
+
+/* monômio c x^d elevado a e (inteiro >= 0) */
+static void power(const SVal *a, const SVal *b, SVal *r) {
+    r->kind = SV_NONE;
+    if (!is_const(b) || !is_mono(a)) return;
+    const double e = b->p[0];
+    if (e != floor(e) || e < 0.0 || a->deg * e > TP_SHAPE_MAX_DEG) return;
+    const int d = a->deg * (int)e;
+    r->kind = SV_POLY;
+    r->deg = d;
+    for (int k = 0; k <= d; k++) r->p[k] = 0.0;
+    r->p[d] = pow(a->p[a->deg], e);
+}
+
+/* sin/cos(f x + fase) -> a sin(|f| x) + b cos(|f| x) */
+static void trig(TP_Func1 fn, const SVal *a, SVal *r) {
+    r->kind = SV_NONE;
+    if ((fn != TP_F_SIN && fn != TP_F_COS) || a->kind != SV_POLY || a->deg != 1) return;
+    double f = a->p[1], ph = a->p[0], sg = 1.0;
+    if (f < 0.0) {
+        /* sin(-u) = -sin(u), cos(-u) = cos(u) */
+        f = -f;
+        ph = -ph;
+        sg = fn == TP_F_SIN ? -1.0 : 1.0;
+    }
+    const double cp = cos(ph), sp = sin(ph);
+    r->kind = SV_TRIG;
+    r->c0 = 0.0;
+    r->n_terms = 1;
+    r->t[0].f = f;
+    r->t[0].s = fn == TP_F_SIN ? sg * cp : -sp;
+    r->t[0].c = fn == TP_F_SIN ? sg * sp : cp;
+    r->calls = 1;
+}
+
+/* valores ligados a slots (LET); bound = 0 fora do escopo */
+typedef struct Slots {
+    SVal *v;
+    unsigned char *bound;
+    int n;
+} Slots;
+
+static int bind(Slots *s, int slot, const SVal *v) {
+    if (slot >= s->n) {
+        int n = s->n ? s->n : 16;
+        while (n <= slot) n *= 2;
+        SVal *nv = (SVal*)realloc(s->v, (size_t)n * sizeof(SVal));
+        if (!nv) return 0;
+        s->v = nv;
+        unsigned char *nb = (unsigned char*)realloc(s->bound, (size_t)n);
+        if (!nb) return 0;
+        memset(nb + s->n, 0, (size_t)(n - s->n));
+        s->bound = nb;
+        s->n = n;
+    }
+    s->v[slot] = *v;
+    s->bound[slot] = 1;
+    return 1;
+}
+
+static void finish(const SVal *v, TP_Shape *sh, int *ok) {
+    *ok = 0;
+    memset(sh, 0, sizeof(*sh));
+    if (v->kind == SV_POLY) {
+        sh->kind = TP_SHAPE_POLY;
+        sh->deg_num = v->deg;
+        memcpy(sh->num, v->p, sizeof(v->p));
+        *ok = 1;
+    } else if (v->kind == SV_RAT) {
+        sh->kind = TP_SHAPE_RATIONAL;
+        sh->deg_num = v->deg;
+        sh->deg_den = v->deg_den;
+        memcpy(sh->num, v->p, sizeof(v->p));
+        memcpy(sh->den, v->q, sizeof(v->q));
+        *ok = 1;
+    } else if (v->kind == SV_TRIG && v->n_terms > 0 && v->calls >= 2) {
+        /* um sin/cos só: o genérico já faz uma chamada, nada a ganhar */
+        double w = v->t[0].f;
+        for (int i = 1; i < v->n_terms; i++) if (v->t[i].f < w) w = v->t[i].f;
+        sh->kind = TP_SHAPE_TRIG;
+        sh->c0 = v->c0;
+        sh->w = w;
+        for (int i = 0; i < v->n_terms; i++) {
+            const double m = floor(v->t[i].f / w + 0.5);
+            if (m > TP_SHAPE_MAX_HARM || fabs(v->t[i].f - m * w) > 1e-12 * v->t[i].f) return;
+            const int k = (int)m;
+            sh->s[k] += v->t[i].s;
+            sh->c[k] += v->t[i].c;
+            if (k > sh->n_harm) sh->n_harm = k;
+        }
+        *ok = 1;
+    }
+}
+
+TP_Shape *tp_shape_detect(const TP_Node *root) {
+    if (!root || root->type == TP_NODE_TUPLE2) return NULL;
+
+    int cap = 16, sp = 0, failed = 0;
+    SVal *vs = (SVal*)malloc((size_t)cap * sizeof(SVal));
+    Slots slots = { NULL, NULL, 0 };
+    if (!vs) return NULL;
+
+    TP_AstWalk w;
+    tp_ast_walk_init(&w, root);
+    const TP_Node *n;
+    while (!failed && (n = tp_ast_walk_next(&w)) != NULL) {
+        const int nc = tp_ast_nchildren(n);
+        sp -= nc;
+        const SVal *a = vs + sp;
+        SVal r;
+        r.kind = SV_NONE;
+        r.calls = 0;
+        for (int i = 0; i < nc; i++) r.calls += a[i].calls;
+
+        int all_const = nc > 0;
+        for (int i = 0; i < nc; i++) all_const &= is_const(&a[i]);
+
+        switch (n->type) {
+            case TP_NODE_NUMBER: set_const(&r, n->as.number); break;
+            case TP_NODE_VAR_X:
+                r.kind = SV_POLY;
+                r.deg = 1;
+                r.p[0] = 0.0;
+                r.p[1] = 1.0;
+                break;
+            case TP_NODE_LET:
+                r = a[1];
+                break;
+            case TP_NODE_SLOT:
+                if (n->as.slot < slots.n && slots.bound[n->as.slot]) r = slots.v[n->as.slot];
+                break;
+            default:
+                if (all_const && n->type != TP_NODE_TUPLE2 && n->type != TP_NODE_PARAM) {
+                    /* mesma dobra de constantes do bytecode */
+                    double k[2] = { a[0].p[0], nc == 2 ? a[1].p[0] : 0.0 };
+                    set_const(&r, tp_ast_apply(n, k, 0.0, NAN));
+                    break;
+                }
+                switch (n->type) {
+                    case TP_NODE_UNARY_NEG:
+                        if (a[0].kind != SV_NONE) { r = a[0]; scale(&r, -1.0, 0); }
+                        break;
+                    case TP_NODE_ADD: add(&a[0], &a[1], 1.0, &r); break;
+                    case TP_NODE_SUB: add(&a[0], &a[1], -1.0, &r); break;
+                    case TP_NODE_MUL: mul(&a[0], &a[1], &r); break;
+                    case TP_NODE_DIV:
+                    case TP_NODE_FRAC: divide(&a[0], &a[1], &r); break;
+                    case TP_NODE_POW: power(&a[0], &a[1], &r); break;
+                    case TP_NODE_FUNC1: trig(n->as.func1.f, &a[0], &r); break;
+                    default: break;   /* y, parâmetros, tupla */
+                }
+                break;
+        }
+
+        if (sp == cap) {
+            SVal *nv = (SVal*)realloc(vs, (size_t)cap * 2 * sizeof(SVal));
+            if (!nv) { failed = 1; break; }
+            vs = nv;
+            cap *= 2;
+        }
+        vs[sp++] = r;
+
+        /* acabou o valor de um LET: liga o slot antes de descer no corpo */
+        if (w.sp > 0 && w.st[w.sp - 1].n->type == TP_NODE_LET && w.st[w.sp - 1].next == 1 &&
+            !bind(&slots, w.st[w.sp - 1].n->as.let.slot, &r))
+            failed = 1;
+    }
+
+    TP_Shape *sh = NULL;
+    if (!failed && !w.failed && sp == 1) {
+        sh = (TP_Shape*)malloc(sizeof(TP_Shape));
+        int ok = 0;
+        if (sh) finish(&vs[0], sh, &ok);
+        if (!ok) { free(sh); sh = NULL; }
+    }
+
+    tp_ast_walk_free(&w);
+    free(slots.v);
+    free(slots.bound);
+    free(vs);
+    return sh;
+}
+
+/* ---------- kernels ---------- */
+
+/* amostras por bloco (buffers na pilha) */
+#define TP_SHAPE_BLOCK 64
+
+/* Horner de grau fixo, um por grau: o laço dos coeficientes desenrola
+   e o das amostras vetoriza. O jato acumula p'' e p' junto (dd, d). */
+#define TP_SHAPE_DEGREES(X) \
+    X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12)
+
+#if TP_SHAPE_MAX_DEG != 12
+#error "TP_SHAPE_DEGREES precisa cobrir 0..TP_SHAPE_MAX_DEG"
+#endif
+
+#define HORNER(D)                                                          \
+    static void horner_##D(const double *c, const double *x,              \
+                           double *out, int m) {                           \
+        for (int i = 0; i < m; i++) {                                      \
+            double r = c[D];                                               \
+            for (int k = D - 1; k >= 0; k--) r = r * x[i] + c[k];          \
+            out[i] = r;                                                    \
+        }                                                                  \
+    }
+
+#define HORNER_JET(D)                                                      \
+    static void horner_jet_##D(const double *c, const double *x,          \
+                               double *out, double *d1, double *d2, int m) { \
+        for (int i = 0; i < m; i++) {                                      \
+            double r = c[D], d = 0.0, dd = 0.0;                            \
+            for (int k = D - 1; k >= 0; k--) {                             \
+                dd = dd * x[i] + 2.0 * d;                                  \
+                d = d * x[i] + r;                                          \
+                r = r * x[i] + c[k];                                       \
+            }                                                              \
+            out[i] = r;                                                    \
+            d1[i] = d;                                                     \
+            d2[i] = dd;                                                    \
+        }                                                                  \
+    }
+
+TP_SHAPE_DEGREES(HORNER)
+TP_SHAPE_DEGREES(HORNER_JET)
+
+typedef void (*HornerFn)(const double *c, const double *x, double *out, int m);
+typedef void (*HornerJetFn)(const double *c, const double *x,
+                            double *out, double *d1, double *d2, int m);
+
+#define HORNER_ENTRY(D) horner_##D,
+#define HORNER_JET_ENTRY(D) horner_jet_##D,
+
+static const HornerFn horner[] = { TP_SHAPE_DEGREES(HORNER_ENTRY) };
+static const HornerJetFn horner_jet[] = { TP_SHAPE_DEGREES(HORNER_JET_ENTRY) };
+
+/* Soma de senoides num bloco: sin/cos de w x uma vez, harmônico m+1 por
+   rotação de (cos, sin) do m. d1 NULL: só o valor (mesma conta). */
+static void trig_block(const TP_Shape *s, const double *x,
+                       double *out, double *d1, double *d2, int m)
+{
+    double s1[TP_SHAPE_BLOCK], c1[TP_SHAPE_BLOCK];
+    double sm[TP_SHAPE_BLOCK], cm[TP_SHAPE_BLOCK];
+    const double w = s->w;
+
+    for (int i = 0; i < m; i++) {
+        const double u = w * x[i];
+        s1[i] = sin(u);
+        c1[i] = cos(u);
+    }
+    for (int i = 0; i < m; i++) {
+        sm[i] = s1[i];
+        cm[i] = c1[i];
+        out[i] = s->c0 + s->s[1] * s1[i] + s->c[1] * c1[i];
+    }
+    if (d1) {
+        for (int i = 0; i < m; i++) {
+            d1[i] = w * (s->s[1] * c1[i] - s->c[1] * s1[i]);
+            d2[i] = -w * w * (s->s[1] * s1[i] + s->c[1] * c1[i]);
+        }
+    }
+
+    for (int k = 2; k <= s->n_harm; k++) {
+        const double a = s->s[k], b = s->c[k];
+        for (int i = 0; i < m; i++) {
+            const double cn = cm[i] * c1[i] - sm[i] * s1[i];
+            sm[i] = sm[i] * c1[i] + cm[i] * s1[i];
+            cm[i] = cn;
+            out[i] += a * sm[i] + b * cm[i];
+        }
+        if (d1) {
+            const double f = k * w;
+            for (int i = 0; i < m; i++) {
+                d1[i] += f * (a * cm[i] - b * sm[i]);
+                d2[i] -= f * f * (a * sm[i] + b * cm[i]);
+            }
+        }
+    }
+}
+
+void tp_shape_eval(const TP_Shape *s, const double *xs, double *out, int n) {
+    for (int base = 0; base < n; base += TP_SHAPE_BLOCK) {
+        const int m = (n - base < TP_SHAPE_BLOCK) ? (n - base) : TP_SHAPE_BLOCK;
+        const double *x = xs + base;
+        double *o = out + base;
+
+        if (s->kind == TP_SHAPE_POLY) {
+            horner[s->deg_num](s->num, x, o, m);
+        } else if (s->kind == TP_SHAPE_RATIONAL) {
+            double q[TP_SHAPE_BLOCK];
+            horner[s->deg_num](s->num, x, o, m);
+            horner[s->deg_den](s->den, x, q, m);
+            for (int i = 0; i < m; i++) o[i] /= q[i];
+        } else {
+            trig_block(s, x, o, NULL, NULL, m);
+        }
+    }
+}
+
+void tp_shape_eval_jet(const TP_Shape *s, const double *xs,
+                       double *out, double *d1, double *d2, int n)
+{
+    for (int base = 0; base < n; base += TP_SHAPE_BLOCK) {
+        const int m = (n - base < TP_SHAPE_BLOCK) ? (n - base) : TP_SHAPE_BLOCK;
+        const double *x = xs + base;
+        double *o = out + base, *g = d1 + base, *h = d2 + base;
+
+        if (s->kind == TP_SHAPE_POLY) {
+            horner_jet[s->deg_num](s->num, x, o, g, h, m);
+        } else if (s->kind == TP_SHAPE_RATIONAL) {
+            double b[TP_SHAPE_BLOCK], b1[TP_SHAPE_BLOCK], b2[TP_SHAPE_BLOCK];
+            horner_jet[s->deg_num](s->num, x, o, g, h, m);
+            horner_jet[s->deg_den](s->den, x, b, b1, b2, m);
+            /* regra do quociente, como TP_OP_DIV no jato */
+            for (int i = 0; i < m; i++) {
+                const double q = o[i] / b[i];
+                const double q1 = (g[i] - q * b1[i]) / b[i];
+                o[i] = q;
+                g[i] = q1;
+                h[i] = (h[i] - 2.0 * q1 * b1[i] - q * b2[i]) / b[i];
+            }
+        } else {
+            trig_block(s, x, o, g, h, m);
+        }
+    }
+}
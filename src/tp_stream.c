@@ -0,0 +1,325 @@
+/* poll e accept não fazem parte do C99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include "tp_stream.h"
+#include "tp_data.h"
+#include "tp_net.h"
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define TP_STREAM_MASK ((unsigned int)TP_STREAM_RING - 1u)
+
+/* espera máxima em poll(): quanto o close demora a ver o quit */
+#define TP_STREAM_POLL_MS 50
+
+/* ---------- anel SPSC ---------- */
+
+/* Copia n pontos para o anel e publica o novo head (SDL_AtomicSet tem
+   barreira total: o render nunca vê head antes dos pontos). Anel cheio:
+   espera o render drenar. Retorna 0, ou -1 se pediram para sair. */
+static int ring_push(TP_Stream *st, const TP_StreamPoint *p, int n) {
+    while (n > 0) {
+        const unsigned int head = (unsigned int)SDL_AtomicGet(&st->head);
+        const unsigned int tail = (unsigned int)SDL_AtomicGet(&st->tail);
+        const unsigned int room = (unsigned int)TP_STREAM_RING - (head - tail);
+        if (room == 0) {
+            if (SDL_AtomicGet(&st->quit)) return -1;
+            SDL_Delay(1);
+            continue;
+        }
+        const int m = (unsigned int)n < room ? n : (int)room;
+        for (int i = 0; i < m; i++) st->ring[(head + (unsigned int)i) & TP_STREAM_MASK] = p[i];
+        SDL_AtomicSet(&st->head, (int)(head + (unsigned int)m));
+        p += m;
+        n -= m;
+    }
+    return 0;
+}
+
+/* ---------- leitora ---------- */
+
+/* estado de uma conexão (stdin inteiro ou um cliente do socket) */
+typedef struct Reader {
+    TP_Stream *st;
+    TP_StreamPoint batch[TP_STREAM_BATCH];
+    int nb;
+    int mode;                  /* 0: indefinido, 1: só y, 2: x,y */
+    unsigned long long idx;    /* x dos pontos só-y */
+} Reader;
+
+static int flush(Reader *rd) {
+    const int rc = ring_push(rd->st, rd->batch, rd->nb);
+    rd->nb = 0;
+    return rc;
+}
+
+/* uma linha sem o '\n'; como no CSV de --data, a primeira linha
+   numérica decide se a sessão é "y" ou "x,y" */
+static int line(Reader *rd, const char *p, const char *eol) {
+    double v[2];
+    const int k = tp_data_fields(p, eol, v);
+    if (k == 0) return 0;
+    if (rd->mode == 0) {
+        rd->mode = k == 1 ? 1 : 2;
+        SDL_AtomicSet(&rd->st->y_only, rd->mode == 1);
+    }
+
+    TP_StreamPoint *pt = &rd->batch[rd->nb++];
+    if (rd->mode == 1) {
+        pt->x = (double)rd->idx;
+        pt->y = v[0];
+    } else {
+        /* "x," sem y: buraco */
+        pt->x = v[0];
+        pt->y = k == 2 ? v[1] : NAN;
+    }
+    rd->idx++;
+    return rd->nb == TP_STREAM_BATCH ? flush(rd) : 0;
+}
+
+/* espera fd ficar legível. 1: legível, 0: quit, -1: erro */
+static int wait_readable(TP_Stream *st, int fd) {
+    for (;;) {
+        if (SDL_AtomicGet(&st->quit)) return 0;
+        struct pollfd pf = { fd, POLLIN, 0 };
+        const int rc = poll(&pf, 1, TP_STREAM_POLL_MS);
+        if (rc > 0) return 1;
+        if (rc < 0 && errno != EINTR) return -1;
+    }
+}
+
+/* lê fd até o fim. 0: fim da fonte, -1: quit */
+static int read_session(Reader *rd, int fd, char *buf) {
+    size_t have = 0;
+    int skip = 0;              /* dentro de uma linha longa demais */
+    rd->mode = 0;
+    for (;;) {
+        const int w = wait_readable(rd->st, fd);
+        if (w == 0) return -1;
+        if (w < 0) break;
+        const ssize_t got = read(fd, buf + have, TP_STREAM_READ - have);
+        if (got < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        if (got <= 0) break;
+        have += (size_t)got;
+
+        /* linhas completas; o resto espera o próximo read() */
+        const char *p = buf, *end = buf + have;
+        const char *eol;
+        if (skip) {
+            /* cauda da linha descartada: não vira linha nova */
+            eol = (const char*)memchr(p, '\n', (size_t)(end - p));
+            if (!eol) {
+                have = 0;
+                continue;
+            }
+            p = eol + 1;
+            skip = 0;
+        }
+        while ((eol = (const char*)memchr(p, '\n', (size_t)(end - p))) != NULL) {
+            if (line(rd, p, eol) != 0) return -1;
+            p = eol + 1;
+        }
+        have = (size_t)(end - p);
+        /* linha maior que o buffer: lixo, descarta até o próximo '\n' */
+        if (have == TP_STREAM_READ) {
+            have = 0;
+            skip = 1;
+        }
+        memmove(buf, p, have);
+
+        /* taxa baixa: ponto aparece já, sem esperar encher o lote */
+        if (flush(rd) != 0) return -1;
+    }
+    if (have > 0 && line(rd, buf, buf + have) != 0) return -1;
+    return flush(rd);
+}
+
+static int reader_main(void *data) {
+    TP_Stream *st = (TP_Stream*)data;
+    char *buf = (char*)malloc(TP_STREAM_READ);
+    Reader *rd = (Reader*)calloc(1, sizeof(*rd));
+    if (!buf || !rd) {
+        fprintf(stderr, "Aviso: stream sem memoria\n");
+        free(buf);
+        free(rd);
+        SDL_AtomicIncRef(&st->ended);
+        return 1;
+    }
+    rd->st = st;
+
+    if (!st->is_socket) {
+        if (read_session(rd, st->fd, buf) == 0) SDL_AtomicIncRef(&st->ended);
+    } else {
+        /* um cliente por vez; o x dos pontos só-y continua entre clientes */
+        while (wait_readable(st, st->fd) > 0) {
+            const int c = accept(st->fd, NULL, NULL);
+            if (c < 0) continue;
+            const int rc = read_session(rd, c, buf);
+            close(c);
+            if (rc != 0) break;
+            SDL_AtomicIncRef(&st->ended);
+        }
+    }
+
+    free(buf);
+    free(rd);
+    return 0;
+}
+
+/* ---------- abertura ---------- */
+
+int tp_stream_open(TP_Stream *st, const char *src, char *err, int err_sz) {
+    memset(st, 0, sizeof(*st));
+    st->fd = -1;
+    st->is_socket = strcmp(src, "-") != 0;
+
+    st->ring = (TP_StreamPoint*)malloc(sizeof(TP_StreamPoint) * TP_STREAM_RING);
+    if (!st->ring) {
+        snprintf(err, (size_t)err_sz, "sem memoria");
+        return 1;
+    }
+
+    if (st->is_socket) {
+        st->fd = tp_net_listen_unix(src, 1, err, err_sz);
+        if (st->fd < 0) {
+            tp_stream_close(st);
+            return 1;
+        }
+        st->path = src;
+    } else {
+        st->fd = STDIN_FILENO;
+    }
+
+    st->thread = SDL_CreateThread(reader_main, "tp_stream", st);
+    if (!st->thread) {
+        snprintf(err, (size_t)err_sz, "falha ao criar thread de leitura: %s", SDL_GetError());
+        tp_stream_close(st);
+        return 1;
+    }
+    return 0;
+}
+
+void tp_stream_close(TP_Stream *st) {
+    if (st->thread) {
+        SDL_AtomicSet(&st->quit, 1);
+        SDL_WaitThread(st->thread, NULL);
+    }
+    if (st->is_socket && st->fd >= 0) close(st->fd);
+    if (st->path) unlink(st->path);
+    free(st->ring);
+    memset(st, 0, sizeof(*st));
+    st->fd = -1;
+}
+
+int tp_stream_ended(TP_Stream *st) {
+    return SDL_AtomicGet(&st->ended) > 0;
+}
+
+/* ---------- janela ---------- */
+
+int tp_stream_win_init(TP_StreamWin *w, unsigned long long n) {
+    memset(w, 0, sizeof(*w));
+    if (n == 0) n = 1;
+    w->n = n;
+    w->k = (n + TP_STREAM_BINS - 1) / TP_STREAM_BINS;
+
+    /* baldes tocados pela janela: ceil(n/k) + 1 parcial no começo */
+    w->n_bin = (int)((n + w->k - 1) / w->k) + 1;
+    w->bin = (TP_StreamBin*)malloc(sizeof(TP_StreamBin) * (size_t)w->n_bin);
+    if (!w->bin) return -1;
+    for (int i = 0; i < w->n_bin; i++) w->bin[i].j = (unsigned long long)-1;
+    return 0;
+}
+
+void tp_stream_win_free(TP_StreamWin *w) {
+    free(w->bin);
+    memset(w, 0, sizeof(*w));
+}
+
+static void win_push(TP_StreamWin *w, double x, double y) {
+    const unsigned long long j = w->count / w->k;
+    TP_StreamBin *b = &w->bin[j % (unsigned long long)w->n_bin];
+    if (b->j != j) {
+        b->j = j;
+        b->x0 = x;
+        b->y0 = y;
+        b->lo_y = INFINITY;
+        b->hi_y = -INFINITY;
+        b->lo_first = 1;
+    }
+    b->x1 = x;
+    b->y1 = y;
+    if (isfinite(x) && isfinite(y)) {
+        if (y < b->lo_y) { b->lo_x = x; b->lo_y = y; b->lo_first = 0; }
+        if (y > b->hi_y) { b->hi_x = x; b->hi_y = y; b->lo_first = 1; }
+    }
+    w->count++;
+}
+
+size_t tp_stream_drain(TP_Stream *st, TP_StreamWin *w) {
+    const unsigned int tail = (unsigned int)SDL_AtomicGet(&st->tail);
+    const unsigned int head = (unsigned int)SDL_AtomicGet(&st->head);
+    for (unsigned int i = tail; i != head; i++) {
+        const TP_StreamPoint *p = &st->ring[i & TP_STREAM_MASK];
+        win_push(w, p->x, p->y);
+    }
+    /* libera os slots só depois de ler */
+    SDL_AtomicSet(&st->tail, (int)head);
+    w->y_only = SDL_AtomicGet(&st->y_only);
+    return (size_t)(head - tail);
+}
+
+int tp_stream_win_bins(const TP_StreamWin *w, unsigned long long *first) {
+    if (w->count == 0) {
+        *first = 0;
+        return 0;
+    }
+    const unsigned long long i0 = w->count > w->n ? w->count - w->n : 0;
+    *first = i0 / w->k;
+    return (int)((w->count - 1) / w->k - *first + 1);
+}
+
+int tp_stream_win_view(const TP_StreamWin *w, TP_View *view, int fit_y) {
+    unsigned long long j0;
+    const int nb = tp_stream_win_bins(w, &j0);
+    if (nb == 0) return 0;
+
+    double xmin = INFINITY, xmax = -INFINITY, ymin = INFINITY, ymax = -INFINITY;
+    for (int i = 0; i < nb; i++) {
+        const TP_StreamBin *b = &w->bin[(j0 + (unsigned long long)i) % (unsigned long long)w->n_bin];
+        if (b->lo_y > b->hi_y) continue;
+        if (b->lo_y < ymin) ymin = b->lo_y;
+        if (b->hi_y > ymax) ymax = b->hi_y;
+        xmin = fmin(xmin, fmin(b->lo_x, b->hi_x));
+        xmax = fmax(xmax, fmax(b->lo_x, b->hi_x));
+        if (isfinite(b->x0)) { xmin = fmin(xmin, b->x0); xmax = fmax(xmax, b->x0); }
+        if (isfinite(b->x1)) { xmin = fmin(xmin, b->x1); xmax = fmax(xmax, b->x1); }
+    }
+
+    if (w->y_only) {
+        /* osciloscópio: largura fixa de N, enche da esquerda e depois rola */
+        const double last = (double)(w->count - 1);
+        const double span = w->n > 1 ? (double)(w->n - 1) : 1.0;
+        view->xmax = last > span ? last : span;
+        view->xmin = view->xmax - span;
+    } else if (xmin <= xmax) {
+        double pad = (xmax - xmin) * 0.02;
+        if (pad <= 0) pad = 1.0;
+        view->xmin = xmin - pad;
+        view->xmax = xmax + pad;
+    }
+
+    if (fit_y && ymin <= ymax) {
+        double pad = (ymax - ymin) * 0.05;
+        if (pad <= 0) pad = 1.0;
+        view->ymin = ymin - pad;
+        view->ymax = ymax + pad;
+    }
+    return 1;
+}
@@ -0,0 +1,331 @@
+#include "tp_sym.h"
+#include <stdlib.h>
+#include <string.h>
+
+void tp_sym_init(TP_SymTab *t) {
+    t->syms = NULL;
+    t->n = 0;
+    t->cap = 0;
+    t->index = NULL;
+    t->n_index = 0;
+    t->n_slots = 0;
+    t->n_param = 0;
+}
+
+void tp_sym_free(TP_SymTab *t) {
+    for (int i = 0; i < t->n; i++) tp_ast_free(t->syms[i].body);
+    free(t->syms);
+    free(t->index);
+    tp_sym_init(t);
+}
+
+static unsigned long hash_name(const char *s, size_t len) {
+    unsigned long h = 2166136261ul;   /* FNV-1a */
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619ul;
+    }
+    return h;
+}
+
+/* entrada do nome no índice: a do símbolo, ou a vazia onde ele entraria */
+static int *lookup(const TP_SymTab *t, const char *name, size_t len) {
+    const int mask = t->n_index - 1;
+    int i = (int)(hash_name(name, len) & (unsigned long)mask);
+    while (t->index[i]) {
+        const TP_Symbol *s = &t->syms[t->index[i] - 1];
+        if (s->len == len && memcmp(s->name, name, len) == 0) break;
+        i = (i + 1) & mask;
+    }
+    return &t->index[i];
+}
+
+static int rehash(TP_SymTab *t) {
+    const int n = t->n_index ? t->n_index * 2 : 16;
+    int *idx = (int*)calloc((size_t)n, sizeof(int));
+    if (!idx) return 0;
+    free(t->index);
+    t->index = idx;
+    t->n_index = n;
+    for (int i = 0; i < t->n; i++) {
+        *lookup(t, t->syms[i].name, t->syms[i].len) = i + 1;
+    }
+    return 1;
+}
+
+int tp_sym_find(const TP_SymTab *t, const char *name, size_t len) {
+    if (t->n == 0) return -1;
+    return *lookup(t, name, len) - 1;
+}
+
+int tp_sym_param(const TP_SymTab *t, const char *name, size_t len) {
+    for (int i = 0; i < t->n_param; i++) {
+        if (t->param_len[i] == len && memcmp(t->param[i], name, len) == 0) return i;
+    }
+    return -1;
+}
+
+/* folha que pode ser copiada em vez de calculada uma vez num LET */
+static int is_trivial(const TP_Node *n) {
+    switch (n->type) {
+        case TP_NODE_NUMBER:
+        case TP_NODE_VAR_X:
+        case TP_NODE_VAR_Y:
+        case TP_NODE_SLOT:
+        case TP_NODE_PARAM:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int tp_sym_define(TP_SymTab *t, const char *name, size_t len, int n_params,
+                  TP_Node *body, int mark) {
+    if ((t->n + 1) * 2 > t->n_index && !rehash(t)) goto fail;
+    if (t->n == t->cap) {
+        const int ncap = t->cap ? t->cap * 2 : 8;
+        TP_Symbol *ns = (TP_Symbol*)realloc(t->syms, (size_t)ncap * sizeof(TP_Symbol));
+        if (!ns) goto fail;
+        t->syms = ns;
+        t->cap = ncap;
+    }
+
+    TP_Symbol *s = &t->syms[t->n];
+    memset(s, 0, sizeof(*s));
+    s->name = name;
+    s->len = len;
+    s->n_params = n_params;
+    s->slot = -1;
+    s->body = body;
+
+    if (n_params < 0) {
+        s->slot = t->n_slots++;
+    } else {
+        /* LETs do corpo (de chamadas feitas nele) ganham ids locais
+           -(j+1); cada instância troca por slots novos */
+        TP_AstWalk w;
+        const TP_Node *c;
+        tp_ast_walk_init(&w, body);
+        while ((c = tp_ast_walk_next(&w)) != NULL) {
+            TP_Node *m = (TP_Node*)c;
+            if (m->type == TP_NODE_PARAM) {
+                s->uses[m->as.slot]++;
+            } else if (m->type == TP_NODE_SLOT && m->as.slot >= mark) {
+                m->as.slot = -(m->as.slot - mark) - 1;
+            } else if (m->type == TP_NODE_LET && m->as.let.slot >= mark) {
+                m->as.let.slot = -(m->as.let.slot - mark) - 1;
+            }
+        }
+        const int failed = w.failed;
+        tp_ast_walk_free(&w);
+        if (failed) goto fail;
+
+        s->n_locals = t->n_slots - mark;
+        t->n_slots = mark;
+    }
+
+    *lookup(t, name, len) = t->n + 1;
+    return t->n++;
+
+fail:
+    tp_ast_free(body);
+    return -1;
+}
+
+/* ---------- instância de função ---------- */
+
+/* cópia do template com os slots locais da instância nos SLOTs */
+static int local_leaf(void *ctx, const TP_Node *leaf, TP_Node **out) {
+    if (leaf->type == TP_NODE_SLOT && leaf->as.slot < 0) {
+        *out = tp_node_slot(*(const int*)ctx - leaf->as.slot - 1);
+        return *out != NULL;
+    }
+    return 1;
+}
+
+/* Cópia do argumento para o próximo uso; o último leva o original,
+   então cada argumento é copiado no máximo (usos - 1) vezes. */
+static TP_Node *take(TP_Node **bind, int *left) {
+    if (--*left > 0) return tp_ast_clone(*bind);
+    TP_Node *n = *bind;
+    *bind = NULL;
+    return n;
+}
+
+TP_Node *tp_sym_call(TP_SymTab *t, int fn, TP_Node **args) {
+    const TP_Symbol *f = &t->syms[fn];
+    TP_Node *bind[TP_SYM_MAX_PARAMS];   /* o que entra no lugar de PARAM i */
+    TP_Node *let_val[TP_SYM_MAX_PARAMS];
+    int let_slot[TP_SYM_MAX_PARAMS];
+    int left[TP_SYM_MAX_PARAMS];
+    int base = t->n_slots;
+    int ok = 1;
+
+    t->n_slots += f->n_locals;
+
+    for (int i = 0; i < f->n_params; i++) {
+        bind[i] = NULL;
+        let_val[i] = NULL;
+        let_slot[i] = -1;
+        left[i] = f->uses[i];
+        if (f->uses[i] == 0) {
+            tp_ast_free(args[i]);
+        } else if (f->uses[i] == 1 || is_trivial(args[i])) {
+            bind[i] = args[i];
+        } else {
+            /* usado mais de uma vez: calcula uma vez só */
+            let_slot[i] = t->n_slots++;
+            let_val[i] = args[i];
+            bind[i] = tp_node_slot(let_slot[i]);
+            if (!bind[i]) ok = 0;
+        }
+        args[i] = NULL;
+    }
+
+    TP_Node *body = ok ? tp_ast_clone_map(f->body, local_leaf, &base) : NULL;
+
+    /* LETs locais ganham os slots da instância; PARAMs viram os
+       argumentos, trocados no pai (os argumentos não são percorridos) */
+    if (body) {
+        TP_AstWalk w;
+        const TP_Node *c;
+        tp_ast_walk_init(&w, body);
+        while (ok && (c = tp_ast_walk_next(&w)) != NULL) {
+            TP_Node *m = (TP_Node*)c;
+            if (m->type == TP_NODE_LET && m->as.let.slot < 0) {
+                m->as.let.slot = base - m->as.let.slot - 1;
+            } else if (m->type == TP_NODE_PARAM) {
+                const int pi = m->as.slot;
+                TP_Node *a = take(&bind[pi], &left[pi]);
+                if (!a) { ok = 0; break; }
+                if (w.sp > 0) tp_ast_set_child(w.st[w.sp - 1].n, w.st[w.sp - 1].next - 1, a);
+                else body = a;
+                tp_ast_free(m);
+            }
+        }
+        if (w.failed) ok = 0;
+        tp_ast_walk_free(&w);
+    }
+    if (!ok) {
+        tp_ast_free(body);
+        body = NULL;
+    }
+
+    for (int i = f->n_params - 1; i >= 0; i--) {
+        tp_ast_free(bind[i]);
+        if (!let_val[i]) continue;
+        TP_Node *l = body ? tp_node_let(let_slot[i], let_val[i], body) : NULL;
+        if (!l) {
+            tp_ast_free(let_val[i]);
+            tp_ast_free(body);
+            body = NULL;
+            continue;
+        }
+        body = l;
+    }
+    return body;
+}
+
+/* ---------- variáveis ---------- */
+
+typedef struct Resolve {
+    TP_Node **val;   /* valor resolvido de cada slot de variável */
+    char *inl;       /* 1: entra no lugar de cada SLOT */
+    int *left;       /* referências ainda por trocar */
+    int n;
+} Resolve;
+
+static int resolve_leaf(void *ctx, const TP_Node *leaf, TP_Node **out) {
+    Resolve *r = (Resolve*)ctx;
+    const int g = leaf->as.slot;
+    if (leaf->type == TP_NODE_SLOT && g >= 0 && g < r->n && r->inl[g]) {
+        *out = take(&r->val[g], &r->left[g]);
+        return *out != NULL;
+    }
+    return 1;
+}
+
+static int count_refs(const TP_Node *n, int *refs, int n_refs) {
+    TP_AstWalk w;
+    const TP_Node *c;
+    tp_ast_walk_init(&w, n);
+    while ((c = tp_ast_walk_next(&w)) != NULL) {
+        if (c->type == TP_NODE_SLOT && c->as.slot >= 0 && c->as.slot < n_refs) refs[c->as.slot]++;
+    }
+    const int ok = !w.failed;
+    tp_ast_walk_free(&w);
+    return ok;
+}
+
+static TP_Node *finish_one(TP_SymTab *t, TP_Node *root) {
+    const int ns = t->n_slots;
+    int *refs = (int*)calloc((size_t)ns + 1, sizeof(int));
+    Resolve r;
+    r.val = (TP_Node**)calloc((size_t)ns + 1, sizeof(TP_Node*));
+    r.inl = (char*)calloc((size_t)ns + 1, 1);
+    r.left = refs;
+    r.n = ns;
+    TP_Node *out = NULL;
+    int ok = refs && r.val && r.inl && count_refs(root, refs, ns);
+
+    /* variável só referencia anteriores: de trás para frente, cada uma
+       já sabe quantas vezes é usada antes de contar as do seu corpo */
+    for (int i = t->n - 1; ok && i >= 0; i--) {
+        const TP_Symbol *s = &t->syms[i];
+        if (s->n_params < 0 && refs[s->slot] > 0) ok = count_refs(s->body, refs, ns);
+    }
+
+    for (int i = 0; ok && i < t->n; i++) {
+        const TP_Symbol *s = &t->syms[i];
+        if (s->n_params >= 0 || refs[s->slot] == 0) continue;
+        TP_Node *v = tp_ast_clone_map(s->body, resolve_leaf, &r);
+        if (!v) { ok = 0; break; }
+        r.val[s->slot] = v;
+        r.inl[s->slot] = (refs[s->slot] == 1 || is_trivial(v));
+    }
+
+    if (ok) out = tp_ast_clone_map(root, resolve_leaf, &r);
+
+    /* as que sobraram envolvem a raiz, a última definida mais por dentro */
+    for (int i = t->n - 1; out && i >= 0; i--) {
+        const TP_Symbol *s = &t->syms[i];
+        if (s->n_params >= 0 || !r.val[s->slot] || r.inl[s->slot]) continue;
+        TP_Node *l = tp_node_let(s->slot, r.val[s->slot], out);
+        if (!l) {
+            tp_ast_free(out);
+            out = NULL;
+            break;
+        }
+        r.val[s->slot] = NULL;
+        out = l;
+    }
+
+    if (r.val) {
+        for (int i = 0; i < ns; i++) tp_ast_free(r.val[i]);
+    }
+    free(r.val);
+    free(r.inl);
+    free(refs);
+    tp_ast_free(root);
+    return out;
+}
+
+TP_Node *tp_sym_finish(TP_SymTab *t, TP_Node *root) {
+    if (!root || t->n == 0) return root;
+    if (root->type != TP_NODE_TUPLE2) return finish_one(t, root);
+
+    TP_Node *a = root->as.tuple2.a, *b = root->as.tuple2.b;
+    root->as.tuple2.a = NULL;
+    root->as.tuple2.b = NULL;
+    a = a ? finish_one(t, a) : NULL;
+    b = b ? finish_one(t, b) : NULL;
+    if (!a || !b) {
+        tp_ast_free(a);
+        tp_ast_free(b);
+        tp_ast_free(root);
+        return NULL;
+    }
+    root->as.tuple2.a = a;
+    root->as.tuple2.b = b;
+    return root;
+}
@@ -0,0 +1,468 @@
+/* sockets, poll, sigaction e rename atômico não fazem parte do C99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include "tp_tile.h"
+#include "tp_screenshot.h"
+#include <errno.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* muda o desenho: muda a chave (tiles antigos em disco ficam órfãos) */
+#define TP_TILE_VERSION 1
+
+/* cliente lento: desiste da conexão */
+#define TP_TILE_IO_MS 5000
+
+/* cabeçalho do pedido */
+#define TP_TILE_REQ_MAX 4096
+
+#define TP_TILE_PENDING 0
+#define TP_TILE_READY 1
+#define TP_TILE_FAILED 2
+
+/* ---------- geometria ---------- */
+
+void tp_tile_view(const TP_View *base, int z, long long x, long long y, TP_View *out) {
+    const double k = ldexp(1.0, -z);
+    const double sx = (base->xmax - base->xmin) * k;
+    const double sy = (base->ymax - base->ymin) * k;
+    const double f = (double)(TP_TILE_SIZE - 1) / (double)TP_TILE_SIZE;
+
+    /* a última coluna fica um pixel antes do tile vizinho: sem costura */
+    out->xmin = base->xmin + (double)x * sx;
+    out->xmax = out->xmin + sx * f;
+    out->ymax = base->ymax - (double)y * sy;
+    out->ymin = out->ymax - sy * f;
+}
+
+/* ---------- render ---------- */
+
+int tp_tile_render(const TP_FrameScene *s, const TP_View *base, TP_FrameCtx *c,
+                   int z, long long x, long long y, unsigned char *bmp)
+{
+    TP_View v;
+    tp_tile_view(base, z, x, y, &v);
+    if (!isfinite(v.xmin) || !isfinite(v.xmax) || !isfinite(v.ymin) || !isfinite(v.ymax) ||
+        !(v.xmin < v.xmax) || !(v.ymin < v.ymax)) return 1;
+
+    if (tp_frame_draw(s, c, &v, TP_TILE_SIZE, TP_TILE_SIZE, NULL) != 0) return 1;
+    tp_screenshot_encode_bmp(c->pixels, TP_TILE_SIZE * (int)sizeof(Uint32),
+                             TP_TILE_SIZE, TP_TILE_SIZE, bmp);
+    return 0;
+}
+
+/* ---------- chave da cena ---------- */
+
+static void fnv64(unsigned long long *h, const void *p, size_t n) {
+    const unsigned char *b = (const unsigned char*)p;
+    for (size_t i = 0; i < n; i++) {
+        *h ^= b[i];
+        *h *= 1099511628211ull;   /* FNV-1a */
+    }
+}
+
+static void fnv64_str(unsigned long long *h, const char *s) {
+    fnv64(h, s ? s : "", s ? strlen(s) + 1 : 1);
+}
+
+static unsigned long long scene_key(const TP_FrameScene *s, const TP_View *base,
+                                     const char *expr, const char *data_path) {
+    unsigned long long h = 14695981039346656037ull;
+    const int ver = TP_TILE_VERSION;
+    fnv64(&h, &ver, sizeof(ver));
+    fnv64_str(&h, expr);
+    fnv64_str(&h, data_path);
+    if (s->data) {
+        fnv64(&h, &s->data->size, sizeof(s->data->size));
+        fnv64(&h, &s->data->mtime, sizeof(s->data->mtime));
+    }
+    if (s->params) fnv64(&h, s->params, sizeof(double) * (size_t)s->n_params);
+    fnv64(&h, base, sizeof(*base));
+    if (s->is_tuple) {
+        fnv64(&h, &s->tmin, sizeof(s->tmin));
+        fnv64(&h, &s->tmax, sizeof(s->tmax));
+    }
+    if (s->is_field) {
+        fnv64(&h, &s->zmin, sizeof(s->zmin));
+        fnv64(&h, &s->zmax, sizeof(s->zmax));
+    }
+    const unsigned char rgb[9] = { s->bg_r, s->bg_g, s->bg_b, s->fg_r, s->fg_g, s->fg_b,
+                                   s->data_r, s->data_g, s->data_b };
+    fnv64(&h, rgb, sizeof(rgb));
+    return h;
+}
+
+/* ---------- cache em disco ---------- */
+
+static void disk_path(const TP_TileServer *srv, char *buf, size_t sz,
+                      int z, long long x, long long y) {
+    snprintf(buf, sz, "%s/%016llx-%d-%lld-%lld.bmp", srv->dir, srv->key, z, x, y);
+}
+
+/* 0 se o arquivo existe e tem o tamanho de um tile */
+static int disk_load(const TP_TileServer *srv, TP_Tile *t) {
+    char path[1024];
+    disk_path(srv, path, sizeof(path), t->z, t->x, t->y);
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    const size_t n = fread(t->bmp, 1, t->size + 1, f);
+    fclose(f);
+    return (n == t->size && t->bmp[0] == 'B' && t->bmp[1] == 'M') ? 0 : -1;
+}
+
+/* temporário + rename: leitor concorrente nunca vê tile pela metade */
+static void disk_store(const TP_TileServer *srv, const TP_Tile *t) {
+    char path[1024], tmp[1100];
+    disk_path(srv, path, sizeof(path), t->z, t->x, t->y);
+    snprintf(tmp, sizeof(tmp), "%s.%lu.tmp", path, (unsigned long)SDL_ThreadID());
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return;
+    int ok = fwrite(t->bmp, 1, t->size, f) == t->size;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok || rename(tmp, path) != 0) remove(tmp);
+}
+
+/* ---------- LRU (chamadas com lock) ---------- */
+
+static unsigned long hash_tile(int z, long long x, long long y) {
+    unsigned long long h = 14695981039346656037ull;
+    fnv64(&h, &z, sizeof(z));
+    fnv64(&h, &x, sizeof(x));
+    fnv64(&h, &y, sizeof(y));
+    return (unsigned long)(h ^ (h >> 32));
+}
+
+static TP_Tile *find(TP_TileServer *srv, int z, long long x, long long y, unsigned long h) {
+    TP_Tile *t = srv->buckets[h & (unsigned long)(srv->n_buckets - 1)];
+    for (; t; t = t->chain) {
+        if (t->hash == h && t->z == z && t->x == x && t->y == y) return t;
+    }
+    return NULL;
+}
+
+static void list_unlink(TP_TileServer *srv, TP_Tile *t) {
+    if (t->prev) t->prev->next = t->next; else srv->head = t->next;
+    if (t->next) t->next->prev = t->prev; else srv->tail = t->prev;
+    t->prev = t->next = NULL;
+}
+
+static void list_push_front(TP_TileServer *srv, TP_Tile *t) {
+    t->prev = NULL;
+    t->next = srv->head;
+    if (srv->head) srv->head->prev = t; else srv->tail = t;
+    srv->head = t;
+}
+
+static void tile_unref(TP_Tile *t) {
+    if (--t->refs == 0) {
+        free(t->bmp);
+        free(t);
+    }
+}
+
+/* tira da tabela e solta a referência do cache */
+static void remove_tile(TP_TileServer *srv, TP_Tile *t) {
+    TP_Tile **pp = &srv->buckets[t->hash & (unsigned long)(srv->n_buckets - 1)];
+    while (*pp != t) pp = &(*pp)->chain;
+    *pp = t->chain;
+    list_unlink(srv, t);
+    srv->count--;
+    tile_unref(t);
+}
+
+/* despeja do fim da lista; tile em render fica (quem espera precisa dele) */
+static void evict(TP_TileServer *srv) {
+    TP_Tile *t = srv->tail;
+    while (srv->count > srv->capacity && t) {
+        TP_Tile *prev = t->prev;
+        if (t->state != TP_TILE_PENDING) remove_tile(srv, t);
+        t = prev;
+    }
+}
+
+/* ---------- API do cache ---------- */
+
+int tp_tile_server_init(TP_TileServer *srv, const TP_FrameScene *scene, const TP_View *base,
+                        const char *expr, const char *data_path, const char *dir) {
+    memset(srv, 0, sizeof(*srv));
+    srv->fd = -1;
+    srv->scene = *scene;
+    srv->base = *base;
+    srv->dir = dir;
+    srv->capacity = TP_TILE_MEM_TILES;
+    srv->n_buckets = 1024;   /* potência de 2 acima de capacity */
+    srv->buckets = (TP_Tile**)calloc((size_t)srv->n_buckets, sizeof(TP_Tile*));
+    srv->lock = SDL_CreateMutex();
+    srv->tile_ready = SDL_CreateCond();
+    if (!srv->buckets || !srv->lock || !srv->tile_ready) {
+        tp_tile_server_free(srv);
+        return -1;
+    }
+
+    /* heatmap sem --zmin/--zmax: o range da viewport inicial vale para
+       todos os tiles (auto-range por tile mudaria a cor na costura) */
+    TP_FrameScene *s = &srv->scene;
+    if (s->is_field && !s->has_zrange) {
+        TP_Heatmap hm;
+        tp_heatmap_init(&hm, 0);
+        const TP_Screen screen = { TP_TILE_SIZE, TP_TILE_SIZE };
+        if (tp_heatmap_render(&hm, s->prog_a, s->params, base, screen, 1, 0, 0.0, 0.0) == 0) {
+            s->zmin = hm.zmin;
+            s->zmax = hm.zmax;
+        }
+        tp_heatmap_free(&hm);
+        s->has_zrange = 1;
+    }
+
+    srv->key = scene_key(s, base, expr, data_path);
+    /* já existente é o caso normal; sem permissão, disk_store só falha */
+    if (dir) mkdir(dir, 0777);
+    return 0;
+}
+
+void tp_tile_server_free(TP_TileServer *srv) {
+    tp_net_pool_stop(&srv->pool);
+    if (srv->fd >= 0) close(srv->fd);
+
+    while (srv->head) remove_tile(srv, srv->head);
+    free(srv->buckets);
+    if (srv->tile_ready) SDL_DestroyCond(srv->tile_ready);
+    if (srv->lock) SDL_DestroyMutex(srv->lock);
+    memset(srv, 0, sizeof(*srv));
+    srv->fd = -1;
+}
+
+void tp_tile_release(TP_TileServer *srv, TP_Tile *t) {
+    if (!t) return;
+    SDL_LockMutex(srv->lock);
+    tile_unref(t);
+    SDL_UnlockMutex(srv->lock);
+}
+
+int tp_tile_get(TP_TileServer *srv, TP_FrameCtx *c,
+                int z, long long x, long long y, TP_Tile **out)
+{
+    const unsigned long h = hash_tile(z, x, y);
+    *out = NULL;
+
+    SDL_LockMutex(srv->lock);
+    TP_Tile *t = find(srv, z, x, y, h);
+    if (t) {
+        t->refs++;
+        list_unlink(srv, t);
+        list_push_front(srv, t);
+        if (t->state == TP_TILE_PENDING) {
+            /* mesmo tile em render noutra thread: espera aquele */
+            srv->shared++;
+            while (t->state == TP_TILE_PENDING) SDL_CondWait(srv->tile_ready, srv->lock);
+        } else {
+            srv->hits++;
+        }
+        const int ok = t->state == TP_TILE_READY;
+        if (!ok) tile_unref(t);
+        SDL_UnlockMutex(srv->lock);
+        if (!ok) return -1;
+        *out = t;
+        return 0;
+    }
+
+    /* novo: entra na tabela já em render, para os próximos esperarem */
+    t = (TP_Tile*)calloc(1, sizeof(TP_Tile));
+    if (!t) {
+        SDL_UnlockMutex(srv->lock);
+        return -1;
+    }
+    t->z = z;
+    t->x = x;
+    t->y = y;
+    t->hash = h;
+    t->state = TP_TILE_PENDING;
+    t->refs = 2;   /* cache + quem pediu */
+    TP_Tile **b = &srv->buckets[h & (unsigned long)(srv->n_buckets - 1)];
+    t->chain = *b;
+    *b = t;
+    list_push_front(srv, t);
+    srv->count++;
+    evict(srv);
+    SDL_UnlockMutex(srv->lock);
+
+    /* fora do lock: disco ou render */
+    int state = TP_TILE_FAILED, from_disk = 0;
+    t->size = tp_screenshot_bmp_size(TP_TILE_SIZE, TP_TILE_SIZE);
+    t->bmp = (unsigned char*)malloc(t->size + 1);
+    if (t->bmp) {
+        if (srv->dir && disk_load(srv, t) == 0) {
+            state = TP_TILE_READY;
+            from_disk = 1;
+        } else if (tp_tile_render(&srv->scene, &srv->base, c, z, x, y, t->bmp) == 0) {
+            state = TP_TILE_READY;
+            if (srv->dir) disk_store(srv, t);
+        }
+    }
+
+    SDL_LockMutex(srv->lock);
+    t->state = state;
+    if (from_disk) srv->disk_hits++;
+    else if (state == TP_TILE_READY) srv->renders++;
+    /* falha não fica no cache: o próximo pedido tenta de novo */
+    if (state != TP_TILE_READY) {
+        remove_tile(srv, t);
+        tile_unref(t);
+        t = NULL;
+    }
+    SDL_CondBroadcast(srv->tile_ready);
+    SDL_UnlockMutex(srv->lock);
+
+    *out = t;
+    return t ? 0 : -1;
+}
+
+/* ---------- HTTP ---------- */
+
+/* cabeçalho da resposta em head; retorna o tamanho */
+static int format_head(char *head, size_t sz, const char *status, const char *type, size_t n) {
+    return snprintf(head, sz,
+                    "HTTP/1.1 %s\r\n"
+                    "Content-Type: %s\r\n"
+                    "Content-Length: %lu\r\n"
+                    "Access-Control-Allow-Origin: *\r\n"
+                    "Connection: close\r\n\r\n",
+                    status, type, (unsigned long)n);
+}
+
+static void respond(int fd, const char *status, const char *type,
+                    const void *body, size_t n) {
+    char head[256];
+    const int k = format_head(head, sizeof(head), status, type, n);
+    if (tp_net_send_all(fd, head, (size_t)k, TP_TILE_IO_MS) == 0 && n > 0) {
+        tp_net_send_all(fd, body, n, TP_TILE_IO_MS);
+    }
+}
+
+static void respond_text(int fd, const char *status) {
+    char body[64];
+    const int k = snprintf(body, sizeof(body), "%s\n", status);
+    respond(fd, status, "text/plain", body, (size_t)k);
+}
+
+/* lê até o fim do cabeçalho; 0 se OK */
+static int read_request(int fd, char *buf, size_t sz) {
+    size_t n = 0;
+    while (n + 1 < sz) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, TP_TILE_IO_MS) <= 0) return -1;
+        const ssize_t k = recv(fd, buf + n, sz - 1 - n, 0);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return -1;
+        n += (size_t)k;
+        buf[n] = '\0';
+        if (strstr(buf, "\r\n\r\n") || strstr(buf, "\n\n")) return 0;
+    }
+    return -1;
+}
+
+/* inteiro com sinal até o separador; avança *p */
+static int parse_ll(const char **p, long long *out) {
+    errno = 0;
+    char *end = NULL;
+    const long long v = strtoll(*p, &end, 10);
+    if (errno != 0 || end == *p || (**p != '-' && (**p < '0' || **p > '9'))) return 0;
+    *out = v;
+    *p = end;
+    return 1;
+}
+
+/* "/z/x/y" ou "/z/x/y.bmp" (query ignorada). 0 se OK. */
+static int parse_path(const char *p, int *z, long long *x, long long *y) {
+    long long zz;
+    if (*p++ != '/' || !parse_ll(&p, &zz) || *p++ != '/' ||
+        !parse_ll(&p, x) || *p++ != '/' || !parse_ll(&p, y)) return -1;
+    if (strncmp(p, ".bmp", 4) == 0) p += 4;
+    if (*p != ' ' && *p != '?') return -1;
+    if (zz < 0 || zz > TP_TILE_MAX_ZOOM) return -1;
+    *z = (int)zz;
+    /* índices fora do tile 0 valem, mas dentro do que o double representa */
+    const double lim = 9007199254740992.0;   /* 2^53 */
+    if (fabs((double)*x) >= lim || fabs((double)*y) >= lim) return -1;
+    return 0;
+}
+
+static void serve_conn(TP_TileServer *srv, TP_FrameCtx *c, int fd) {
+    char req[TP_TILE_REQ_MAX];
+    if (read_request(fd, req, sizeof(req)) != 0) return;
+
+    if (strncmp(req, "GET ", 4) != 0) {
+        respond_text(fd, "405 Method Not Allowed");
+        return;
+    }
+    int z;
+    long long x, y;
+    if (parse_path(req + 4, &z, &x, &y) != 0) {
+        respond_text(fd, "404 Not Found");
+        return;
+    }
+
+    TP_Tile *t = NULL;
+    if (tp_tile_get(srv, c, z, x, y, &t) != 0) {
+        respond_text(fd, "500 Internal Server Error");
+        return;
+    }
+    respond(fd, "200 OK", "image/bmp", t->bmp, t->size);
+    tp_tile_release(srv, t);
+}
+
+static int worker_main(void *data) {
+    TP_TileServer *srv = (TP_TileServer*)data;
+    TP_FrameCtx ctx;
+    tp_frame_ctx_init(&ctx);
+
+    int fd;
+    while ((fd = tp_net_pool_next(&srv->pool)) >= 0) {
+        serve_conn(srv, &ctx, fd);
+        close(fd);
+    }
+
+    tp_frame_ctx_free(&ctx);
+    return 0;
+}
+
+int tp_tile_server_listen(TP_TileServer *srv, int port, char *err, int err_sz) {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        snprintf(err, (size_t)err_sz, "socket: %s", strerror(errno));
+        return 1;
+    }
+    const int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    /* só localhost: o visualizador roda na mesma máquina */
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+        snprintf(err, (size_t)err_sz, "porta %d: %s", port, strerror(errno));
+        close(fd);
+        return 1;
+    }
+    srv->fd = fd;
+    return tp_net_pool_start(&srv->pool, fd, TP_TILE_QUEUE, worker_main, "tp_tile", srv, err, err_sz);
+}
+
+void tp_tile_server_run(TP_TileServer *srv) {
+    /* 503 pronto: fila cheia leva um send só, no próprio accept */
+    static const char msg[] = "503 Service Unavailable\n";
+    char busy[320];
+    const int k = format_head(busy, sizeof(busy), "503 Service Unavailable", "text/plain", sizeof(msg) - 1);
+    memcpy(busy + k, msg, sizeof(msg) - 1);
+    tp_net_pool_run(&srv->pool, busy, (size_t)k + sizeof(msg) - 1);
+}
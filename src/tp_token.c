@@ -1,8 +1,12 @@
 #include "tp_token.h"
-#include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* classes ASCII sem <ctype.h>: sem locale, sem chamada por caractere */
+static int is_digit(char c) { return (unsigned char)(c - '0') < 10; }
+static int is_alpha(char c) { return (unsigned char)((c | 0x20) - 'a') < 26; }
+static int is_space(char c) { return c == ' ' || (unsigned char)(c - '\t') < 5; }
+
 static char peek(const TP_Lexer *lx) { return lx->src[lx->pos]; }
 static char peek_next(const TP_Lexer *lx) { return lx->src[lx->pos + 1]; }
 
@@ -14,31 +18,97 @@ static char advance(TP_Lexer *lx) {
 }
 
 static void lex_error(TP_Lexer *lx, const char *msg) {
+    if (lx->error) return;   /* com lookahead, vale o primeiro */
     lx->error = msg;
     lx->error_pos = lx->pos;
     lx->error_col = lx->col;
 }
 
 static void skip_ws(TP_Lexer *lx) {
-    while (isspace((unsigned char)peek(lx))) advance(lx);
+    while (is_space(peek(lx))) advance(lx);
 }
 
-static TP_Token make_tok(TP_TokType t, const char *lex, size_t len, size_t pos, size_t col) {
-    TP_Token tok;
-    tok.type = t;
-    tok.lexeme = lex;
-    tok.len = len;
-    tok.pos = pos;
-    tok.col = col;
-    tok.number = 0.0;
-    return tok;
+static void set_tok(TP_Token *tok, TP_TokType t, const char *lex, size_t len, size_t pos, size_t col) {
+    tok->type = t;
+    tok->cmd = TP_CMD_NONE;
+    tok->lexeme = lex;
+    tok->len = len;
+    tok->pos = pos;
+    tok->col = col;
+    tok->number = 0.0;
 }
 
 static int is_ident_start(char c) {
-    return isalpha((unsigned char)c) || c == '_';
+    return is_alpha(c) || c == '_';
 }
 static int is_ident_char(char c) {
-    return isalnum((unsigned char)c) || c == '_';
+    return is_alpha(c) || is_digit(c) || c == '_';
+}
+
+/* Literal decimal sem expoente. Até 15 dígitos a mantissa inteira e
+   10^k (k <= 22) são exatos em double, então uma divisão dá o valor
+   corretamente arredondado; o resto cai no strtod. */
+static double parse_number(const char *s, size_t len) {
+    static const double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    double mant = 0.0;
+    int digits = 0, frac = -1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '.') { frac = 0; continue; }
+        if (digits == 0 && s[i] == '0' && frac < 0) continue;   /* zeros à esquerda */
+        mant = mant * 10.0 + (double)(s[i] - '0');
+        digits++;
+        if (frac >= 0) frac++;
+    }
+    if (frac < 0) frac = 0;
+    if (digits <= 15 && frac <= 22) return mant / pow10[frac];
+
+    char buf[128];
+    memcpy(buf, s, len);
+    buf[len] = '\0';
+    return strtod(buf, NULL);
+}
+
+/* nome do comando -> id: switch por tamanho e 1a letra, 1 memcmp */
+static TP_Command command_id(const char *s, size_t len) {
+    switch (len) {
+        case 1:
+            return (s[0] == ';' || s[0] == ',' || s[0] == ':' || s[0] == '!')
+                   ? TP_CMD_SPACE : TP_CMD_UNKNOWN;
+        case 3:
+            switch (s[0]) {
+                case 's': return memcmp(s, "sin", 3) == 0 ? TP_CMD_SIN : TP_CMD_UNKNOWN;
+                case 'c': return memcmp(s, "cos", 3) == 0 ? TP_CMD_COS : TP_CMD_UNKNOWN;
+                case 't': return memcmp(s, "tan", 3) == 0 ? TP_CMD_TAN : TP_CMD_UNKNOWN;
+                case 'l': return memcmp(s, "log", 3) == 0 ? TP_CMD_LOG : TP_CMD_UNKNOWN;
+                case 'e': return memcmp(s, "exp", 3) == 0 ? TP_CMD_EXP : TP_CMD_UNKNOWN;
+                default:  return TP_CMD_UNKNOWN;
+            }
+        case 4:
+            switch (s[0]) {
+                case 's': return memcmp(s, "sqrt", 4) == 0 ? TP_CMD_SQRT : TP_CMD_UNKNOWN;
+                case 'f': return memcmp(s, "frac", 4) == 0 ? TP_CMD_FRAC : TP_CMD_UNKNOWN;
+                case 'l': return memcmp(s, "left", 4) == 0 ? TP_CMD_LEFT : TP_CMD_UNKNOWN;
+                case 'q': return memcmp(s, "quad", 4) == 0 ? TP_CMD_QUAD : TP_CMD_UNKNOWN;
+                default:  return TP_CMD_UNKNOWN;
+            }
+        case 5:
+            switch (s[0]) {
+                case 'r': return memcmp(s, "right", 5) == 0 ? TP_CMD_RIGHT : TP_CMD_UNKNOWN;
+                case 'q': return memcmp(s, "qquad", 5) == 0 ? TP_CMD_QQUAD : TP_CMD_UNKNOWN;
+                default:  return TP_CMD_UNKNOWN;
+            }
+        default:
+            return TP_CMD_UNKNOWN;
+    }
+}
+
+int tp_cmd_is_noop(TP_Command c) {
+    return c == TP_CMD_LEFT || c == TP_CMD_RIGHT ||
+           c == TP_CMD_QUAD || c == TP_CMD_QQUAD || c == TP_CMD_SPACE;
 }
 
 int tp_tok_is_primary_start(TP_TokType t) {
@@ -49,20 +119,8 @@ int tp_tok_is_primary_start(TP_TokType t) {
             t == TP_TOK_LBRACE);
 }
 
-void tp_lex_init(TP_Lexer *lx, const char *src) {
-    lx->src = src ? src : "";
-    lx->pos = 0;
-    lx->col = 1;
-
-    lx->error = NULL;
-    lx->error_pos = 0;
-    lx->error_col = 1;
-
-    lx->current = make_tok(TP_TOK_EOF, lx->src, 0, 0, 1);
-    tp_lex_next(lx);
-}
-
-void tp_lex_next(TP_Lexer *lx) {
+/* lê o próximo token da entrada direto no slot do ring */
+static void scan(TP_Lexer *lx, TP_Token *tok) {
     skip_ws(lx);
 
     const size_t tok_pos = lx->pos;
@@ -71,23 +129,25 @@ void tp_lex_next(TP_Lexer *lx) {
     char c = peek(lx);
 
     if (c == '\0') {
-        lx->current = make_tok(TP_TOK_EOF, start, 0, tok_pos, tok_col);
+        set_tok(tok, TP_TOK_EOF, start, 0, tok_pos, tok_col);
         return;
     }
 
     switch (c) {
-        case '+': advance(lx); lx->current = make_tok(TP_TOK_PLUS,  start, 1, tok_pos, tok_col); return;
-        case '-': advance(lx); lx->current = make_tok(TP_TOK_MINUS, start, 1, tok_pos, tok_col); return;
-        case '*': advance(lx); lx->current = make_tok(TP_TOK_STAR,  start, 1, tok_pos, tok_col); return;
-        case '/': advance(lx); lx->current = make_tok(TP_TOK_SLASH, start, 1, tok_pos, tok_col); return;
-        case '^': advance(lx); lx->current = make_tok(TP_TOK_CARET, start, 1, tok_pos, tok_col); return;
-
-        case ',': advance(lx); lx->current = make_tok(TP_TOK_COMMA, start, 1, tok_pos, tok_col); return;
-
-        case '(': advance(lx); lx->current = make_tok(TP_TOK_LPAREN,start, 1, tok_pos, tok_col); return;
-        case ')': advance(lx); lx->current = make_tok(TP_TOK_RPAREN,start, 1, tok_pos, tok_col); return;
-        case '{': advance(lx); lx->current = make_tok(TP_TOK_LBRACE,start, 1, tok_pos, tok_col); return;
-        case '}': advance(lx); lx->current = make_tok(TP_TOK_RBRACE,start, 1, tok_pos, tok_col); return;
+        case '+': advance(lx); set_tok(tok, TP_TOK_PLUS,  start, 1, tok_pos, tok_col); return;
+        case '-': advance(lx); set_tok(tok, TP_TOK_MINUS, start, 1, tok_pos, tok_col); return;
+        case '*': advance(lx); set_tok(tok, TP_TOK_STAR,  start, 1, tok_pos, tok_col); return;
+        case '/': advance(lx); set_tok(tok, TP_TOK_SLASH, start, 1, tok_pos, tok_col); return;
+        case '^': advance(lx); set_tok(tok, TP_TOK_CARET, start, 1, tok_pos, tok_col); return;
+
+        case ',': advance(lx); set_tok(tok, TP_TOK_COMMA, start, 1, tok_pos, tok_col); return;
+        case ';': advance(lx); set_tok(tok, TP_TOK_SEMI,  start, 1, tok_pos, tok_col); return;
+        case '=': advance(lx); set_tok(tok, TP_TOK_EQUALS,start, 1, tok_pos, tok_col); return;
+
+        case '(': advance(lx); set_tok(tok, TP_TOK_LPAREN,start, 1, tok_pos, tok_col); return;
+        case ')': advance(lx); set_tok(tok, TP_TOK_RPAREN,start, 1, tok_pos, tok_col); return;
+        case '{': advance(lx); set_tok(tok, TP_TOK_LBRACE,start, 1, tok_pos, tok_col); return;
+        case '}': advance(lx); set_tok(tok, TP_TOK_RBRACE,start, 1, tok_pos, tok_col); return;
         default: break;
     }
 
@@ -102,7 +162,8 @@ void tp_lex_next(TP_Lexer *lx) {
             const size_t cmd_pos = lx->pos;
             const size_t cmd_col = lx->col;
             advance(lx); /* consume that single char */
-            lx->current = make_tok(TP_TOK_COMMAND, cmd_start, 1, cmd_pos, cmd_col);
+            set_tok(tok, TP_TOK_COMMAND, cmd_start, 1, cmd_pos, cmd_col);
+            tok->cmd = TP_CMD_SPACE;
             return;
         }
 
@@ -112,45 +173,83 @@ void tp_lex_next(TP_Lexer *lx) {
 
         if (!is_ident_start(peek(lx))) {
             lex_error(lx, "comando '\\' deve ser seguido de letras (ex: \\sin)");
-            lx->current = make_tok(TP_TOK_INVALID, start, 1, tok_pos, tok_col);
+            set_tok(tok, TP_TOK_INVALID, start, 1, tok_pos, tok_col);
             return;
         }
         while (is_ident_char(peek(lx))) advance(lx);
         size_t len = (size_t)((lx->src + lx->pos) - cmd_start);
-        lx->current = make_tok(TP_TOK_COMMAND, cmd_start, len, cmd_pos, cmd_col);
+        set_tok(tok, TP_TOK_COMMAND, cmd_start, len, cmd_pos, cmd_col);
+        tok->cmd = command_id(cmd_start, len);
         return;
     }
 
-    if (isdigit((unsigned char)c) || (c == '.' && isdigit((unsigned char)peek_next(lx)))) {
-        while (isdigit((unsigned char)peek(lx))) advance(lx);
+    if (is_digit(c) || (c == '.' && is_digit(peek_next(lx)))) {
+        while (is_digit(peek(lx))) advance(lx);
         if (peek(lx) == '.') {
             advance(lx);
-            while (isdigit((unsigned char)peek(lx))) advance(lx);
+            while (is_digit(peek(lx))) advance(lx);
         }
         size_t len = (size_t)((lx->src + lx->pos) - start);
 
-        char buf[128];
-        if (len >= sizeof(buf)) {
+        if (len >= 128) {
             lex_error(lx, "numero muito grande");
-            lx->current = make_tok(TP_TOK_INVALID, start, len, tok_pos, tok_col);
+            set_tok(tok, TP_TOK_INVALID, start, len, tok_pos, tok_col);
             return;
         }
-        memcpy(buf, start, len);
-        buf[len] = '\0';
 
-        TP_Token tok = make_tok(TP_TOK_NUMBER, start, len, tok_pos, tok_col);
-        tok.number = strtod(buf, NULL);
-        lx->current = tok;
+        set_tok(tok, TP_TOK_NUMBER, start, len, tok_pos, tok_col);
+        tok->number = parse_number(start, len);
         return;
     }
 
     if (is_ident_start(c)) {
         while (is_ident_char(peek(lx))) advance(lx);
         size_t len = (size_t)((lx->src + lx->pos) - start);
-        lx->current = make_tok(TP_TOK_IDENT, start, len, tok_pos, tok_col);
+        set_tok(tok, TP_TOK_IDENT, start, len, tok_pos, tok_col);
         return;
     }
 
     lex_error(lx, "caractere invalido na expressao");
-    lx->current = make_tok(TP_TOK_INVALID, start, 1, tok_pos, tok_col);
+    set_tok(tok, TP_TOK_INVALID, start, 1, tok_pos, tok_col);
+}
+
+#define RING_MASK (TP_LEX_LOOKAHEAD - 1)
+
+void tp_lex_init(TP_Lexer *lx, const char *src) {
+    lx->src = src ? src : "";
+    lx->pos = 0;
+    lx->col = 1;
+
+    lx->error = NULL;
+    lx->error_pos = 0;
+    lx->error_col = 1;
+
+    lx->head = 0;
+    lx->avail = 1;
+    scan(lx, &lx->ring[0]);
+    lx->current = &lx->ring[0];
+}
+
+const TP_Token *tp_lex_peek(TP_Lexer *lx, unsigned int k) {
+    if (k > RING_MASK) k = RING_MASK;
+    while (lx->avail <= k) {
+        const TP_Token *last = &lx->ring[(lx->head + lx->avail - 1) & RING_MASK];
+        TP_Token *slot = &lx->ring[(lx->head + lx->avail) & RING_MASK];
+        /* EOF/INVALID se repetem sem reler a entrada */
+        if (last->type == TP_TOK_EOF || last->type == TP_TOK_INVALID) *slot = *last;
+        else scan(lx, slot);
+        lx->avail++;
+    }
+    return &lx->ring[(lx->head + k) & RING_MASK];
+}
+
+void tp_lex_next(TP_Lexer *lx) {
+    if (lx->avail > 1) {
+        lx->head = (lx->head + 1) & RING_MASK;
+        lx->avail--;
+    } else if (lx->current->type != TP_TOK_EOF && lx->current->type != TP_TOK_INVALID) {
+        lx->head = (lx->head + 1) & RING_MASK;
+        scan(lx, &lx->ring[lx->head]);
+    }
+    lx->current = &lx->ring[lx->head];
 }
@@ -0,0 +1,287 @@
+#include "tp_vector.h"
+#include "tp_cli.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------- escrita bufferizada ---------- */
+
+static void flush_buf(TP_Vec *v) {
+    if (v->len > 0 && fwrite(v->buf, 1, v->len, v->f) != v->len) v->failed = 1;
+    v->off += (long long)v->len;
+    v->len = 0;
+}
+
+static void put(TP_Vec *v, const char *s, size_t n) {
+    if (v->len + n > sizeof(v->buf)) flush_buf(v);
+    if (n > sizeof(v->buf)) {
+        if (fwrite(s, 1, n, v->f) != n) v->failed = 1;
+        v->off += (long long)n;
+        return;
+    }
+    memcpy(v->buf + v->len, s, n);
+    v->len += n;
+}
+
+static void puts_(TP_Vec *v, const char *s) { put(v, s, strlen(s)); }
+
+static void putf(TP_Vec *v, const char *fmt, ...) {
+    char tmp[256];
+    va_list ap;
+    va_start(ap, fmt);
+    const int k = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+    va_end(ap);
+    if (k > 0) put(v, tmp, (size_t)k < sizeof(tmp) ? (size_t)k : sizeof(tmp) - 1);
+}
+
+/* centésimos de pixel, sem zeros à direita: printf("%g") é o gargalo
+   em curvas densas */
+static void put_num(TP_Vec *v, double x) {
+    char tmp[32];
+    char *p = tmp + sizeof(tmp);
+    long long q = isfinite(x) ? llround(x * 100.0) : 0;
+    const int neg = q < 0;
+    if (neg) q = -q;
+
+    int frac = (int)(q % 100);
+    q /= 100;
+    if (frac) {
+        if (frac % 10 == 0) {
+            *--p = (char)('0' + frac / 10);
+        } else {
+            *--p = (char)('0' + frac % 10);
+            *--p = (char)('0' + frac / 10);
+        }
+        *--p = '.';
+    }
+    do {
+        *--p = (char)('0' + (int)(q % 10));
+        q /= 10;
+    } while (q);
+    if (neg) *--p = '-';
+    put(v, p, (size_t)(tmp + sizeof(tmp) - p));
+}
+
+static void put_xy(TP_Vec *v, double x, double y) {
+    put_num(v, x);
+    put(v, " ", 1);
+    put_num(v, y);
+}
+
+/* ---------- RDP ---------- */
+
+/* distância de p ao segmento a-b (a == b: até a) */
+static double seg_dist(const double *a, const double *b, const double *p) {
+    const double dx = b[0] - a[0], dy = b[1] - a[1];
+    const double l2 = dx * dx + dy * dy;
+    double t = l2 > 0.0 ? ((p[0] - a[0]) * dx + (p[1] - a[1]) * dy) / l2 : 0.0;
+    if (t < 0.0) t = 0.0;
+    if (t > 1.0) t = 1.0;
+    return hypot(p[0] - (a[0] + t * dx), p[1] - (a[1] + t * dy));
+}
+
+int tp_vec_simplify(double *pt, int n, double tol, unsigned char *keep, int *stack) {
+    if (n <= 2) return n;
+    memset(keep, 0, (size_t)n);
+    keep[0] = keep[n - 1] = 1;
+
+    /* pilha explícita de intervalos [a, b]: sem recursão em curvas longas */
+    int sp = 0;
+    stack[sp++] = 0;
+    stack[sp++] = n - 1;
+    while (sp > 0) {
+        const int b = stack[--sp], a = stack[--sp];
+        double best = -1.0;
+        int at = -1;
+        for (int i = a + 1; i < b; i++) {
+            const double d = seg_dist(pt + 2 * a, pt + 2 * b, pt + 2 * i);
+            if (d > best) { best = d; at = i; }
+        }
+        if (at < 0 || best <= tol) continue;
+        keep[at] = 1;
+        stack[sp++] = a;
+        stack[sp++] = at;
+        stack[sp++] = at;
+        stack[sp++] = b;
+    }
+
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        if (!keep[i]) continue;
+        pt[2 * m] = pt[2 * i];
+        pt[2 * m + 1] = pt[2 * i + 1];
+        m++;
+    }
+    return m;
+}
+
+/* ---------- polilinhas ---------- */
+
+/* garante espaço para mais um ponto */
+static int grow(TP_Vec *v) {
+    if (v->n < v->cap) return 0;
+    const int cap = v->cap ? v->cap * 2 : 1024;
+    double *pt = (double*)realloc(v->pt, sizeof(double) * 2 * (size_t)cap);
+    if (!pt) return -1;
+    v->pt = pt;
+    unsigned char *keep = (unsigned char*)realloc(v->keep, (size_t)cap);
+    if (!keep) return -1;
+    v->keep = keep;
+    /* pior caso do RDP: dois índices por ponto */
+    int *stack = (int*)realloc(v->stack, sizeof(int) * 2 * (size_t)cap);
+    if (!stack) return -1;
+    v->stack = stack;
+    v->cap = cap;
+    return 0;
+}
+
+static void emit(TP_Vec *v) {
+    if (v->n == 0) return;
+    const int n = tp_vec_simplify(v->pt, v->n, v->tol, v->keep, v->stack);
+    v->n = 0;
+
+    if (v->fmt == TP_VEC_SVG) {
+        puts_(v, "<path d=\"M");
+        put_xy(v, v->pt[0], v->pt[1]);
+        if (n == 1) {
+            puts_(v, "h0");
+        } else {
+            puts_(v, "L");
+            for (int i = 1; i < n; i++) {
+                if (i > 1) put(v, " ", 1);
+                put_xy(v, v->pt[2 * i], v->pt[2 * i + 1]);
+            }
+        }
+        puts_(v, "\"/>\n");
+    } else {
+        put_xy(v, v->pt[0], v->pt[1]);
+        puts_(v, " m\n");
+        for (int i = n == 1 ? 0 : 1; i < n; i++) {
+            put_xy(v, v->pt[2 * i], v->pt[2 * i + 1]);
+            puts_(v, " l\n");
+        }
+        puts_(v, "S\n");
+    }
+}
+
+static void add(TP_Vec *v, double x, double y) {
+    if (grow(v) != 0) {
+        /* sem memória: grava o que tem e recomeça do ponto */
+        emit(v);
+        if (v->cap == 0) { v->failed = 1; return; }
+    }
+    v->pt[2 * v->n] = x;
+    v->pt[2 * v->n + 1] = y;
+    v->n++;
+}
+
+void tp_vec_color(TP_Vec *v, unsigned char r, unsigned char g, unsigned char b) {
+    if (v->has_color && r == v->r && g == v->g && b == v->b) return;
+    emit(v);
+    if (v->fmt == TP_VEC_SVG) {
+        if (v->has_color) puts_(v, "</g>\n");
+        putf(v, "<g stroke=\"#%02x%02x%02x\">\n", r, g, b);
+    } else {
+        putf(v, "%.4g %.4g %.4g RG\n", r / 255.0, g / 255.0, b / 255.0);
+    }
+    v->r = r;
+    v->g = g;
+    v->b = b;
+    v->has_color = 1;
+}
+
+void tp_vec_line(TP_Vec *v, double x0, double y0, double x1, double y1) {
+    /* continua a polilinha aberta se começa onde ela parou */
+    if (!(v->n > 0 && v->pt[2 * v->n - 2] == x0 && v->pt[2 * v->n - 1] == y0)) {
+        emit(v);
+        add(v, x0, y0);
+    }
+    add(v, x1, y1);
+}
+
+void tp_vec_point(TP_Vec *v, double x, double y) {
+    emit(v);
+    add(v, x, y);
+    emit(v);
+}
+
+/* ---------- arquivo ---------- */
+
+int tp_vec_format_for(const char *path) {
+    if (tp_path_has_ext(path, ".svg")) return TP_VEC_SVG;
+    if (tp_path_has_ext(path, ".pdf")) return TP_VEC_PDF;
+    return -1;
+}
+
+int tp_vec_open(TP_Vec *v, const char *path, TP_VecFormat fmt, int w, int h,
+                unsigned char bg_r, unsigned char bg_g, unsigned char bg_b,
+                double tol, char *err, int err_sz)
+{
+    memset(v, 0, sizeof(*v));
+    v->fmt = fmt;
+    v->w = w;
+    v->h = h;
+    v->tol = tol;
+    v->f = fopen(path, "wb");
+    if (!v->f) {
+        snprintf(err, (size_t)err_sz, "nao consegui criar %s", path);
+        return 1;
+    }
+
+    if (fmt == TP_VEC_SVG) {
+        putf(v, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\" "
+                "viewBox=\"0 0 %d %d\">\n", w, h, w, h);
+        putf(v, "<rect width=\"100%%\" height=\"100%%\" fill=\"#%02x%02x%02x\"/>\n", bg_r, bg_g, bg_b);
+        puts_(v, "<g fill=\"none\" stroke-width=\"1\" stroke-linecap=\"round\" stroke-linejoin=\"round\">\n");
+        return 0;
+    }
+
+    /* PDF de uma página; o comprimento do conteúdo vai num objeto
+       indireto escrito depois, para o stream sair sem voltar no arquivo */
+    puts_(v, "%PDF-1.4\n");
+    v->obj_off[1] = v->off + (long long)v->len;
+    puts_(v, "1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+    v->obj_off[2] = v->off + (long long)v->len;
+    puts_(v, "2 0 obj\n<< /Type /Pages /Kids [3 0 R] /Count 1 >>\nendobj\n");
+    v->obj_off[3] = v->off + (long long)v->len;
+    putf(v, "3 0 obj\n<< /Type /Page /Parent 2 0 R /MediaBox [0 0 %d %d] "
+            "/Contents 4 0 R /Resources << >> >>\nendobj\n", w, h);
+    v->obj_off[4] = v->off + (long long)v->len;
+    puts_(v, "4 0 obj\n<< /Length 5 0 R >>\nstream\n");
+    v->stream_start = v->off + (long long)v->len;
+
+    /* Y para baixo como na tela */
+    putf(v, "1 0 0 -1 0 %d cm\n", h);
+    putf(v, "%.4g %.4g %.4g rg 0 0 %d %d re f\n", bg_r / 255.0, bg_g / 255.0, bg_b / 255.0, w, h);
+    puts_(v, "1 w 1 J 1 j\n");
+    return 0;
+}
+
+int tp_vec_close(TP_Vec *v) {
+    if (!v->f) return 1;
+    emit(v);
+
+    if (v->fmt == TP_VEC_SVG) {
+        if (v->has_color) puts_(v, "</g>\n");
+        puts_(v, "</g>\n</svg>\n");
+    } else {
+        const long long len = v->off + (long long)v->len - v->stream_start;
+        puts_(v, "endstream\nendobj\n");
+        v->obj_off[5] = v->off + (long long)v->len;
+        putf(v, "5 0 obj\n%lld\nendobj\n", len);
+        const long long xref = v->off + (long long)v->len;
+        puts_(v, "xref\n0 6\n0000000000 65535 f \n");
+        for (int i = 1; i <= 5; i++) putf(v, "%010lld 00000 n \n", v->obj_off[i]);
+        putf(v, "trailer\n<< /Size 6 /Root 1 0 R >>\nstartxref\n%lld\n%%%%EOF\n", xref);
+    }
+
+    flush_buf(v);
+    int rc = v->failed;
+    if (fclose(v->f) != 0) rc = 1;
+    free(v->pt);
+    free(v->keep);
+    free(v->stack);
+    memset(v, 0, sizeof(*v));
+    return rc;
+}
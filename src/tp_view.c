@@ -1,4 +1,6 @@
 #include "tp_view.h"
+#include <float.h>
+#include <math.h>
 
 void tp_view_pan(TP_View *v, double dx, double dy) {
     v->xmin += dx; v->xmax += dx;
@@ -40,3 +42,60 @@ void tp_view_zoom_at(TP_View *v, double factor, double anchor_x, double anchor_y
     v->ymin = anchor_y - ay * new_ry;
     v->ymax = v->ymin + new_ry;
 }
+
+/* ---------- precisão estendida ---------- */
+
+/* pixels com menos que isso de ulps de double entram no modo double-double */
+#define TP_DD_MIN_ULPS_PER_PIXEL 64.0
+
+void tp_view_dd_from(TP_ViewDD *d, const TP_View *v) {
+    d->xmin = tp_dd(v->xmin);
+    d->ymin = tp_dd(v->ymin);
+    d->xspan = v->xmax - v->xmin;
+    d->yspan = v->ymax - v->ymin;
+}
+
+void tp_view_dd_to(const TP_ViewDD *d, TP_View *v) {
+    v->xmin = tp_dd_to_double(d->xmin);
+    v->xmax = tp_dd_to_double(tp_dd_add_d(d->xmin, d->xspan));
+    v->ymin = tp_dd_to_double(d->ymin);
+    v->ymax = tp_dd_to_double(tp_dd_add_d(d->ymin, d->yspan));
+}
+
+void tp_view_dd_pan(TP_ViewDD *d, double dx, double dy) {
+    d->xmin = tp_dd_add_d(d->xmin, dx);
+    d->ymin = tp_dd_add_d(d->ymin, dy);
+}
+
+void tp_view_dd_zoom(TP_ViewDD *d, double factor) {
+    TP_DD cx = tp_dd_add_d(d->xmin, d->xspan * 0.5);
+    TP_DD cy = tp_dd_add_d(d->ymin, d->yspan * 0.5);
+    tp_view_dd_zoom_at(d, factor, cx, cy);
+}
+
+void tp_view_dd_zoom_at(TP_ViewDD *d, double factor, TP_DD anchor_x, TP_DD anchor_y) {
+    if (factor <= 0.0) return;
+    if (d->xspan <= 0.0 || d->yspan <= 0.0) return;
+
+    /* offset do anchor cabe em double (está dentro da viewport) */
+    const double ox = tp_dd_to_double(tp_dd_sub(anchor_x, d->xmin));
+    const double oy = tp_dd_to_double(tp_dd_sub(anchor_y, d->ymin));
+
+    d->xmin = tp_dd_add_d(anchor_x, -ox * factor);
+    d->ymin = tp_dd_add_d(anchor_y, -oy * factor);
+    d->xspan *= factor;
+    d->yspan *= factor;
+}
+
+static int axis_needs_dd(TP_DD min, double span, int pixels) {
+    if (pixels < 2) pixels = 2;
+    const double a = fabs(min.hi);
+    const double b = fabs(min.hi + span);
+    const double mag = (a > b) ? a : b;
+    const double pixel = span / (double)(pixels - 1);
+    return pixel < mag * DBL_EPSILON * TP_DD_MIN_ULPS_PER_PIXEL;
+}
+
+int tp_view_dd_needed(const TP_ViewDD *d, int w, int h) {
+    return axis_needs_dd(d->xmin, d->xspan, w) || axis_needs_dd(d->ymin, d->yspan, h);
+}